@@ -0,0 +1,179 @@
+# CMAKE generated file: DO NOT EDIT!
+# Generated by "Unix Makefiles" Generator, CMake Version 3.25
+
+# The generator used is:
+set(CMAKE_DEPENDS_GENERATOR "Unix Makefiles")
+
+# The top level Makefile was generated from the following files:
+set(CMAKE_MAKEFILE_DEPENDS
+  "CMakeCache.txt"
+  "/root/repo/.git/HEAD"
+  "/root/repo/.git/refs/heads/master"
+  "/root/repo/CMakeLists.txt"
+  "CMakeFiles/3.25.1/CMakeCCompiler.cmake"
+  "CMakeFiles/3.25.1/CMakeCXXCompiler.cmake"
+  "CMakeFiles/3.25.1/CMakeSystem.cmake"
+  "CMakeFiles/git-data/grabRef.cmake"
+  "/root/repo/cmake/macros/GetGitRevisionDescription.cmake"
+  "/root/repo/cmake/macros/GetGitRevisionDescription.cmake.in"
+  "/root/repo/cmake/macros/require_out_of_src_build.cmake"
+  "/root/repo/doc/Doxyfile.cmake"
+  "/root/repo/doc/libipaca.png"
+  "/root/repo/include/ipaca/config.hpp.cmake"
+  "/root/repo/src/CMakeLists.txt"
+  "/root/repo/test/CMakeLists.txt"
+  "/usr/lib/x86_64-linux-gnu/cmake/Boost-1.74.0/BoostConfig.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/Boost-1.74.0/BoostConfigVersion.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/BoostDetectToolset-1.74.0.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_atomic-1.74.0/boost_atomic-config-version.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_atomic-1.74.0/boost_atomic-config.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_atomic-1.74.0/libboost_atomic-variant-shared.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_atomic-1.74.0/libboost_atomic-variant-static.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_chrono-1.74.0/boost_chrono-config-version.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_chrono-1.74.0/boost_chrono-config.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_chrono-1.74.0/libboost_chrono-variant-shared.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_chrono-1.74.0/libboost_chrono-variant-static.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_headers-1.74.0/boost_headers-config-version.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_headers-1.74.0/boost_headers-config.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_system-1.74.0/boost_system-config-version.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_system-1.74.0/boost_system-config.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_system-1.74.0/libboost_system-variant-shared.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_system-1.74.0/libboost_system-variant-static.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_thread-1.74.0/boost_thread-config-version.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_thread-1.74.0/boost_thread-config.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_thread-1.74.0/libboost_thread-variant-shared.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_thread-1.74.0/libboost_thread-variant-static.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeCInformation.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeCXXInformation.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeCommonLanguageInclude.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeFindDependencyMacro.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeGenericSystem.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeInitializeConfigs.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeLanguageInformation.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeSystemSpecificInformation.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeSystemSpecificInitialize.cmake"
+  "/usr/share/cmake-3.25/Modules/CPack.cmake"
+  "/usr/share/cmake-3.25/Modules/CPackComponent.cmake"
+  "/usr/share/cmake-3.25/Modules/CTest.cmake"
+  "/usr/share/cmake-3.25/Modules/CTestTargets.cmake"
+  "/usr/share/cmake-3.25/Modules/CTestUseLaunchers.cmake"
+  "/usr/share/cmake-3.25/Modules/CheckCSourceCompiles.cmake"
+  "/usr/share/cmake-3.25/Modules/CheckIncludeFile.cmake"
+  "/usr/share/cmake-3.25/Modules/CheckLibraryExists.cmake"
+  "/usr/share/cmake-3.25/Modules/Compiler/CMakeCommonCompilerMacros.cmake"
+  "/usr/share/cmake-3.25/Modules/Compiler/GNU-C.cmake"
+  "/usr/share/cmake-3.25/Modules/Compiler/GNU-CXX.cmake"
+  "/usr/share/cmake-3.25/Modules/Compiler/GNU.cmake"
+  "/usr/share/cmake-3.25/Modules/DartConfiguration.tcl.in"
+  "/usr/share/cmake-3.25/Modules/FindBoost.cmake"
+  "/usr/share/cmake-3.25/Modules/FindDoxygen.cmake"
+  "/usr/share/cmake-3.25/Modules/FindPackageHandleStandardArgs.cmake"
+  "/usr/share/cmake-3.25/Modules/FindPackageMessage.cmake"
+  "/usr/share/cmake-3.25/Modules/FindThreads.cmake"
+  "/usr/share/cmake-3.25/Modules/Internal/CheckSourceCompiles.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/Linux-GNU-C.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/Linux-GNU-CXX.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/Linux-GNU.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/Linux.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/UnixPaths.cmake"
+  "/usr/share/cmake-3.25/Templates/CPackConfig.cmake.in"
+  )
+
+# The corresponding makefile is:
+set(CMAKE_MAKEFILE_OUTPUTS
+  "Makefile"
+  "CMakeFiles/cmake.check_cache"
+  )
+
+# Byproducts of CMake generate step:
+set(CMAKE_MAKEFILE_PRODUCTS
+  "CMakeFiles/git-data/HEAD"
+  "CMakeFiles/git-data/grabRef.cmake"
+  "CMakeFiles/git-data/head-ref"
+  "include/ipaca/config.hpp"
+  "DartConfiguration.tcl"
+  "doc/Doxyfile"
+  "doc/libipaca.png"
+  "CPackConfig.cmake"
+  "CPackSourceConfig.cmake"
+  "CMakeFiles/CMakeDirectoryInformation.cmake"
+  "test/CMakeFiles/CMakeDirectoryInformation.cmake"
+  "src/CMakeFiles/CMakeDirectoryInformation.cmake"
+  )
+
+# Dependency information for all targets:
+set(CMAKE_DEPEND_INFO_FILES
+  "CMakeFiles/Experimental.dir/DependInfo.cmake"
+  "CMakeFiles/Nightly.dir/DependInfo.cmake"
+  "CMakeFiles/Continuous.dir/DependInfo.cmake"
+  "CMakeFiles/NightlyMemoryCheck.dir/DependInfo.cmake"
+  "CMakeFiles/NightlyStart.dir/DependInfo.cmake"
+  "CMakeFiles/NightlyUpdate.dir/DependInfo.cmake"
+  "CMakeFiles/NightlyConfigure.dir/DependInfo.cmake"
+  "CMakeFiles/NightlyBuild.dir/DependInfo.cmake"
+  "CMakeFiles/NightlyTest.dir/DependInfo.cmake"
+  "CMakeFiles/NightlyCoverage.dir/DependInfo.cmake"
+  "CMakeFiles/NightlyMemCheck.dir/DependInfo.cmake"
+  "CMakeFiles/NightlySubmit.dir/DependInfo.cmake"
+  "CMakeFiles/ExperimentalStart.dir/DependInfo.cmake"
+  "CMakeFiles/ExperimentalUpdate.dir/DependInfo.cmake"
+  "CMakeFiles/ExperimentalConfigure.dir/DependInfo.cmake"
+  "CMakeFiles/ExperimentalBuild.dir/DependInfo.cmake"
+  "CMakeFiles/ExperimentalTest.dir/DependInfo.cmake"
+  "CMakeFiles/ExperimentalCoverage.dir/DependInfo.cmake"
+  "CMakeFiles/ExperimentalMemCheck.dir/DependInfo.cmake"
+  "CMakeFiles/ExperimentalSubmit.dir/DependInfo.cmake"
+  "CMakeFiles/ContinuousStart.dir/DependInfo.cmake"
+  "CMakeFiles/ContinuousUpdate.dir/DependInfo.cmake"
+  "CMakeFiles/ContinuousConfigure.dir/DependInfo.cmake"
+  "CMakeFiles/ContinuousBuild.dir/DependInfo.cmake"
+  "CMakeFiles/ContinuousTest.dir/DependInfo.cmake"
+  "CMakeFiles/ContinuousCoverage.dir/DependInfo.cmake"
+  "CMakeFiles/ContinuousMemCheck.dir/DependInfo.cmake"
+  "CMakeFiles/ContinuousSubmit.dir/DependInfo.cmake"
+  "CMakeFiles/doc.dir/DependInfo.cmake"
+  "test/CMakeFiles/test_asynccalculation.dir/DependInfo.cmake"
+  "test/CMakeFiles/unit_asynccalculation.dir/DependInfo.cmake"
+  "test/CMakeFiles/test_powertable.dir/DependInfo.cmake"
+  "test/CMakeFiles/unit_powertable.dir/DependInfo.cmake"
+  "test/CMakeFiles/test_memoryresource.dir/DependInfo.cmake"
+  "test/CMakeFiles/unit_memoryresource.dir/DependInfo.cmake"
+  "test/CMakeFiles/test_compactmercury.dir/DependInfo.cmake"
+  "test/CMakeFiles/unit_compactmercury.dir/DependInfo.cmake"
+  "test/CMakeFiles/test_capi.dir/DependInfo.cmake"
+  "test/CMakeFiles/unit_capi.dir/DependInfo.cmake"
+  "test/CMakeFiles/test_patternindex.dir/DependInfo.cmake"
+  "test/CMakeFiles/unit_patternindex.dir/DependInfo.cmake"
+  "test/CMakeFiles/test_patternscorer.dir/DependInfo.cmake"
+  "test/CMakeFiles/unit_patternscorer.dir/DependInfo.cmake"
+  "test/CMakeFiles/test_finestructure.dir/DependInfo.cmake"
+  "test/CMakeFiles/unit_finestructure.dir/DependInfo.cmake"
+  "test/CMakeFiles/test_binnedconvolution.dir/DependInfo.cmake"
+  "test/CMakeFiles/unit_binnedconvolution.dir/DependInfo.cmake"
+  "test/CMakeFiles/test_profilerenderer.dir/DependInfo.cmake"
+  "test/CMakeFiles/unit_profilerenderer.dir/DependInfo.cmake"
+  "test/CMakeFiles/test_masscalculator.dir/DependInfo.cmake"
+  "test/CMakeFiles/unit_masscalculator.dir/DependInfo.cmake"
+  "test/CMakeFiles/test_momentapproximation.dir/DependInfo.cmake"
+  "test/CMakeFiles/unit_momentapproximation.dir/DependInfo.cmake"
+  "test/CMakeFiles/test_convolutionkernels.dir/DependInfo.cmake"
+  "test/CMakeFiles/unit_convolutionkernels.dir/DependInfo.cmake"
+  "test/CMakeFiles/test_convolutionplan.dir/DependInfo.cmake"
+  "test/CMakeFiles/unit_convolutionplan.dir/DependInfo.cmake"
+  "test/CMakeFiles/test_elementpattern.dir/DependInfo.cmake"
+  "test/CMakeFiles/unit_elementpattern.dir/DependInfo.cmake"
+  "test/CMakeFiles/test_prunepolicy.dir/DependInfo.cmake"
+  "test/CMakeFiles/unit_prunepolicy.dir/DependInfo.cmake"
+  "test/CMakeFiles/test_mercury7.dir/DependInfo.cmake"
+  "test/CMakeFiles/unit_mercury7.dir/DependInfo.cmake"
+  "test/CMakeFiles/test_mercury7impl.dir/DependInfo.cmake"
+  "test/CMakeFiles/unit_mercury7impl.dir/DependInfo.cmake"
+  "test/CMakeFiles/test_stoichiometry.dir/DependInfo.cmake"
+  "test/CMakeFiles/unit_stoichiometry.dir/DependInfo.cmake"
+  "test/CMakeFiles/test_patternservice.dir/DependInfo.cmake"
+  "test/CMakeFiles/unit_patternservice.dir/DependInfo.cmake"
+  "test/CMakeFiles/test_sharedpatterncache.dir/DependInfo.cmake"
+  "test/CMakeFiles/unit_sharedpatterncache.dir/DependInfo.cmake"
+  "src/CMakeFiles/ipaca.dir/DependInfo.cmake"
+  "src/CMakeFiles/ipacad.dir/DependInfo.cmake"
+  )
@@ -0,0 +1,42 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/src/BinnedConvolution.cpp" "src/CMakeFiles/ipaca.dir/BinnedConvolution.cpp.o" "gcc" "src/CMakeFiles/ipaca.dir/BinnedConvolution.cpp.o.d"
+  "/root/repo/src/CApi.cpp" "src/CMakeFiles/ipaca.dir/CApi.cpp.o" "gcc" "src/CMakeFiles/ipaca.dir/CApi.cpp.o.d"
+  "/root/repo/src/CompactMercury.cpp" "src/CMakeFiles/ipaca.dir/CompactMercury.cpp.o" "gcc" "src/CMakeFiles/ipaca.dir/CompactMercury.cpp.o.d"
+  "/root/repo/src/ConvolutionKernels.cpp" "src/CMakeFiles/ipaca.dir/ConvolutionKernels.cpp.o" "gcc" "src/CMakeFiles/ipaca.dir/ConvolutionKernels.cpp.o.d"
+  "/root/repo/src/ConvolutionPlan.cpp" "src/CMakeFiles/ipaca.dir/ConvolutionPlan.cpp.o" "gcc" "src/CMakeFiles/ipaca.dir/ConvolutionPlan.cpp.o.d"
+  "/root/repo/src/ElementPattern.cpp" "src/CMakeFiles/ipaca.dir/ElementPattern.cpp.o" "gcc" "src/CMakeFiles/ipaca.dir/ElementPattern.cpp.o.d"
+  "/root/repo/src/Executor.cpp" "src/CMakeFiles/ipaca.dir/Executor.cpp.o" "gcc" "src/CMakeFiles/ipaca.dir/Executor.cpp.o.d"
+  "/root/repo/src/FineStructure.cpp" "src/CMakeFiles/ipaca.dir/FineStructure.cpp.o" "gcc" "src/CMakeFiles/ipaca.dir/FineStructure.cpp.o.d"
+  "/root/repo/src/MassCalculator.cpp" "src/CMakeFiles/ipaca.dir/MassCalculator.cpp.o" "gcc" "src/CMakeFiles/ipaca.dir/MassCalculator.cpp.o.d"
+  "/root/repo/src/MassIndex.cpp" "src/CMakeFiles/ipaca.dir/MassIndex.cpp.o" "gcc" "src/CMakeFiles/ipaca.dir/MassIndex.cpp.o.d"
+  "/root/repo/src/MemoryResource.cpp" "src/CMakeFiles/ipaca.dir/MemoryResource.cpp.o" "gcc" "src/CMakeFiles/ipaca.dir/MemoryResource.cpp.o.d"
+  "/root/repo/src/Mercury7Impl.cpp" "src/CMakeFiles/ipaca.dir/Mercury7Impl.cpp.o" "gcc" "src/CMakeFiles/ipaca.dir/Mercury7Impl.cpp.o.d"
+  "/root/repo/src/MomentApproximation.cpp" "src/CMakeFiles/ipaca.dir/MomentApproximation.cpp.o" "gcc" "src/CMakeFiles/ipaca.dir/MomentApproximation.cpp.o.d"
+  "/root/repo/src/PatternCache.cpp" "src/CMakeFiles/ipaca.dir/PatternCache.cpp.o" "gcc" "src/CMakeFiles/ipaca.dir/PatternCache.cpp.o.d"
+  "/root/repo/src/PatternClient.cpp" "src/CMakeFiles/ipaca.dir/PatternClient.cpp.o" "gcc" "src/CMakeFiles/ipaca.dir/PatternClient.cpp.o.d"
+  "/root/repo/src/PatternScorer.cpp" "src/CMakeFiles/ipaca.dir/PatternScorer.cpp.o" "gcc" "src/CMakeFiles/ipaca.dir/PatternScorer.cpp.o.d"
+  "/root/repo/src/PatternService.cpp" "src/CMakeFiles/ipaca.dir/PatternService.cpp.o" "gcc" "src/CMakeFiles/ipaca.dir/PatternService.cpp.o.d"
+  "/root/repo/src/PowerTable.cpp" "src/CMakeFiles/ipaca.dir/PowerTable.cpp.o" "gcc" "src/CMakeFiles/ipaca.dir/PowerTable.cpp.o.d"
+  "/root/repo/src/ProfileRenderer.cpp" "src/CMakeFiles/ipaca.dir/ProfileRenderer.cpp.o" "gcc" "src/CMakeFiles/ipaca.dir/ProfileRenderer.cpp.o.d"
+  "/root/repo/src/PrunePolicy.cpp" "src/CMakeFiles/ipaca.dir/PrunePolicy.cpp.o" "gcc" "src/CMakeFiles/ipaca.dir/PrunePolicy.cpp.o.d"
+  "/root/repo/src/SharedPatternCache.cpp" "src/CMakeFiles/ipaca.dir/SharedPatternCache.cpp.o" "gcc" "src/CMakeFiles/ipaca.dir/SharedPatternCache.cpp.o.d"
+  "/root/repo/src/Spectrum.cpp" "src/CMakeFiles/ipaca.dir/Spectrum.cpp.o" "gcc" "src/CMakeFiles/ipaca.dir/Spectrum.cpp.o.d"
+  "/root/repo/src/Stoichiometry.cpp" "src/CMakeFiles/ipaca.dir/Stoichiometry.cpp.o" "gcc" "src/CMakeFiles/ipaca.dir/Stoichiometry.cpp.o.d"
+  "/root/repo/src/Traits.cpp" "src/CMakeFiles/ipaca.dir/Traits.cpp.o" "gcc" "src/CMakeFiles/ipaca.dir/Traits.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
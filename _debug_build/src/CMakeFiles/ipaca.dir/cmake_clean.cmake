@@ -0,0 +1,57 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/ipaca.dir/BinnedConvolution.cpp.o"
+  "CMakeFiles/ipaca.dir/BinnedConvolution.cpp.o.d"
+  "CMakeFiles/ipaca.dir/CApi.cpp.o"
+  "CMakeFiles/ipaca.dir/CApi.cpp.o.d"
+  "CMakeFiles/ipaca.dir/CompactMercury.cpp.o"
+  "CMakeFiles/ipaca.dir/CompactMercury.cpp.o.d"
+  "CMakeFiles/ipaca.dir/ConvolutionKernels.cpp.o"
+  "CMakeFiles/ipaca.dir/ConvolutionKernels.cpp.o.d"
+  "CMakeFiles/ipaca.dir/ConvolutionPlan.cpp.o"
+  "CMakeFiles/ipaca.dir/ConvolutionPlan.cpp.o.d"
+  "CMakeFiles/ipaca.dir/ElementPattern.cpp.o"
+  "CMakeFiles/ipaca.dir/ElementPattern.cpp.o.d"
+  "CMakeFiles/ipaca.dir/Executor.cpp.o"
+  "CMakeFiles/ipaca.dir/Executor.cpp.o.d"
+  "CMakeFiles/ipaca.dir/FineStructure.cpp.o"
+  "CMakeFiles/ipaca.dir/FineStructure.cpp.o.d"
+  "CMakeFiles/ipaca.dir/MassCalculator.cpp.o"
+  "CMakeFiles/ipaca.dir/MassCalculator.cpp.o.d"
+  "CMakeFiles/ipaca.dir/MassIndex.cpp.o"
+  "CMakeFiles/ipaca.dir/MassIndex.cpp.o.d"
+  "CMakeFiles/ipaca.dir/MemoryResource.cpp.o"
+  "CMakeFiles/ipaca.dir/MemoryResource.cpp.o.d"
+  "CMakeFiles/ipaca.dir/Mercury7Impl.cpp.o"
+  "CMakeFiles/ipaca.dir/Mercury7Impl.cpp.o.d"
+  "CMakeFiles/ipaca.dir/MomentApproximation.cpp.o"
+  "CMakeFiles/ipaca.dir/MomentApproximation.cpp.o.d"
+  "CMakeFiles/ipaca.dir/PatternCache.cpp.o"
+  "CMakeFiles/ipaca.dir/PatternCache.cpp.o.d"
+  "CMakeFiles/ipaca.dir/PatternClient.cpp.o"
+  "CMakeFiles/ipaca.dir/PatternClient.cpp.o.d"
+  "CMakeFiles/ipaca.dir/PatternScorer.cpp.o"
+  "CMakeFiles/ipaca.dir/PatternScorer.cpp.o.d"
+  "CMakeFiles/ipaca.dir/PatternService.cpp.o"
+  "CMakeFiles/ipaca.dir/PatternService.cpp.o.d"
+  "CMakeFiles/ipaca.dir/PowerTable.cpp.o"
+  "CMakeFiles/ipaca.dir/PowerTable.cpp.o.d"
+  "CMakeFiles/ipaca.dir/ProfileRenderer.cpp.o"
+  "CMakeFiles/ipaca.dir/ProfileRenderer.cpp.o.d"
+  "CMakeFiles/ipaca.dir/PrunePolicy.cpp.o"
+  "CMakeFiles/ipaca.dir/PrunePolicy.cpp.o.d"
+  "CMakeFiles/ipaca.dir/SharedPatternCache.cpp.o"
+  "CMakeFiles/ipaca.dir/SharedPatternCache.cpp.o.d"
+  "CMakeFiles/ipaca.dir/Spectrum.cpp.o"
+  "CMakeFiles/ipaca.dir/Spectrum.cpp.o.d"
+  "CMakeFiles/ipaca.dir/Stoichiometry.cpp.o"
+  "CMakeFiles/ipaca.dir/Stoichiometry.cpp.o.d"
+  "CMakeFiles/ipaca.dir/Traits.cpp.o"
+  "CMakeFiles/ipaca.dir/Traits.cpp.o.d"
+  "libipaca.a"
+  "libipaca.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/ipaca.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
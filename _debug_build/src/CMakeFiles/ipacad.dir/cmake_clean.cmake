@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/ipacad.dir/ipacad.cpp.o"
+  "CMakeFiles/ipacad.dir/ipacad.cpp.o.d"
+  "ipacad"
+  "ipacad.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/ipacad.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_asynccalculation.dir/AsyncCalculation-test.cpp.o"
+  "CMakeFiles/test_asynccalculation.dir/AsyncCalculation-test.cpp.o.d"
+  "test_asynccalculation"
+  "test_asynccalculation.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/test_asynccalculation.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_binnedconvolution.dir/BinnedConvolution-test.cpp.o"
+  "CMakeFiles/test_binnedconvolution.dir/BinnedConvolution-test.cpp.o.d"
+  "test_binnedconvolution"
+  "test_binnedconvolution.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/test_binnedconvolution.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_compactmercury.dir/CompactMercury-test.cpp.o"
+  "CMakeFiles/test_compactmercury.dir/CompactMercury-test.cpp.o.d"
+  "test_compactmercury"
+  "test_compactmercury.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/test_compactmercury.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_convolutionkernels.dir/ConvolutionKernels-test.cpp.o"
+  "CMakeFiles/test_convolutionkernels.dir/ConvolutionKernels-test.cpp.o.d"
+  "test_convolutionkernels"
+  "test_convolutionkernels.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/test_convolutionkernels.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
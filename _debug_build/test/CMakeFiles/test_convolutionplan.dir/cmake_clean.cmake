@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_convolutionplan.dir/ConvolutionPlan-test.cpp.o"
+  "CMakeFiles/test_convolutionplan.dir/ConvolutionPlan-test.cpp.o.d"
+  "test_convolutionplan"
+  "test_convolutionplan.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/test_convolutionplan.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_elementpattern.dir/ElementPattern-test.cpp.o"
+  "CMakeFiles/test_elementpattern.dir/ElementPattern-test.cpp.o.d"
+  "test_elementpattern"
+  "test_elementpattern.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/test_elementpattern.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
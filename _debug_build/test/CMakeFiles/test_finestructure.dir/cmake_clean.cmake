@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_finestructure.dir/FineStructure-test.cpp.o"
+  "CMakeFiles/test_finestructure.dir/FineStructure-test.cpp.o.d"
+  "test_finestructure"
+  "test_finestructure.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/test_finestructure.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_masscalculator.dir/MassCalculator-test.cpp.o"
+  "CMakeFiles/test_masscalculator.dir/MassCalculator-test.cpp.o.d"
+  "test_masscalculator"
+  "test_masscalculator.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/test_masscalculator.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_memoryresource.dir/MemoryResource-test.cpp.o"
+  "CMakeFiles/test_memoryresource.dir/MemoryResource-test.cpp.o.d"
+  "test_memoryresource"
+  "test_memoryresource.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/test_memoryresource.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
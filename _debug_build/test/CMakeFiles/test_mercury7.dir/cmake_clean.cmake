@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_mercury7.dir/Mercury7-test.cpp.o"
+  "CMakeFiles/test_mercury7.dir/Mercury7-test.cpp.o.d"
+  "test_mercury7"
+  "test_mercury7.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/test_mercury7.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
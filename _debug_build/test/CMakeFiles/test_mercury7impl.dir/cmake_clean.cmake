@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_mercury7impl.dir/Mercury7Impl-test.cpp.o"
+  "CMakeFiles/test_mercury7impl.dir/Mercury7Impl-test.cpp.o.d"
+  "test_mercury7impl"
+  "test_mercury7impl.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/test_mercury7impl.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
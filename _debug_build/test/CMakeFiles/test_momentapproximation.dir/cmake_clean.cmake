@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_momentapproximation.dir/MomentApproximation-test.cpp.o"
+  "CMakeFiles/test_momentapproximation.dir/MomentApproximation-test.cpp.o.d"
+  "test_momentapproximation"
+  "test_momentapproximation.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/test_momentapproximation.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
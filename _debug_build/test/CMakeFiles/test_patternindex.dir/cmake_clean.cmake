@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_patternindex.dir/PatternIndex-test.cpp.o"
+  "CMakeFiles/test_patternindex.dir/PatternIndex-test.cpp.o.d"
+  "test_patternindex"
+  "test_patternindex.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/test_patternindex.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_patternscorer.dir/PatternScorer-test.cpp.o"
+  "CMakeFiles/test_patternscorer.dir/PatternScorer-test.cpp.o.d"
+  "test_patternscorer"
+  "test_patternscorer.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/test_patternscorer.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
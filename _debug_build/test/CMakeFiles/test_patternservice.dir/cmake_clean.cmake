@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_patternservice.dir/PatternService-test.cpp.o"
+  "CMakeFiles/test_patternservice.dir/PatternService-test.cpp.o.d"
+  "test_patternservice"
+  "test_patternservice.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/test_patternservice.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
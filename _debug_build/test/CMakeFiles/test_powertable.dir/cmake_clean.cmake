@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_powertable.dir/PowerTable-test.cpp.o"
+  "CMakeFiles/test_powertable.dir/PowerTable-test.cpp.o.d"
+  "test_powertable"
+  "test_powertable.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/test_powertable.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_profilerenderer.dir/ProfileRenderer-test.cpp.o"
+  "CMakeFiles/test_profilerenderer.dir/ProfileRenderer-test.cpp.o.d"
+  "test_profilerenderer"
+  "test_profilerenderer.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/test_profilerenderer.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
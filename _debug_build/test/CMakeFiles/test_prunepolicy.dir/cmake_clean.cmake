@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_prunepolicy.dir/PrunePolicy-test.cpp.o"
+  "CMakeFiles/test_prunepolicy.dir/PrunePolicy-test.cpp.o.d"
+  "test_prunepolicy"
+  "test_prunepolicy.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/test_prunepolicy.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_sharedpatterncache.dir/SharedPatternCache-test.cpp.o"
+  "CMakeFiles/test_sharedpatterncache.dir/SharedPatternCache-test.cpp.o.d"
+  "test_sharedpatterncache"
+  "test_sharedpatterncache.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/test_sharedpatterncache.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
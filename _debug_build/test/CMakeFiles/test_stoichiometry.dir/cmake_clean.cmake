@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_stoichiometry.dir/Stoichiometry-test.cpp.o"
+  "CMakeFiles/test_stoichiometry.dir/Stoichiometry-test.cpp.o.d"
+  "test_stoichiometry"
+  "test_stoichiometry.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/test_stoichiometry.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,8 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/unit_asynccalculation"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang )
+  include(CMakeFiles/unit_asynccalculation.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
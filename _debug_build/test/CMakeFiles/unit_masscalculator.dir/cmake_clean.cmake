@@ -0,0 +1,8 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/unit_masscalculator"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang )
+  include(CMakeFiles/unit_masscalculator.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,8 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/unit_mercury7"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang )
+  include(CMakeFiles/unit_mercury7.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,8 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/unit_sharedpatterncache"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang )
+  include(CMakeFiles/unit_sharedpatterncache.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,48 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo/test
+# Build directory: /root/repo/_debug_build/test
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+add_test(AsyncCalculation "test_asynccalculation")
+set_tests_properties(AsyncCalculation PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;29;ADD_TEST;/root/repo/test/CMakeLists.txt;77;ADD_LIBIPACA_TEST;/root/repo/test/CMakeLists.txt;0;")
+add_test(PowerTable "test_powertable")
+set_tests_properties(PowerTable PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;29;ADD_TEST;/root/repo/test/CMakeLists.txt;78;ADD_LIBIPACA_TEST;/root/repo/test/CMakeLists.txt;0;")
+add_test(MemoryResource "test_memoryresource")
+set_tests_properties(MemoryResource PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;29;ADD_TEST;/root/repo/test/CMakeLists.txt;79;ADD_LIBIPACA_TEST;/root/repo/test/CMakeLists.txt;0;")
+add_test(CompactMercury "test_compactmercury")
+set_tests_properties(CompactMercury PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;29;ADD_TEST;/root/repo/test/CMakeLists.txt;80;ADD_LIBIPACA_TEST;/root/repo/test/CMakeLists.txt;0;")
+add_test(CApi "test_capi")
+set_tests_properties(CApi PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;29;ADD_TEST;/root/repo/test/CMakeLists.txt;81;ADD_LIBIPACA_TEST;/root/repo/test/CMakeLists.txt;0;")
+add_test(PatternIndex "test_patternindex")
+set_tests_properties(PatternIndex PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;29;ADD_TEST;/root/repo/test/CMakeLists.txt;82;ADD_LIBIPACA_TEST;/root/repo/test/CMakeLists.txt;0;")
+add_test(PatternScorer "test_patternscorer")
+set_tests_properties(PatternScorer PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;29;ADD_TEST;/root/repo/test/CMakeLists.txt;83;ADD_LIBIPACA_TEST;/root/repo/test/CMakeLists.txt;0;")
+add_test(FineStructure "test_finestructure")
+set_tests_properties(FineStructure PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;29;ADD_TEST;/root/repo/test/CMakeLists.txt;84;ADD_LIBIPACA_TEST;/root/repo/test/CMakeLists.txt;0;")
+add_test(BinnedConvolution "test_binnedconvolution")
+set_tests_properties(BinnedConvolution PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;29;ADD_TEST;/root/repo/test/CMakeLists.txt;85;ADD_LIBIPACA_TEST;/root/repo/test/CMakeLists.txt;0;")
+add_test(ProfileRenderer "test_profilerenderer")
+set_tests_properties(ProfileRenderer PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;29;ADD_TEST;/root/repo/test/CMakeLists.txt;86;ADD_LIBIPACA_TEST;/root/repo/test/CMakeLists.txt;0;")
+add_test(MassCalculator "test_masscalculator")
+set_tests_properties(MassCalculator PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;29;ADD_TEST;/root/repo/test/CMakeLists.txt;87;ADD_LIBIPACA_TEST;/root/repo/test/CMakeLists.txt;0;")
+add_test(MomentApproximation "test_momentapproximation")
+set_tests_properties(MomentApproximation PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;29;ADD_TEST;/root/repo/test/CMakeLists.txt;88;ADD_LIBIPACA_TEST;/root/repo/test/CMakeLists.txt;0;")
+add_test(ConvolutionKernels "test_convolutionkernels")
+set_tests_properties(ConvolutionKernels PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;29;ADD_TEST;/root/repo/test/CMakeLists.txt;89;ADD_LIBIPACA_TEST;/root/repo/test/CMakeLists.txt;0;")
+add_test(ConvolutionPlan "test_convolutionplan")
+set_tests_properties(ConvolutionPlan PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;29;ADD_TEST;/root/repo/test/CMakeLists.txt;90;ADD_LIBIPACA_TEST;/root/repo/test/CMakeLists.txt;0;")
+add_test(ElementPattern "test_elementpattern")
+set_tests_properties(ElementPattern PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;29;ADD_TEST;/root/repo/test/CMakeLists.txt;91;ADD_LIBIPACA_TEST;/root/repo/test/CMakeLists.txt;0;")
+add_test(PrunePolicy "test_prunepolicy")
+set_tests_properties(PrunePolicy PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;29;ADD_TEST;/root/repo/test/CMakeLists.txt;92;ADD_LIBIPACA_TEST;/root/repo/test/CMakeLists.txt;0;")
+add_test(Mercury7 "test_mercury7")
+set_tests_properties(Mercury7 PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;29;ADD_TEST;/root/repo/test/CMakeLists.txt;93;ADD_LIBIPACA_TEST;/root/repo/test/CMakeLists.txt;0;")
+add_test(Mercury7Impl "test_mercury7impl")
+set_tests_properties(Mercury7Impl PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;29;ADD_TEST;/root/repo/test/CMakeLists.txt;94;ADD_LIBIPACA_TEST;/root/repo/test/CMakeLists.txt;0;")
+add_test(Stoichiometry "test_stoichiometry")
+set_tests_properties(Stoichiometry PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;29;ADD_TEST;/root/repo/test/CMakeLists.txt;95;ADD_LIBIPACA_TEST;/root/repo/test/CMakeLists.txt;0;")
+add_test(PatternService "test_patternservice")
+set_tests_properties(PatternService PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;29;ADD_TEST;/root/repo/test/CMakeLists.txt;97;ADD_LIBIPACA_TEST;/root/repo/test/CMakeLists.txt;0;")
+add_test(SharedPatternCache "test_sharedpatterncache")
+set_tests_properties(SharedPatternCache PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;29;ADD_TEST;/root/repo/test/CMakeLists.txt;100;ADD_LIBIPACA_TEST;/root/repo/test/CMakeLists.txt;0;")
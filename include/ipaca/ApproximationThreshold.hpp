@@ -0,0 +1,95 @@
+/*
+ * ApproximationThreshold.hpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+
+#ifndef __LIBIPACA_INCLUDE_IPACA_APPROXIMATIONTHRESHOLD_HPP__
+#define __LIBIPACA_INCLUDE_IPACA_APPROXIMATIONTHRESHOLD_HPP__
+
+#include <ipaca/config.hpp>
+#include <ipaca/Error.hpp>
+#include <ipaca/Types.hpp>
+
+namespace ipaca {
+
+/** Specifies when the exact calculation is replaced by the moment-based
+ * approximation (see \c detail::approximateSpectrum()).
+ *
+ * For very large compounds (polymers, protein complexes of several
+ * hundred kDa), the isotope distribution is close to normal and the
+ * exact pruned convolution becomes expensive.
+ *
+ * \li \c NEVER: always calculate the exact distribution.
+ * \li \c MASS: approximate compounds whose average mass exceeds the
+ *     threshold.
+ * \li \c PEAK_COUNT: approximate compounds whose distribution is
+ *     expected to have more peaks above the pruning limit than the
+ *     threshold.
+ */
+class ApproximationThreshold
+{
+public:
+    enum Type
+    {
+        NEVER, MASS, PEAK_COUNT
+    };
+
+    /** Default constructor; never approximates.
+     */
+    ApproximationThreshold() :
+        type_(NEVER), value_(0.0)
+    {
+    }
+
+    /** @return A threshold that never approximates.
+     */
+    static ApproximationThreshold never()
+    {
+        return ApproximationThreshold();
+    }
+
+    /** @param mass The average mass above which to approximate.
+     * @return A mass threshold.
+     */
+    static ApproximationThreshold aboveMass(const Double mass)
+    {
+        ipaca_precondition(mass >= 0.0,
+            "ApproximationThreshold::aboveMass: mass must be non-negative.");
+        return ApproximationThreshold(MASS, mass);
+    }
+
+    /** @param n The expected number of peaks above which to approximate.
+     * @return A peak count threshold.
+     */
+    static ApproximationThreshold abovePeakCount(const Size n)
+    {
+        return ApproximationThreshold(PEAK_COUNT, static_cast<Double>(n));
+    }
+
+    Type getType() const
+    {
+        return type_;
+    }
+
+    /** @return The threshold value (zero for \c NEVER).
+     */
+    Double getValue() const
+    {
+        return value_;
+    }
+
+private:
+    ApproximationThreshold(const Type type, const Double value) :
+        type_(type), value_(value)
+    {
+    }
+
+    Type type_;
+    Double value_;
+};
+
+} // namespace ipaca
+
+#endif /* __LIBIPACA_INCLUDE_IPACA_APPROXIMATIONTHRESHOLD_HPP__ */
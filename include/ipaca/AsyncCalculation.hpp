@@ -0,0 +1,196 @@
+/*
+ * AsyncCalculation.hpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+
+#ifndef __LIBIPACA_INCLUDE_IPACA_ASYNCCALCULATION_HPP__
+#define __LIBIPACA_INCLUDE_IPACA_ASYNCCALCULATION_HPP__
+
+#include <ipaca/config.hpp>
+#include <ipaca/Error.hpp>
+#include <ipaca/Executor.hpp>
+#include <ipaca/Types.hpp>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/future.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace ipaca {
+
+/** The state of an asynchronous calculation.
+ */
+enum AsyncStatus
+{
+    ASYNC_QUEUED, ASYNC_RUNNING, ASYNC_DONE, ASYNC_CANCELLED
+};
+
+namespace detail {
+
+/** The state shared by an \c AsyncCalculation and the work item that has
+ * been handed to the executor.
+ */
+template<typename T>
+class AsyncState : private boost::noncopyable
+{
+public:
+    typedef boost::function<T ()> Work;
+    typedef boost::function<void (const boost::shared_future<T>&)> Callback;
+
+    AsyncState(const Work& work, const Callback& callback) :
+        work_(work), callback_(callback), future_(promise_.get_future()),
+        status_(ASYNC_QUEUED)
+    {
+    }
+
+    /** Run the work unless it has been cancelled; called by the executor.
+     */
+    void run()
+    {
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            if (status_ != ASYNC_QUEUED) {
+                return;
+            }
+            status_ = ASYNC_RUNNING;
+        }
+        try {
+            T result = work_();
+            setStatus(ASYNC_DONE);
+            promise_.set_value(result);
+        } catch (...) {
+            setStatus(ASYNC_DONE);
+            promise_.set_exception(boost::current_exception());
+        }
+        finish();
+    }
+
+    /** @return True if the work had not started and has been cancelled.
+     */
+    Bool cancel()
+    {
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            if (status_ != ASYNC_QUEUED) {
+                return false;
+            }
+            status_ = ASYNC_CANCELLED;
+        }
+        promise_.set_exception(boost::copy_exception(CancelledError(
+            "AsyncCalculation: the calculation has been cancelled.")));
+        finish();
+        return true;
+    }
+
+    AsyncStatus getStatus() const
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        return status_;
+    }
+
+    const boost::shared_future<T>& getFuture() const
+    {
+        return future_;
+    }
+
+private:
+    void setStatus(const AsyncStatus status)
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        status_ = status;
+    }
+
+    /** Release the inputs and report the result.
+     */
+    void finish()
+    {
+        work_ = Work();
+        if (callback_) {
+            callback_(future_);
+            callback_ = Callback();
+        }
+    }
+
+    Work work_;
+    Callback callback_;
+    boost::promise<T> promise_;
+    boost::shared_future<T> future_;
+    AsyncStatus status_;
+    mutable boost::mutex mutex_;
+};
+
+} // namespace detail
+
+/** A handle to a calculation that has been submitted to an \c Executor
+ * (see \c Mercury7::submit()). Copies refer to the same calculation.
+ *
+ * The result is available through a future, and through a callback that
+ * is passed at submission and invoked with the future once it is ready.
+ * The callback runs on the thread that finishes the calculation, i.e. on
+ * a thread of the executor, or on the thread that calls \c cancel().
+ */
+template<typename T>
+class AsyncCalculation
+{
+public:
+    typedef typename detail::AsyncState<T>::Work Work;
+    typedef typename detail::AsyncState<T>::Callback Callback;
+
+    /** Submit work to an executor.
+     * @param executor The executor; must outlive the calculation.
+     * @param work The calculation.
+     * @param callback If set, invoked with the future once it is ready.
+     */
+    static AsyncCalculation submit(Executor& executor, const Work& work,
+        const Callback& callback = Callback())
+    {
+        AsyncCalculation calculation;
+        calculation.state_.reset(new detail::AsyncState<T>(work, callback));
+        executor.execute(boost::bind(&detail::AsyncState<T>::run,
+            calculation.state_));
+        return calculation;
+    }
+
+    /** Cancel the calculation if it has not started yet. The executor
+     * still dequeues it, but it does not run; its future reports a
+     * \c CancelledError.
+     * @return True if the calculation has been cancelled.
+     */
+    Bool cancel()
+    {
+        return state_->cancel();
+    }
+
+    /** @return The state of the calculation.
+     */
+    AsyncStatus getStatus() const
+    {
+        return state_->getStatus();
+    }
+
+    /** @return The future of the result.
+     */
+    const boost::shared_future<T>& getFuture() const
+    {
+        return state_->getFuture();
+    }
+
+    /** Wait for the result.
+     * @return The result.
+     * @throws CancelledError The calculation has been cancelled.
+     */
+    T get() const
+    {
+        return state_->getFuture().get();
+    }
+
+private:
+    boost::shared_ptr<detail::AsyncState<T> > state_;
+};
+
+} // namespace ipaca
+
+#endif /* __LIBIPACA_INCLUDE_IPACA_ASYNCCALCULATION_HPP__ */
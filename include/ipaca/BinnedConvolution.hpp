@@ -0,0 +1,52 @@
+/*
+ * BinnedConvolution.hpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+
+#ifndef __LIBIPACA_INCLUDE_IPACA_BINNEDCONVOLUTION_HPP__
+#define __LIBIPACA_INCLUDE_IPACA_BINNEDCONVOLUTION_HPP__
+
+#include <ipaca/config.hpp>
+#include <ipaca/Spectrum.hpp>
+#include <ipaca/Types.hpp>
+
+namespace ipaca {
+
+namespace detail {
+
+/*
+ * In the mass-binned mode, isotope distributions are sparse lists of
+ * peaks in order of increasing mass rather than one peak per nominal
+ * isotope index. Peaks are accumulated in hash bins of half the peak
+ * width (FWHM = mz / resolution, i.e. bins of constant width in log(mz))
+ * and neighbouring bins whose centroids are closer than the peak width
+ * are merged. Hence the number of peaks of any intermediate result is
+ * bounded by the mass range times the resolution, independent of the
+ * number of isotope configurations.
+ */
+
+/** Merge the peaks of a spectrum that cannot be resolved at a given
+ * resolution. Peaks with zero abundance are discarded.
+ * @param spectrum The peaks, in any order; receives the merged peaks in
+ *                 order of increasing mass.
+ * @param resolution The resolution; positive.
+ */
+void mergePeaks(Spectrum& spectrum, const Double resolution);
+
+/** Convolve two sparse isotope distributions and merge the peaks of the
+ * result that cannot be resolved at a given resolution.
+ * @param s1 Spectrum on the left hand side of the convolution.
+ * @param s2 Spectrum on the right hand side of the convolution.
+ * @param resolution The resolution; positive.
+ * @param result Receives the merged peaks in order of increasing mass.
+ */
+void binnedConvolve(const Spectrum& s1, const Spectrum& s2,
+    const Double resolution, Spectrum& result);
+
+} // namespace detail
+
+} // namespace ipaca
+
+#endif /* __LIBIPACA_INCLUDE_IPACA_BINNEDCONVOLUTION_HPP__ */
@@ -0,0 +1,130 @@
+/*
+ * CApi.h
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+
+#ifndef __LIBIPACA_INCLUDE_IPACA_CAPI_H__
+#define __LIBIPACA_INCLUDE_IPACA_CAPI_H__
+
+#include <stddef.h>
+
+/*
+ * A flat C interface for calculating the isotope distributions of many
+ * compounds in one call, e.g. from Python (ctypes/cffi) or Rust.
+ *
+ * The element table is registered once per calculator. A batch of
+ * compounds is then passed in compressed sparse row (CSR) form: the
+ * composition of compound k consists of the element ids
+ * elements[offsets[k] .. offsets[k + 1]) with the (possibly fractional)
+ * counts at the same positions. All peaks are written back to back into
+ * caller-provided m/z and abundance arrays, and peakOffsets[k] ..
+ * peakOffsets[k + 1] delimit the peaks of compound k. No function of
+ * this interface throws; errors are reported as status codes.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Status codes.
+ */
+enum
+{
+    IPACA_OK = 0,
+    /** An argument is invalid, e.g. an unknown element id. */
+    IPACA_ERROR_ARGUMENT = 1,
+    /** The peak arrays are full; see \c ipaca_calculate(). */
+    IPACA_ERROR_CAPACITY = 2,
+    /** The calculation failed. */
+    IPACA_ERROR_INTERNAL = 3
+};
+
+/** The type of particle that carries the charge.
+ */
+enum
+{
+    IPACA_ELECTRON = 0, IPACA_PROTON = 1
+};
+
+/** The part of the isotope distribution to calculate (see
+ * \c ipaca::OutputMode).
+ */
+enum
+{
+    IPACA_ALL = 0, IPACA_FIRST_N = 1, IPACA_TOP_K = 2
+};
+
+/** An opaque calculator: an element table and calculation settings.
+ */
+typedef struct ipaca_calculator ipaca_calculator;
+
+/** @return A new calculator with an empty element table, an absolute
+ *          pruning limit of 1e-26 and all peaks as output, or null.
+ */
+ipaca_calculator* ipaca_calculator_create(void);
+
+void ipaca_calculator_destroy(ipaca_calculator* calculator);
+
+/** Add an element to the element table.
+ * @param calculator The calculator.
+ * @param mz The masses of the isotopes, lightest first.
+ * @param ab The abundances of the isotopes.
+ * @param nIsotopes The number of isotopes; positive.
+ * @return The id of the element, or -1 on error.
+ */
+long ipaca_calculator_add_element(ipaca_calculator* calculator,
+    const double* mz, const double* ab, size_t nIsotopes);
+
+/** Select the element to which charge protons are added. By default,
+ * charge protons form an entry of their own with the default hydrogen
+ * isotope table.
+ * @param element The id of the hydrogen element.
+ */
+int ipaca_calculator_set_hydrogen(ipaca_calculator* calculator,
+    size_t element);
+
+/** Set the abundance limit below which peaks are pruned; positive.
+ */
+int ipaca_calculator_set_limit(ipaca_calculator* calculator, double limit);
+
+/** Set the part of the isotope distribution to calculate.
+ * @param mode \c IPACA_ALL, \c IPACA_FIRST_N or \c IPACA_TOP_K.
+ * @param n The number of peaks for \c IPACA_FIRST_N and \c IPACA_TOP_K.
+ *          With either mode, a compound yields at most \a n peaks, which
+ *          bounds the capacity needed for a batch.
+ */
+int ipaca_calculator_set_output(ipaca_calculator* calculator, int mode,
+    size_t n);
+
+/** Calculate the isotope distributions of a batch of compounds.
+ * @param calculator The calculator.
+ * @param nCompounds The number of compounds.
+ * @param offsets The CSR row offsets; nCompounds + 1 entries.
+ * @param elements The element ids.
+ * @param counts The atom counts.
+ * @param charges The charges of the compounds, or null for neutral
+ *                compounds. Negative charges remove protons.
+ * @param particle \c IPACA_PROTON or \c IPACA_ELECTRON.
+ * @param mz Receives the m/z values of all peaks.
+ * @param ab Receives the abundances of all peaks.
+ * @param capacity The number of entries of \a mz and \a ab.
+ * @param peakOffsets Receives the peak offsets; nCompounds + 1 entries.
+ * @param nDone If non-null, receives the number of compounds whose peaks
+ *              were written. If the capacity is exhausted, the call
+ *              returns \c IPACA_ERROR_CAPACITY after the last compound
+ *              that fits, and the batch can be resumed from there.
+ * @return A status code. On error, the peaks of the first \a nDone
+ *         compounds are valid.
+ */
+int ipaca_calculate(const ipaca_calculator* calculator, size_t nCompounds,
+    const size_t* offsets, const size_t* elements, const double* counts,
+    const int* charges, int particle, double* mz, double* ab,
+    size_t capacity, size_t* peakOffsets, size_t* nDone);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* __LIBIPACA_INCLUDE_IPACA_CAPI_H__ */
@@ -0,0 +1,109 @@
+/*
+ * CompactMercury.hpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+
+#ifndef __LIBIPACA_INCLUDE_IPACA_COMPACTMERCURY_HPP__
+#define __LIBIPACA_INCLUDE_IPACA_COMPACTMERCURY_HPP__
+
+#include <ipaca/config.hpp>
+#include <ipaca/Spectrum.hpp>
+#include <ipaca/Stoichiometry.hpp>
+#include <ipaca/Types.hpp>
+#include <vector>
+
+namespace ipaca {
+
+/** The floating-point type of the abundances in exact calculations (see
+ * \c detail::Mercury7Impl::setPrecision()).
+ */
+enum Precision
+{
+    DOUBLE_PRECISION, SINGLE_PRECISION
+};
+
+namespace detail {
+
+/*
+ * The compact engine calculates nominal isotope distributions with a
+ * configurable floating-point type T for all per-peak data. Only the mass
+ * of the first peak (the origin) is kept in double precision; the k-th
+ * peak lies at origin + k + defect_k, and its mass defect is small enough
+ * to be represented in single precision without loss of relevant
+ * accuracy. Abundances and abundance-weighted defects are stored in two
+ * arrays (structure of arrays), so a convolution streams contiguous
+ * arrays of T: with T = float, a SIMD register holds twice as many peaks,
+ * and half as many bytes are moved.
+ *
+ * The engine is instantiated for float and double. The calculators use
+ * it in single precision (see \c Mercury7Impl::setPrecision()), which
+ * also applies the prune policy, the output mode and the maximum number
+ * of peaks; \c compactMercury() itself is a low-level entry point that
+ * only prunes leading and trailing peaks below a fixed limit.
+ */
+
+/** A nominal isotope distribution in structure-of-arrays layout.
+ */
+template<typename T>
+struct CompactSpectrum
+{
+    /** The mass of the peak at index 0.
+     */
+    Double origin;
+    /** The abundances.
+     */
+    std::vector<T> ab;
+    /** The abundance-weighted mass defects, i.e. ab_k * (mz_k - origin -
+     * k).
+     */
+    std::vector<T> weightedDefect;
+};
+
+/** Set up the distribution of a single atom.
+ * @param isotopes The isotopes, lightest first.
+ * @param result Receives the distribution.
+ */
+template<typename T>
+void compactElement(const Isotopes& isotopes, CompactSpectrum<T>& result);
+
+/** Convolve two distributions.
+ * @param s1 Spectrum on the left hand side of the convolution.
+ * @param s2 Spectrum on the right hand side of the convolution; may be
+ *           \a s1.
+ * @param result Receives the convolution; must be neither operand.
+ */
+template<typename T>
+void compactConvolve(const CompactSpectrum<T>& s1,
+    const CompactSpectrum<T>& s2, CompactSpectrum<T>& result);
+
+/** Remove the leading and trailing peaks below an abundance limit.
+ */
+template<typename T>
+void compactPrune(CompactSpectrum<T>& s, const T limit);
+
+/** Calculate the distribution of n atoms of an element by repeated
+ * squaring, pruning every intermediate result.
+ */
+template<typename T>
+void compactPower(const Isotopes& isotopes, const Size n, const T limit,
+    CompactSpectrum<T>& result);
+
+/** Calculate the nominal isotope distribution of a compound with the
+ * compact engine. Fractional atoms are handled as in \c Mercury7Impl.
+ * @param stoichiometry The stoichiometry.
+ * @param limit The abundance limit below which leading and trailing
+ *              peaks are pruned; it is raised to the smallest normalized
+ *              value of T to avoid denormal arithmetic.
+ * @param result Receives the distribution.
+ */
+template<typename T>
+void compactMercury(const Stoichiometry& stoichiometry, const Double limit,
+    Spectrum& result);
+
+} // namespace detail
+
+} // namespace ipaca
+
+#endif /* __LIBIPACA_INCLUDE_IPACA_COMPACTMERCURY_HPP__ */
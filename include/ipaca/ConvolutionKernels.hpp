@@ -0,0 +1,209 @@
+/*
+ * ConvolutionKernels.hpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+
+#ifndef __LIBIPACA_INCLUDE_IPACA_CONVOLUTIONKERNELS_HPP__
+#define __LIBIPACA_INCLUDE_IPACA_CONVOLUTIONKERNELS_HPP__
+
+#include <ipaca/config.hpp>
+#include <ipaca/Spectrum.hpp>
+#include <ipaca/Types.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <iosfwd>
+
+namespace ipaca {
+
+/** The kernels that are available to convolve two isotope distributions.
+ *
+ * \li \c DIRECT_KERNEL: every output peak is a dot product over the
+ *     overlapping operand peaks. This is the classic Mercury kernel.
+ * \li \c SQUARE_KERNEL: the direct kernel for self-convolutions, which
+ *     evaluates each symmetric pair of terms only once.
+ * \li \c SCATTER_KERNEL: every peak of the smaller operand is multiplied
+ *     onto the complete larger operand and accumulated into the output.
+ *     The inner loop is long and contiguous, which pays off when one
+ *     operand only has a few peaks (e.g. a single atom).
+ */
+enum ConvolutionKernel
+{
+    DIRECT_KERNEL, SQUARE_KERNEL, SCATTER_KERNEL, NUM_KERNELS
+};
+
+/** @return The name of a convolution kernel.
+ */
+const char* getKernelName(const ConvolutionKernel kernel);
+
+/** The crossover points between the convolution kernels.
+ *
+ * The fastest kernel depends on the operand sizes and on the machine.
+ * The crossover points are either measured by a short micro-benchmark
+ * (see \c measure()), loaded from a saved profile or left at their
+ * built-in defaults.
+ */
+struct KernelCalibration
+{
+    enum Source
+    {
+        DEFAULT, MEASURED, LOADED
+    };
+
+    /** Default constructor; uses the built-in crossover points.
+     */
+    KernelCalibration();
+
+    /** The scatter kernel is used if the smaller operand of a convolution
+     * has fewer peaks than this.
+     */
+    Size scatterCrossover;
+
+    /** The squaring kernel is used for self-convolutions of at least this
+     * many peaks; smaller ones use the scatter kernel.
+     */
+    Size squareCrossover;
+
+    /** Where the crossover points come from.
+     */
+    Source source;
+
+    /** Select the kernel for a convolution.
+     * @param n1 The number of peaks of the left hand side operand.
+     * @param n2 The number of peaks of the right hand side operand.
+     * @param square Whether both operands are the same spectrum.
+     * @return The kernel to use.
+     */
+    ConvolutionKernel select(const Size n1, const Size n2,
+        const Bool square) const;
+
+    /** Measure the crossover points on this machine. This takes a few
+     * milliseconds.
+     */
+    static KernelCalibration measure();
+
+    /** Load a calibration profile written by \c save().
+     * @param is The input stream.
+     * @throws RuntimeError The profile is malformed.
+     */
+    static KernelCalibration load(std::istream& is);
+
+    /** Load a calibration profile from a file.
+     * @param filename The name of the file.
+     * @throws RuntimeError The file cannot be read or is malformed.
+     */
+    static KernelCalibration load(const String& filename);
+
+    /** Save the calibration profile.
+     * @param os The output stream.
+     */
+    void save(std::ostream& os) const;
+
+    /** Save the calibration profile to a file.
+     * @param filename The name of the file.
+     * @throws RuntimeError The file cannot be written.
+     */
+    void save(const String& filename) const;
+
+    /** Get the process-wide calibration. At first use, the profile named
+     * by the \c IPACA_CALIBRATION environment variable is loaded; if there
+     * is none (or it cannot be read), the crossover points are measured.
+     */
+    static const KernelCalibration& getDefault();
+};
+
+/** Convolution statistics: the calibration in use and, for every kernel,
+ * the number of convolutions and calculated peaks.
+ */
+struct KernelStats
+{
+    KernelStats();
+
+    KernelCalibration calibration;
+    Size calls[NUM_KERNELS];
+    Double peaks[NUM_KERNELS];
+};
+
+namespace detail {
+
+/** Calculates the k-th peak of the convolution of two non-empty spectra
+ * with the direct (or, if both operands are the same spectrum, the
+ * squaring) kernel.
+ */
+void calculatePeak(const Spectrum& s1, const Spectrum& s2, const Size k,
+    SpectrumElement& peak);
+
+/** Calculates the peaks [first, last) of the convolution of two
+ * non-empty spectra.
+ * @param kernel The kernel to use. The squaring kernel requires both
+ *               operands to be the same spectrum.
+ * @param s1 Spectrum on the left hand side of the convolution.
+ * @param s2 Spectrum on the right hand side of the convolution.
+ * @param first The index of the first peak.
+ * @param last One past the index of the last peak; at most
+ *             s1.size() + s2.size() - 1.
+ * @param result Receives the last - first peaks.
+ */
+void convolveRange(const ConvolutionKernel kernel, const Spectrum& s1,
+    const Spectrum& s2, const Size first, const Size last,
+    SpectrumElement* result);
+
+/** Thread-safe accumulator for the kernel statistics. Counters are
+ * shared by all copies of a calculator; while a \c KernelCountersScope
+ * is active, the convolutions of the calling thread are counted without
+ * locking and merged once the scope ends.
+ */
+class KernelCounters
+{
+public:
+    KernelCounters();
+
+    /** Record a convolution.
+     */
+    void record(const ConvolutionKernel kernel, const Size peaks);
+
+    /** Add counts, e.g. those of a \c KernelCountersScope.
+     */
+    void merge(const KernelStats& stats);
+
+    /** @return The counts so far.
+     */
+    KernelStats get() const;
+
+    /** Reset all counts.
+     */
+    void reset();
+
+private:
+    KernelStats stats_;
+    mutable boost::mutex mutex_;
+};
+
+/** Collects the convolutions that the calling thread records to a set of
+ * counters and merges them into the counters on destruction. Scopes may
+ * be nested.
+ */
+class KernelCountersScope : private boost::noncopyable
+{
+public:
+    /** Constructor.
+     * @param counters The counters; must outlive the scope.
+     */
+    explicit KernelCountersScope(KernelCounters& counters);
+
+    ~KernelCountersScope();
+
+private:
+    friend class KernelCounters;
+
+    KernelCounters& counters_;
+    KernelStats stats_;
+    KernelCountersScope* previous_;
+};
+
+} // namespace detail
+
+} // namespace ipaca
+
+#endif /* __LIBIPACA_INCLUDE_IPACA_CONVOLUTIONKERNELS_HPP__ */
@@ -0,0 +1,203 @@
+/*
+ * ConvolutionPlan.hpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+
+#ifndef __LIBIPACA_INCLUDE_IPACA_CONVOLUTIONPLAN_HPP__
+#define __LIBIPACA_INCLUDE_IPACA_CONVOLUTIONPLAN_HPP__
+
+#include <ipaca/config.hpp>
+#include <ipaca/Stoichiometry.hpp>
+#include <ipaca/Types.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <list>
+#include <map>
+#include <vector>
+
+namespace ipaca {
+
+namespace detail {
+
+/** Moments of the isotope index distribution of an element (or of any
+ * partial result), used to estimate the number of peaks that survive
+ * pruning.
+ */
+struct IndexMoments
+{
+    Double mean, variance, span;
+};
+
+/** Calculate the index moments of a single atom.
+ * @param isotopes The isotope distribution of the element.
+ * @return The moments of the isotope index distribution.
+ */
+IndexMoments getIndexMoments(const Isotopes& isotopes);
+
+/** Estimate the number of peaks of a distribution that survive pruning.
+ * The distribution is approximated by a normal distribution; all peaks
+ * within sqrt(2 ln(1/limit)) standard deviations of the mean are
+ * counted, clipped to the valid index range.
+ * @param m The moments of the distribution.
+ * @param limit The abundance limit used for pruning.
+ * @param maxPeaks The maximum number of peaks in the current output mode.
+ * @return The estimated number of peaks.
+ */
+Double estimatePeakCount(const IndexMoments& m, const Double limit,
+    const Size maxPeaks);
+
+/** A single convolution in a plan: node = node[lhs] (x) node[rhs].
+ */
+struct PlanStep
+{
+    Size lhs, rhs;
+};
+
+/** An addition chain to calculate E^n for an element E. Node 0 is the
+ * isotope distribution of the element; step k produces node k+1, and the
+ * last node is E^n.
+ */
+typedef std::vector<PlanStep> AdditionChain;
+
+/** Build the right-to-left binary (square-and-multiply) chain for n.
+ * This is the classic Mercury7 scheme.
+ */
+void binaryChain(const Size n, AdditionChain& chain);
+
+/** Build a left-to-right sliding window chain for n. The odd powers
+ * E^1, E^3, ..., E^(2^window - 1) that are needed are precomputed; the
+ * partial result is then squared and multiplied by these small powers.
+ * A window of 1 yields the left-to-right binary method.
+ */
+void slidingWindowChain(const Size n, const Size window, AdditionChain& chain);
+
+/** Estimate the cost of an addition chain as the number of multiply-adds.
+ * @param chain The addition chain.
+ * @param m The index moments of a single atom.
+ * @param limit The abundance limit used for pruning.
+ * @param maxPeaks The maximum number of peaks in the current output mode.
+ */
+Double estimateChainCost(const AdditionChain& chain, const IndexMoments& m,
+    const Double limit, const Size maxPeaks);
+
+/** Calculate the number of times the pruned nodes of an addition chain
+ * enter its result, summed over all nodes. If the chain is empty, the
+ * result (node 0) is pruned once.
+ */
+Double getChainPruneWeight(const AdditionChain& chain);
+
+/** How to calculate the contribution of a single element.
+ */
+struct ElementPlan
+{
+    /** Index of the element in the integer stoichiometry.
+     */
+    Size element;
+    /** Evaluate the element pattern in closed form.
+     */
+    Bool closedForm;
+    /** The addition chain, if the element is not evaluated in closed form.
+     */
+    AdditionChain chain;
+};
+
+/** A plan for the calculation of the isotope distribution of an integer
+ * stoichiometry. All element results are calculated first (result nodes
+ * 0..elements.size()-1); each merge step then adds another result node.
+ * The last result node is the isotope distribution.
+ */
+struct ConvolutionPlan
+{
+    std::vector<ElementPlan> elements;
+    std::vector<PlanStep> merges;
+    /** The estimated cost in multiply-adds.
+     */
+    Double cost;
+    /** The sum of the multiplicities of all pruning steps.
+     */
+    Double pruneWeight;
+};
+
+/** Creates convolution plans and caches their element chains.
+ *
+ * The planner estimates the peak count of every element power and
+ * chooses the cheapest of several exponentiation schemes (right-to-left
+ * binary, left-to-right sliding window) per element. The element results
+ * are then combined Huffman-style, always merging the two partial results
+ * with the smallest estimated peak counts.
+ *
+ * The plan of an element power only depends on its count and on the
+ * isotope abundances of the element, but not on the isotope masses or on
+ * the other elements of the composition. Hence, element plans are cached
+ * individually and shared by all compositions that contain the same
+ * element power; the merge order is cheap and planned on every call. The
+ * cache is thread-safe and evicts the least recently used entries.
+ */
+class ConvolutionPlanner
+{
+public:
+    /** Constructor.
+     * @param capacity The maximum number of cached element plans.
+     */
+    explicit ConvolutionPlanner(const Size capacity = 4096);
+
+    /** Get the plan for a stoichiometry, using the cached element plans.
+     * @param intStoi The integer part of the stoichiometry.
+     * @param limit The abundance limit used for the cost estimates.
+     * @param closedForm Whether elements with at most three isotopes may
+     *                   be evaluated in closed form.
+     * @param maxPeaks The maximum number of peaks in the current output mode.
+     */
+    boost::shared_ptr<const ConvolutionPlan> getPlan(
+        const Stoichiometry& intStoi, const Double limit,
+        const Bool closedForm, const Size maxPeaks) const;
+
+    /** Create a plan for a stoichiometry, bypassing the cache.
+     */
+    ConvolutionPlan createPlan(const Stoichiometry& intStoi,
+        const Double limit, const Bool closedForm, const Size maxPeaks) const;
+
+    /** @return The number of cached element plans.
+     */
+    Size size() const;
+
+    /** Discard all cached element plans.
+     */
+    void clear();
+
+private:
+    /** The plan of a single element power.
+     */
+    struct ElementEntry
+    {
+        Bool closedForm;
+        AdditionChain chain;
+        Double cost;
+        Double pruneWeight;
+    };
+    typedef boost::shared_ptr<const ElementEntry> EntryPtr;
+    typedef std::vector<Double> Key;
+    /** Cached keys, most recently used first.
+     */
+    typedef std::list<Key> Usage;
+    typedef std::map<Key, std::pair<EntryPtr, Usage::iterator> > Cache;
+
+    ConvolutionPlan buildPlan(const Stoichiometry& intStoi,
+        const Double limit, const Bool closedForm, const Size maxPeaks,
+        const Bool cached) const;
+    static EntryPtr planElement(const Isotopes& isotopes, const Size n,
+        const Double limit, const Bool closedForm, const Size maxPeaks);
+
+    Size capacity_;
+    mutable Cache cache_;
+    mutable Usage usage_;
+    mutable boost::mutex mutex_;
+};
+
+} // namespace detail
+
+} // namespace ipaca
+
+#endif /* __LIBIPACA_INCLUDE_IPACA_CONVOLUTIONPLAN_HPP__ */
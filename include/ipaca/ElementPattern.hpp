@@ -0,0 +1,75 @@
+/*
+ * ElementPattern.hpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+
+#ifndef __LIBIPACA_INCLUDE_IPACA_ELEMENTPATTERN_HPP__
+#define __LIBIPACA_INCLUDE_IPACA_ELEMENTPATTERN_HPP__
+
+#include <ipaca/config.hpp>
+#include <ipaca/Spectrum.hpp>
+#include <ipaca/Stoichiometry.hpp>
+#include <ipaca/Types.hpp>
+#include <limits>
+#include <vector>
+
+namespace ipaca {
+
+namespace detail {
+
+/** Check if the isotope distribution of n atoms of an element can be
+ * evaluated in closed form, i.e. if the element has at most three
+ * isotope entries. The isotope distribution of such an element is a
+ * binomial (two entries) or a trinomial (three entries) distribution.
+ * @param isotopes The isotope distribution of the element.
+ * @return A boolean, true if \c closedFormPattern can be used.
+ */
+Bool hasClosedFormPattern(const Isotopes& isotopes);
+
+/** Calculate the probabilities of a binomial distribution B(n, p) at
+ * all k whose probability exceeds a threshold. The distribution is
+ * unimodal, hence the probabilities are evaluated from the mode outward
+ * using the recurrence of successive binomial coefficients.
+ * @param n The number of trials.
+ * @param p The success probability.
+ * @param tau Probabilities at or below \a tau are discarded.
+ * @param first Receives the smallest k that has been kept.
+ * @param probs Receives the probabilities P(first), P(first+1), ...
+ */
+void binomialTerms(const Size n, const Double p, const Double tau,
+    Size& first, std::vector<Double>& probs);
+
+/** Calculate the isotope distribution of \a n atoms of an element with
+ * at most three isotope entries directly, without any convolutions.
+ *
+ * With isotope entries at index offsets 0, 1 and 2, the i-th peak of
+ * the distribution collects all configurations (a0, a1, a2) with
+ * a1 + 2 a2 = i. Their probabilities follow from the multinomial
+ * distribution, factored as a2 ~ B(n, p2) and a1 | a2 ~ B(n - a2,
+ * p1 / (p0 + p1)). The mass of each peak is the mass expectation over
+ * its configurations.
+ *
+ * Configurations whose probability is at or below \a tau are skipped;
+ * since a peak collects at most n + 1 configurations, every peak is
+ * exact up to (n + 1) * tau.
+ * @param isotopes The isotope distribution of the element.
+ * @param n The number of atoms.
+ * @param tau The probability below which configurations are skipped.
+ * @param spectrum Receives the isotope distribution, starting at the first
+ *                 non-empty peak.
+ * @param first If non-null, receives the isotope index of the first peak.
+ * @param lo Peaks with an isotope index below \a lo are not calculated.
+ * @param hi Peaks with an isotope index at or above \a hi are not
+ *           calculated.
+ */
+void closedFormPattern(const Isotopes& isotopes, const Size n,
+    const Double tau, Spectrum& spectrum, Size* first = 0, const Size lo = 0,
+    const Size hi = std::numeric_limits<Size>::max());
+
+} // namespace detail
+
+} // namespace ipaca
+
+#endif /* __LIBIPACA_INCLUDE_IPACA_ELEMENTPATTERN_HPP__ */
@@ -110,6 +110,26 @@ public:
     }
 }; /* class RuntimeError */
 
+/**
+ *   Reported by asynchronous calculations that have been cancelled before
+ *   they started.
+ */
+class CancelledError : public RuntimeError
+{
+public:
+    explicit CancelledError(const char* message) :
+        RuntimeError(message)
+    {
+    }
+    explicit CancelledError(const std::string& message) :
+        RuntimeError(message)
+    {
+    }
+    virtual ~CancelledError() throw ()
+    {
+    }
+}; /* class CancelledError */
+
 //////////////////////////////////
 // now, some general subclasses //
 //////////////////////////////////
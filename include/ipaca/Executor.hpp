@@ -0,0 +1,80 @@
+/*
+ * Executor.hpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+
+#ifndef __LIBIPACA_INCLUDE_IPACA_EXECUTOR_HPP__
+#define __LIBIPACA_INCLUDE_IPACA_EXECUTOR_HPP__
+
+#include <ipaca/config.hpp>
+#include <ipaca/Types.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <deque>
+
+namespace ipaca {
+
+/** Runs work that has been submitted asynchronously (see
+ * \c Mercury7::submit()). Applications with an event loop implement
+ * \c execute() to hand the work to their own threads; everybody else
+ * uses a \c ThreadPoolExecutor.
+ */
+class Executor
+{
+public:
+    typedef boost::function<void ()> Work;
+
+    virtual ~Executor();
+
+    /** Schedule work. The work must eventually be run exactly once, in
+     * any thread; it does not throw.
+     * @param work The work.
+     */
+    virtual void execute(const Work& work) = 0;
+};
+
+/** An executor that runs work on a fixed number of threads, in the order
+ * of submission.
+ */
+class ThreadPoolExecutor : public Executor, private boost::noncopyable
+{
+public:
+    /** Constructor. Starts the threads.
+     * @param threads The number of threads, or zero for one per hardware
+     *                thread.
+     */
+    explicit ThreadPoolExecutor(const Size threads = 0);
+
+    /** Destructor. Runs all queued work and joins the threads.
+     */
+    ~ThreadPoolExecutor();
+
+    void execute(const Work& work);
+
+    /** @return The number of threads.
+     */
+    Size getThreads() const;
+
+    /** @return The number of queued work items that have not started.
+     */
+    Size getQueued() const;
+
+private:
+    void runWorker();
+
+    std::deque<Work> queue_;
+    Bool stopping_;
+    mutable boost::mutex mutex_;
+    boost::condition_variable ready_;
+    boost::thread_group threads_;
+    Size size_;
+};
+
+} // namespace ipaca
+
+#endif /* __LIBIPACA_INCLUDE_IPACA_EXECUTOR_HPP__ */
@@ -0,0 +1,57 @@
+/*
+ * FineStructure.hpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+
+#ifndef __LIBIPACA_INCLUDE_IPACA_FINESTRUCTURE_HPP__
+#define __LIBIPACA_INCLUDE_IPACA_FINESTRUCTURE_HPP__
+
+#include <ipaca/config.hpp>
+#include <ipaca/Spectrum.hpp>
+#include <ipaca/Stoichiometry.hpp>
+#include <ipaca/Types.hpp>
+#include <limits>
+
+namespace ipaca {
+
+namespace detail {
+
+/** Calculate the isotopic fine structure of a compound, i.e. the
+ * individual isotopologues rather than one peak per nominal isotope
+ * index.
+ *
+ * The isotopologues are enumerated in order of decreasing probability
+ * until their total probability reaches the requested coverage:
+ *
+ * \li For every element, a sub-generator enumerates the multinomial
+ *     configurations of its atoms in order of decreasing probability.
+ *     It starts at the mode and explores the configurations that differ
+ *     by one atom in a best-first manner; as the multinomial distribution
+ *     is log-concave, this yields the exact order.
+ * \li The isotopologues are tuples of element configurations. They are
+ *     explored best-first from the tuple of the most probable element
+ *     configurations; every tuple is reached from exactly one parent,
+ *     hence no tuple is generated twice.
+ *
+ * Time and memory depend on the number of isotopologues needed for the
+ * coverage rather than on the size of the compound. Fractional atoms are
+ * treated as in \c Mercury7Impl, i.e. as a mixture of "no atom" and a
+ * full atom.
+ * @param stoichiometry The stoichiometry.
+ * @param coverage The total probability to cover, relative to the total
+ *                 abundance of the compound; in (0, 1].
+ * @param spectrum Receives the isotopologues in order of increasing mass.
+ * @param maxPeaks The maximum number of isotopologues.
+ * @return The total probability of the isotopologues.
+ */
+Double fineStructure(const Stoichiometry& stoichiometry,
+    const Double coverage, Spectrum& spectrum,
+    const Size maxPeaks = std::numeric_limits<Size>::max());
+
+} // namespace detail
+
+} // namespace ipaca
+
+#endif /* __LIBIPACA_INCLUDE_IPACA_FINESTRUCTURE_HPP__ */
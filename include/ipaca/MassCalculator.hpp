@@ -0,0 +1,91 @@
+/*
+ * MassCalculator.hpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+
+#ifndef __LIBIPACA_INCLUDE_IPACA_MASSCALCULATOR_HPP__
+#define __LIBIPACA_INCLUDE_IPACA_MASSCALCULATOR_HPP__
+
+#include <ipaca/config.hpp>
+#include <ipaca/Stoichiometry.hpp>
+#include <ipaca/Types.hpp>
+#include <vector>
+
+namespace ipaca {
+
+/** Calculates monoisotopic and average masses for large batches of
+ * compounds, e.g. to pre-filter candidate compositions before any
+ * isotope pattern is calculated.
+ *
+ * The element table is set up once; each element contributes its
+ * monoisotopic mass (the mass of its first isotope) and its average
+ * mass. The compositions are passed as a columnar matrix of atom counts
+ * with one row per element and one column per compound, i.e. the count
+ * of element \c e in compound \c c is at <tt>counts[e * stride + c]</tt>.
+ * The masses are then two dot products per compound, which are evaluated
+ * for several compounds at once with SSE2 (where available). The element
+ * rows are streamed exactly once and the accumulators stay in registers.
+ */
+class MassCalculator
+{
+public:
+    /** Default constructor; creates an empty element table.
+     */
+    MassCalculator();
+
+    /** Add an element to the table.
+     * @param monoisotopicMass The mass of the lightest isotope.
+     * @param averageMass The abundance-weighted mass of one atom.
+     * @return The row index of the element in the composition matrix.
+     */
+    Size addElement(const Double monoisotopicMass, const Double averageMass);
+
+    /** Add an element to the table. The masses are calculated from the
+     * isotope distribution in the same way as in
+     * \c detail::Mercury7Impl::getMonoisotopicMass() and
+     * \c detail::Mercury7Impl::getAverageMass(); the count is ignored.
+     * @param element The element.
+     * @return The row index of the element in the composition matrix.
+     */
+    Size addElement(const detail::Element& element);
+
+    /** @return The number of elements in the table.
+     */
+    Size size() const;
+
+    Double getMonoisotopicMass(const Size element) const;
+
+    Double getAverageMass(const Size element) const;
+
+    /** Calculate the masses of a batch of compounds.
+     * @param counts The composition matrix; the row of element \c e
+     *               starts at <tt>counts + e * stride</tt>. There must be
+     *               one row per element in the table.
+     * @param nCompounds The number of compounds (columns).
+     * @param stride The distance between two rows; at least
+     *               \a nCompounds.
+     * @param monoisotopicMasses If non-null, receives \a nCompounds
+     *                           monoisotopic masses.
+     * @param averageMasses If non-null, receives \a nCompounds average
+     *                      masses.
+     */
+    void operator()(const Double* counts, const Size nCompounds,
+        const Size stride, Double* monoisotopicMasses,
+        Double* averageMasses) const;
+
+    /** Calculate the masses of a batch of compounds whose rows are
+     * stored without gaps, i.e. with a stride of \a nCompounds.
+     */
+    void operator()(const Double* counts, const Size nCompounds,
+        Double* monoisotopicMasses, Double* averageMasses) const;
+
+private:
+    std::vector<Double> mono_;
+    std::vector<Double> average_;
+};
+
+} // namespace ipaca
+
+#endif /* __LIBIPACA_INCLUDE_IPACA_MASSCALCULATOR_HPP__ */
@@ -0,0 +1,93 @@
+/*
+ * MassIndex.hpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+
+#ifndef __LIBIPACA_INCLUDE_IPACA_MASSINDEX_HPP__
+#define __LIBIPACA_INCLUDE_IPACA_MASSINDEX_HPP__
+
+#include <ipaca/config.hpp>
+#include <ipaca/Types.hpp>
+#include <utility>
+#include <vector>
+
+namespace ipaca {
+
+namespace detail {
+
+/** A static index for range queries over a set of masses.
+ *
+ * The masses are searched in Eytzinger (breadth-first) order: the first
+ * levels of the implicit search tree share a few cache lines, and the
+ * children of a node are adjacent, so they can be prefetched. A search
+ * yields the rank of the first mass in sorted order, and a range is then
+ * scanned in the plain sorted copy of the masses. Batches of queries are
+ * searched in lockstep, which overlaps their cache misses.
+ */
+class MassIndex
+{
+public:
+    /** The ranks [first, second) of the masses in a range.
+     */
+    typedef std::pair<Size, Size> Range;
+
+    /** Default constructor; creates an empty index.
+     */
+    MassIndex();
+
+    /** Build the index.
+     * @param masses The masses, in any order.
+     */
+    void build(const std::vector<Double>& masses);
+
+    /** @return The number of masses.
+     */
+    Size size() const;
+
+    /** @return The rank of the first mass not less than \a mass, or
+     *          \c size().
+     */
+    Size lowerBound(const Double mass) const;
+
+    /** @return The ranks of the masses in [lo, hi].
+     */
+    Range find(const Double lo, const Double hi) const;
+
+    /** Find the masses in several ranges.
+     * @param lo The lower ends of the ranges.
+     * @param hi The upper ends of the ranges.
+     * @param n The number of ranges.
+     * @param ranges Receives the ranks of the masses in each range.
+     */
+    void find(const Double* lo, const Double* hi, const Size n,
+        Range* ranges) const;
+
+    /** @return The mass of the given rank.
+     */
+    Double getMass(const Size rank) const;
+
+    /** @return The position of the mass of the given rank in the input
+     *          of \c build().
+     */
+    Size getId(const Size rank) const;
+
+private:
+    /** Map a terminal Eytzinger position to the rank of the first mass
+     * not less than the query.
+     */
+    Size toRank(Size k) const;
+
+    std::vector<Double> eytzinger_;
+    std::vector<Size> ranks_;
+    std::vector<Double> sorted_;
+    std::vector<Size> ids_;
+    Size depth_;
+};
+
+} // namespace detail
+
+} // namespace ipaca
+
+#endif /* __LIBIPACA_INCLUDE_IPACA_MASSINDEX_HPP__ */
@@ -0,0 +1,237 @@
+/*
+ * MemoryResource.hpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+
+#ifndef __LIBIPACA_INCLUDE_IPACA_MEMORYRESOURCE_HPP__
+#define __LIBIPACA_INCLUDE_IPACA_MEMORYRESOURCE_HPP__
+
+#include <ipaca/config.hpp>
+#include <ipaca/Types.hpp>
+#include <boost/noncopyable.hpp>
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <vector>
+
+namespace ipaca {
+
+/*
+ * All isotope distributions, spectra and stoichiometries in detail:: draw
+ * their memory from the memory resource of the calling thread. By default,
+ * this is the global heap. A MemoryResourceScope installs a different
+ * resource, e.g. a MonotonicArena per batch of compounds:
+ *
+ *   MonotonicArena arena;
+ *   for (each batch) {
+ *       {
+ *           MemoryResourceScope scope(&arena);
+ *           ... calculate and copy out the results ...
+ *       }
+ *       arena.reset();
+ *   }
+ *
+ * Every block remembers the resource it came from, hence containers may be
+ * freed after the scope has been left. The resource must outlive all
+ * blocks that it has handed out, i.e. detail:: containers that are
+ * created within a scope must be destroyed (or copied into heap memory)
+ * before the arena is reset. The results of \c Mercury7 are always
+ * converted into the caller's spectrum type and are not affected.
+ */
+
+/** The interface of a source of raw memory.
+ */
+class MemoryResource
+{
+public:
+    virtual ~MemoryResource();
+
+    /** Allocate a block.
+     * @param bytes The size of the block.
+     * @return A block that is aligned for any fundamental type, or null if
+     *         no memory is available.
+     */
+    virtual void* allocate(const Size bytes) = 0;
+
+    /** Release a block.
+     * @param p A block that has been returned by \c allocate().
+     * @param bytes The size that has been passed to \c allocate().
+     */
+    virtual void deallocate(void* p, const Size bytes) = 0;
+};
+
+/** A memory resource that hands out consecutive parts of large chunks and
+ * releases them all at once.
+ *
+ * Single blocks are only given back if they are the most recent
+ * allocation (which covers the growth of the last container and
+ * stack-like temporaries); the memory of all other blocks is reclaimed by
+ * \c reset(). An arena must not be shared between threads without
+ * external locking.
+ */
+class MonotonicArena : public MemoryResource, private boost::noncopyable
+{
+public:
+    /** Constructor.
+     * @param chunkSize The size of the chunks requested from the heap.
+     *                  Larger blocks get a chunk of their own.
+     */
+    explicit MonotonicArena(const Size chunkSize = 65536);
+
+    ~MonotonicArena();
+
+    void* allocate(const Size bytes);
+
+    void deallocate(void* p, const Size bytes);
+
+    /** Release all blocks. The memory is kept in a single chunk that is
+     * large enough to serve the same workload again without touching the
+     * heap.
+     */
+    void reset();
+
+    /** @return The number of bytes currently handed out.
+     */
+    Size getAllocated() const;
+
+    /** @return The number of bytes held in chunks.
+     */
+    Size getCapacity() const;
+
+private:
+    struct Chunk
+    {
+        char* begin;
+        Size size;
+    };
+    void addChunk(const Size bytes);
+    std::vector<Chunk> chunks_;
+    Size chunkSize_;
+    char* current_;
+    char* end_;
+    Size allocated_;
+};
+
+/** Installs a memory resource for the calling thread and restores the
+ * previous one on destruction. Scopes may be nested.
+ */
+class MemoryResourceScope : private boost::noncopyable
+{
+public:
+    /** Constructor.
+     * @param resource The memory resource, or null for the global heap.
+     */
+    explicit MemoryResourceScope(MemoryResource* resource);
+
+    ~MemoryResourceScope();
+
+private:
+    MemoryResource* previous_;
+};
+
+/** @return The memory resource of the calling thread, or null for the
+ *          global heap.
+ */
+MemoryResource* getMemoryResource();
+
+namespace detail {
+
+/** Allocate a block from the memory resource of the calling thread.
+ * @throws std::bad_alloc No memory is available.
+ */
+void* allocateBlock(const Size bytes);
+
+/** Release a block allocated by \c allocateBlock(), independent of the
+ * memory resource that is currently installed.
+ */
+void deallocateBlock(void* p);
+
+/** A stateless allocator that draws from the memory resource of the
+ * calling thread. All instances compare equal, since every block can be
+ * released by any of them.
+ */
+template<typename T>
+class Allocator
+{
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    template<typename U>
+    struct rebind
+    {
+        typedef Allocator<U> other;
+    };
+
+    Allocator()
+    {
+    }
+
+    template<typename U>
+    Allocator(const Allocator<U>&)
+    {
+    }
+
+    pointer address(reference x) const
+    {
+        return &x;
+    }
+
+    const_pointer address(const_reference x) const
+    {
+        return &x;
+    }
+
+    pointer allocate(size_type n, const void* = 0)
+    {
+        if (n > max_size()) {
+            throw std::bad_alloc();
+        }
+        return static_cast<pointer>(allocateBlock(n * sizeof(T)));
+    }
+
+    void deallocate(pointer p, size_type)
+    {
+        deallocateBlock(p);
+    }
+
+    size_type max_size() const
+    {
+        return std::numeric_limits<size_type>::max() / sizeof(T) - 1;
+    }
+
+    void construct(pointer p, const T& val)
+    {
+        new (static_cast<void*>(p)) T(val);
+    }
+
+    void destroy(pointer p)
+    {
+        p->~T();
+    }
+};
+
+template<typename T, typename U>
+inline bool operator==(const Allocator<T>&, const Allocator<U>&)
+{
+    return true;
+}
+
+template<typename T, typename U>
+inline bool operator!=(const Allocator<T>&, const Allocator<U>&)
+{
+    return false;
+}
+
+} // namespace detail
+
+} // namespace ipaca
+
+#endif /* __LIBIPACA_INCLUDE_IPACA_MEMORYRESOURCE_HPP__ */
@@ -8,12 +8,24 @@
 #ifndef __LIBIPACA_INCLUDE_IPACA_MERCURY7_HPP__
 #define __LIBIPACA_INCLUDE_IPACA_MERCURY7_HPP__
 #include <ipaca/config.hpp>
+#include <ipaca/ApproximationThreshold.hpp>
+#include <ipaca/AsyncCalculation.hpp>
+#include <ipaca/CompactMercury.hpp>
+#include <ipaca/ConvolutionKernels.hpp>
+#include <ipaca/Error.hpp>
+#include <ipaca/FineStructure.hpp>
+#include <ipaca/MemoryResource.hpp>
 #include <ipaca/Mercury7Impl.hpp>
+#include <ipaca/OutputMode.hpp>
+#include <ipaca/PatternCache.hpp>
+#include <ipaca/PowerTable.hpp>
+#include <ipaca/PrunePolicy.hpp>
 #include <ipaca/Spectrum.hpp>
 #include <ipaca/Stoichiometry.hpp>
 #include <ipaca/Types.hpp>
 #include <ipaca/Traits.hpp>
 #include <boost/shared_ptr.hpp>
+#include <vector>
 
 namespace ipaca {
 
@@ -43,12 +55,118 @@ public:
      */
     Mercury7();
 
+    /** Constructor.
+     * @param mode The part of the isotope distribution to calculate,
+     *             e.g. only the first few or the most abundant peaks.
+     */
+    explicit Mercury7(const OutputMode& mode);
+
+    /** Set the part of the isotope distribution to calculate.
+     * @param mode The output mode.
+     */
+    void setOutputMode(const OutputMode& mode);
+
+    /** @return The current output mode.
+     */
+    const OutputMode& getOutputMode() const;
+
+    /** Switch to the mass-binned mode, in which peaks are merged at a
+     * given resolution (see \c detail::Mercury7Impl::setMassResolution()).
+     * @param resolution The resolution (m/z over FWHM), or zero for one
+     *                   peak per nominal isotope index.
+     */
+    void setMassResolution(const Double resolution);
+
+    /** @return The resolution of the mass-binned mode, or zero.
+     */
+    Double getMassResolution() const;
+
+    /** Set the floating-point type of the abundances (see
+     * \c detail::Mercury7Impl::setPrecision()).
+     * @param precision The precision; the default is \c DOUBLE_PRECISION.
+     */
+    void setPrecision(const Precision precision);
+
+    /** @return The floating-point type of the abundances.
+     */
+    Precision getPrecision() const;
+
+    /** Set the crossover points used to select the convolution kernels.
+     * @param calibration The kernel calibration, e.g. a saved profile.
+     */
+    void setKernelCalibration(const KernelCalibration& calibration);
+
+    /** @return The kernel calibration in use and the number of
+     *          convolutions and peaks calculated by each kernel.
+     */
+    KernelStats getKernelStats() const;
+
+    /** Reset the kernel statistics.
+     */
+    void resetKernelStats();
+
+    /** Set the threshold above which isotope distributions are
+     * approximated from the moments of the composition instead of being
+     * calculated exactly. The default is to never approximate.
+     * @param threshold The approximation threshold, e.g.
+     *                  \c ApproximationThreshold::aboveMass(200000.0).
+     */
+    void setApproximationThreshold(const ApproximationThreshold& threshold);
+
+    /** @return The approximation threshold.
+     */
+    const ApproximationThreshold& getApproximationThreshold() const;
+
+    /** Share calculated isotope distributions through a cache, e.g. a
+     * \c SharedPatternCache that is used by all processes on a node.
+     * Only calculations with an absolute limit are cached.
+     * @param cache The cache, or null to disable caching.
+     */
+    void setPatternCache(const boost::shared_ptr<PatternCache>& cache);
+
+    /** @return The pattern cache, or null.
+     */
+    const boost::shared_ptr<PatternCache>& getPatternCache() const;
+
+    /** Calculate the powers E^1, E^2, ..., E^(2^k) of a set of elements,
+     * with 2^k <= \a maxCount, pruned at an absolute limit. Save the table
+     * with \c PowerTable::save() and map it in later jobs with
+     * \c PowerTable::load().
+     * @param isotopes The isotope tables of the elements.
+     * @param limit The abundance limit.
+     * @param maxCount The largest atom count the table is used for.
+     */
+    boost::shared_ptr<const PowerTable> createPowerTable(
+        const std::vector<detail::Isotopes>& isotopes, const Double limit,
+        const Size maxCount) const;
+
+    /** Use a table of element powers for all calculations with the
+     * absolute limit of the table.
+     * @param table The table, or null.
+     */
+    void setPowerTable(const boost::shared_ptr<const PowerTable>& table);
+
+    /** @return The table of element powers, or null.
+     */
+    const boost::shared_ptr<const PowerTable>& getPowerTable() const;
+
+    /** Get the error bound of the approximation for a compound.
+     * @param stoichiometry The stoichiometry of the compound.
+     * @param charge The charge of the compound.
+     * @param particle The type of particle that carries the charge.
+     * @return The bound on the absolute abundance error of every peak of
+     *         the approximated distribution (before pruning).
+     */
+    Double getApproximationErrorBound(const StoichiometryType& stoichiometry,
+        const int charge, const Particle particle) const;
+
     /** Functor method to calculate the theoretical isotope
      *         distribution of a compound.
      * @param stoichiometry The stoichiometry for which the isotope
      *                      distribution should be calculated.
      * @param limit The abundance limit below which peaks are pruned
-     *              during the processing
+     *              during the processing; a limit <= 0 yields an empty
+     *              spectrum.
      *
      * The procedure is based on Perttu Haimi's and Alan Rockwood's
      * sparse/binary convolution algorithm.
@@ -57,6 +175,53 @@ public:
     operator()(const StoichiometryType& stoichiometry, const int charge,
         const Particle particle, const Double limit = 1e-26) const;
 
+    /** Functor method to calculate the theoretical isotope
+     *         distribution of a compound using a custom pruning strategy.
+     * @param stoichiometry The stoichiometry for which the isotope
+     *                      distribution should be calculated.
+     * @param policy The policy that decides which peaks of the
+     *               intermediate results are discarded.
+     * @param discarded If non-null, receives the total abundance that has
+     *                  been lost due to pruning.
+     */
+    SpectrumType
+    operator()(const StoichiometryType& stoichiometry, const int charge,
+        const Particle particle, const PrunePolicy& policy,
+        Double* discarded = 0) const;
+
+    /** The callback of an asynchronous calculation.
+     */
+    typedef typename AsyncCalculation<SpectrumType>::Callback Callback;
+
+    /** Calculate the theoretical isotope distribution of a compound
+     * asynchronously, e.g. to keep an event loop responsive. The
+     * stoichiometry is converted and the settings of the calculator are
+     * captured right away, on the global heap rather than in the memory
+     * resource of the caller; later changes do not affect the
+     * calculation.
+     * @param executor The executor that runs the calculation, e.g. a
+     *                 \c ThreadPoolExecutor; must outlive the calculation.
+     * @param stoichiometry The stoichiometry of the compound.
+     * @param policy The policy that decides which peaks of the
+     *               intermediate results are discarded.
+     * @param callback If set, invoked with the future of the result once
+     *                 it is ready (see \c AsyncCalculation).
+     * @return A handle to wait for or cancel the calculation.
+     */
+    AsyncCalculation<SpectrumType>
+    submit(Executor& executor, const StoichiometryType& stoichiometry,
+        const int charge, const Particle particle,
+        const boost::shared_ptr<const PrunePolicy>& policy,
+        const Callback& callback = Callback()) const;
+
+    /** Calculate the theoretical isotope distribution of a compound
+     * asynchronously with an absolute abundance limit (see above).
+     */
+    AsyncCalculation<SpectrumType>
+    submit(Executor& executor, const StoichiometryType& stoichiometry,
+        const int charge, const Particle particle, const Double limit = 1e-26,
+        const Callback& callback = Callback()) const;
+
     /** calculate the monoisotopic mass of a given stoichiometry
      *  @param stoichiometry The stoichiometry to calculate the mass for.
      *  @param charge The charge at which the monoisotopic mass is desired
@@ -71,7 +236,168 @@ public:
      *                (zero for theoretical but unobservable mass).
      */
     Double getAverageMass(const StoichiometryType& stoichiometry) const;
+
+    /** Calculate the monoisotopic m/z of a compound, i.e. the m/z of the
+     * first peak of its isotope distribution (before pruning).
+     * @param stoichiometry The stoichiometry of the compound.
+     * @param charge The charge of the compound.
+     * @param particle The type of particle that carries the charge.
+     */
+    Double getMonoisotopicMz(const StoichiometryType& stoichiometry,
+        const int charge, const Particle particle) const;
+
+    /** Calculate only the part of the isotope distribution of a compound
+     * that falls into an m/z window, e.g. a targeted extraction window.
+     * The window is mapped to a range of isotope indices that restricts
+     * every intermediate result, hence peaks that cannot contribute to
+     * the window are never calculated. In \c FIRST_N and \c TOP_K mode,
+     * the first or most abundant peaks within the window are returned.
+     * @param stoichiometry The stoichiometry of the compound.
+     * @param charge The charge of the compound.
+     * @param particle The type of particle that carries the charge.
+     * @param mzMin The lower end of the m/z window.
+     * @param mzMax The upper end of the m/z window.
+     * @param limit The abundance limit below which peaks are pruned.
+     * @return The peaks within [mzMin, mzMax].
+     */
+    SpectrumType
+    window(const StoichiometryType& stoichiometry, const int charge,
+        const Particle particle, const Double mzMin, const Double mzMax,
+        const Double limit = 1e-26) const;
+
+    /** Calculate only the part of the isotope distribution of a compound
+     * that falls into an m/z window using a custom pruning strategy.
+     * @param policy The policy that decides which peaks of the
+     *               intermediate results are discarded.
+     */
+    SpectrumType
+    window(const StoichiometryType& stoichiometry, const int charge,
+        const Particle particle, const Double mzMin, const Double mzMax,
+        const PrunePolicy& policy) const;
+
+    /** Calculate the isotope distributions of a compound at several
+     * isotope enrichment levels (see \c detail::Mercury7Impl::sweep()).
+     * The unlabeled part of the compound is calculated only once.
+     * @param stoichiometry The stoichiometry of the compound.
+     * @param charge The charge of the compound.
+     * @param particle The type of particle that carries the charge.
+     * @param labeled The indices of the labeled elements in the converted
+     *                stoichiometry, i.e. in the order produced by the
+     *                stoichiometry converter. Charge protons are added to
+     *                the hydrogen entry and share its labeling.
+     * @param enrichments The isotope abundances of the labeled elements
+     *                    at each enrichment level.
+     * @param policy The policy that decides which peaks of the
+     *               intermediate results are discarded.
+     * @return One isotope distribution per enrichment level.
+     */
+    std::vector<SpectrumType>
+    sweep(const StoichiometryType& stoichiometry, const int charge,
+        const Particle particle, const std::vector<Size>& labeled,
+        const std::vector<detail::Enrichment>& enrichments,
+        const PrunePolicy& policy = AbsoluteLimitPrunePolicy(1e-26)) const;
+
+    /** Calculate the isotope distributions of the modified forms of a
+     * compound (see \c detail::Mercury7Impl::variants()). The unmodified
+     * core is calculated once, and variants with the same total delta
+     * are calculated only once.
+     * @param stoichiometry The stoichiometry of the unmodified compound.
+     * @param charge The charge of all variants.
+     * @param particle The type of particle that carries the charge.
+     * @param deltas The elemental composition changes of the
+     *               modifications; counts may be negative.
+     * @param variants The modified forms; each holds one count per
+     *                 modification.
+     * @param policy The policy that decides which peaks of the
+     *               intermediate results are discarded.
+     * @return One isotope distribution per variant.
+     */
+    std::vector<SpectrumType>
+    variants(const StoichiometryType& stoichiometry, const int charge,
+        const Particle particle, const std::vector<StoichiometryType>& deltas,
+        const std::vector<detail::Variant>& variants,
+        const PrunePolicy& policy = AbsoluteLimitPrunePolicy(1e-26)) const;
+
+    /** Calculate the isotope distribution of a compound that is made up
+     * of building blocks, e.g. a polymer or a glycan (see
+     * \c detail::Mercury7Impl::operator()(const detail::Blocks&, const PrunePolicy&)).
+     * @param blocks The stoichiometries of the building blocks.
+     * @param counts The number of times each block occurs.
+     * @param charge The charge of the compound. Charge protons are added
+     *               to the first block that occurs once, or form a
+     *               block of their own.
+     * @param particle The type of particle that carries the charge.
+     * @param policy The policy that decides which peaks of the
+     *               intermediate results are discarded.
+     */
+    SpectrumType
+    blocks(const std::vector<StoichiometryType>& blocks,
+        const std::vector<Size>& counts, const int charge,
+        const Particle particle,
+        const PrunePolicy& policy = AbsoluteLimitPrunePolicy(1e-26)) const;
+
+    /** Calculate the isotope distributions of a polydisperse series
+     * ends + unit^n for n = nMin, ..., nMax (see
+     * \c detail::Mercury7Impl::series()).
+     * @param ends The stoichiometries of the end groups, each of which
+     *             occurs once.
+     * @param unit The stoichiometry of the repeat unit.
+     * @param nMin The smallest number of repeat units.
+     * @param nMax The largest number of repeat units.
+     * @param charge The charge of all members of the series.
+     * @param particle The type of particle that carries the charge.
+     * @param policy The policy that decides which peaks of the
+     *               intermediate results are discarded.
+     * @return nMax - nMin + 1 isotope distributions.
+     */
+    std::vector<SpectrumType>
+    series(const std::vector<StoichiometryType>& ends,
+        const StoichiometryType& unit, const Size nMin, const Size nMax,
+        const int charge, const Particle particle,
+        const PrunePolicy& policy = AbsoluteLimitPrunePolicy(1e-26)) const;
+
+    /** Calculate the isotopic fine structure of a compound, i.e. its
+     * individual isotopologues, in order of decreasing probability until
+     * the requested coverage is reached (see \c detail::fineStructure()).
+     * The output mode and the mass resolution do not apply.
+     * @param stoichiometry The stoichiometry of the compound.
+     * @param charge The charge of the compound.
+     * @param particle The type of particle that carries the charge.
+     * @param coverage The total probability to cover; in (0, 1].
+     * @return The isotopologues in order of increasing m/z.
+     */
+    SpectrumType
+    fineStructure(const StoichiometryType& stoichiometry, const int charge,
+        const Particle particle, const Double coverage = 0.99) const;
+
 private:
+    /** Convert building blocks to the internal type and adjust them for
+     * charge and particle type.
+     */
+    void convertBlocks(const std::vector<StoichiometryType>& blocks,
+        const std::vector<Size>& counts, const int charge,
+        const Particle particle, detail::Blocks& b) const;
+
+    /** Convert a stoichiometry to the internal type and adjust it for
+     * charge and particle type.
+     */
+    void convertStoichiometry(const StoichiometryType& stoichiometry,
+        const int charge, const Particle particle,
+        detail::Stoichiometry& s) const;
+
+    /** Adjust a spectrum for the charge and convert it to the user type.
+     */
+    SpectrumType convertSpectrum(detail::Spectrum result,
+        const int charge) const;
+
+    /** The work of an asynchronous calculation.
+     * @param policy The prune policy, or null for an empty result.
+     */
+    SpectrumType calculate(
+        const boost::shared_ptr<const detail::Mercury7Impl>& impl,
+        const detail::Stoichiometry& stoichiometry, const int charge,
+        const boost::shared_ptr<const PrunePolicy>& policy) const;
+
     boost::shared_ptr<detail::Mercury7Impl> pImpl_;
 };
 
@@ -85,13 +411,365 @@ Mercury7<StoichiometryType, SpectrumType>::Mercury7() :
 {
 }
 
+template<typename StoichiometryType, typename SpectrumType>
+Mercury7<StoichiometryType, SpectrumType>::Mercury7(const OutputMode& mode) :
+    pImpl_(new detail::Mercury7Impl(mode))
+{
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+void Mercury7<StoichiometryType, SpectrumType>::setOutputMode(
+    const OutputMode& mode)
+{
+    pImpl_->setOutputMode(mode);
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+const OutputMode& Mercury7<StoichiometryType, SpectrumType>::getOutputMode() const
+{
+    return pImpl_->getOutputMode();
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+void Mercury7<StoichiometryType, SpectrumType>::setMassResolution(
+    const Double resolution)
+{
+    pImpl_->setMassResolution(resolution);
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+Double Mercury7<StoichiometryType, SpectrumType>::getMassResolution() const
+{
+    return pImpl_->getMassResolution();
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+void Mercury7<StoichiometryType, SpectrumType>::setPrecision(
+    const Precision precision)
+{
+    pImpl_->setPrecision(precision);
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+Precision Mercury7<StoichiometryType, SpectrumType>::getPrecision() const
+{
+    return pImpl_->getPrecision();
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+void Mercury7<StoichiometryType, SpectrumType>::setKernelCalibration(
+    const KernelCalibration& calibration)
+{
+    pImpl_->setKernelCalibration(calibration);
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+KernelStats Mercury7<StoichiometryType, SpectrumType>::getKernelStats() const
+{
+    return pImpl_->getKernelStats();
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+void Mercury7<StoichiometryType, SpectrumType>::resetKernelStats()
+{
+    pImpl_->resetKernelStats();
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+void Mercury7<StoichiometryType, SpectrumType>::setApproximationThreshold(
+    const ApproximationThreshold& threshold)
+{
+    pImpl_->setApproximationThreshold(threshold);
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+const ApproximationThreshold&
+Mercury7<StoichiometryType, SpectrumType>::getApproximationThreshold() const
+{
+    return pImpl_->getApproximationThreshold();
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+void Mercury7<StoichiometryType, SpectrumType>::setPatternCache(
+    const boost::shared_ptr<PatternCache>& cache)
+{
+    pImpl_->setPatternCache(cache);
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+const boost::shared_ptr<PatternCache>&
+Mercury7<StoichiometryType, SpectrumType>::getPatternCache() const
+{
+    return pImpl_->getPatternCache();
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+boost::shared_ptr<const PowerTable>
+Mercury7<StoichiometryType, SpectrumType>::createPowerTable(
+    const std::vector<detail::Isotopes>& isotopes, const Double limit,
+    const Size maxCount) const
+{
+    return pImpl_->createPowerTable(isotopes, limit, maxCount);
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+void Mercury7<StoichiometryType, SpectrumType>::setPowerTable(
+    const boost::shared_ptr<const PowerTable>& table)
+{
+    pImpl_->setPowerTable(table);
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+const boost::shared_ptr<const PowerTable>&
+Mercury7<StoichiometryType, SpectrumType>::getPowerTable() const
+{
+    return pImpl_->getPowerTable();
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+Double Mercury7<StoichiometryType, SpectrumType>::getApproximationErrorBound(
+    const StoichiometryType& stoichiometry, const int charge,
+    const Particle particle) const
+{
+    detail::Stoichiometry s;
+    convertStoichiometry(stoichiometry, charge, particle, s);
+    return pImpl_->getApproximationErrorBound(s);
+}
+
 template<typename StoichiometryType, typename SpectrumType>
 SpectrumType Mercury7<StoichiometryType, SpectrumType>::operator()(
     const StoichiometryType& stoichiometry, const int charge,
     const Particle particle, const Double limit) const
 {
-    // convert the user type to our internal type
     detail::Stoichiometry s;
+    convertStoichiometry(stoichiometry, charge, particle, s);
+    return convertSpectrum(pImpl_->operator()(s, limit), charge);
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+SpectrumType Mercury7<StoichiometryType, SpectrumType>::operator()(
+    const StoichiometryType& stoichiometry, const int charge,
+    const Particle particle, const PrunePolicy& policy,
+    Double* discarded) const
+{
+    detail::Stoichiometry s;
+    convertStoichiometry(stoichiometry, charge, particle, s);
+    return convertSpectrum(pImpl_->operator()(s, policy, discarded), charge);
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+AsyncCalculation<SpectrumType>
+Mercury7<StoichiometryType, SpectrumType>::submit(Executor& executor,
+    const StoichiometryType& stoichiometry, const int charge,
+    const Particle particle,
+    const boost::shared_ptr<const PrunePolicy>& policy,
+    const Callback& callback) const
+{
+    ipaca_precondition(policy != 0, "Mercury7::submit: policy is null.");
+    // the work is released on a thread of the executor, possibly after
+    // any memory resource of the caller is gone
+    MemoryResourceScope heap(0);
+    detail::Stoichiometry s;
+    convertStoichiometry(stoichiometry, charge, particle, s);
+    boost::shared_ptr<const detail::Mercury7Impl> impl(
+        new detail::Mercury7Impl(*pImpl_));
+    return AsyncCalculation<SpectrumType>::submit(executor, boost::bind(
+        &Mercury7::calculate, *this, impl, s, charge, policy), callback);
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+AsyncCalculation<SpectrumType>
+Mercury7<StoichiometryType, SpectrumType>::submit(Executor& executor,
+    const StoichiometryType& stoichiometry, const int charge,
+    const Particle particle, const Double limit,
+    const Callback& callback) const
+{
+    if (limit <= 0.0) {
+        // same as the synchronous call: an empty spectrum
+        return AsyncCalculation<SpectrumType>::submit(executor, boost::bind(
+            &Mercury7::calculate, *this,
+            boost::shared_ptr<const detail::Mercury7Impl>(),
+            detail::Stoichiometry(), 0,
+            boost::shared_ptr<const PrunePolicy>()), callback);
+    }
+    return submit(executor, stoichiometry, charge, particle,
+        boost::shared_ptr<const PrunePolicy>(new AbsoluteLimitPrunePolicy(
+            limit)), callback);
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+SpectrumType Mercury7<StoichiometryType, SpectrumType>::calculate(
+    const boost::shared_ptr<const detail::Mercury7Impl>& impl,
+    const detail::Stoichiometry& stoichiometry, const int charge,
+    const boost::shared_ptr<const PrunePolicy>& policy) const
+{
+    if (!policy) {
+        return convertSpectrum(detail::Spectrum(), 0);
+    }
+    return convertSpectrum((*impl)(stoichiometry, *policy), charge);
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+SpectrumType Mercury7<StoichiometryType, SpectrumType>::window(
+    const StoichiometryType& stoichiometry, const int charge,
+    const Particle particle, const Double mzMin, const Double mzMax,
+    const Double limit) const
+{
+    return window(stoichiometry, charge, particle, mzMin, mzMax,
+        AbsoluteLimitPrunePolicy(limit));
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+SpectrumType Mercury7<StoichiometryType, SpectrumType>::window(
+    const StoichiometryType& stoichiometry, const int charge,
+    const Particle particle, const Double mzMin, const Double mzMax,
+    const PrunePolicy& policy) const
+{
+    ipaca_precondition(mzMin <= mzMax, "Mercury7::window: empty window.");
+    detail::Stoichiometry s;
+    convertStoichiometry(stoichiometry, charge, particle, s);
+    // map the m/z window to neutral masses (inverting convertSpectrum)
+    Double massMin = mzMin, massMax = mzMax;
+    if (charge != 0) {
+        Int absCharge = (abs)(charge);
+        Double e = Traits<StoichiometryType, SpectrumType>::getElectronMass();
+        massMin = mzMin * absCharge + charge * e;
+        massMax = mzMax * absCharge + charge * e;
+    }
+    return convertSpectrum(pImpl_->operator()(s, massMin, massMax, policy),
+        charge);
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+std::vector<SpectrumType> Mercury7<StoichiometryType, SpectrumType>::sweep(
+    const StoichiometryType& stoichiometry, const int charge,
+    const Particle particle, const std::vector<Size>& labeled,
+    const std::vector<detail::Enrichment>& enrichments,
+    const PrunePolicy& policy) const
+{
+    detail::Stoichiometry s;
+    convertStoichiometry(stoichiometry, charge, particle, s);
+    std::vector<detail::Spectrum> results;
+    pImpl_->sweep(s, labeled, enrichments, policy, results);
+    std::vector<SpectrumType> spectra;
+    spectra.reserve(results.size());
+    typedef std::vector<detail::Spectrum>::const_iterator RCI;
+    for (RCI i = results.begin(); i != results.end(); ++i) {
+        spectra.push_back(convertSpectrum(*i, charge));
+    }
+    return spectra;
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+std::vector<SpectrumType> Mercury7<StoichiometryType, SpectrumType>::variants(
+    const StoichiometryType& stoichiometry, const int charge,
+    const Particle particle, const std::vector<StoichiometryType>& deltas,
+    const std::vector<detail::Variant>& variants,
+    const PrunePolicy& policy) const
+{
+    detail::Stoichiometry s;
+    convertStoichiometry(stoichiometry, charge, particle, s);
+    std::vector<detail::Stoichiometry> d(deltas.size());
+    typename Traits<StoichiometryType, SpectrumType>::stoichiometry_converter
+            stoi_conv;
+    for (Size m = 0; m < deltas.size(); ++m) {
+        stoi_conv(deltas[m], d[m]);
+    }
+    std::vector<detail::Spectrum> results;
+    pImpl_->variants(s, d, variants, policy, results);
+    std::vector<SpectrumType> spectra;
+    spectra.reserve(results.size());
+    typedef std::vector<detail::Spectrum>::const_iterator RCI;
+    for (RCI i = results.begin(); i != results.end(); ++i) {
+        spectra.push_back(convertSpectrum(*i, charge));
+    }
+    return spectra;
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+SpectrumType Mercury7<StoichiometryType, SpectrumType>::blocks(
+    const std::vector<StoichiometryType>& blocks,
+    const std::vector<Size>& counts, const int charge,
+    const Particle particle, const PrunePolicy& policy) const
+{
+    detail::Blocks b;
+    convertBlocks(blocks, counts, charge, particle, b);
+    return convertSpectrum(pImpl_->operator()(b, policy), charge);
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+std::vector<SpectrumType> Mercury7<StoichiometryType, SpectrumType>::series(
+    const std::vector<StoichiometryType>& ends,
+    const StoichiometryType& unit, const Size nMin, const Size nMax,
+    const int charge, const Particle particle,
+    const PrunePolicy& policy) const
+{
+    detail::Blocks b;
+    convertBlocks(ends, std::vector<Size>(ends.size(), 1), charge, particle,
+        b);
+    detail::Stoichiometry u;
+    typename Traits<StoichiometryType, SpectrumType>::stoichiometry_converter
+            stoi_conv;
+    stoi_conv(unit, u);
+    std::vector<detail::Spectrum> results;
+    pImpl_->series(b, u, nMin, nMax, policy, results);
+    std::vector<SpectrumType> spectra;
+    spectra.reserve(results.size());
+    typedef std::vector<detail::Spectrum>::const_iterator RCI;
+    for (RCI i = results.begin(); i != results.end(); ++i) {
+        spectra.push_back(convertSpectrum(*i, charge));
+    }
+    return spectra;
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+SpectrumType Mercury7<StoichiometryType, SpectrumType>::fineStructure(
+    const StoichiometryType& stoichiometry, const int charge,
+    const Particle particle, const Double coverage) const
+{
+    detail::Stoichiometry s;
+    convertStoichiometry(stoichiometry, charge, particle, s);
+    detail::Spectrum result;
+    detail::fineStructure(s, coverage, result);
+    return convertSpectrum(result, charge);
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+void Mercury7<StoichiometryType, SpectrumType>::convertBlocks(
+    const std::vector<StoichiometryType>& blocks,
+    const std::vector<Size>& counts, const int charge,
+    const Particle particle, detail::Blocks& b) const
+{
+    ipaca_precondition(blocks.size() == counts.size(),
+        "Mercury7::blocks: expected one count per block.");
+    typename Traits<StoichiometryType, SpectrumType>::stoichiometry_converter
+            stoi_conv;
+    b.resize(blocks.size());
+    Size charged = blocks.size();
+    for (Size k = 0; k < blocks.size(); ++k) {
+        stoi_conv(blocks[k], b[k].stoichiometry);
+        b[k].count = counts[k];
+        if (charged == blocks.size() && counts[k] == 1) {
+            charged = k;
+        }
+    }
+    // Adjust the number of hydrogens of a block that occurs once.
+    if (charge != 0 && particle == PROTON) {
+        if (charged == blocks.size()) {
+            b.push_back(detail::Block());
+            b.back().count = 1;
+        }
+        detail::adjustStoichiometryForProtonation<StoichiometryType,
+                SpectrumType>(b[charged].stoichiometry, charge);
+    }
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+void Mercury7<StoichiometryType, SpectrumType>::convertStoichiometry(
+    const StoichiometryType& stoichiometry, const int charge,
+    const Particle particle, detail::Stoichiometry& s) const
+{
+    // convert the user type to our internal type
     typename Traits<StoichiometryType, SpectrumType>::stoichiometry_converter
             stoi_conv;
     stoi_conv(stoichiometry, s);
@@ -102,7 +780,12 @@ SpectrumType Mercury7<StoichiometryType, SpectrumType>::operator()(
     if (charge != 0 && particle == PROTON) {
         detail::adjustStoichiometryForProtonation<StoichiometryType, SpectrumType>(s, charge);
     }
-    detail::Spectrum result = pImpl_->operator()(s, limit);
+}
+
+template<typename StoichiometryType, typename SpectrumType>
+SpectrumType Mercury7<StoichiometryType, SpectrumType>::convertSpectrum(
+    detail::Spectrum result, const int charge) const
+{
     // Do the charge adjustment. This is the same for all types of charges
     // because we adjusted the number of hydrogens earlier.
     if (charge != 0) {
@@ -131,6 +814,21 @@ Double Mercury7<StoichiometryType, SpectrumType>::getMonoisotopicMass(
     return pImpl_->getMonoisotopicMass(s);
 }
 
+template<typename StoichiometryType, typename SpectrumType>
+Double Mercury7<StoichiometryType, SpectrumType>::getMonoisotopicMz(
+    const StoichiometryType& stoichiometry, const int charge,
+    const Particle particle) const
+{
+    detail::Stoichiometry s;
+    convertStoichiometry(stoichiometry, charge, particle, s);
+    Double mz = pImpl_->getMonoisotopicMass(s);
+    if (charge != 0) {
+        Double e = Traits<StoichiometryType, SpectrumType>::getElectronMass();
+        mz = (mz - (charge * e)) / (abs)(charge);
+    }
+    return mz;
+}
+
 template<typename StoichiometryType, typename SpectrumType>
 Double Mercury7<StoichiometryType, SpectrumType>::getAverageMass(
     const StoichiometryType& stoichiometry) const
@@ -57,16 +57,81 @@
 #ifndef __LIBIPACA_INCLUDE_IPACA_MERCURY7IMPL_HPP__
 #define __LIBIPACA_INCLUDE_IPACA_MERCURY7IMPL_HPP__
 #include <ipaca/config.hpp>
+#include <ipaca/ApproximationThreshold.hpp>
+#include <ipaca/CompactMercury.hpp>
+#include <ipaca/ConvolutionKernels.hpp>
+#include <ipaca/ConvolutionPlan.hpp>
+#include <ipaca/OutputMode.hpp>
+#include <ipaca/PatternCache.hpp>
+#include <ipaca/PowerTable.hpp>
+#include <ipaca/PrunePolicy.hpp>
 #include <ipaca/Spectrum.hpp>
 #include <ipaca/Stoichiometry.hpp>
 #include <ipaca/Types.hpp>
+#include <boost/shared_ptr.hpp>
 #include <vector>
 #include <exception>
+#include <limits>
 #include <stdexcept>
 
 namespace ipaca {
 
 namespace detail {
+
+/** Restricts a calculation to a range of isotope indices of the result.
+ * The isotope index of a peak is its offset from the lightest possible
+ * configuration of the composition.
+ */
+struct IndexWindow
+{
+    /** The first and the last requested isotope index of the result.
+     */
+    Size first, last;
+    /** The largest possible isotope index of the complete composition.
+     */
+    Size span;
+
+    /** Get the peaks of a partial result that can still contribute to the
+     * window. A peak at isotope index i of the partial result ends up at
+     * an index between i and i + (span - partial span) of the result.
+     * @param offset The isotope index of the first peak of the partial
+     *               result.
+     * @param partialSpan The largest possible isotope index of the partial
+     *                    composition.
+     * @param lo Receives the first peak that can contribute.
+     * @param hi Receives one past the last peak that can contribute.
+     */
+    void clip(const Size offset, const Size partialSpan, Size& lo,
+        Size& hi) const;
+};
+
+/** The isotope abundances of one element at one enrichment level, in the
+ * order of the isotopes of the element.
+ */
+typedef std::vector<Double> Abundances;
+
+/** The isotope abundances of all labeled elements at one enrichment level.
+ */
+typedef std::vector<Abundances> Enrichment;
+
+/** A modified form of a compound, given as the number of occurrences of
+ * each modification.
+ */
+typedef std::vector<Size> Variant;
+
+/** A building block of a compound (e.g. a repeat unit of a polymer or a
+ * monosaccharide of a glycan) and the number of times it occurs.
+ */
+struct Block
+{
+    Stoichiometry stoichiometry;
+    Size count;
+};
+
+/** A compound given by its building blocks.
+ */
+typedef std::vector<Block> Blocks;
+
 /** Calculates a theoretical isotope distribution from an
  *  elemental composition (stoichiometry).
  *  @ingroup asap
@@ -74,6 +139,131 @@ namespace detail {
 class Mercury7Impl
 {
 public:
+    /** Constructor.
+     * @param mode The part of the isotope distribution to calculate.
+     */
+    explicit Mercury7Impl(const OutputMode& mode = OutputMode());
+
+    /** Set the part of the isotope distribution to calculate.
+     * @param mode The output mode.
+     */
+    void setOutputMode(const OutputMode& mode);
+
+    /** @return The current output mode.
+     */
+    const OutputMode& getOutputMode() const;
+
+    /** Switch to the mass-binned mode (see \c detail::binnedConvolve()).
+     * All intermediate results are kept as sparse peak lists in which
+     * peaks that cannot be resolved at the given resolution are merged.
+     * This yields isotopic fine structure at high resolutions and
+     * instrument-like centroids at lower ones. Policies with a fixed
+     * limit discard every peak at or below the limit, not only those at
+     * the ends. The mode applies to the calculation of single compounds,
+     * with or without a mass window; the approximation threshold is not
+     * applied.
+     * @param resolution The resolution (m/z over FWHM), or zero for the
+     *                   default of one peak per nominal isotope index.
+     */
+    void setMassResolution(const Double resolution);
+
+    /** @return The resolution of the mass-binned mode, or zero.
+     */
+    Double getMassResolution() const;
+
+    /** Set the floating-point type of the abundances. In single
+     * precision, exact calculations of single compounds use the compact
+     * engine with float abundances (see \c detail::compactMercury()),
+     * which moves half as many bytes per convolution; the relative error
+     * of the abundances is of the order of 1e-6, and limits are raised
+     * to the smallest normalized float. Policies with a fixed limit prune
+     * the leading and trailing peaks of every intermediate result; all
+     * other policies prune the result only. The mass-binned mode, the
+     * approximation threshold and the calculations of several compounds
+     * at once (sweeps, variants, blocks and series) are not affected.
+     * @param precision The precision; the default is \c DOUBLE_PRECISION.
+     */
+    void setPrecision(const Precision precision);
+
+    /** @return The floating-point type of the abundances.
+     */
+    Precision getPrecision() const;
+
+    /** Set the crossover points used to select the convolution kernels.
+     * By default, the process-wide calibration is used (see
+     * \c KernelCalibration::getDefault()).
+     * @param calibration The kernel calibration.
+     */
+    void setKernelCalibration(const KernelCalibration& calibration);
+
+    /** @return The kernel calibration in use.
+     */
+    const KernelCalibration& getKernelCalibration() const;
+
+    /** @return The kernel calibration in use and the number of
+     *          convolutions and peaks calculated by each kernel.
+     */
+    KernelStats getKernelStats() const;
+
+    /** Reset the kernel statistics.
+     */
+    void resetKernelStats();
+
+    /** Set the threshold above which the isotope distribution is
+     * approximated from the moments of the composition instead of being
+     * calculated exactly (see \c detail::approximateSpectrum()).
+     * @param threshold The approximation threshold.
+     */
+    void setApproximationThreshold(const ApproximationThreshold& threshold);
+
+    /** @return The approximation threshold.
+     */
+    const ApproximationThreshold& getApproximationThreshold() const;
+
+    /** Set a cache for the results of single compounds. The cache is
+     * consulted for all calculations with an absolute limit (see
+     * \c AbsoluteLimitPrunePolicy) that do not ask for the discarded
+     * abundance; the key contains the canonical composition and all
+     * settings that affect the result.
+     * @param cache The cache, or null to disable caching.
+     */
+    void setPatternCache(const boost::shared_ptr<PatternCache>& cache);
+
+    /** @return The pattern cache, or null.
+     */
+    const boost::shared_ptr<PatternCache>& getPatternCache() const;
+
+    /** Calculate the powers E^1, E^2, ..., E^(2^k) of a set of elements,
+     * with 2^k <= \a maxCount, pruned at an absolute limit.
+     * @param isotopes The isotope tables of the elements.
+     * @param limit The abundance limit.
+     * @param maxCount The largest atom count the table is used for.
+     */
+    boost::shared_ptr<const PowerTable> createPowerTable(
+        const std::vector<detail::Isotopes>& isotopes, const Double limit,
+        const Size maxCount) const;
+
+    /** Use a table of element powers. Elements that are evaluated along
+     * an addition chain take the binary route through the table instead,
+     * if the table covers their isotope table and atom count and the
+     * calculation uses the absolute limit of the table.
+     * @param table The table, or null.
+     */
+    void setPowerTable(const boost::shared_ptr<const PowerTable>& table);
+
+    /** @return The table of element powers, or null.
+     */
+    const boost::shared_ptr<const PowerTable>& getPowerTable() const;
+
+    /** Get the error bound of the approximation for a stoichiometry,
+     * whether or not the approximation is used for it.
+     * @param stoichiometry The stoichiometry.
+     * @return The bound on the absolute abundance error of every peak
+     *         (see \c detail::getApproximationErrorBound()).
+     */
+    Double getApproximationErrorBound(
+        const detail::Stoichiometry& stoichiometry) const;
+
     /** Functor method to calculate the theoretical isotope
      *         distribution of a compound.
      * @param stoichiometry The stoichiometry for which the isotope
@@ -96,6 +286,133 @@ public:
     operator()(const detail::Stoichiometry& stoichiometry,
         const Double limit = 1e-26) const;
 
+    /** Functor method to calculate the theoretical isotope
+     *         distribution of a compound using a custom pruning strategy.
+     * @param stoichiometry The stoichiometry for which the isotope
+     *                      distribution should be calculated.
+     * @param policy The policy that decides which peaks of the
+     *               intermediate results are discarded.
+     * @param discarded If non-null, receives the total abundance that has
+     *                  been lost due to pruning, i.e. the difference between
+     *                  the total abundance of the exact and the returned
+     *                  distribution. This includes the peaks that are
+     *                  dropped due to the output mode.
+     */
+    detail::Spectrum
+    operator()(const detail::Stoichiometry& stoichiometry,
+        const PrunePolicy& policy, Double* discarded = 0) const;
+
+    /** Calculate the part of the isotope distribution of a compound within
+     * a mass window. The window is mapped to a range of isotope indices,
+     * using the smallest and largest mass increment per isotope index of
+     * all elements; intermediate results are clipped to the peaks that can
+     * still contribute to that range.
+     * @param stoichiometry The stoichiometry for which the isotope
+     *                      distribution should be calculated.
+     * @param massMin The lower end of the (neutral) mass window.
+     * @param massMax The upper end of the (neutral) mass window.
+     * @param policy The policy that decides which peaks of the
+     *               intermediate results are discarded.
+     * @return The peaks with a mass within [massMin, massMax].
+     */
+    detail::Spectrum
+    operator()(const detail::Stoichiometry& stoichiometry,
+        const Double massMin, const Double massMax,
+        const PrunePolicy& policy) const;
+
+    /** Calculate the isotope distributions of a compound at several
+     * isotope enrichment levels, e.g. for a 13C or 15N labeling curve.
+     * The distribution of the unlabeled elements is calculated once and
+     * convolved with the distribution of the labeled elements at each
+     * level, hence each additional level only costs the power chains of
+     * the labeled elements and one convolution. The labeled elements are
+     * planned anew at each level, since their plans depend on the
+     * abundances (see \c detail::ConvolutionPlanner); planning is cheap
+     * compared to the convolutions.
+     *
+     * The approximation threshold is not applied. For policies without
+     * a fixed limit, the budget is split evenly between the unlabeled
+     * part, the labeled part and their convolution.
+     * @param stoichiometry The stoichiometry; the abundances of the
+     *                      labeled elements are replaced at each level.
+     * @param labeled The indices of the labeled elements in
+     *                \a stoichiometry.
+     * @param enrichments The enrichment levels. Each level holds one
+     *                    abundance vector per labeled element, with one
+     *                    entry per isotope of that element.
+     * @param policy The policy that decides which peaks of the
+     *               intermediate results are discarded.
+     * @param spectra Receives one isotope distribution per level.
+     */
+    void sweep(const detail::Stoichiometry& stoichiometry,
+        const std::vector<Size>& labeled,
+        const std::vector<Enrichment>& enrichments,
+        const PrunePolicy& policy,
+        std::vector<detail::Spectrum>& spectra) const;
+
+    /** Calculate the isotope distributions of the modified forms of a
+     * compound, e.g. of a peptide with variable modifications.
+     *
+     * The modifications are elemental deltas that may remove atoms (e.g.
+     * deamidation). Elements of the deltas are identified with elements
+     * of the compound by their isotope distributions. The atoms that are
+     * common to all variants form the core, whose distribution is
+     * calculated once. Each variant is the core plus a small residual
+     * composition; variants with the same total delta share the residual
+     * and are only calculated once. Hence every distinct variant costs
+     * one small residual pattern and one convolution.
+     *
+     * The approximation threshold is not applied. For policies without
+     * a fixed limit, the budget is split evenly between the core, the
+     * residual and their convolution.
+     * @param stoichiometry The stoichiometry of the unmodified compound.
+     * @param deltas The elemental composition changes of the
+     *               modifications; counts may be negative.
+     * @param variants The modified forms; each holds one count per
+     *                 modification.
+     * @param policy The policy that decides which peaks of the
+     *               intermediate results are discarded.
+     * @param spectra Receives one isotope distribution per variant.
+     */
+    void variants(const detail::Stoichiometry& stoichiometry,
+        const std::vector<detail::Stoichiometry>& deltas,
+        const std::vector<Variant>& variants, const PrunePolicy& policy,
+        std::vector<detail::Spectrum>& spectra) const;
+
+    /** Calculate the isotope distribution of a compound that is made up
+     * of building blocks. The pruned distribution of each block is
+     * calculated once and raised to the power of its multiplicity along
+     * the same addition chains that are used for the elements (see
+     * \c detail::ConvolutionPlanner), i.e. every block is treated as a
+     * single "element" whose isotopes are the peaks of its distribution.
+     *
+     * The approximation threshold is not applied. For policies without
+     * a fixed limit, half of the budget is spent on the blocks, split
+     * according to their multiplicities, and half on the powers.
+     * @param blocks The building blocks.
+     * @param policy The policy that decides which peaks of the
+     *               intermediate results are discarded.
+     */
+    detail::Spectrum
+    operator()(const Blocks& blocks, const PrunePolicy& policy) const;
+
+    /** Calculate the isotope distributions of a polydisperse series
+     * ends + unit^n for n = nMin, ..., nMax. The distribution of unit^nMin
+     * is calculated along an addition chain; every further member only
+     * costs one convolution with the distribution of the unit and one
+     * with the end groups.
+     * @param ends The end groups; may be empty.
+     * @param unit The repeat unit.
+     * @param nMin The smallest number of repeat units.
+     * @param nMax The largest number of repeat units.
+     * @param policy The policy that decides which peaks of the
+     *               intermediate results are discarded.
+     * @param spectra Receives nMax - nMin + 1 isotope distributions.
+     */
+    void series(const Blocks& ends, const detail::Stoichiometry& unit,
+        const Size nMin, const Size nMax, const PrunePolicy& policy,
+        std::vector<detail::Spectrum>& spectra) const;
+
     /** calculate the monoisotopic mass of a given stoichiometry
      *  @param stoichiometry The stoichiometry to calculate the mass for.
      *  @param charge The charge at which the monoisotopic mass is desired
@@ -112,25 +429,170 @@ public:
     Double getAverageMass(const detail::Stoichiometry& stoichiometry) const;
 
 private:
+    /** Calculate the exact theoretical isotope distribution of a
+     * compound.
+     * @param budget The fraction of the error budget of \a policy that
+     *               may be spent on this compound.
+     */
+    void exactMercury(const detail::Stoichiometry& stoichiometry,
+        const PrunePolicy& policy, detail::Spectrum& result,
+        const IndexWindow* window = 0, const Double budget = 1.0) const;
+
+    /** Calculate the first \c getMaxPeaks() peaks of the exact theoretical
+     * isotope distribution of a compound in \c FIRST_N mode.
+     * @param policy A policy with a fixed limit.
+     */
+    void firstMercury(const detail::Stoichiometry& stoichiometry,
+        const PrunePolicy& policy, detail::Spectrum& result) const;
+
+    /** Calculate the isotope distribution of a compound made up of
+     * building blocks.
+     * @param budget The fraction of the error budget of \a policy that
+     *               may be spent on this compound.
+     */
+    void blockMercury(const Blocks& blocks, const PrunePolicy& policy,
+        const Double budget, detail::Spectrum& result) const;
+
+    /** Calculate the isotope distribution of a compound in single
+     * precision (see \c setPrecision()).
+     */
+    void singleMercury(const detail::Stoichiometry& stoichiometry,
+        const PrunePolicy& policy, detail::Spectrum& result) const;
+
+    /** Calculate an isotope distribution in the mass-binned mode.
+     */
+    void binnedMercury(const detail::Stoichiometry& stoichiometry,
+        const PrunePolicy& policy, detail::Spectrum& result) const;
+
+    /** Prune a sparse peak list of the mass-binned mode.
+     */
+    void prunePeaks(detail::Spectrum& s, const PrunePolicy& policy,
+        const Double share) const;
+
+    /** Map a mass window to isotope indices.
+     * @return False if no peak can fall into the window.
+     */
+    Bool getIndexWindow(const detail::Stoichiometry& stoichiometry,
+        const Double massMin, const Double massMax,
+        IndexWindow& window) const;
+
+    /** Build the pattern cache key of a calculation.
+     */
+    void getCacheKey(const detail::Stoichiometry& stoichiometry,
+        const Double limit, std::string& key) const;
+
+    /** Check if a stoichiometry exceeds the approximation threshold.
+     * @param limit The abundance limit used to estimate the peak count.
+     */
+    Bool useApproximation(const detail::Stoichiometry& stoichiometry,
+        const Double limit) const;
+
     /** Calculate the theoretical isotope distribution of a compound
      * of integer stoichiometries.
+     * @param stoichiometry The integer stoichiometry.
+     * @param plan The plan that specifies how each element is
+     *             evaluated and in which order the element contributions
+     *             are combined (see \c detail::ConvolutionPlanner).
+     * @param window If non-null, restricts the calculation to the peaks
+     *               that can contribute to the window.
+     * @return The isotope index of the first peak.
+     */
+    Size integerMercury(const detail::Stoichiometry& stoichiometry,
+        const detail::ConvolutionPlan& plan, const PrunePolicy& policy,
+        const Double share, detail::Spectrum& spectrum,
+        const IndexWindow* window = 0) const;
+
+    /** Calculate the isotope distribution of all atoms of a single element,
+     * either in closed form (see \c detail::closedFormPattern) or along
+     * the addition chain of the element plan.
+     * @return The isotope index of the first peak.
+     */
+    Size elementMercury(const detail::Element& element,
+        const detail::ElementPlan& plan, const PrunePolicy& policy,
+        const Double share, detail::Spectrum& result,
+        const IndexWindow* window = 0) const;
+
+    /** Calculate E^n by multiplying the powers E^(2^k) of the power table
+     * for all bits k of n.
+     * @param element The index of the element in the power table.
+     * @return The isotope index of the first peak.
      */
-    void integerMercury(const detail::Stoichiometry& stoichiometry,
-        const Double limit, detail::Spectrum& spectrum) const;
+    Size powerMercury(const Size element, const Size n,
+        const PrunePolicy& policy, const Double share,
+        detail::Spectrum& result) const;
 
     /** Calculate the theoretical isotope distribution of a compound
      * of fractional stoichiometries.
      */
     void fractionalMercury(const detail::Stoichiometry& stoichiometry,
-        const Double limit, detail::Spectrum& spectrum) const;
+        detail::Spectrum& spectrum) const;
 
-    /** Convolves two isotope distributions.
+    /** Convolves two isotope distributions. If both operands refer to
+     * the same spectrum, a dedicated squaring kernel is used that exploits
+     * the symmetry of the self-convolution.
      * @param s1 Spectrum on the left hand side of the convolution.
      * @param s2 Spectrum on the right hand side of the convolution.
      * @param result The result of the convolution.
+     * @param maxPeaks The maximum number of peaks to calculate, counted
+     *                 from the lightest one.
      */
     void convolve(const detail::Spectrum& s1, const detail::Spectrum& s2,
-        detail::Spectrum& result) const;
+        detail::Spectrum& result,
+        const Size maxPeaks = std::numeric_limits<Size>::max()) const;
+
+    /** Convolves two isotope distributions and prunes the result against
+     * an absolute abundance limit in a single pass. Only the surviving
+     * peaks are calculated and stored; the tails are skipped based on an
+     * upper bound derived from the cumulative abundances of the operands.
+     * @param s1 Spectrum on the left hand side of the convolution.
+     * @param s2 Spectrum on the right hand side of the convolution.
+     * @param result The pruned result of the convolution.
+     * @param limit The abundance limit at or below which peaks are
+     *              discarded from both ends of the result.
+     * @param maxPeaks The maximum number of peaks to calculate, counted
+     *                 from the first one above the limit.
+     * @param lo Peaks of the convolution before \a lo are skipped.
+     * @param hi Peaks of the convolution at or after \a hi are skipped.
+     * @return The index of the first peak of the result within the
+     *         convolution.
+     */
+    Size convolveAndPrune(const detail::Spectrum& s1,
+        const detail::Spectrum& s2, detail::Spectrum& result,
+        const Double limit,
+        const Size maxPeaks = std::numeric_limits<Size>::max(),
+        const Size lo = 0,
+        const Size hi = std::numeric_limits<Size>::max()) const;
+
+    /** Calculates the peaks [first, last) of a convolution with the
+     * fastest kernel for the operand sizes, according to the calibration.
+     * @param result Must hold last - first peaks.
+     */
+    void convolveRange(const detail::Spectrum& s1, const detail::Spectrum& s2,
+        const Size first, const Size last, detail::Spectrum& result) const;
+
+    /** Convolves and prunes two isotope distributions; uses the fused
+     * kernel if the prune policy permits. At most \a maxPeaks peaks are
+     * kept, counted from the first one that survives pruning.
+     * @return The index of the first peak of the result within the
+     *         convolution.
+     */
+    Size convolveAndPrune(const detail::Spectrum& s1,
+        const detail::Spectrum& s2, detail::Spectrum& result,
+        const PrunePolicy& policy, const Double share,
+        const Size maxPeaks, const Size lo = 0,
+        const Size hi = std::numeric_limits<Size>::max()) const;
+
+    /** @return The maximum number of peaks of a result in the current
+     *          output mode.
+     */
+    Size getMaxPeaks() const;
+
+    /** Keeps only the \a k most abundant peaks of a spectrum; the
+     * remaining peaks stay in order of increasing mass.
+     * @param spectrum A \c detail::Spectrum object.
+     * @param k The number of peaks to keep.
+     */
+    void selectTopK(detail::Spectrum& spectrum, const Size k) const;
 
     /** Prunes sparse isotope distributions based on the observed intensities.
      * @param spectrum A \c detail::Spectrum object.
@@ -141,6 +603,36 @@ private:
      * below the abundance limit.
      */
     void prune(detail::Spectrum& spectrum, const Double limit) const;
+
+    /** Prunes an isotope distribution according to a prune policy.
+     * @param spectrum A \c detail::Spectrum object.
+     * @param policy The prune policy that decides which peaks survive.
+     * @param share The share of the error budget available for this step.
+     * @param first If non-null, receives the number of peaks discarded at
+     *              the light end.
+     * @return The total abundance of the discarded peaks.
+     */
+    Double prune(detail::Spectrum& spectrum, const PrunePolicy& policy,
+        const Double share, Size* first = 0) const;
+
+    /** Discards the peaks of a partial result that cannot contribute to
+     * a window.
+     * @param offset The isotope index of the first peak; updated.
+     * @param partialSpan The largest possible isotope index of the partial
+     *                    composition.
+     */
+    void clip(detail::Spectrum& spectrum, Size& offset,
+        const Size partialSpan, const IndexWindow* window) const;
+
+    OutputMode mode_;
+    boost::shared_ptr<detail::ConvolutionPlanner> planner_;
+    KernelCalibration calibration_;
+    boost::shared_ptr<detail::KernelCounters> counters_;
+    ApproximationThreshold threshold_;
+    Double resolution_;
+    Precision precision_;
+    boost::shared_ptr<PatternCache> cache_;
+    boost::shared_ptr<const PowerTable> powers_;
 };
 
 } // namespace detail
@@ -0,0 +1,114 @@
+/*
+ * MomentApproximation.hpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+
+#ifndef __LIBIPACA_INCLUDE_IPACA_MOMENTAPPROXIMATION_HPP__
+#define __LIBIPACA_INCLUDE_IPACA_MOMENTAPPROXIMATION_HPP__
+
+#include <ipaca/config.hpp>
+#include <ipaca/Spectrum.hpp>
+#include <ipaca/Stoichiometry.hpp>
+#include <ipaca/Types.hpp>
+
+namespace ipaca {
+
+namespace detail {
+
+/** The moments of the isotope distribution of a compound, accumulated
+ * analytically from the per-atom isotope distributions. The isotope
+ * index of an atom is the offset of its isotope entry; the index of a
+ * compound is the sum over all atoms. Fractional atoms are treated as in
+ * \c Mercury7Impl, i.e. as a mixture of "no atom" and a full atom.
+ */
+struct CompositionMoments
+{
+    /** The total abundance, i.e. the product of the total abundances
+     * of all atoms.
+     */
+    Double total;
+    /** Mean and variance of the isotope index.
+     */
+    Double indexMean, indexVariance;
+    /** The sum of the third absolute central moments of the atoms.
+     */
+    Double absoluteThirdMoment;
+    /** The average mass and the covariance of mass and isotope index.
+     */
+    Double massMean, massIndexCovariance;
+    /** Whether every atom only has isotope entries at offsets 0 and 1, in
+     * which case the index is a sum of independent Bernoulli variables.
+     */
+    Bool bernoulli;
+    /** The sum of the squared success probabilities, if \c bernoulli.
+     */
+    Double bernoulliSquares;
+    /** The largest possible isotope index.
+     */
+    Double maxIndex;
+};
+
+/** Calculate the moments of the isotope distribution of a compound.
+ * @param stoichiometry The stoichiometry.
+ * @return The moments.
+ */
+CompositionMoments getCompositionMoments(const Stoichiometry& stoichiometry);
+
+/** The distributions used to approximate the isotope index.
+ */
+enum ApproximationModel
+{
+    GAUSSIAN_MODEL, POISSON_MODEL
+};
+
+/** Get the error bound of an approximation. The bound holds for the
+ * abundance of every single peak (before pruning):
+ *
+ * \li Gaussian model: the peaks are differences of the normal CDF at
+ *     k -/+ 1/2, hence by the Berry-Esseen theorem for independent,
+ *     non-identically distributed summands the error is at most
+ *     2 * 0.5600 * sum(rho_i) / sigma^3 of the total abundance, where
+ *     rho_i are the third absolute central moments of the atoms.
+ * \li Poisson model (Bernoulli atoms only): by the Barbour-Hall bound,
+ *     the total variation distance to Poisson(lambda) is at most
+ *     (1 - exp(-lambda)) / lambda * sum(p_i^2).
+ *
+ * @param moments The moments of the compound.
+ * @param model The approximation model.
+ * @return The bound on the absolute abundance error of each peak; at most
+ *         the total abundance.
+ */
+Double getApproximationErrorBound(const CompositionMoments& moments,
+    const ApproximationModel model);
+
+/** @return The model with the smaller error bound for a compound.
+ */
+ApproximationModel selectApproximationModel(const CompositionMoments& moments);
+
+/** Approximate the isotope distribution of a compound from its moments.
+ *
+ * The isotope index is approximated by a normal distribution (with
+ * continuity correction) or, for compounds of Bernoulli atoms with a
+ * tighter bound, by a Poisson distribution. The mass of the k-th peak is
+ * the linear regression of mass on index, i.e. the average mass shifted
+ * by cov(mass, index) / var(index) per index unit.
+ *
+ * The peaks are evaluated from the mode outward until their abundance
+ * drops to or below \a cutoff. The cost is proportional to the number of
+ * peaks and independent of the number of atoms.
+ * @param stoichiometry The stoichiometry.
+ * @param cutoff The abundance at or below which peaks are discarded.
+ * @param spectrum Receives the approximate isotope distribution.
+ * @param model If non-null, receives the model that has been used.
+ * @return The error bound (see \c getApproximationErrorBound()).
+ */
+Double approximateSpectrum(const Stoichiometry& stoichiometry,
+    const Double cutoff, Spectrum& spectrum, ApproximationModel* model = 0);
+
+} // namespace detail
+
+} // namespace ipaca
+
+#endif /* __LIBIPACA_INCLUDE_IPACA_MOMENTAPPROXIMATION_HPP__ */
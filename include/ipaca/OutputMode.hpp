@@ -0,0 +1,96 @@
+/*
+ * OutputMode.hpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+
+#ifndef __LIBIPACA_INCLUDE_IPACA_OUTPUTMODE_HPP__
+#define __LIBIPACA_INCLUDE_IPACA_OUTPUTMODE_HPP__
+
+#include <ipaca/config.hpp>
+#include <ipaca/Error.hpp>
+#include <ipaca/Types.hpp>
+
+namespace ipaca {
+
+/** Specifies which part of an isotope distribution is requested.
+ *
+ * Many clients only look at the first few isotope peaks or at the most
+ * abundant ones. Restricting the output allows the engine to truncate
+ * intermediate results early and bounds the cost per call.
+ *
+ * \li \c ALL: the complete (pruned) distribution.
+ * \li \c FIRST_N: the first N peaks of the pruned distribution, i.e.
+ *     counted from the first peak above the limit. As the peaks up to an
+ *     isotope index only depend on the peaks up to that index of the
+ *     operands, intermediate results are clipped to the indices that
+ *     hold the first N peaks.
+ * \li \c TOP_K: the K most abundant peaks, in order of increasing mass.
+ *     The selection is made on the final distribution.
+ */
+class OutputMode
+{
+public:
+    enum Type
+    {
+        ALL, FIRST_N, TOP_K
+    };
+
+    /** Default constructor; requests the complete distribution.
+     */
+    OutputMode() :
+        type_(ALL), count_(0)
+    {
+    }
+
+    /** @return An output mode that requests the complete distribution.
+     */
+    static OutputMode all()
+    {
+        return OutputMode();
+    }
+
+    /** @param n The number of peaks, counted from the lightest one.
+     * @return An output mode that requests the first \a n peaks.
+     */
+    static OutputMode firstN(const Size n)
+    {
+        ipaca_precondition(n > 0, "OutputMode::firstN: n must be positive.");
+        return OutputMode(FIRST_N, n);
+    }
+
+    /** @param k The number of peaks.
+     * @return An output mode that requests the \a k most abundant peaks.
+     */
+    static OutputMode topK(const Size k)
+    {
+        ipaca_precondition(k > 0, "OutputMode::topK: k must be positive.");
+        return OutputMode(TOP_K, k);
+    }
+
+    Type getType() const
+    {
+        return type_;
+    }
+
+    /** @return The number of requested peaks (zero for \c ALL).
+     */
+    Size getCount() const
+    {
+        return count_;
+    }
+
+private:
+    OutputMode(const Type type, const Size count) :
+        type_(type), count_(count)
+    {
+    }
+
+    Type type_;
+    Size count_;
+};
+
+} // namespace ipaca
+
+#endif /* __LIBIPACA_INCLUDE_IPACA_OUTPUTMODE_HPP__ */
@@ -0,0 +1,65 @@
+/*
+ * PatternCache.hpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+
+#ifndef __LIBIPACA_INCLUDE_IPACA_PATTERNCACHE_HPP__
+#define __LIBIPACA_INCLUDE_IPACA_PATTERNCACHE_HPP__
+
+#include <ipaca/config.hpp>
+#include <ipaca/Spectrum.hpp>
+#include <ipaca/Stoichiometry.hpp>
+#include <ipaca/Types.hpp>
+#include <string>
+
+namespace ipaca {
+
+/** The interface of a cache for calculated isotope distributions (see
+ * \c Mercury7::setPatternCache()).
+ *
+ * The keys are opaque byte strings that encode the canonical composition
+ * and all settings that affect the result. Implementations must be
+ * thread-safe; they may drop entries at any time.
+ */
+class PatternCache
+{
+public:
+    virtual ~PatternCache();
+
+    /** Look up a distribution.
+     * @param key The key.
+     * @param spectrum Receives the distribution.
+     * @return True if the key has been found.
+     */
+    virtual Bool find(const std::string& key,
+        detail::Spectrum& spectrum) const = 0;
+
+    /** Store a distribution. Implementations may ignore the request, e.g.
+     * if the distribution does not fit into their storage.
+     * @param key The key.
+     * @param spectrum The distribution.
+     */
+    virtual void insert(const std::string& key,
+        const detail::Spectrum& spectrum) = 0;
+};
+
+namespace detail {
+
+/** Append the canonical form of a stoichiometry to a key. Elements are
+ * identified by their isotope tables and sorted; entries with the same
+ * isotope table and integral counts are merged and empty entries are
+ * dropped. Hence, two stoichiometries that only differ in the order or the
+ * splitting of their integral entries yield the same key. Fractional
+ * counts are kept apart: C_1.5 C_1.5 and C_3 have different spectra.
+ * @param s The stoichiometry.
+ * @param key The key.
+ */
+void appendCanonicalStoichiometry(const Stoichiometry& s, std::string& key);
+
+} // namespace detail
+
+} // namespace ipaca
+
+#endif /* __LIBIPACA_INCLUDE_IPACA_PATTERNCACHE_HPP__ */
@@ -0,0 +1,89 @@
+/*
+ * PatternClient.hpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+
+#ifndef __LIBIPACA_INCLUDE_IPACA_PATTERNCLIENT_HPP__
+#define __LIBIPACA_INCLUDE_IPACA_PATTERNCLIENT_HPP__
+
+#include <ipaca/config.hpp>
+#include <ipaca/PatternService.hpp>
+#include <ipaca/Stoichiometry.hpp>
+#include <ipaca/Types.hpp>
+#include <boost/noncopyable.hpp>
+#include <string>
+
+namespace ipaca {
+
+/** A connection to a pattern server (see \c PatternServer).
+ *
+ * Requests can be pipelined: \c send() returns immediately, and
+ * \c receive() returns the responses in the order of the requests. The
+ * server stops reading from a connection with a large backlog of
+ * unread responses, so very long pipelines must be interleaved with
+ * \c receive() calls. The synchronous calls require that no responses
+ * are pending. A client must not be used by several threads at once.
+ */
+class PatternClient : private boost::noncopyable
+{
+public:
+    /** Constructor. Connects to the server.
+     * @param path The path of the server socket.
+     * @throws RuntimeError The server is not reachable.
+     */
+    explicit PatternClient(const String& path);
+
+    ~PatternClient();
+
+    /** Add an element to the element table of this connection.
+     * @param isotopes The isotopes, lightest first.
+     * @return The element id.
+     * @throws ParameterError The server rejected the element.
+     */
+    Size addElement(const detail::Isotopes& isotopes);
+
+    /** Select the element to which charge protons are added (see
+     * \c ipaca_calculator_set_hydrogen()).
+     */
+    void setHydrogen(const Size element);
+
+    /** Send a batch without waiting for the result.
+     * @return The request id.
+     */
+    Size send(const PatternRequest& request);
+
+    /** Receive the response to the oldest pending request.
+     * @param response Receives the response.
+     * @return The request id.
+     */
+    Size receive(PatternResponse& response);
+
+    /** Send a batch and wait for the result.
+     */
+    PatternResponse calculate(const PatternRequest& request);
+
+    /** @return The counters of the server.
+     */
+    ServiceStats getStats();
+
+    /** @return The number of requests whose responses have not been
+     *          received.
+     */
+    Size getPending() const;
+
+private:
+    Size sendFrame(const detail::ServiceMessage type,
+        const std::string& payload);
+    Size receiveFrame(detail::ServiceHeader& header, std::string& payload);
+    void call(const detail::ServiceMessage type, const std::string& payload,
+        detail::ServiceHeader& header, std::string& response);
+    int fd_;
+    Size nextId_;
+    Size pending_;
+};
+
+} // namespace ipaca
+
+#endif /* __LIBIPACA_INCLUDE_IPACA_PATTERNCLIENT_HPP__ */
@@ -0,0 +1,284 @@
+/*
+ * PatternIndex.hpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+
+#ifndef __LIBIPACA_INCLUDE_IPACA_PATTERNINDEX_HPP__
+#define __LIBIPACA_INCLUDE_IPACA_PATTERNINDEX_HPP__
+
+#include <ipaca/config.hpp>
+#include <ipaca/Error.hpp>
+#include <ipaca/MassIndex.hpp>
+#include <ipaca/Types.hpp>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace ipaca {
+
+/** An in-memory index over a library of precomputed isotope patterns,
+ * keyed by charge and monoisotopic m/z.
+ *
+ * Patterns are added together with their monoisotopic m/z, e.g.
+ * \code
+ * index.add(mercury(s, z, P::PROTON), mercury.getMonoisotopicMz(s, z,
+ *     P::PROTON), z);
+ * \endcode
+ * and \c build() sets up one \c detail::MassIndex per charge. Queries
+ * return ranges of pointers to the stored patterns (in order of
+ * increasing monoisotopic m/z); nothing is copied. The ranges remain
+ * valid until the next call to \c add() or \c build().
+ */
+template<typename SpectrumType>
+class PatternIndex
+{
+public:
+    typedef typename std::vector<const SpectrumType*>::const_iterator
+            const_iterator;
+    typedef std::pair<const_iterator, const_iterator> Range;
+
+    /** Default constructor; creates an empty index.
+     */
+    PatternIndex();
+
+    /** Copy constructor. The copy refers to its own patterns, hence it is
+     * rebuilt if \a rhs is built.
+     */
+    PatternIndex(const PatternIndex& rhs);
+
+    PatternIndex& operator=(const PatternIndex& rhs);
+
+    /** Add a pattern to the library. The index must be rebuilt before
+     * the next query.
+     * @param pattern The isotope pattern.
+     * @param monoisotopicMz The monoisotopic m/z of the pattern.
+     * @param charge The charge of the pattern.
+     * @return The id of the pattern.
+     */
+    Size add(const SpectrumType& pattern, const Double monoisotopicMz,
+        const Int charge);
+
+    /** Build the index over all patterns added so far.
+     */
+    void build();
+
+    /** @return The number of patterns.
+     */
+    Size size() const;
+
+    const SpectrumType& getPattern(const Size id) const;
+
+    Double getMonoisotopicMz(const Size id) const;
+
+    Int getCharge(const Size id) const;
+
+    /** @return The id of a pattern returned by a query.
+     */
+    Size getId(const SpectrumType* pattern) const;
+
+    /** Find all patterns of a charge whose monoisotopic m/z is within a
+     * relative tolerance of \a mz.
+     * @param mz The m/z.
+     * @param charge The charge.
+     * @param tolerance The tolerance in ppm of \a mz.
+     * @return The patterns, in order of increasing monoisotopic m/z.
+     */
+    Range find(const Double mz, const Int charge,
+        const Double tolerance = 5.0) const;
+
+    /** Find the patterns for a batch of m/z values at once.
+     * @param mz The m/z values.
+     * @param charge The charge.
+     * @param tolerance The tolerance in ppm.
+     * @param ranges Receives one range per m/z value.
+     */
+    void find(const std::vector<Double>& mz, const Int charge,
+        const Double tolerance, std::vector<Range>& ranges) const;
+
+private:
+    /** The patterns of one charge.
+     */
+    struct Group
+    {
+        detail::MassIndex index;
+        std::vector<const SpectrumType*> patterns;
+    };
+
+    /** @return The patterns of a charge, or null.
+     */
+    const Group* getGroup(const Int charge) const;
+
+    std::vector<SpectrumType> patterns_;
+    std::vector<Double> mz_;
+    std::vector<Int> charges_;
+    std::map<Int, Group> groups_;
+    std::vector<const SpectrumType*> empty_;
+    Bool built_;
+};
+
+//
+// template implementation
+//
+
+template<typename SpectrumType>
+PatternIndex<SpectrumType>::PatternIndex() :
+    built_(true)
+{
+}
+
+template<typename SpectrumType>
+PatternIndex<SpectrumType>::PatternIndex(const PatternIndex& rhs) :
+    patterns_(rhs.patterns_), mz_(rhs.mz_), charges_(rhs.charges_),
+        built_(false)
+{
+    if (rhs.built_) {
+        build();
+    }
+}
+
+template<typename SpectrumType>
+PatternIndex<SpectrumType>& PatternIndex<SpectrumType>::operator=(
+    const PatternIndex& rhs)
+{
+    if (this != &rhs) {
+        patterns_ = rhs.patterns_;
+        mz_ = rhs.mz_;
+        charges_ = rhs.charges_;
+        groups_.clear();
+        built_ = false;
+        if (rhs.built_) {
+            build();
+        }
+    }
+    return *this;
+}
+
+template<typename SpectrumType>
+Size PatternIndex<SpectrumType>::add(const SpectrumType& pattern,
+    const Double monoisotopicMz, const Int charge)
+{
+    patterns_.push_back(pattern);
+    mz_.push_back(monoisotopicMz);
+    charges_.push_back(charge);
+    built_ = false;
+    return patterns_.size() - 1;
+}
+
+template<typename SpectrumType>
+void PatternIndex<SpectrumType>::build()
+{
+    // collect the ids per charge
+    std::map<Int, std::vector<Size> > ids;
+    for (Size k = 0; k < patterns_.size(); ++k) {
+        ids[charges_[k]].push_back(k);
+    }
+    groups_.clear();
+    typedef typename std::map<Int, std::vector<Size> >::const_iterator MCI;
+    for (MCI i = ids.begin(); i != ids.end(); ++i) {
+        const std::vector<Size>& members = i->second;
+        std::vector<Double> masses(members.size());
+        for (Size k = 0; k < members.size(); ++k) {
+            masses[k] = mz_[members[k]];
+        }
+        Group& g = groups_[i->first];
+        g.index.build(masses);
+        g.patterns.resize(members.size());
+        for (Size r = 0; r < members.size(); ++r) {
+            g.patterns[r] = &patterns_[members[g.index.getId(r)]];
+        }
+    }
+    built_ = true;
+}
+
+template<typename SpectrumType>
+Size PatternIndex<SpectrumType>::size() const
+{
+    return patterns_.size();
+}
+
+template<typename SpectrumType>
+const SpectrumType& PatternIndex<SpectrumType>::getPattern(const Size id) const
+{
+    ipaca_precondition(id < patterns_.size(),
+        "PatternIndex::getPattern: id out of range.");
+    return patterns_[id];
+}
+
+template<typename SpectrumType>
+Double PatternIndex<SpectrumType>::getMonoisotopicMz(const Size id) const
+{
+    ipaca_precondition(id < mz_.size(),
+        "PatternIndex::getMonoisotopicMz: id out of range.");
+    return mz_[id];
+}
+
+template<typename SpectrumType>
+Int PatternIndex<SpectrumType>::getCharge(const Size id) const
+{
+    ipaca_precondition(id < charges_.size(),
+        "PatternIndex::getCharge: id out of range.");
+    return charges_[id];
+}
+
+template<typename SpectrumType>
+Size PatternIndex<SpectrumType>::getId(const SpectrumType* pattern) const
+{
+    ipaca_precondition(!patterns_.empty() && pattern >= &patterns_[0]
+            && pattern < &patterns_[0] + patterns_.size(),
+        "PatternIndex::getId: unknown pattern.");
+    return static_cast<Size>(pattern - &patterns_[0]);
+}
+
+template<typename SpectrumType>
+const typename PatternIndex<SpectrumType>::Group*
+PatternIndex<SpectrumType>::getGroup(const Int charge) const
+{
+    ipaca_precondition(built_,
+        "PatternIndex: the index must be rebuilt after adding patterns.");
+    typename std::map<Int, Group>::const_iterator i = groups_.find(charge);
+    return i == groups_.end() ? 0 : &i->second;
+}
+
+template<typename SpectrumType>
+typename PatternIndex<SpectrumType>::Range PatternIndex<SpectrumType>::find(
+    const Double mz, const Int charge, const Double tolerance) const
+{
+    const Group* g = getGroup(charge);
+    if (!g) {
+        return Range(empty_.begin(), empty_.end());
+    }
+    Double delta = mz * tolerance * 1e-6;
+    detail::MassIndex::Range r = g->index.find(mz - delta, mz + delta);
+    return Range(g->patterns.begin() + r.first, g->patterns.begin()
+            + r.second);
+}
+
+template<typename SpectrumType>
+void PatternIndex<SpectrumType>::find(const std::vector<Double>& mz,
+    const Int charge, const Double tolerance,
+    std::vector<Range>& ranges) const
+{
+    const Group* g = getGroup(charge);
+    ranges.assign(mz.size(), Range(empty_.begin(), empty_.end()));
+    if (!g || mz.empty()) {
+        return;
+    }
+    std::vector<Double> lo(mz.size()), hi(mz.size());
+    for (Size k = 0; k < mz.size(); ++k) {
+        Double delta = mz[k] * tolerance * 1e-6;
+        lo[k] = mz[k] - delta;
+        hi[k] = mz[k] + delta;
+    }
+    std::vector<detail::MassIndex::Range> r(mz.size());
+    g->index.find(&lo[0], &hi[0], mz.size(), &r[0]);
+    for (Size k = 0; k < mz.size(); ++k) {
+        ranges[k] = Range(g->patterns.begin() + r[k].first,
+            g->patterns.begin() + r[k].second);
+    }
+}
+
+} // namespace ipaca
+
+#endif /* __LIBIPACA_INCLUDE_IPACA_PATTERNINDEX_HPP__ */
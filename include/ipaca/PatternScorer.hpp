@@ -0,0 +1,135 @@
+/*
+ * PatternScorer.hpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+
+#ifndef __LIBIPACA_INCLUDE_IPACA_PATTERNSCORER_HPP__
+#define __LIBIPACA_INCLUDE_IPACA_PATTERNSCORER_HPP__
+
+#include <ipaca/config.hpp>
+#include <ipaca/Spectrum.hpp>
+#include <ipaca/Types.hpp>
+#include <vector>
+
+namespace ipaca {
+
+/** The similarity of an observed peak cluster and a theoretical isotope
+ * pattern.
+ */
+struct PatternScore
+{
+    /** The cosine of the abundance vectors; 1 is a perfect match.
+     */
+    Double cosine;
+    /** The Kullback-Leibler divergence of the candidate from the observed
+     * cluster; 0 is a perfect match.
+     */
+    Double kullbackLeibler;
+    /** The symmetric chi-squared distance, sum (o - c)^2 / (o + c), in
+     * [0, 2]; 0 is a perfect match.
+     */
+    Double chiSquared;
+    /** The number of candidate peaks that matched an observed peak.
+     */
+    Size matched;
+    /** True if the candidate failed an early rejection check; the scores
+     * are then set to their worst values.
+     */
+    Bool rejected;
+};
+
+/** Scores many candidate isotope patterns (e.g. from \c Mercury7) against
+ * one observed peak cluster.
+ *
+ * The observed cluster is prepared once: it is normalized to unit total
+ * abundance, and its tolerance windows are calculated. Each candidate is
+ * aligned against it by a single merge of the two m/z-sorted peak lists;
+ * candidate peaks that fall into the same observed peak (e.g. the
+ * isotopologues of a fine structure) are summed, and unmatched peaks of
+ * either side are paired with zero abundance. The scores are then
+ * accumulated over the aligned abundance vectors, two entries at a time
+ * with SSE2 (where available).
+ *
+ * Candidates can be rejected before any score is calculated if their
+ * monoisotopic peak or their most abundant peak has no observed
+ * counterpart.
+ */
+class PatternScorer
+{
+public:
+    /** How the m/z tolerance is given.
+     */
+    enum ToleranceUnit
+    {
+        MZ, PPM
+    };
+
+    /** Constructor.
+     * @param observed The observed peak cluster, in order of increasing
+     *                 m/z.
+     * @param tolerance The m/z tolerance for aligning peaks; positive.
+     * @param unit Whether the tolerance is absolute or relative.
+     */
+    PatternScorer(const detail::Spectrum& observed, const Double tolerance,
+        const ToleranceUnit unit = MZ);
+
+    /** Require the monoisotopic (first) peak of a candidate to match an
+     * observed peak. The default is true.
+     */
+    void setRequireMonoisotopic(const Bool require);
+
+    Bool getRequireMonoisotopic() const;
+
+    /** Require the most abundant peak of a candidate to match an observed
+     * peak. The default is true.
+     */
+    void setRequireTopPeak(const Bool require);
+
+    Bool getRequireTopPeak() const;
+
+    /** Set the smallest candidate abundance used in the Kullback-Leibler
+     * divergence, which keeps it finite if an observed peak has no
+     * candidate counterpart. The default is 1e-6.
+     * @param floor The floor, relative to the total candidate abundance;
+     *              positive.
+     */
+    void setFloor(const Double floor);
+
+    Double getFloor() const;
+
+    /** Score a candidate pattern.
+     * @param candidate The theoretical pattern, in order of increasing m/z.
+     * @return The scores.
+     */
+    PatternScore operator()(const detail::Spectrum& candidate) const;
+
+    /** Score a batch of candidate patterns.
+     * @param candidates The theoretical patterns.
+     * @param scores Receives one score per candidate.
+     */
+    void operator()(const std::vector<detail::Spectrum>& candidates,
+        std::vector<PatternScore>& scores) const;
+
+private:
+    /** Score a candidate using caller-owned scratch buffers.
+     */
+    PatternScore score(const detail::Spectrum& candidate,
+        std::vector<Double>& observed, std::vector<Double>& expected) const;
+
+    /** @return The index of the observed peak closest to \a mz within
+     *          the tolerance, or the number of observed peaks. The search
+     *          starts at \a first, which is advanced past all observed
+     *          peaks below the window.
+     */
+    Size match(const Double mz, Size& first) const;
+
+    std::vector<Double> mz_, ab_, tolerance_;
+    Bool requireMonoisotopic_, requireTopPeak_;
+    Double floor_;
+};
+
+} // namespace ipaca
+
+#endif /* __LIBIPACA_INCLUDE_IPACA_PATTERNSCORER_HPP__ */
@@ -0,0 +1,219 @@
+/*
+ * PatternService.hpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+
+#ifndef __LIBIPACA_INCLUDE_IPACA_PATTERNSERVICE_HPP__
+#define __LIBIPACA_INCLUDE_IPACA_PATTERNSERVICE_HPP__
+
+#include <ipaca/config.hpp>
+#include <ipaca/CApi.h>
+#include <ipaca/Types.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <string>
+#include <vector>
+
+namespace ipaca {
+
+/*
+ * The pattern service shares one warm result cache between all processes
+ * on a node. A server (see the ipacad executable) listens on a Unix domain
+ * socket; clients register their element tables per connection and send
+ * batches of compounds in the CSR form of the C interface (see CApi.h).
+ *
+ * All messages are frames of a 16 byte header (payload size, request id,
+ * message type, status; 32 bit each, host byte order) and a binary
+ * payload. The server answers the frames of a connection in order, so a
+ * client may send many requests before it reads the first response
+ * (pipelining). Results are cached by the content of the isotope tables,
+ * not by element ids, hence clients with different element tables share
+ * the cache.
+ */
+
+/** A batch of compounds for the pattern service.
+ */
+struct PatternRequest
+{
+    /** Constructor. The defaults are those of \c ipaca_calculator_create().
+     */
+    PatternRequest();
+
+    /** Append a compound.
+     * @param elements The element ids (see \c PatternClient::addElement()).
+     * @param counts The atom counts.
+     * @param n The number of entries.
+     * @param charge The charge.
+     */
+    void addCompound(const Size* elements, const Double* counts,
+        const Size n, const Int charge = 0);
+
+    /** @return The number of compounds.
+     */
+    Size size() const;
+
+    /** The abundance limit below which peaks are pruned.
+     */
+    Double limit;
+    /** \c IPACA_ALL, \c IPACA_FIRST_N or \c IPACA_TOP_K, and the number of
+     * peaks for the latter two.
+     */
+    Int outputMode;
+    Size outputCount;
+    /** \c IPACA_PROTON or \c IPACA_ELECTRON.
+     */
+    Int particle;
+    /** The compounds in CSR form: compound k consists of the entries
+     * offsets[k] .. offsets[k + 1] of elements and counts.
+     */
+    std::vector<Size> offsets;
+    std::vector<Size> elements;
+    std::vector<Double> counts;
+    std::vector<Int> charges;
+};
+
+/** The result of a batch, in the CSR form of \c ipaca_calculate().
+ */
+struct PatternResponse
+{
+    /** The status code; the peaks are only valid for \c IPACA_OK.
+     */
+    Int status;
+    /** The peaks of compound k are peakOffsets[k] .. peakOffsets[k + 1].
+     */
+    std::vector<Size> peakOffsets;
+    std::vector<Double> mz;
+    std::vector<Double> ab;
+};
+
+/** Counters of a pattern server.
+ */
+struct ServiceStats
+{
+    /** The number of frames that have been answered.
+     */
+    Size requests;
+    /** The number of compounds served from the cache.
+     */
+    Size hits;
+    /** The number of compounds that have been calculated.
+     */
+    Size misses;
+    /** The number of cached results.
+     */
+    Size entries;
+};
+
+namespace detail {
+
+/** The message types of the pattern service protocol.
+ */
+enum ServiceMessage
+{
+    /** u32 n, n x (f64 mz, f64 ab) -> u32 element id */
+    SERVICE_ADD_ELEMENT = 1,
+    /** u32 element -> (empty) */
+    SERVICE_SET_HYDROGEN = 2,
+    /** f64 limit, i32 mode, u32 n, i32 particle, u32 compounds,
+     * compounds x (i32 charge, u32 entries, entries x (u32 element,
+     * f64 count)) -> u32 compounds, compounds x (u32 peaks, peaks x
+     * (f64 mz, f64 ab)) */
+    SERVICE_CALCULATE = 3,
+    /** (empty) -> u64 requests, hits, misses, entries */
+    SERVICE_STATS = 4
+};
+
+/** The header of a frame.
+ */
+struct ServiceHeader
+{
+    boost::uint32_t size, id, type;
+    boost::int32_t status;
+};
+
+/** The largest accepted payload.
+ */
+const Size maxServicePayload = 1 << 28;
+
+/** Appends binary values to a payload.
+ */
+class ServiceWriter
+{
+public:
+    explicit ServiceWriter(std::string& buffer);
+    void putU32(const Size v);
+    void putI32(const Int v);
+    void putU64(const Size v);
+    void putF64(const Double v);
+private:
+    std::string& buffer_;
+};
+
+/** Reads binary values from a payload. Reading past the end yields zeros
+ * and sets the failure flag.
+ */
+class ServiceReader
+{
+public:
+    ServiceReader(const char* begin, const char* end);
+    Size getU32();
+    Int getI32();
+    Size getU64();
+    Double getF64();
+    /** @return The number of unread bytes.
+     */
+    Size remaining() const;
+    Bool failed() const;
+private:
+    void get(void* p, const Size n);
+    const char* current_;
+    const char* end_;
+    Bool failed_;
+};
+
+} // namespace detail
+
+/** Serves isotope patterns from a shared cache over a Unix domain socket.
+ *
+ * The server runs a single-threaded event loop; all connections share one
+ * least-recently-used result cache.
+ */
+class PatternServer : private boost::noncopyable
+{
+public:
+    /** Constructor. Binds and listens on the socket. A stale socket file
+     * is replaced; a socket that accepts connections is not.
+     * @param path The path of the socket.
+     * @param capacity The maximum number of cached results.
+     * @throws RuntimeError The socket cannot be created.
+     */
+    explicit PatternServer(const String& path, const Size capacity = 1 << 20);
+
+    /** Destructor. Closes all connections and removes the socket file.
+     */
+    ~PatternServer();
+
+    /** Serve requests until \c stop() is called.
+     */
+    void run();
+
+    /** Make \c run() return. Thread-safe and async-signal-safe.
+     */
+    void stop();
+
+    /** @return The counters; only consistent if the server is not
+     *          running.
+     */
+    ServiceStats getStats() const;
+
+private:
+    struct Impl;
+    boost::shared_ptr<Impl> pImpl_;
+};
+
+} // namespace ipaca
+
+#endif /* __LIBIPACA_INCLUDE_IPACA_PATTERNSERVICE_HPP__ */
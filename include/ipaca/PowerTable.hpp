@@ -0,0 +1,120 @@
+/*
+ * PowerTable.hpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+
+#ifndef __LIBIPACA_INCLUDE_IPACA_POWERTABLE_HPP__
+#define __LIBIPACA_INCLUDE_IPACA_POWERTABLE_HPP__
+
+#include <ipaca/config.hpp>
+#include <ipaca/Spectrum.hpp>
+#include <ipaca/Stoichiometry.hpp>
+#include <ipaca/Types.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <vector>
+
+namespace ipaca {
+
+/** The element powers E^1, E^2, E^4, ... of a set of elements, pruned at
+ * a fixed abundance limit (see \c Mercury7::createPowerTable()). With a
+ * table, the isotope distribution of n atoms of an element only costs the
+ * multiplications of the binary exponentiation; the squarings are looked
+ * up.
+ *
+ * A table is immutable. Its binary format is the same in memory and on
+ * disk, hence \c load() maps a snapshot instead of reading it, and short
+ * jobs start with all powers at hand. A snapshot is tagged with a format
+ * version, the isotope tables and the limit it was built with, and
+ * \c load() rejects snapshots that do not match. Snapshots use the native
+ * byte order and are not meant to be exchanged between platforms.
+ */
+class PowerTable : private boost::noncopyable
+{
+public:
+    /** Constructor.
+     * @param isotopes The isotope tables of the elements.
+     * @param limit The abundance limit the powers have been pruned at.
+     * @param powers For every element, the powers E^1, E^2, E^4, ...
+     * @param offsets For every element and power, the isotope index of the
+     *                first peak.
+     */
+    PowerTable(const std::vector<detail::Isotopes>& isotopes,
+        const Double limit,
+        const std::vector<std::vector<detail::Spectrum> >& powers,
+        const std::vector<std::vector<Size> >& offsets);
+
+    ~PowerTable();
+
+    /** Map a snapshot.
+     * @param filename The snapshot.
+     * @param isotopes The isotope tables the snapshot must have been built
+     *                 for, in the same order.
+     * @param limit The limit the snapshot must have been built with.
+     * @throws RuntimeError The file cannot be read, is not a snapshot of
+     *         this version, or does not match \a isotopes and \a limit.
+     */
+    static boost::shared_ptr<const PowerTable> load(const String& filename,
+        const std::vector<detail::Isotopes>& isotopes, const Double limit);
+
+    /** Write a snapshot.
+     * @throws RuntimeError The file cannot be written.
+     */
+    void save(const String& filename) const;
+
+    /** @return The abundance limit the powers have been pruned at.
+     */
+    Double getLimit() const;
+
+    /** @return The number of elements.
+     */
+    Size size() const;
+
+    /** @return The size of the table in bytes.
+     */
+    Size getBytes() const;
+
+    /** @param isotopes An isotope table.
+     * @return The index of the element with that isotope table, or
+     *         \c size() if there is none.
+     */
+    Size find(const detail::Isotopes& isotopes) const;
+
+    /** @param element The index of an element.
+     * @param isotopes Receives the isotope table of the element.
+     */
+    void getIsotopes(const Size element, detail::Isotopes& isotopes) const;
+
+    /** @param element The index of an element.
+     * @return The number of powers k, i.e. E^1, ..., E^(2^(k-1)) are
+     *         available.
+     */
+    Size getPowers(const Size element) const;
+
+    /** Copy a power of an element.
+     * @param element The index of the element.
+     * @param k The power E^(2^k).
+     * @param spectrum Receives the power.
+     * @return The isotope index of the first peak.
+     */
+    Size getPower(const Size element, const Size k,
+        detail::Spectrum& spectrum) const;
+
+private:
+    struct Mapping;
+    PowerTable();
+    /** Check the layout of a table.
+     * @return False if the table is malformed.
+     */
+    Bool attach(const char* data, const Size size);
+    std::vector<char> image_;
+    boost::shared_ptr<Mapping> mapping_;
+    const char* data_;
+    Size size_;
+};
+
+} // namespace ipaca
+
+#endif /* __LIBIPACA_INCLUDE_IPACA_POWERTABLE_HPP__ */
@@ -0,0 +1,148 @@
+/*
+ * ProfileRenderer.hpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+
+#ifndef __LIBIPACA_INCLUDE_IPACA_PROFILERENDERER_HPP__
+#define __LIBIPACA_INCLUDE_IPACA_PROFILERENDERER_HPP__
+
+#include <ipaca/config.hpp>
+#include <ipaca/Spectrum.hpp>
+#include <ipaca/Types.hpp>
+#include <vector>
+
+namespace ipaca {
+
+/** Renders centroided isotope distributions as profile spectra on a fixed
+ * m/z grid.
+ *
+ * Every peak is replaced by a Gaussian or Lorentzian peak shape whose
+ * apex height is the peak abundance (times an intensity factor) and
+ * whose full width at half maximum (FWHM) follows from the resolution at
+ * the peak position. The peak shapes are truncated where they drop below
+ * a fraction of their apex height, and the grid points within the
+ * truncated kernel are addressed directly (uniform grids) or by binary
+ * search (arbitrary sorted grids). Hence the cost is proportional to the
+ * number of peaks times the kernel width, independent of the grid size.
+ *
+ * On uniform grids, the Gaussian is evaluated by a multiplicative
+ * recurrence (the ratio of neighbouring grid values is itself a geometric
+ * sequence), which avoids one exp() per grid point; both shapes are
+ * evaluated for two grid points at once with SSE2 (where available).
+ *
+ * The renderer adds to the caller-owned buffers; it never clears them.
+ */
+class ProfileRenderer
+{
+public:
+    enum PeakShape
+    {
+        GAUSSIAN, LORENTZIAN
+    };
+
+    /** How the resolution depends on m/z.
+     *
+     * \li \c CONSTANT_RESOLUTION: FWHM = mz / R (e.g. TOF instruments).
+     * \li \c ORBITRAP_RESOLUTION: R is given at a reference m/z and
+     *     scales with 1/sqrt(mz), i.e. FWHM = mz^1.5 / (R sqrt(mz_ref)).
+     * \li \c CONSTANT_WIDTH: the FWHM is R (in m/z units) everywhere
+     *     (e.g. quadrupoles).
+     */
+    enum ResolutionModel
+    {
+        CONSTANT_RESOLUTION, ORBITRAP_RESOLUTION, CONSTANT_WIDTH
+    };
+
+    /** Constructor for a uniform grid.
+     * @param mzFirst The m/z of the first grid point.
+     * @param mzStep The distance between two grid points; positive.
+     * @param size The number of grid points; positive.
+     */
+    ProfileRenderer(const Double mzFirst, const Double mzStep,
+        const Size size);
+
+    /** Constructor for an arbitrary grid.
+     * @param grid The m/z values of the grid points, in ascending order.
+     */
+    explicit ProfileRenderer(const std::vector<Double>& grid);
+
+    /** Set the peak shape; the default is \c GAUSSIAN.
+     */
+    void setPeakShape(const PeakShape shape);
+
+    PeakShape getPeakShape() const;
+
+    /** Set the resolution; the default is a constant resolution of
+     * 60000.
+     * @param resolution The resolution (or the FWHM for
+     *                   \c CONSTANT_WIDTH); positive.
+     * @param model How the resolution depends on m/z.
+     * @param referenceMz The m/z at which an \c ORBITRAP_RESOLUTION is
+     *                    given.
+     */
+    void setResolution(const Double resolution,
+        const ResolutionModel model = CONSTANT_RESOLUTION,
+        const Double referenceMz = 200.0);
+
+    /** @return The FWHM of a peak at \a mz.
+     */
+    Double getFwhm(const Double mz) const;
+
+    /** Set the height, relative to the apex, at which the peak shapes are
+     * truncated. The default is 1e-6. Note that Lorentzian peaks decay
+     * slowly: their kernels extend to sqrt(1 / truncation) half widths.
+     * @param truncation The relative height, in (0, 1).
+     */
+    void setTruncation(const Double truncation);
+
+    Double getTruncation() const;
+
+    /** @return The number of grid points.
+     */
+    Size size() const;
+
+    /** @return The m/z of the k-th grid point.
+     */
+    Double getMz(const Size k) const;
+
+    /** Render a spectrum.
+     * @param spectrum The centroided spectrum, e.g. the output of
+     *                 \c Mercury7Impl.
+     * @param buffer The profile; \c size() values to which the peak
+     *               shapes are added.
+     * @param intensity The factor applied to all abundances.
+     */
+    void render(const detail::Spectrum& spectrum, Double* buffer,
+        const Double intensity = 1.0) const;
+
+    /** Render a batch of spectra into separate profiles.
+     * @param spectra The centroided spectra.
+     * @param buffers The profiles; the profile of the k-th spectrum
+     *                starts at <tt>buffers + k * stride</tt>.
+     * @param stride The distance between two profiles; at least
+     *               \c size().
+     * @param intensities If non-null, one intensity factor per spectrum.
+     */
+    void render(const std::vector<detail::Spectrum>& spectra,
+        Double* buffers, const Size stride,
+        const Double* intensities = 0) const;
+
+private:
+    /** Add a single peak shape to the profile.
+     */
+    void renderPeak(const Double mz, const Double height, Double* buffer) const;
+
+    Double first_, step_;
+    Size size_;
+    std::vector<Double> grid_;
+    PeakShape shape_;
+    ResolutionModel model_;
+    Double resolution_, referenceMz_;
+    Double truncation_;
+};
+
+} // namespace ipaca
+
+#endif /* __LIBIPACA_INCLUDE_IPACA_PROFILERENDERER_HPP__ */
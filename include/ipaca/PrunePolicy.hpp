@@ -0,0 +1,161 @@
+/*
+ * PrunePolicy.hpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+
+#ifndef __LIBIPACA_INCLUDE_IPACA_PRUNEPOLICY_HPP__
+#define __LIBIPACA_INCLUDE_IPACA_PRUNEPOLICY_HPP__
+
+#include <ipaca/config.hpp>
+#include <ipaca/Spectrum.hpp>
+#include <ipaca/Types.hpp>
+
+namespace ipaca {
+
+/** Base class for all pruning strategies.
+ *
+ * During the calculation of an isotope distribution, every intermediate
+ * result is pruned, i.e. negligible peaks are trimmed from both ends of
+ * the spectrum. A prune policy decides which (contiguous) range of peaks
+ * survives; the actual trimming and the bookkeeping of the discarded
+ * probability mass is done by the caller.
+ */
+class PrunePolicy
+{
+public:
+    /** Virtual destructor.
+     */
+    virtual ~PrunePolicy();
+
+    /** Determine the range of peaks that survives pruning.
+     * @param spectrum The (intermediate) isotope distribution.
+     * @param share The fraction of the overall error budget that is
+     *              available for this pruning step, relative to the
+     *              total abundance of \a spectrum. The engine guarantees
+     *              that the shares of all steps of a calculation, weighted
+     *              by how often each intermediate enters the final result,
+     *              sum up to one.
+     * @param first Index of the first peak to keep.
+     * @param last One past the index of the last peak to keep. An empty
+     *             range (\a first == \a last) discards the spectrum.
+     */
+    virtual void operator()(const detail::Spectrum& spectrum,
+        const Double share, Size& first, Size& last) const = 0;
+
+    /** Fixed absolute limit of the policy, if any.
+     * Policies that discard exactly those peaks at both ends of a
+     * spectrum whose abundance is at or below a fixed limit return that
+     * limit. This allows the engine to prune while convolving, without
+     * materializing the tails.
+     * @return The limit, or zero if the policy has no fixed limit.
+     */
+    virtual Double getFixedLimit() const;
+};
+
+/** Discards all peaks at both ends of a spectrum whose abundance is
+ * at or below a fixed, absolute limit. This is the classic Mercury7
+ * behavior.
+ */
+class AbsoluteLimitPrunePolicy : public PrunePolicy
+{
+public:
+    /** Constructor.
+     * @param limit The absolute abundance limit; must be positive.
+     * @throws ipaca::PreconditionViolation if \a limit is not positive.
+     */
+    explicit AbsoluteLimitPrunePolicy(const Double limit = 1e-26);
+
+    void operator()(const detail::Spectrum& spectrum, const Double share,
+        Size& first, Size& last) const;
+
+    Double getFixedLimit() const;
+
+    /** @return The absolute abundance limit.
+     */
+    Double getLimit() const;
+
+private:
+    Double limit_;
+};
+
+/** Discards all peaks at both ends of a spectrum whose abundance is
+ * at or below a fraction of the most abundant peak.
+ */
+class RelativeLimitPrunePolicy : public PrunePolicy
+{
+public:
+    /** Constructor.
+     * @param fraction The limit relative to the maximum abundance;
+     *                 must be in [0, 1).
+     * @throws ipaca::PreconditionViolation if \a fraction is out of range.
+     */
+    explicit RelativeLimitPrunePolicy(const Double fraction);
+
+    void operator()(const detail::Spectrum& spectrum, const Double share,
+        Size& first, Size& last) const;
+
+    /** @return The relative abundance limit.
+     */
+    Double getFraction() const;
+
+private:
+    Double fraction_;
+};
+
+/** Trims the tails of a spectrum such that each pruning step keeps at
+ * least a given fraction of the total abundance. Because the coverage
+ * is enforced per step, the coverage of the final result may be lower;
+ * use \c ErrorBudgetPrunePolicy for a guaranteed bound on the result.
+ */
+class CoveragePrunePolicy : public PrunePolicy
+{
+public:
+    /** Constructor.
+     * @param coverage The fraction of the total abundance that must be
+     *                 kept, e.g. 0.99999; must be in (0, 1].
+     * @throws ipaca::PreconditionViolation if \a coverage is out of range.
+     */
+    explicit CoveragePrunePolicy(const Double coverage);
+
+    void operator()(const detail::Spectrum& spectrum, const Double share,
+        Size& first, Size& last) const;
+
+    /** @return The per-step coverage.
+     */
+    Double getCoverage() const;
+
+private:
+    Double coverage_;
+};
+
+/** Spreads a relative error budget over all pruning steps of a
+ * calculation. The total abundance discarded from the final result is
+ * guaranteed to be at most \c budget times the abundance of the exact
+ * (unpruned) result.
+ */
+class ErrorBudgetPrunePolicy : public PrunePolicy
+{
+public:
+    /** Constructor.
+     * @param budget The overall relative error budget, e.g. 1e-5; must
+     *               be in [0, 1).
+     * @throws ipaca::PreconditionViolation if \a budget is out of range.
+     */
+    explicit ErrorBudgetPrunePolicy(const Double budget);
+
+    void operator()(const detail::Spectrum& spectrum, const Double share,
+        Size& first, Size& last) const;
+
+    /** @return The overall error budget.
+     */
+    Double getBudget() const;
+
+private:
+    Double budget_;
+};
+
+} // namespace ipaca
+
+#endif /* __LIBIPACA_INCLUDE_IPACA_PRUNEPOLICY_HPP__ */
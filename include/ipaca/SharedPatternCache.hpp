@@ -0,0 +1,86 @@
+/*
+ * SharedPatternCache.hpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+
+#ifndef __LIBIPACA_INCLUDE_IPACA_SHAREDPATTERNCACHE_HPP__
+#define __LIBIPACA_INCLUDE_IPACA_SHAREDPATTERNCACHE_HPP__
+
+#include <ipaca/config.hpp>
+#include <ipaca/PatternCache.hpp>
+#include <ipaca/Types.hpp>
+#include <boost/noncopyable.hpp>
+#include <string>
+
+namespace ipaca {
+
+/** A pattern cache in a POSIX shared memory segment, shared by all
+ * processes on a node that open the same name.
+ *
+ * The segment holds a fixed number of fixed-size slots; each slot stores
+ * one key and up to \c getMaxPeaks() peaks. The slots form an
+ * open-addressing hash table with linear probing over a short window;
+ * a full window evicts its oldest entry.
+ *
+ * Every slot is guarded by a sequence lock. Readers never write to the
+ * segment: they copy a slot and retry if its sequence number was odd or
+ * has changed meanwhile. A writer claims a slot by making its sequence
+ * number odd and skips the insertion if another writer holds it. A
+ * process that dies while writing leaves its slot locked, i.e. unused,
+ * until the segment is removed.
+ *
+ * The segment is created by the first process and persists until
+ * \c remove() is called (or the node reboots). All processes use the
+ * geometry of the segment, regardless of their constructor arguments.
+ */
+class SharedPatternCache : public PatternCache, private boost::noncopyable
+{
+public:
+    /** Constructor. Opens the segment, or creates it if it does not
+     * exist.
+     * @param name The name of the segment, e.g. "/ipaca-patterns".
+     * @param slots The number of slots; rounded up to a power of two.
+     * @param maxPeaks The maximum number of peaks per pattern.
+     * @param maxKey The maximum key size in bytes.
+     * @throws RuntimeError The segment cannot be opened or is not a
+     *         pattern cache.
+     */
+    explicit SharedPatternCache(const String& name, const Size slots = 65536,
+        const Size maxPeaks = 64, const Size maxKey = 512);
+
+    /** Destructor. Unmaps the segment but does not remove it.
+     */
+    ~SharedPatternCache();
+
+    Bool find(const std::string& key, detail::Spectrum& spectrum) const;
+
+    void insert(const std::string& key, const detail::Spectrum& spectrum);
+
+    /** Discard all entries.
+     */
+    void clear();
+
+    Size getSlots() const;
+    Size getMaxPeaks() const;
+    Size getMaxKey() const;
+
+    /** Remove a segment. Processes that have it open keep using it.
+     * @param name The name of the segment.
+     */
+    static void remove(const String& name);
+
+private:
+    struct Header;
+    const char* getSlot(const Size index) const;
+    char* getSlot(const Size index);
+    Header* header_;
+    Size size_;
+    Size mask_;
+    Size slotSize_;
+};
+
+} // namespace ipaca
+
+#endif /* __LIBIPACA_INCLUDE_IPACA_SHAREDPATTERNCACHE_HPP__ */
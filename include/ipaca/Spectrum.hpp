@@ -19,7 +19,8 @@ namespace detail {
 /** A mass spectrum is the same as an isotope distribution.
  */
 typedef Isotope SpectrumElement;
-typedef std::vector<SpectrumElement> Spectrum;
+typedef std::vector<SpectrumElement, Allocator<SpectrumElement> >
+        Spectrum;
 
 /** A stream operator for the Spectrum class.
  *
@@ -11,6 +11,7 @@
 #include <ipaca/config.hpp>
 #include <vector>
 #include <iosfwd>
+#include <ipaca/MemoryResource.hpp>
 #include <ipaca/Types.hpp>
 
 namespace ipaca {
@@ -28,14 +29,17 @@ struct Isotope
     Double mz, ab;
 };
 
-/** An isotope distribution.
+/** An isotope distribution. Like all containers in this file, it draws
+ * its memory from the memory resource of the calling thread (see
+ * \c MemoryResourceScope).
  */
-typedef std::vector<Isotope> Isotopes;
+typedef std::vector<Isotope, Allocator<Isotope> > Isotopes;
 
 /** A mass spectrum is the same as an isotope distribution.
  */
 typedef Isotope SpectrumElement;
-typedef std::vector<SpectrumElement> Spectrum;
+typedef std::vector<SpectrumElement, Allocator<SpectrumElement> >
+        Spectrum;
 
 /** The relevant element information in a stoichiometry. We only need
  * the isotopic distribution and the number of occurences.
@@ -49,7 +53,7 @@ struct Element
 /** A stoichiometry is simply a list of elements with their isotopic
  * distributions and number of occurences.
  */
-typedef std::vector<Element> Stoichiometry;
+typedef std::vector<Element, Allocator<Element> > Stoichiometry;
 
 //
 // a few free functions
@@ -74,6 +78,16 @@ Bool isPlausibleStoichiometry(const Stoichiometry& s);
 void splitStoichiometry(const Stoichiometry& s, Stoichiometry& intStoi,
     Stoichiometry& fracStoi);
 
+/** Calculate the isotope distribution of a fractional atom, i.e. of a
+ * mixture of "no atom" and a full atom.
+ *
+ * @param isotopes The isotope distribution of the element; not empty.
+ * @param fractional The fraction of the atom, in (0, 1).
+ * @param esa Receives the isotope distribution of the fractional atom.
+ */
+void fractionalAtom(const Isotopes& isotopes, const Double fractional,
+    Isotopes& esa);
+
 /** Stream operator.
  *
  * @param os A reference to the outstream.
@@ -0,0 +1,135 @@
+/*
+ * BinnedConvolution.cpp
+ *
+ *  Copyright (C) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/BinnedConvolution.hpp>
+#include <ipaca/Error.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/unordered_map.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace ipaca;
+
+namespace {
+
+/** The accumulated abundance and (unnormalized) mass expectation of a bin.
+ */
+struct Bin
+{
+    Bin() :
+        ab(0.0), mzab(0.0)
+    {
+    }
+
+    Double ab, mzab;
+};
+
+typedef boost::unordered_map<boost::int64_t, Bin> Bins;
+
+/** @return The bin of a mass; bins are half a peak width wide.
+ */
+inline boost::int64_t getBin(const Double mz, const Double resolution)
+{
+    if (mz <= 0.0) {
+        return std::numeric_limits<boost::int64_t>::min();
+    }
+    return static_cast<boost::int64_t>(std::floor(2.0 * resolution
+            * std::log(mz)));
+}
+
+inline void accumulate(Bins& bins, const Double mz, const Double ab,
+    const Double resolution)
+{
+    Bin& bin = bins[getBin(mz, resolution)];
+    bin.ab += ab;
+    bin.mzab += ab * mz;
+}
+
+inline bool lessMass(const detail::SpectrumElement& lhs,
+    const detail::SpectrumElement& rhs)
+{
+    return lhs.mz < rhs.mz;
+}
+
+/** Collect the bins in order of increasing mass and merge neighbours
+ * whose centroids are closer than the peak width.
+ */
+void collect(const Bins& bins, const Double resolution,
+    detail::Spectrum& result)
+{
+    result.clear();
+    result.reserve(bins.size());
+    for (Bins::const_iterator i = bins.begin(); i != bins.end(); ++i) {
+        if (i->second.ab > 0.0) {
+            detail::SpectrumElement e;
+            e.mz = i->second.mzab / i->second.ab;
+            e.ab = i->second.ab;
+            result.push_back(e);
+        }
+    }
+    std::sort(result.begin(), result.end(), lessMass);
+    Size n = 0;
+    for (Size k = 0; k < result.size(); ++k) {
+        if (n > 0 && result[k].mz - result[n - 1].mz < result[n - 1].mz
+                / resolution) {
+            detail::SpectrumElement& e = result[n - 1];
+            Double ab = e.ab + result[k].ab;
+            e.mz = (e.mz * e.ab + result[k].mz * result[k].ab) / ab;
+            e.ab = ab;
+        } else {
+            result[n++] = result[k];
+        }
+    }
+    result.resize(n);
+}
+
+} // anonymous namespace
+
+void detail::mergePeaks(detail::Spectrum& spectrum, const Double resolution)
+{
+    ipaca_precondition(resolution > 0.0,
+        "mergePeaks: resolution must be positive.");
+    Bins bins(spectrum.size());
+    typedef detail::Spectrum::const_iterator CI;
+    for (CI i = spectrum.begin(); i != spectrum.end(); ++i) {
+        if (i->ab > 0.0) {
+            accumulate(bins, i->mz, i->ab, resolution);
+        }
+    }
+    collect(bins, resolution, spectrum);
+}
+
+void detail::binnedConvolve(const detail::Spectrum& s1,
+    const detail::Spectrum& s2, const Double resolution,
+    detail::Spectrum& result)
+{
+    ipaca_precondition(resolution > 0.0,
+        "binnedConvolve: resolution must be positive.");
+    // the number of bins is bounded by the mass range of the result
+    Size n = s1.size() * s2.size();
+    if (n == 0) {
+        result.clear();
+        return;
+    }
+    Double range = 2.0 * resolution * std::log((s1.back().mz + s2.back().mz)
+            / std::max(s1.front().mz + s2.front().mz,
+                std::numeric_limits<Double>::min())) + 1.0;
+    if (range > 0.0 && range < static_cast<Double>(n)) {
+        n = static_cast<Size>(range);
+    }
+    Bins bins(n);
+    typedef detail::Spectrum::const_iterator CI;
+    for (CI i = s1.begin(); i != s1.end(); ++i) {
+        for (CI j = s2.begin(); j != s2.end(); ++j) {
+            Double ab = i->ab * j->ab;
+            if (ab > 0.0) {
+                accumulate(bins, i->mz + j->mz, ab, resolution);
+            }
+        }
+    }
+    collect(bins, resolution, result);
+}
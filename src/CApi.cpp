@@ -0,0 +1,221 @@
+/*
+ * CApi.cpp
+ *
+ *  Copyright (C) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/CApi.h>
+#include <ipaca/MemoryResource.hpp>
+#include <ipaca/Mercury7Impl.hpp>
+#include <ipaca/OutputMode.hpp>
+#include <ipaca/PrunePolicy.hpp>
+#include <ipaca/Stoichiometry.hpp>
+#include <ipaca/Traits.hpp>
+#include <limits>
+#include <new>
+#include <vector>
+
+using namespace ipaca;
+
+struct ipaca_calculator
+{
+    detail::Mercury7Impl mercury;
+    std::vector<detail::Isotopes> elements;
+    Bool hasHydrogen;
+    Size hydrogen;
+    Double limit;
+};
+
+namespace {
+
+/** Sets up the stoichiometry of the entries [first, last) of a CSR row
+ * in \a s, reusing its storage.
+ * @return A status code.
+ */
+int buildStoichiometry(const ipaca_calculator& c, const Size first,
+    const Size last, const size_t* elements, const double* counts,
+    const int charge, const int particle, detail::Stoichiometry& s)
+{
+    Size n = last - first;
+    s.resize(n);
+    Size h = n;
+    for (Size j = 0; j < n; ++j) {
+        Size id = elements[first + j];
+        Double count = counts[first + j];
+        if (id >= c.elements.size() || !(count >= 0.0 && count
+                <= std::numeric_limits<Double>::max())) {
+            return IPACA_ERROR_ARGUMENT;
+        }
+        s[j].isotopes = c.elements[id];
+        s[j].count = count;
+        if (c.hasHydrogen && id == c.hydrogen && h == n) {
+            h = j;
+        }
+    }
+    if (charge == 0 || particle != IPACA_PROTON) {
+        return IPACA_OK;
+    }
+    // charge protons
+    Double z = static_cast<Double>(charge);
+    if (h < n) {
+        s[h].count += z;
+        return s[h].count < 0.0 ? IPACA_ERROR_ARGUMENT : IPACA_OK;
+    }
+    if (charge < 0) {
+        return IPACA_ERROR_ARGUMENT;
+    }
+    s.resize(n + 1);
+    if (c.hasHydrogen) {
+        s[n].isotopes = c.elements[c.hydrogen];
+        s[n].count = z;
+    } else {
+        s[n] = detail::getHydrogens(static_cast<Size>(charge));
+    }
+    return IPACA_OK;
+}
+
+} // anonymous namespace
+
+ipaca_calculator* ipaca_calculator_create(void)
+{
+    ipaca_calculator* c = new (std::nothrow) ipaca_calculator;
+    if (c) {
+        c->hasHydrogen = false;
+        c->hydrogen = 0;
+        c->limit = 1e-26;
+    }
+    return c;
+}
+
+void ipaca_calculator_destroy(ipaca_calculator* calculator)
+{
+    delete calculator;
+}
+
+long ipaca_calculator_add_element(ipaca_calculator* calculator,
+    const double* mz, const double* ab, size_t nIsotopes)
+{
+    if (!calculator || !mz || !ab || nIsotopes == 0) {
+        return -1;
+    }
+    try {
+        // the element table outlives any memory resource of the caller
+        MemoryResourceScope heap(0);
+        detail::Isotopes isotopes(nIsotopes);
+        for (Size u = 0; u < nIsotopes; ++u) {
+            isotopes[u].mz = mz[u];
+            isotopes[u].ab = ab[u];
+        }
+        calculator->elements.push_back(isotopes);
+    } catch (...) {
+        return -1;
+    }
+    return static_cast<long>(calculator->elements.size() - 1);
+}
+
+int ipaca_calculator_set_hydrogen(ipaca_calculator* calculator,
+    size_t element)
+{
+    if (!calculator || element >= calculator->elements.size()) {
+        return IPACA_ERROR_ARGUMENT;
+    }
+    calculator->hasHydrogen = true;
+    calculator->hydrogen = element;
+    return IPACA_OK;
+}
+
+int ipaca_calculator_set_limit(ipaca_calculator* calculator, double limit)
+{
+    if (!calculator || !(limit > 0.0)) {
+        return IPACA_ERROR_ARGUMENT;
+    }
+    calculator->limit = limit;
+    return IPACA_OK;
+}
+
+int ipaca_calculator_set_output(ipaca_calculator* calculator, int mode,
+    size_t n)
+{
+    if (!calculator) {
+        return IPACA_ERROR_ARGUMENT;
+    }
+    switch (mode) {
+        case IPACA_ALL:
+            calculator->mercury.setOutputMode(OutputMode::all());
+            return IPACA_OK;
+        case IPACA_FIRST_N:
+            if (n == 0) {
+                return IPACA_ERROR_ARGUMENT;
+            }
+            calculator->mercury.setOutputMode(OutputMode::firstN(n));
+            return IPACA_OK;
+        case IPACA_TOP_K:
+            if (n == 0) {
+                return IPACA_ERROR_ARGUMENT;
+            }
+            calculator->mercury.setOutputMode(OutputMode::topK(n));
+            return IPACA_OK;
+        default:
+            return IPACA_ERROR_ARGUMENT;
+    }
+}
+
+int ipaca_calculate(const ipaca_calculator* calculator, size_t nCompounds,
+    const size_t* offsets, const size_t* elements, const double* counts,
+    const int* charges, int particle, double* mz, double* ab,
+    size_t capacity, size_t* peakOffsets, size_t* nDone)
+{
+    if (nDone) {
+        *nDone = 0;
+    }
+    if (!calculator || !offsets || !peakOffsets || (particle
+            != IPACA_PROTON && particle != IPACA_ELECTRON) || (capacity > 0
+            && (!mz || !ab))) {
+        return IPACA_ERROR_ARGUMENT;
+    }
+    if (offsets[nCompounds] > offsets[0] && (!elements || !counts)) {
+        return IPACA_ERROR_ARGUMENT;
+    }
+    const Double e = detail::getElectronMass();
+    AbsoluteLimitPrunePolicy policy(calculator->limit);
+    Size written = 0;
+    peakOffsets[0] = 0;
+    try {
+        // the stoichiometry and the spectrum are reused for all compounds
+        detail::Stoichiometry s;
+        detail::Spectrum result;
+        for (Size k = 0; k < nCompounds; ++k) {
+            if (offsets[k + 1] < offsets[k]) {
+                return IPACA_ERROR_ARGUMENT;
+            }
+            int charge = charges ? charges[k] : 0;
+            int status = buildStoichiometry(*calculator, offsets[k],
+                offsets[k + 1], elements, counts, charge, particle, s);
+            if (status != IPACA_OK) {
+                return status;
+            }
+            result = calculator->mercury(s, policy);
+            if (result.size() > capacity - written) {
+                return IPACA_ERROR_CAPACITY;
+            }
+            // the same charge adjustment as in Mercury7
+            Double absCharge = charge < 0 ? -charge : charge;
+            for (Size j = 0; j < result.size(); ++j) {
+                Double m = result[j].mz;
+                if (charge != 0) {
+                    m = (m - charge * e) / absCharge;
+                }
+                mz[written + j] = m;
+                ab[written + j] = result[j].ab;
+            }
+            written += result.size();
+            peakOffsets[k + 1] = written;
+            if (nDone) {
+                *nDone = k + 1;
+            }
+        }
+    } catch (...) {
+        return IPACA_ERROR_INTERNAL;
+    }
+    return IPACA_OK;
+}
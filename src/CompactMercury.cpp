@@ -0,0 +1,248 @@
+/*
+ * CompactMercury.cpp
+ *
+ *  Copyright (C) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/CompactMercury.hpp>
+#include <ipaca/Error.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace ipaca;
+
+namespace {
+
+/** Adds a * b (abundances) and awd * b + a * bwd (weighted defects) to
+ * the n peaks of the result. One SSE register holds four floats ...
+ */
+inline void scatterRow(const float* bab, const float* bwd, const float a,
+    const float awd, float* rab, float* rwd, const Size n)
+{
+    Size j = 0;
+#ifdef __SSE2__
+    __m128 va = _mm_set1_ps(a);
+    __m128 vw = _mm_set1_ps(awd);
+    for (; j + 4 <= n; j += 4) {
+        __m128 b = _mm_loadu_ps(bab + j);
+        __m128 bw = _mm_loadu_ps(bwd + j);
+        _mm_storeu_ps(rab + j, _mm_add_ps(_mm_loadu_ps(rab + j),
+            _mm_mul_ps(va, b)));
+        _mm_storeu_ps(rwd + j, _mm_add_ps(_mm_loadu_ps(rwd + j), _mm_add_ps(
+            _mm_mul_ps(vw, b), _mm_mul_ps(va, bw))));
+    }
+#endif
+    for (; j < n; ++j) {
+        rab[j] += a * bab[j];
+        rwd[j] += awd * bab[j] + a * bwd[j];
+    }
+}
+
+/** ... and two doubles.
+ */
+inline void scatterRow(const double* bab, const double* bwd, const double a,
+    const double awd, double* rab, double* rwd, const Size n)
+{
+    Size j = 0;
+#ifdef __SSE2__
+    __m128d va = _mm_set1_pd(a);
+    __m128d vw = _mm_set1_pd(awd);
+    for (; j + 2 <= n; j += 2) {
+        __m128d b = _mm_loadu_pd(bab + j);
+        __m128d bw = _mm_loadu_pd(bwd + j);
+        _mm_storeu_pd(rab + j, _mm_add_pd(_mm_loadu_pd(rab + j),
+            _mm_mul_pd(va, b)));
+        _mm_storeu_pd(rwd + j, _mm_add_pd(_mm_loadu_pd(rwd + j), _mm_add_pd(
+            _mm_mul_pd(vw, b), _mm_mul_pd(va, bw))));
+    }
+#endif
+    for (; j < n; ++j) {
+        rab[j] += a * bab[j];
+        rwd[j] += awd * bab[j] + a * bwd[j];
+    }
+}
+
+/** Sets up the distribution of zero atoms.
+ */
+template<typename T>
+void identity(detail::CompactSpectrum<T>& s)
+{
+    s.origin = 0.0;
+    s.ab.assign(1, static_cast<T>(1));
+    s.weightedDefect.assign(1, static_cast<T>(0));
+}
+
+/** Convolves \a s with \a rhs and prunes the result in place; \a tmp is
+ * scratch space.
+ */
+template<typename T>
+void multiply(detail::CompactSpectrum<T>& s,
+    const detail::CompactSpectrum<T>& rhs, const T limit,
+    detail::CompactSpectrum<T>& tmp)
+{
+    detail::compactConvolve(s, rhs, tmp);
+    detail::compactPrune(tmp, limit);
+    std::swap(s.origin, tmp.origin);
+    s.ab.swap(tmp.ab);
+    s.weightedDefect.swap(tmp.weightedDefect);
+}
+
+} // anonymous namespace
+
+template<typename T>
+void detail::compactElement(const detail::Isotopes& isotopes,
+    detail::CompactSpectrum<T>& result)
+{
+    result.ab.clear();
+    result.weightedDefect.clear();
+    result.origin = isotopes.empty() ? 0.0 : isotopes[0].mz;
+    typedef detail::Isotopes::const_iterator ICI;
+    for (ICI i = isotopes.begin(); i != isotopes.end(); ++i) {
+        Double d = i->mz - result.origin;
+        ipaca_precondition(d >= 0.0,
+            "compactElement: the lightest isotope must come first.");
+        if (i->ab <= 0.0) {
+            continue;
+        }
+        Size k = static_cast<Size>(std::floor(d + 0.5));
+        if (k >= result.ab.size()) {
+            result.ab.resize(k + 1, static_cast<T>(0));
+            result.weightedDefect.resize(k + 1, static_cast<T>(0));
+        }
+        result.ab[k] += static_cast<T>(i->ab);
+        result.weightedDefect[k] += static_cast<T>(i->ab * (d
+                - static_cast<Double>(k)));
+    }
+}
+
+template<typename T>
+void detail::compactConvolve(const detail::CompactSpectrum<T>& s1,
+    const detail::CompactSpectrum<T>& s2, detail::CompactSpectrum<T>& result)
+{
+    result.origin = s1.origin + s2.origin;
+    if (s1.ab.empty() || s2.ab.empty()) {
+        result.ab.clear();
+        result.weightedDefect.clear();
+        return;
+    }
+    // scatter the peaks of the smaller operand onto the larger one
+    const CompactSpectrum<T>& a = s1.ab.size() <= s2.ab.size() ? s1 : s2;
+    const CompactSpectrum<T>& b = s1.ab.size() <= s2.ab.size() ? s2 : s1;
+    Size n = a.ab.size() + b.ab.size() - 1;
+    result.ab.assign(n, static_cast<T>(0));
+    result.weightedDefect.assign(n, static_cast<T>(0));
+    for (Size i = 0; i < a.ab.size(); ++i) {
+        scatterRow(&b.ab[0], &b.weightedDefect[0], a.ab[i],
+            a.weightedDefect[i], &result.ab[i], &result.weightedDefect[i],
+            b.ab.size());
+    }
+}
+
+template<typename T>
+void detail::compactPrune(detail::CompactSpectrum<T>& s, const T limit)
+{
+    Size first = 0, last = s.ab.size();
+    while (first < last && s.ab[first] < limit) {
+        ++first;
+    }
+    while (last > first && s.ab[last - 1] < limit) {
+        --last;
+    }
+    if (first == 0 && last == s.ab.size()) {
+        return;
+    }
+    // dropping leading peaks moves the origin by one per peak
+    s.origin += static_cast<Double>(first);
+    s.ab.erase(s.ab.begin() + last, s.ab.end());
+    s.ab.erase(s.ab.begin(), s.ab.begin() + first);
+    s.weightedDefect.erase(s.weightedDefect.begin() + last,
+        s.weightedDefect.end());
+    s.weightedDefect.erase(s.weightedDefect.begin(),
+        s.weightedDefect.begin() + first);
+}
+
+template<typename T>
+void detail::compactPower(const detail::Isotopes& isotopes, Size n,
+    const T limit, detail::CompactSpectrum<T>& result)
+{
+    detail::CompactSpectrum<T> base, tmp;
+    compactElement(isotopes, base);
+    identity(result);
+    while (n > 0) {
+        if (n & 1) {
+            multiply(result, base, limit, tmp);
+        }
+        n >>= 1;
+        if (n > 0) {
+            compactConvolve(base, base, tmp);
+            compactPrune(tmp, limit);
+            std::swap(base.origin, tmp.origin);
+            base.ab.swap(tmp.ab);
+            base.weightedDefect.swap(tmp.weightedDefect);
+        }
+    }
+}
+
+template<typename T>
+void detail::compactMercury(const detail::Stoichiometry& stoichiometry,
+    const Double limit, detail::Spectrum& result)
+{
+    result.clear();
+    if (!detail::isPlausibleStoichiometry(stoichiometry)) {
+        return;
+    }
+    T l = static_cast<T>(std::max(limit, static_cast<Double>(
+        std::numeric_limits<T>::min())));
+    detail::CompactSpectrum<T> total, part, tmp;
+    identity(total);
+    typedef detail::Stoichiometry::const_iterator SCI;
+    for (SCI i = stoichiometry.begin(); i != stoichiometry.end(); ++i) {
+        if (i->count <= 0.0 || i->isotopes.empty()) {
+            continue;
+        }
+        Double integer = trunc(i->count);
+        Double fractional = i->count - integer;
+        if (integer > 0.0) {
+            compactPower(i->isotopes, static_cast<Size>(integer), l, part);
+            multiply(total, part, l, tmp);
+        }
+        if (fractional > 0.0) {
+            detail::Isotopes esa;
+            detail::fractionalAtom(i->isotopes, fractional, esa);
+            compactElement(esa, part);
+            multiply(total, part, l, tmp);
+        }
+    }
+    result.resize(total.ab.size());
+    for (Size k = 0; k < total.ab.size(); ++k) {
+        Double ab = static_cast<Double>(total.ab[k]);
+        Double defect = ab > 0.0 ? static_cast<Double>(
+            total.weightedDefect[k]) / ab : 0.0;
+        result[k].mz = total.origin + static_cast<Double>(k) + defect;
+        result[k].ab = ab;
+    }
+}
+
+// the supported precisions
+#define IPACA_INSTANTIATE_COMPACT(T) \
+    template void detail::compactElement<T>(const detail::Isotopes&, \
+        detail::CompactSpectrum<T>&); \
+    template void detail::compactConvolve<T>( \
+        const detail::CompactSpectrum<T>&, \
+        const detail::CompactSpectrum<T>&, detail::CompactSpectrum<T>&); \
+    template void detail::compactPrune<T>(detail::CompactSpectrum<T>&, \
+        const T); \
+    template void detail::compactPower<T>(const detail::Isotopes&, \
+        Size, const T, detail::CompactSpectrum<T>&); \
+    template void detail::compactMercury<T>(const detail::Stoichiometry&, \
+        const Double, detail::Spectrum&);
+
+IPACA_INSTANTIATE_COMPACT(float)
+IPACA_INSTANTIATE_COMPACT(double)
+
+#undef IPACA_INSTANTIATE_COMPACT
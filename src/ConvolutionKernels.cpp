@@ -0,0 +1,459 @@
+/*
+ * ConvolutionKernels.cpp
+ *
+ *  Copyright (C) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/ConvolutionKernels.hpp>
+#include <ipaca/Error.hpp>
+#include <boost/chrono.hpp>
+#include <boost/thread/once.hpp>
+#include <boost/thread/tss.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace ipaca;
+
+namespace {
+
+/** Calculates the k-th peak of the convolution of two non-empty spectra.
+ */
+inline void convolvePeak(const detail::Spectrum& s1,
+    const detail::Spectrum& s2, const Size k, detail::SpectrumElement& peak)
+{
+    Size n1 = s1.size();
+    Size n2 = s2.size();
+    double totalAbundance = 0.0;
+    double massExpectation = 0.0;
+    size_t start = k < (n2 - 1) ? 0 : k - n2 + 1; // max(0, k-n2+1)
+    size_t end = k < (n1 - 1) ? k : n1 - 1; // min(n1-1, k)
+    // calculate the convolution of the k-th peak with everything else
+    for (size_t i = start; i <= end; i++) {
+        double ithAbundance = s1[i].ab * s2[k - i].ab;
+        if (ithAbundance > 0.0) {
+            // calculate the expected mass position
+            totalAbundance += ithAbundance;
+            double ithMass = s1[i].mz + s2[k - i].mz;
+            massExpectation += ithAbundance * ithMass;
+        }
+    }
+    // We cannot simply throw away isotopes with zero probability, as
+    // this would mess up the isotope count k.
+    peak.mz = totalAbundance > 0 ? (massExpectation / totalAbundance) : 0;
+    peak.ab = totalAbundance;
+}
+
+/** Calculates the k-th peak of the self-convolution of a non-empty
+ * spectrum. The terms s[i]*s[k-i] and s[k-i]*s[i] are identical, hence
+ * only one of them is evaluated and counted twice; this halves the number
+ * of loads and multiply-adds compared to \c convolvePeak.
+ */
+inline void squarePeak(const detail::Spectrum& s, const Size k,
+    detail::SpectrumElement& peak)
+{
+    Size n = s.size();
+    size_t start = k < (n - 1) ? 0 : k - n + 1; // max(0, k-n+1)
+    size_t mid = (k + 1) / 2; // all i < mid have a partner k-i > i
+#ifdef __SSE2__
+    // Accumulate (abundance * mass, abundance) in a single register. Each
+    // Isotope is loaded as (mz, ab); the mass lane is replaced by one to
+    // accumulate the total abundance alongside the mass expectation.
+    const __m128d one = _mm_set1_pd(1.0);
+    __m128d acc = _mm_setzero_pd();
+    for (size_t i = start; i < mid; i++) {
+        __m128d a = _mm_loadu_pd(&s[i].mz);
+        __m128d b = _mm_loadu_pd(&s[k - i].mz);
+        __m128d ab = _mm_mul_pd(_mm_unpackhi_pd(a, a), _mm_unpackhi_pd(b, b));
+        __m128d mz = _mm_move_sd(one, _mm_add_pd(a, b));
+        acc = _mm_add_pd(acc, _mm_mul_pd(ab, mz));
+    }
+    acc = _mm_add_pd(acc, acc);
+    if (k % 2 == 0) {
+        __m128d a = _mm_loadu_pd(&s[k / 2].mz);
+        __m128d ab = _mm_unpackhi_pd(a, a);
+        __m128d mz = _mm_move_sd(one, _mm_add_pd(a, a));
+        acc = _mm_add_pd(acc, _mm_mul_pd(_mm_mul_pd(ab, ab), mz));
+    }
+    double sums[2];
+    _mm_storeu_pd(sums, acc);
+    double massExpectation = sums[0];
+    double totalAbundance = sums[1];
+#else
+    double totalAbundance = 0.0;
+    double massExpectation = 0.0;
+    for (size_t i = start; i < mid; i++) {
+        double ithAbundance = s[i].ab * s[k - i].ab;
+        totalAbundance += ithAbundance;
+        massExpectation += ithAbundance * (s[i].mz + s[k - i].mz);
+    }
+    totalAbundance += totalAbundance;
+    massExpectation += massExpectation;
+    if (k % 2 == 0) {
+        double ithAbundance = s[k / 2].ab * s[k / 2].ab;
+        totalAbundance += ithAbundance;
+        massExpectation += ithAbundance * (s[k / 2].mz + s[k / 2].mz);
+    }
+#endif
+    peak.mz = totalAbundance > 0 ? (massExpectation / totalAbundance) : 0;
+    peak.ab = totalAbundance;
+}
+
+/** Calculates the peaks [first, last) of a convolution by scattering the
+ * products of every peak of the smaller operand with all peaks of the
+ * larger one. The output peaks serve as accumulators: the abundance
+ * field collects the total abundance, the mass field the (unnormalized)
+ * mass expectation.
+ */
+void scatterRange(const detail::Spectrum& s1, const detail::Spectrum& s2,
+    const Size first, const Size last, detail::SpectrumElement* result)
+{
+    const detail::Spectrum& a = s1.size() <= s2.size() ? s1 : s2;
+    const detail::Spectrum& b = s1.size() <= s2.size() ? s2 : s1;
+    Size na = a.size();
+    Size nb = b.size();
+    for (Size k = 0; k < last - first; ++k) {
+        result[k].mz = 0.0;
+        result[k].ab = 0.0;
+    }
+    for (Size i = 0; i < na && i < last; ++i) {
+        double ai = a[i].ab;
+        if (ai <= 0.0) {
+            continue;
+        }
+        double mi = a[i].mz;
+        Size start = first > i ? first - i : 0;
+        Size end = std::min(nb, last - i);
+        detail::SpectrumElement* out = result + (i + start - first);
+        for (Size j = start; j < end; ++j, ++out) {
+            double p = ai * b[j].ab;
+            out->ab += p;
+            out->mz += p * (mi + b[j].mz);
+        }
+    }
+    for (Size k = 0; k < last - first; ++k) {
+        result[k].mz = result[k].ab > 0.0 ? result[k].mz / result[k].ab : 0.0;
+    }
+}
+
+/** Create a synthetic isotope distribution for the calibration.
+ */
+detail::Spectrum createSpectrum(const Size n)
+{
+    detail::Spectrum s(n);
+    for (Size k = 0; k < n; ++k) {
+        s[k].mz = 100.0 + static_cast<Double>(k);
+        s[k].ab = 1.0 / static_cast<Double>(1 + k);
+    }
+    return s;
+}
+
+/** Measure the time per call of a kernel, in seconds.
+ */
+Double timeKernel(const ConvolutionKernel kernel, const detail::Spectrum& s1,
+    const detail::Spectrum& s2)
+{
+    typedef boost::chrono::steady_clock Clock;
+    Size n = s1.size() + s2.size() - 1;
+    detail::Spectrum result(n);
+    Double best = 0.0;
+    Size reps = 1;
+    // double the repetitions until a run takes long enough to be timed
+    // reliably, then keep the best of three runs
+    for (Size run = 0; run < 3;) {
+        Clock::time_point start = Clock::now();
+        for (Size r = 0; r < reps; ++r) {
+            detail::convolveRange(kernel, s1, s2, 0, n, &result[0]);
+        }
+        Double elapsed = boost::chrono::duration<Double>(Clock::now()
+                - start).count();
+        if (elapsed < 1e-4) {
+            reps *= 2;
+            continue;
+        }
+        Double t = elapsed / static_cast<Double>(reps);
+        best = run == 0 ? t : std::min(best, t);
+        ++run;
+    }
+    return best;
+}
+
+KernelCalibration* defaultCalibration = 0;
+boost::once_flag defaultCalibrationFlag = BOOST_ONCE_INIT;
+
+void initDefaultCalibration()
+{
+    static KernelCalibration calibration;
+    const char* filename = std::getenv("IPACA_CALIBRATION");
+    Bool loaded = false;
+    if (filename && *filename) {
+        try {
+            calibration = KernelCalibration::load(String(filename));
+            loaded = true;
+        } catch (RuntimeError&) {
+            // fall back to measuring
+        }
+    }
+    if (!loaded) {
+        calibration = KernelCalibration::measure();
+    }
+    defaultCalibration = &calibration;
+}
+
+const char* const calibrationHeader = "ipaca-kernel-calibration";
+const int calibrationVersion = 1;
+
+// the kernel counters scope of the calling thread
+#ifdef __GNUC__
+__thread detail::KernelCountersScope* currentScope = 0;
+
+detail::KernelCountersScope* getCurrentScope()
+{
+    return currentScope;
+}
+
+void setCurrentScope(detail::KernelCountersScope* scope)
+{
+    currentScope = scope;
+}
+#else
+void noCleanup(detail::KernelCountersScope*)
+{
+}
+
+boost::thread_specific_ptr<detail::KernelCountersScope> currentScope(
+    &noCleanup);
+
+detail::KernelCountersScope* getCurrentScope()
+{
+    return currentScope.get();
+}
+
+void setCurrentScope(detail::KernelCountersScope* scope)
+{
+    currentScope.reset(scope);
+}
+#endif
+
+} // anonymous namespace
+
+const char* ipaca::getKernelName(const ConvolutionKernel kernel)
+{
+    switch (kernel) {
+        case DIRECT_KERNEL:
+            return "direct";
+        case SQUARE_KERNEL:
+            return "square";
+        case SCATTER_KERNEL:
+            return "scatter";
+        default:
+            return "unknown";
+    }
+}
+
+KernelCalibration::KernelCalibration() :
+    scatterCrossover(8), squareCrossover(0), source(DEFAULT)
+{
+}
+
+ConvolutionKernel KernelCalibration::select(const Size n1, const Size n2,
+    const Bool square) const
+{
+    if (square) {
+        return n1 >= squareCrossover ? SQUARE_KERNEL : SCATTER_KERNEL;
+    }
+    return std::min(n1, n2) < scatterCrossover ? SCATTER_KERNEL
+            : DIRECT_KERNEL;
+}
+
+KernelCalibration KernelCalibration::measure()
+{
+    KernelCalibration calibration;
+    calibration.source = MEASURED;
+    const Size sizes[] = { 1, 2, 3, 4, 6, 8, 12, 16, 24, 32, 48, 64, 96, 128 };
+    const Size nSizes = sizeof(sizes) / sizeof(sizes[0]);
+    const Size largest = sizes[nSizes - 1];
+    // Small times large operand: scatter vs. direct. Timings are noisy,
+    // hence the crossover is the smallest size from which on the direct
+    // kernel wins consistently.
+    detail::Spectrum large = createSpectrum(largest);
+    calibration.scatterCrossover = 2 * largest;
+    for (Size k = nSizes; k > 0; --k) {
+        detail::Spectrum small = createSpectrum(sizes[k - 1]);
+        if (timeKernel(DIRECT_KERNEL, small, large) > timeKernel(
+            SCATTER_KERNEL, small, large)) {
+            break;
+        }
+        calibration.scatterCrossover = sizes[k - 1];
+    }
+    // self-convolutions: scatter vs. squaring, likewise
+    calibration.squareCrossover = 2 * largest;
+    for (Size k = nSizes; k > 0; --k) {
+        detail::Spectrum s = createSpectrum(sizes[k - 1]);
+        if (timeKernel(SQUARE_KERNEL, s, s) > timeKernel(SCATTER_KERNEL, s,
+            s)) {
+            break;
+        }
+        calibration.squareCrossover = sizes[k - 1];
+    }
+    return calibration;
+}
+
+KernelCalibration KernelCalibration::load(std::istream& is)
+{
+    KernelCalibration calibration;
+    std::string header, key;
+    int version = 0;
+    if (!(is >> header >> version) || header != calibrationHeader) {
+        ipaca_fail("KernelCalibration::load: not a calibration profile.");
+    }
+    if (version != calibrationVersion) {
+        ipaca_fail("KernelCalibration::load: unsupported profile version.");
+    }
+    Bool hasScatter = false, hasSquare = false;
+    Size value;
+    while (is >> key >> value) {
+        if (key == "scatterCrossover") {
+            calibration.scatterCrossover = value;
+            hasScatter = true;
+        } else if (key == "squareCrossover") {
+            calibration.squareCrossover = value;
+            hasSquare = true;
+        }
+    }
+    if (!is.eof() || !hasScatter || !hasSquare) {
+        ipaca_fail("KernelCalibration::load: malformed calibration profile.");
+    }
+    calibration.source = LOADED;
+    return calibration;
+}
+
+KernelCalibration KernelCalibration::load(const String& filename)
+{
+    std::ifstream ifs(filename.c_str());
+    if (!ifs) {
+        ipaca_fail("KernelCalibration::load: cannot open '" + filename + "'.");
+    }
+    return load(ifs);
+}
+
+void KernelCalibration::save(std::ostream& os) const
+{
+    os << calibrationHeader << ' ' << calibrationVersion << '\n'
+            << "scatterCrossover " << scatterCrossover << '\n'
+            << "squareCrossover " << squareCrossover << '\n';
+}
+
+void KernelCalibration::save(const String& filename) const
+{
+    std::ofstream ofs(filename.c_str());
+    save(ofs);
+    if (!ofs) {
+        ipaca_fail("KernelCalibration::save: cannot write '" + filename
+                + "'.");
+    }
+}
+
+const KernelCalibration& KernelCalibration::getDefault()
+{
+    boost::call_once(initDefaultCalibration, defaultCalibrationFlag);
+    return *defaultCalibration;
+}
+
+KernelStats::KernelStats()
+{
+    std::fill(calls, calls + NUM_KERNELS, 0);
+    std::fill(peaks, peaks + NUM_KERNELS, 0.0);
+}
+
+void detail::calculatePeak(const detail::Spectrum& s1,
+    const detail::Spectrum& s2, const Size k, detail::SpectrumElement& peak)
+{
+    if (&s1 == &s2) {
+        squarePeak(s1, k, peak);
+    } else {
+        convolvePeak(s1, s2, k, peak);
+    }
+}
+
+void detail::convolveRange(const ConvolutionKernel kernel,
+    const detail::Spectrum& s1, const detail::Spectrum& s2, const Size first,
+    const Size last, detail::SpectrumElement* result)
+{
+    switch (kernel) {
+        case SCATTER_KERNEL:
+            scatterRange(s1, s2, first, last, result);
+            break;
+        case SQUARE_KERNEL:
+            ipaca_precondition(&s1 == &s2,
+                "convolveRange: squaring requires identical operands.");
+            for (Size k = first; k < last; ++k) {
+                squarePeak(s1, k, result[k - first]);
+            }
+            break;
+        default:
+            for (Size k = first; k < last; ++k) {
+                convolvePeak(s1, s2, k, result[k - first]);
+            }
+            break;
+    }
+}
+
+detail::KernelCounters::KernelCounters()
+{
+}
+
+void detail::KernelCounters::record(const ConvolutionKernel kernel,
+    const Size peaks)
+{
+    detail::KernelCountersScope* scope = getCurrentScope();
+    if (scope && &scope->counters_ == this) {
+        ++scope->stats_.calls[kernel];
+        scope->stats_.peaks[kernel] += static_cast<Double>(peaks);
+        return;
+    }
+    boost::mutex::scoped_lock lock(mutex_);
+    ++stats_.calls[kernel];
+    stats_.peaks[kernel] += static_cast<Double>(peaks);
+}
+
+void detail::KernelCounters::merge(const KernelStats& stats)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    for (Size k = 0; k < NUM_KERNELS; ++k) {
+        stats_.calls[k] += stats.calls[k];
+        stats_.peaks[k] += stats.peaks[k];
+    }
+}
+
+KernelStats detail::KernelCounters::get() const
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    return stats_;
+}
+
+void detail::KernelCounters::reset()
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    stats_ = KernelStats();
+}
+
+detail::KernelCountersScope::KernelCountersScope(
+    detail::KernelCounters& counters) :
+    counters_(counters), previous_(getCurrentScope())
+{
+    setCurrentScope(this);
+}
+
+detail::KernelCountersScope::~KernelCountersScope()
+{
+    setCurrentScope(previous_);
+    counters_.merge(stats_);
+}
@@ -0,0 +1,361 @@
+/*
+ * ConvolutionPlan.cpp
+ *
+ *  Copyright (C) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/ConvolutionPlan.hpp>
+#include <ipaca/ElementPattern.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <utility>
+
+using namespace ipaca;
+
+namespace {
+
+Size addStep(detail::AdditionChain& chain, const Size lhs, const Size rhs)
+{
+    detail::PlanStep step;
+    step.lhs = lhs;
+    step.rhs = rhs;
+    chain.push_back(step);
+    return chain.size();
+}
+
+detail::IndexMoments scaleMoments(const detail::IndexMoments& m,
+    const Double n)
+{
+    detail::IndexMoments r;
+    r.mean = m.mean * n;
+    r.variance = m.variance * n;
+    r.span = m.span * n;
+    return r;
+}
+
+} // anonymous namespace
+
+detail::IndexMoments detail::getIndexMoments(const detail::Isotopes& isotopes)
+{
+    detail::IndexMoments m;
+    Double total = 0.0, first = 0.0, second = 0.0;
+    for (Size u = 0; u < isotopes.size(); ++u) {
+        Double x = static_cast<Double>(u);
+        total += isotopes[u].ab;
+        first += x * isotopes[u].ab;
+        second += x * x * isotopes[u].ab;
+    }
+    m.mean = total > 0.0 ? first / total : 0.0;
+    m.variance = total > 0.0 ? std::max(second / total - m.mean * m.mean,
+        0.0) : 0.0;
+    m.span = isotopes.empty() ? 0.0
+            : static_cast<Double>(isotopes.size() - 1);
+    return m;
+}
+
+Double detail::estimatePeakCount(const detail::IndexMoments& m,
+    const Double limit, const Size maxPeaks)
+{
+    Double z = limit < 1.0 ? std::sqrt(2.0 * std::log(1.0 / limit)) : 0.0;
+    z = std::max(z, 1.0);
+    Double sd = std::sqrt(m.variance);
+    Double lo = std::max(0.0, m.mean - z * sd);
+    Double hi = std::min(m.span, m.mean + z * sd);
+    Double w = std::max(hi - lo, 0.0) + 1.0;
+    return std::min(w, static_cast<Double>(maxPeaks));
+}
+
+void detail::binaryChain(const Size n, detail::AdditionChain& chain)
+{
+    chain.clear();
+    Size esa = 0;
+    Size msa = 0;
+    Bool msa_initialized = false;
+    Size k = n;
+    while (k) {
+        if (k & 1) {
+            if (msa_initialized) {
+                msa = addStep(chain, msa, esa);
+            } else {
+                msa = esa;
+                msa_initialized = true;
+            }
+        }
+        k = k >> 1;
+        if (k) {
+            esa = addStep(chain, esa, esa);
+        }
+    }
+    assert(chain.empty() || msa == chain.size());
+}
+
+void detail::slidingWindowChain(const Size n, const Size window,
+    detail::AdditionChain& chain)
+{
+    chain.clear();
+    if (n <= 1) {
+        return;
+    }
+    // Split the exponent into windows, most significant bit first. Each
+    // window is a run of at most 'window' bits that starts and ends with
+    // a set bit; zero squares the partial result, an odd value multiplies
+    // it with the respective power.
+    Int top = 0;
+    while ((n >> (top + 1)) != 0) {
+        ++top;
+    }
+    std::vector<Size> ops;
+    Size maxOdd = 1;
+    Int i = top;
+    while (i >= 0) {
+        if (((n >> i) & 1) == 0) {
+            ops.push_back(0);
+            --i;
+            continue;
+        }
+        Int j = std::max(i - static_cast<Int>(window) + 1, 0);
+        while (((n >> j) & 1) == 0) {
+            ++j;
+        }
+        Size value = (n >> j) & ((static_cast<Size>(1) << (i - j + 1)) - 1);
+        for (Int t = j; t <= i; ++t) {
+            ops.push_back(0);
+        }
+        ops.push_back(value);
+        maxOdd = std::max(maxOdd, value);
+        i = j - 1;
+    }
+    // precompute the odd powers
+    std::vector<Size> odd(maxOdd / 2 + 1);
+    odd[0] = 0;
+    if (maxOdd > 1) {
+        Size square = addStep(chain, 0, 0);
+        for (Size v = 1; v < odd.size(); ++v) {
+            odd[v] = addStep(chain, odd[v - 1], square);
+        }
+    }
+    // run the windows
+    Size acc = 0;
+    Bool acc_initialized = false;
+    for (Size k = 0; k < ops.size(); ++k) {
+        if (ops[k] == 0) {
+            if (acc_initialized) {
+                acc = addStep(chain, acc, acc);
+            }
+        } else if (acc_initialized) {
+            acc = addStep(chain, acc, odd[ops[k] / 2]);
+        } else {
+            acc = odd[ops[k] / 2];
+            acc_initialized = true;
+        }
+    }
+    assert(acc == chain.size());
+}
+
+Double detail::estimateChainCost(const detail::AdditionChain& chain,
+    const detail::IndexMoments& m, const Double limit, const Size maxPeaks)
+{
+    std::vector<Double> width(chain.size() + 1);
+    std::vector<Double> exponent(chain.size() + 1);
+    exponent[0] = 1.0;
+    width[0] = estimatePeakCount(m, limit, maxPeaks);
+    Double cost = 0.0;
+    for (Size k = 0; k < chain.size(); ++k) {
+        Size l = chain[k].lhs;
+        Size r = chain[k].rhs;
+        if (l == r) {
+            // the squaring kernel evaluates each pair only once
+            cost += 0.5 * width[l] * (width[l] + 1.0);
+        } else {
+            cost += width[l] * width[r];
+        }
+        exponent[k + 1] = exponent[l] + exponent[r];
+        width[k + 1] = estimatePeakCount(scaleMoments(m, exponent[k + 1]),
+            limit, maxPeaks);
+    }
+    return cost;
+}
+
+Double detail::getChainPruneWeight(const detail::AdditionChain& chain)
+{
+    if (chain.empty()) {
+        return 1.0;
+    }
+    // propagate the multiplicities from the result back to the nodes
+    std::vector<Double> multiplicity(chain.size() + 1, 0.0);
+    multiplicity.back() = 1.0;
+    for (Size k = chain.size(); k > 0; --k) {
+        multiplicity[chain[k - 1].lhs] += multiplicity[k];
+        multiplicity[chain[k - 1].rhs] += multiplicity[k];
+    }
+    Double weight = 0.0;
+    for (Size k = 1; k < multiplicity.size(); ++k) {
+        weight += multiplicity[k];
+    }
+    return weight;
+}
+
+detail::ConvolutionPlanner::ConvolutionPlanner(const Size capacity) :
+    capacity_(capacity)
+{
+}
+
+boost::shared_ptr<const detail::ConvolutionPlan>
+detail::ConvolutionPlanner::getPlan(const detail::Stoichiometry& intStoi,
+    const Double limit, const Bool closedForm, const Size maxPeaks) const
+{
+    return boost::shared_ptr<const ConvolutionPlan>(new ConvolutionPlan(
+        buildPlan(intStoi, limit, closedForm, maxPeaks, true)));
+}
+
+detail::ConvolutionPlan detail::ConvolutionPlanner::createPlan(
+    const detail::Stoichiometry& intStoi, const Double limit,
+    const Bool closedForm, const Size maxPeaks) const
+{
+    return buildPlan(intStoi, limit, closedForm, maxPeaks, false);
+}
+
+detail::ConvolutionPlanner::EntryPtr
+detail::ConvolutionPlanner::planElement(const detail::Isotopes& isotopes,
+    const Size n, const Double limit, const Bool closedForm,
+    const Size maxPeaks)
+{
+    boost::shared_ptr<ElementEntry> entry(new ElementEntry);
+    detail::IndexMoments m = getIndexMoments(isotopes);
+    entry->closedForm = closedForm && n > 1
+            && detail::hasClosedFormPattern(isotopes);
+    if (entry->closedForm) {
+        entry->cost = estimatePeakCount(scaleMoments(m,
+            static_cast<Double>(n)), limit, maxPeaks) * m.span;
+        entry->pruneWeight = 1.0;
+    } else {
+        // pick the cheapest exponentiation scheme; the classic binary
+        // scheme wins ties
+        detail::binaryChain(n, entry->chain);
+        entry->cost = estimateChainCost(entry->chain, m, limit, maxPeaks);
+        for (Size window = 1; window <= 4; ++window) {
+            detail::AdditionChain chain;
+            detail::slidingWindowChain(n, window, chain);
+            Double c = estimateChainCost(chain, m, limit, maxPeaks);
+            if (c < entry->cost) {
+                entry->cost = c;
+                entry->chain.swap(chain);
+            }
+        }
+        entry->pruneWeight = getChainPruneWeight(entry->chain);
+    }
+    return entry;
+}
+
+detail::ConvolutionPlan detail::ConvolutionPlanner::buildPlan(
+    const detail::Stoichiometry& intStoi, const Double limit,
+    const Bool closedForm, const Size maxPeaks, const Bool cached) const
+{
+    detail::ConvolutionPlan plan;
+    plan.cost = 0.0;
+    plan.pruneWeight = 0.0;
+    std::vector<detail::IndexMoments> moments;
+    for (Size i = 0; i < intStoi.size(); ++i) {
+        Size n = static_cast<Size>(intStoi[i].count);
+        if (n == 0) {
+            continue;
+        }
+        const detail::Isotopes& isotopes = intStoi[i].isotopes;
+        EntryPtr entry;
+        Key key;
+        if (cached) {
+            // The element plan depends on the count and the abundances
+            // only, not on the masses or the rest of the composition.
+            key.push_back(limit);
+            key.push_back(closedForm ? 1.0 : 0.0);
+            key.push_back(static_cast<Double>(maxPeaks));
+            key.push_back(static_cast<Double>(n));
+            typedef detail::Isotopes::const_iterator ICI;
+            for (ICI j = isotopes.begin(); j != isotopes.end(); ++j) {
+                key.push_back(j->ab);
+            }
+            boost::mutex::scoped_lock lock(mutex_);
+            Cache::iterator c = cache_.find(key);
+            if (c != cache_.end()) {
+                usage_.splice(usage_.begin(), usage_, c->second.second);
+                entry = c->second.first;
+            }
+        }
+        if (!entry) {
+            entry = planElement(isotopes, n, limit, closedForm, maxPeaks);
+            if (cached && capacity_ > 0) {
+                boost::mutex::scoped_lock lock(mutex_);
+                if (cache_.find(key) == cache_.end()) {
+                    if (cache_.size() >= capacity_) {
+                        cache_.erase(usage_.back());
+                        usage_.pop_back();
+                    }
+                    usage_.push_front(key);
+                    cache_[key] = std::make_pair(entry, usage_.begin());
+                }
+            }
+        }
+        detail::ElementPlan ep;
+        ep.element = i;
+        ep.closedForm = entry->closedForm;
+        ep.chain = entry->chain;
+        plan.cost += entry->cost;
+        plan.pruneWeight += entry->pruneWeight;
+        plan.elements.push_back(ep);
+        moments.push_back(scaleMoments(getIndexMoments(isotopes),
+            static_cast<Double>(n)));
+    }
+    // Huffman-style merging: always combine the two partial results with
+    // the smallest estimated peak counts.
+    std::vector<Size> active;
+    std::vector<Double> width;
+    for (Size k = 0; k < moments.size(); ++k) {
+        active.push_back(k);
+        width.push_back(estimatePeakCount(moments[k], limit, maxPeaks));
+    }
+    while (active.size() > 1) {
+        Size a = 0, b = 1;
+        if (width[active[b]] < width[active[a]]) {
+            std::swap(a, b);
+        }
+        for (Size k = 2; k < active.size(); ++k) {
+            if (width[active[k]] < width[active[a]]) {
+                b = a;
+                a = k;
+            } else if (width[active[k]] < width[active[b]]) {
+                b = k;
+            }
+        }
+        Size lhs = active[std::min(a, b)];
+        Size rhs = active[std::max(a, b)];
+        detail::PlanStep step;
+        step.lhs = lhs;
+        step.rhs = rhs;
+        plan.merges.push_back(step);
+        plan.cost += width[lhs] * width[rhs];
+        plan.pruneWeight += 1.0;
+        detail::IndexMoments m;
+        m.mean = moments[lhs].mean + moments[rhs].mean;
+        m.variance = moments[lhs].variance + moments[rhs].variance;
+        m.span = moments[lhs].span + moments[rhs].span;
+        moments.push_back(m);
+        width.push_back(estimatePeakCount(m, limit, maxPeaks));
+        active.erase(active.begin() + std::max(a, b));
+        active[std::min(a, b)] = moments.size() - 1;
+    }
+    return plan;
+}
+
+Size detail::ConvolutionPlanner::size() const
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    return cache_.size();
+}
+
+void detail::ConvolutionPlanner::clear()
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    cache_.clear();
+    usage_.clear();
+}
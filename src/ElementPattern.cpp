@@ -0,0 +1,141 @@
+/*
+ * ElementPattern.cpp
+ *
+ *  Copyright (C) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/ElementPattern.hpp>
+#include <ipaca/Error.hpp>
+#include <cmath>
+
+using namespace ipaca;
+
+Bool detail::hasClosedFormPattern(const detail::Isotopes& isotopes)
+{
+    return !isotopes.empty() && isotopes.size() <= 3;
+}
+
+void detail::binomialTerms(const Size n, const Double p, const Double tau,
+    Size& first, std::vector<Double>& probs)
+{
+    probs.clear();
+    // degenerate distributions
+    if (p <= 0.0 || n == 0) {
+        first = 0;
+        probs.push_back(1.0);
+        return;
+    }
+    if (p >= 1.0) {
+        first = n;
+        probs.push_back(1.0);
+        return;
+    }
+    Double q = 1.0 - p;
+    Double dn = static_cast<Double>(n);
+    Size mode = static_cast<Size>(std::floor((dn + 1.0) * p));
+    if (mode > n) {
+        mode = n;
+    }
+    Double dm = static_cast<Double>(mode);
+    Double pm = std::exp(lgamma(dn + 1.0) - lgamma(dm + 1.0)
+            - lgamma(dn - dm + 1.0) + dm * std::log(p) + (dn - dm)
+            * std::log(q));
+    // walk to the left: P(k-1) = P(k) * k / (n-k+1) * q/p
+    std::vector<Double> left;
+    Double v = pm;
+    for (Size k = mode; k > 0; --k) {
+        v *= static_cast<Double>(k) / static_cast<Double>(n - k + 1) * (q / p);
+        if (v <= tau) {
+            break;
+        }
+        left.push_back(v);
+    }
+    first = mode - left.size();
+    probs.assign(left.rbegin(), left.rend());
+    probs.push_back(pm);
+    // walk to the right: P(k+1) = P(k) * (n-k) / (k+1) * p/q
+    v = pm;
+    for (Size k = mode; k < n; ++k) {
+        v *= static_cast<Double>(n - k) / static_cast<Double>(k + 1) * (p / q);
+        if (v <= tau) {
+            break;
+        }
+        probs.push_back(v);
+    }
+}
+
+void detail::closedFormPattern(const detail::Isotopes& isotopes, const Size n,
+    const Double tau, detail::Spectrum& spectrum, Size* first, const Size lo,
+    const Size hi)
+{
+    ipaca_precondition(hasClosedFormPattern(isotopes),
+        "closedFormPattern: at most three isotopes are supported.");
+    spectrum.clear();
+    // pad to three entries; missing isotopes have zero abundance
+    Double m[3] = { isotopes[0].mz, 0.0, 0.0 };
+    Double p[3] = { isotopes[0].ab, 0.0, 0.0 };
+    for (Size u = 1; u < isotopes.size(); ++u) {
+        m[u] = isotopes[u].mz;
+        p[u] = isotopes[u].ab;
+    }
+    // Isotope tables need not sum up to one exactly; Mercury keeps the
+    // abundances unnormalized, hence so do we.
+    Double total = p[0] + p[1] + p[2];
+    if (first) {
+        *first = lo;
+    }
+    if (n == 0 || total <= 0.0 || lo >= hi) {
+        return;
+    }
+    Double scale = std::pow(total, static_cast<Double>(n));
+    Double t = tau / scale;
+    // a2 ~ B(n, p2)
+    Size first2;
+    std::vector<Double> probs2;
+    binomialTerms(n, p[2] / total, t, first2, probs2);
+    // a1 | a2 ~ B(n - a2, p1 / (p0 + p1))
+    Double light = p[0] + p[1];
+    Double p1 = light > 0.0 ? p[1] / light : 0.0;
+    Size first1;
+    std::vector<Double> probs1;
+    std::vector<Double> abundance, massExpectation;
+    for (Size i2 = 0; i2 < probs2.size(); ++i2) {
+        Size a2 = first2 + i2;
+        binomialTerms(n - a2, p1, t / probs2[i2], first1, probs1);
+        for (Size i1 = 0; i1 < probs1.size(); ++i1) {
+            Size a1 = first1 + i1;
+            Size a0 = n - a2 - a1;
+            Size k = a1 + 2 * a2;
+            if (k < lo) {
+                continue;
+            }
+            if (k >= hi) {
+                break;
+            }
+            Size idx = k - lo;
+            if (idx >= abundance.size()) {
+                abundance.resize(idx + 1, 0.0);
+                massExpectation.resize(idx + 1, 0.0);
+            }
+            Double prob = probs2[i2] * probs1[i1];
+            abundance[idx] += prob;
+            massExpectation[idx] += prob * (static_cast<Double>(a0) * m[0]
+                    + static_cast<Double>(a1) * m[1]
+                    + static_cast<Double>(a2) * m[2]);
+        }
+    }
+    // skip the empty leading indices and assemble the spectrum
+    Size start = 0;
+    while (start < abundance.size() && abundance[start] <= 0.0) {
+        ++start;
+    }
+    if (first) {
+        *first = lo + start;
+    }
+    spectrum.resize(abundance.size() - start);
+    for (Size k = start; k < abundance.size(); ++k) {
+        detail::SpectrumElement& e = spectrum[k - start];
+        e.mz = abundance[k] > 0.0 ? massExpectation[k] / abundance[k] : 0.0;
+        e.ab = abundance[k] * scale;
+    }
+}
@@ -0,0 +1,81 @@
+/*
+ * Executor.cpp
+ *
+ *  Copyright (C) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/Executor.hpp>
+#include <boost/bind.hpp>
+#include <algorithm>
+
+using namespace ipaca;
+
+Executor::~Executor()
+{
+}
+
+ThreadPoolExecutor::ThreadPoolExecutor(const Size threads) :
+    stopping_(false), size_(threads)
+{
+    if (size_ == 0) {
+        size_ = std::max(boost::thread::hardware_concurrency(), 1u);
+    }
+    for (Size k = 0; k < size_; ++k) {
+        threads_.create_thread(boost::bind(&ThreadPoolExecutor::runWorker,
+            this));
+    }
+}
+
+ThreadPoolExecutor::~ThreadPoolExecutor()
+{
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        stopping_ = true;
+    }
+    ready_.notify_all();
+    threads_.join_all();
+}
+
+void ThreadPoolExecutor::execute(const Work& work)
+{
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        queue_.push_back(work);
+    }
+    ready_.notify_one();
+}
+
+Size ThreadPoolExecutor::getThreads() const
+{
+    return size_;
+}
+
+Size ThreadPoolExecutor::getQueued() const
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    return queue_.size();
+}
+
+void ThreadPoolExecutor::runWorker()
+{
+    for (;;) {
+        Work work;
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            while (queue_.empty() && !stopping_) {
+                ready_.wait(lock);
+            }
+            // drain the queue before stopping
+            if (queue_.empty()) {
+                return;
+            }
+            work.swap(queue_.front());
+            queue_.pop_front();
+        }
+        try {
+            work();
+        } catch (...) {
+            // work must not throw; keep the thread alive regardless
+        }
+    }
+}
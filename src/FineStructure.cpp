@@ -0,0 +1,296 @@
+/*
+ * FineStructure.cpp
+ *
+ *  Copyright (C) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/FineStructure.hpp>
+#include <ipaca/Error.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_set.hpp>
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <vector>
+
+using namespace ipaca;
+
+namespace {
+
+/** The number of atoms per isotope.
+ */
+typedef std::vector<Size> Configuration;
+
+/** A configuration that waits to be enumerated.
+ */
+struct Candidate
+{
+    Double logProbability;
+    Configuration configuration;
+
+    bool operator<(const Candidate& rhs) const
+    {
+        return logProbability < rhs.logProbability;
+    }
+};
+
+/** Enumerates the configurations of n atoms of an element in order of
+ * decreasing (multinomial) probability.
+ */
+class ElementGenerator
+{
+public:
+    ElementGenerator(const detail::Isotopes& isotopes, const Size n);
+
+    /** Enumerate configurations until the k-th is available.
+     * @return False if there are at most k configurations.
+     */
+    bool ensure(const Size k);
+
+    Double getLogProbability(const Size k) const
+    {
+        return logProbabilities_[k];
+    }
+
+    Double getMass(const Size k) const
+    {
+        return masses_[k];
+    }
+
+    /** @return The logarithm of the total probability of all
+     *          configurations.
+     */
+    Double getLogTotal() const
+    {
+        return logTotal_;
+    }
+
+private:
+    Double logProbability(const Configuration& c) const;
+
+    void push(const Configuration& c);
+
+    std::vector<Double> mz_, logAb_;
+    Double logNFactorial_, logTotal_;
+    std::vector<Double> logProbabilities_, masses_;
+    std::priority_queue<Candidate> queue_;
+    boost::unordered_set<Configuration, boost::hash<Configuration> >
+            visited_;
+};
+
+ElementGenerator::ElementGenerator(const detail::Isotopes& isotopes,
+    const Size n) :
+    logNFactorial_(lgamma(static_cast<Double>(n) + 1.0))
+{
+    // isotopes without abundance never occur
+    Double total = 0.0;
+    typedef detail::Isotopes::const_iterator ICI;
+    for (ICI i = isotopes.begin(); i != isotopes.end(); ++i) {
+        if (i->ab > 0.0) {
+            mz_.push_back(i->mz);
+            logAb_.push_back(std::log(i->ab));
+            total += i->ab;
+        }
+    }
+    logTotal_ = static_cast<Double>(n) * std::log(total);
+    Size k = mz_.size();
+    // start close to the mode and climb to it: as the log-probability is
+    // a separable concave function on the simplex, a configuration that
+    // cannot be improved by moving one atom is the mode.
+    Configuration c(k, 0);
+    Size assigned = 0, largest = 0;
+    for (Size u = 0; u < k; ++u) {
+        c[u] = static_cast<Size>(std::floor(static_cast<Double>(n)
+                * std::exp(logAb_[u]) / total));
+        assigned += c[u];
+        if (logAb_[u] > logAb_[largest]) {
+            largest = u;
+        }
+    }
+    c[largest] += n - std::min(n, assigned);
+    bool improved = true;
+    while (improved) {
+        improved = false;
+        Double best = 0.0;
+        Size from = 0, to = 0;
+        for (Size i = 0; i < k; ++i) {
+            if (c[i] == 0) {
+                continue;
+            }
+            for (Size j = 0; j < k; ++j) {
+                if (i == j) {
+                    continue;
+                }
+                Double gain = std::log(static_cast<Double>(c[i]))
+                        - std::log(static_cast<Double>(c[j] + 1))
+                        + logAb_[j] - logAb_[i];
+                if (gain > best) {
+                    best = gain;
+                    from = i;
+                    to = j;
+                }
+            }
+        }
+        if (best > 0.0) {
+            --c[from];
+            ++c[to];
+            improved = true;
+        }
+    }
+    if (k > 0) {
+        push(c);
+    }
+}
+
+Double ElementGenerator::logProbability(const Configuration& c) const
+{
+    Double lp = logNFactorial_;
+    for (Size u = 0; u < c.size(); ++u) {
+        lp += static_cast<Double>(c[u]) * logAb_[u] - lgamma(
+            static_cast<Double>(c[u]) + 1.0);
+    }
+    return lp;
+}
+
+void ElementGenerator::push(const Configuration& c)
+{
+    if (visited_.insert(c).second) {
+        Candidate candidate;
+        candidate.logProbability = logProbability(c);
+        candidate.configuration = c;
+        queue_.push(candidate);
+    }
+}
+
+bool ElementGenerator::ensure(const Size k)
+{
+    // best-first search from the mode: every other configuration has a
+    // more probable neighbour, hence configurations leave the queue in
+    // order of decreasing probability.
+    while (logProbabilities_.size() <= k) {
+        if (queue_.empty()) {
+            return false;
+        }
+        Candidate top = queue_.top();
+        queue_.pop();
+        Double mass = 0.0;
+        for (Size u = 0; u < mz_.size(); ++u) {
+            mass += static_cast<Double>(top.configuration[u]) * mz_[u];
+        }
+        logProbabilities_.push_back(top.logProbability);
+        masses_.push_back(mass);
+        Configuration& c = top.configuration;
+        for (Size i = 0; i < c.size(); ++i) {
+            if (c[i] == 0) {
+                continue;
+            }
+            for (Size j = 0; j < c.size(); ++j) {
+                if (i != j) {
+                    --c[i];
+                    ++c[j];
+                    push(c);
+                    ++c[i];
+                    --c[j];
+                }
+            }
+        }
+    }
+    return true;
+}
+
+inline bool lessMass(const detail::SpectrumElement& lhs,
+    const detail::SpectrumElement& rhs)
+{
+    return lhs.mz < rhs.mz;
+}
+
+} // anonymous namespace
+
+Double detail::fineStructure(const detail::Stoichiometry& stoichiometry,
+    const Double coverage, detail::Spectrum& spectrum, const Size maxPeaks)
+{
+    ipaca_precondition(coverage > 0.0 && coverage <= 1.0,
+        "fineStructure: coverage must be in (0, 1].");
+    spectrum.clear();
+    if (!detail::isPlausibleStoichiometry(stoichiometry) || maxPeaks == 0) {
+        return 0.0;
+    }
+    // one sub-generator per element; fractional atoms are a mixture of
+    // "no atom" and a full atom
+    std::vector<ElementGenerator> generators;
+    Double logTotal = 0.0;
+    typedef detail::Stoichiometry::const_iterator SCI;
+    for (SCI i = stoichiometry.begin(); i != stoichiometry.end(); ++i) {
+        if (i->count <= 0.0 || i->isotopes.empty()) {
+            continue;
+        }
+        Double integer = trunc(i->count);
+        Double fractional = i->count - integer;
+        if (integer > 0.0) {
+            generators.push_back(ElementGenerator(i->isotopes,
+                static_cast<Size>(integer)));
+        }
+        if (fractional > 0.0) {
+            detail::Isotopes esa;
+            detail::fractionalAtom(i->isotopes, fractional, esa);
+            generators.push_back(ElementGenerator(esa, 1));
+        }
+    }
+    Size nElements = generators.size();
+    for (Size e = 0; e < nElements; ++e) {
+        if (!generators[e].ensure(0)) {
+            return 0.0;
+        }
+        logTotal += generators[e].getLogTotal();
+    }
+    if (nElements == 0) {
+        return 0.0;
+    }
+    // Best-first search over the tuples of configuration indices. The
+    // parent of a tuple t is t - e_p, where p is the first non-zero
+    // position of t; conversely, the children of t increment a position
+    // j <= p. Every tuple has a single parent, and children are never
+    // more probable than their parent.
+    std::vector<Size> tuples(nElements, 0);
+    std::priority_queue<std::pair<Double, Size> > queue;
+    Double lp0 = 0.0;
+    for (Size e = 0; e < nElements; ++e) {
+        lp0 += generators[e].getLogProbability(0);
+    }
+    queue.push(std::make_pair(lp0, static_cast<Size>(0)));
+    Double target = coverage * std::exp(logTotal);
+    Double covered = 0.0;
+    while (!queue.empty() && covered < target && spectrum.size() < maxPeaks) {
+        Double lp = queue.top().first;
+        Size t = queue.top().second * nElements;
+        queue.pop();
+        detail::SpectrumElement peak;
+        peak.mz = 0.0;
+        peak.ab = std::exp(lp);
+        Size pivot = nElements - 1;
+        for (Size e = 0; e < nElements; ++e) {
+            peak.mz += generators[e].getMass(tuples[t + e]);
+            if (tuples[t + e] > 0 && e < pivot) {
+                pivot = e;
+            }
+        }
+        spectrum.push_back(peak);
+        covered += peak.ab;
+        for (Size j = 0; j <= pivot; ++j) {
+            Size k = tuples[t + j];
+            if (!generators[j].ensure(k + 1)) {
+                continue;
+            }
+            Size child = tuples.size();
+            tuples.resize(child + nElements);
+            std::copy(tuples.begin() + t, tuples.begin() + t + nElements,
+                tuples.begin() + child);
+            ++tuples[child + j];
+            queue.push(std::make_pair(lp - generators[j].getLogProbability(k)
+                    + generators[j].getLogProbability(k + 1), child
+                    / nElements));
+        }
+    }
+    std::sort(spectrum.begin(), spectrum.end(), lessMass);
+    return covered;
+}
@@ -0,0 +1,168 @@
+/*
+ * MassCalculator.cpp
+ *
+ *  Copyright (C) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/MassCalculator.hpp>
+#include <ipaca/Error.hpp>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace ipaca;
+
+namespace {
+
+/** The number of compounds whose masses are accumulated together.
+ */
+const Size blockSize = 8;
+
+/** Calculates the masses of the compounds [c, c + blockSize).
+ */
+inline void massBlock(const Double* counts, const Size c, const Size stride,
+    const Double* mono, const Double* average, const Size nElements,
+    Double* monoOut, Double* averageOut)
+{
+#ifdef __SSE2__
+    __m128d m0 = _mm_setzero_pd(), m1 = m0, m2 = m0, m3 = m0;
+    __m128d a0 = m0, a1 = m0, a2 = m0, a3 = m0;
+    const Double* row = counts + c;
+    for (Size e = 0; e < nElements; ++e, row += stride) {
+        __m128d m = _mm_set1_pd(mono[e]);
+        __m128d a = _mm_set1_pd(average[e]);
+        __m128d x0 = _mm_loadu_pd(row);
+        __m128d x1 = _mm_loadu_pd(row + 2);
+        __m128d x2 = _mm_loadu_pd(row + 4);
+        __m128d x3 = _mm_loadu_pd(row + 6);
+        m0 = _mm_add_pd(m0, _mm_mul_pd(x0, m));
+        m1 = _mm_add_pd(m1, _mm_mul_pd(x1, m));
+        m2 = _mm_add_pd(m2, _mm_mul_pd(x2, m));
+        m3 = _mm_add_pd(m3, _mm_mul_pd(x3, m));
+        a0 = _mm_add_pd(a0, _mm_mul_pd(x0, a));
+        a1 = _mm_add_pd(a1, _mm_mul_pd(x1, a));
+        a2 = _mm_add_pd(a2, _mm_mul_pd(x2, a));
+        a3 = _mm_add_pd(a3, _mm_mul_pd(x3, a));
+    }
+    if (monoOut) {
+        _mm_storeu_pd(monoOut + c, m0);
+        _mm_storeu_pd(monoOut + c + 2, m1);
+        _mm_storeu_pd(monoOut + c + 4, m2);
+        _mm_storeu_pd(monoOut + c + 6, m3);
+    }
+    if (averageOut) {
+        _mm_storeu_pd(averageOut + c, a0);
+        _mm_storeu_pd(averageOut + c + 2, a1);
+        _mm_storeu_pd(averageOut + c + 4, a2);
+        _mm_storeu_pd(averageOut + c + 6, a3);
+    }
+#else
+    Double m[blockSize] = { 0.0 };
+    Double a[blockSize] = { 0.0 };
+    const Double* row = counts + c;
+    for (Size e = 0; e < nElements; ++e, row += stride) {
+        for (Size k = 0; k < blockSize; ++k) {
+            m[k] += row[k] * mono[e];
+            a[k] += row[k] * average[e];
+        }
+    }
+    for (Size k = 0; k < blockSize; ++k) {
+        if (monoOut) {
+            monoOut[c + k] = m[k];
+        }
+        if (averageOut) {
+            averageOut[c + k] = a[k];
+        }
+    }
+#endif
+}
+
+} // anonymous namespace
+
+MassCalculator::MassCalculator()
+{
+}
+
+Size MassCalculator::addElement(const Double monoisotopicMass,
+    const Double averageMass)
+{
+    mono_.push_back(monoisotopicMass);
+    average_.push_back(averageMass);
+    return mono_.size() - 1;
+}
+
+Size MassCalculator::addElement(const detail::Element& element)
+{
+    ipaca_precondition(!element.isotopes.empty(),
+        "MassCalculator::addElement: element without isotopes.");
+    Double average = 0.0;
+    typedef detail::Isotopes::const_iterator ICI;
+    for (ICI j = element.isotopes.begin(); j != element.isotopes.end(); ++j) {
+        average += j->mz * j->ab;
+    }
+    return addElement(element.isotopes[0].mz, average);
+}
+
+Size MassCalculator::size() const
+{
+    return mono_.size();
+}
+
+Double MassCalculator::getMonoisotopicMass(const Size element) const
+{
+    ipaca_precondition(element < mono_.size(),
+        "MassCalculator::getMonoisotopicMass: element out of range.");
+    return mono_[element];
+}
+
+Double MassCalculator::getAverageMass(const Size element) const
+{
+    ipaca_precondition(element < average_.size(),
+        "MassCalculator::getAverageMass: element out of range.");
+    return average_[element];
+}
+
+void MassCalculator::operator()(const Double* counts, const Size nCompounds,
+    const Size stride, Double* monoisotopicMasses,
+    Double* averageMasses) const
+{
+    ipaca_precondition(stride >= nCompounds,
+        "MassCalculator: the stride must not be smaller than the number "
+        "of compounds.");
+    if (nCompounds == 0 || (!monoisotopicMasses && !averageMasses)) {
+        return;
+    }
+    ipaca_precondition(counts || mono_.empty(),
+        "MassCalculator: no composition matrix.");
+    Size nElements = mono_.size();
+    const Double* mono = nElements > 0 ? &mono_[0] : 0;
+    const Double* average = nElements > 0 ? &average_[0] : 0;
+    Size c = 0;
+    for (; c + blockSize <= nCompounds; c += blockSize) {
+        massBlock(counts, c, stride, mono, average, nElements,
+            monoisotopicMasses, averageMasses);
+    }
+    // the remaining compounds
+    for (; c < nCompounds; ++c) {
+        Double m = 0.0, a = 0.0;
+        const Double* row = counts + c;
+        for (Size e = 0; e < nElements; ++e, row += stride) {
+            m += *row * mono[e];
+            a += *row * average[e];
+        }
+        if (monoisotopicMasses) {
+            monoisotopicMasses[c] = m;
+        }
+        if (averageMasses) {
+            averageMasses[c] = a;
+        }
+    }
+}
+
+void MassCalculator::operator()(const Double* counts, const Size nCompounds,
+    Double* monoisotopicMasses, Double* averageMasses) const
+{
+    (*this)(counts, nCompounds, nCompounds, monoisotopicMasses,
+        averageMasses);
+}
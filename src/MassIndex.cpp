@@ -0,0 +1,159 @@
+/*
+ * MassIndex.cpp
+ *
+ *  Copyright (C) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/MassIndex.hpp>
+#include <algorithm>
+
+using namespace ipaca;
+
+namespace {
+
+/** The number of queries that are searched in lockstep.
+ */
+const Size batchSize = 8;
+
+/** Orders positions by their masses.
+ */
+struct LessMass
+{
+    explicit LessMass(const std::vector<Double>& masses) :
+        masses_(masses)
+    {
+    }
+
+    bool operator()(const Size lhs, const Size rhs) const
+    {
+        return masses_[lhs] < masses_[rhs];
+    }
+
+    const std::vector<Double>& masses_;
+};
+
+/** Fills the Eytzinger layout by an in-order walk of the implicit tree.
+ * @param k The current node (1-based).
+ * @param rank The rank of the next mass in sorted order.
+ * @return The rank of the next mass after the subtree of k.
+ */
+Size fill(const std::vector<Double>& sorted, const Size k, Size rank,
+    std::vector<Double>& eytzinger, std::vector<Size>& ranks)
+{
+    if (k < eytzinger.size()) {
+        rank = fill(sorted, 2 * k, rank, eytzinger, ranks);
+        eytzinger[k] = sorted[rank];
+        ranks[k] = rank;
+        ++rank;
+        rank = fill(sorted, 2 * k + 1, rank, eytzinger, ranks);
+    }
+    return rank;
+}
+
+} // anonymous namespace
+
+detail::MassIndex::MassIndex() :
+    eytzinger_(1), ranks_(1), depth_(0)
+{
+}
+
+void detail::MassIndex::build(const std::vector<Double>& masses)
+{
+    Size n = masses.size();
+    ids_.resize(n);
+    for (Size k = 0; k < n; ++k) {
+        ids_[k] = k;
+    }
+    std::stable_sort(ids_.begin(), ids_.end(), LessMass(masses));
+    sorted_.resize(n);
+    for (Size k = 0; k < n; ++k) {
+        sorted_[k] = masses[ids_[k]];
+    }
+    // position 0 is unused; the root is at position 1
+    eytzinger_.assign(n + 1, 0.0);
+    ranks_.assign(n + 1, 0);
+    fill(sorted_, 1, 0, eytzinger_, ranks_);
+    depth_ = 0;
+    for (Size m = n; m > 0; m >>= 1) {
+        ++depth_;
+    }
+}
+
+Size detail::MassIndex::size() const
+{
+    return sorted_.size();
+}
+
+Size detail::MassIndex::toRank(Size k) const
+{
+    // the search went right at the trailing one bits of k; the last left
+    // turn is the answer
+    while (k & 1) {
+        k >>= 1;
+    }
+    k >>= 1;
+    return k == 0 ? sorted_.size() : ranks_[k];
+}
+
+Size detail::MassIndex::lowerBound(const Double mass) const
+{
+    Size n = sorted_.size();
+    Size k = 1;
+    while (k <= n) {
+        k = 2 * k + (eytzinger_[k] < mass);
+    }
+    return toRank(k);
+}
+
+detail::MassIndex::Range detail::MassIndex::find(const Double lo,
+    const Double hi) const
+{
+    Size first = lowerBound(lo);
+    Size last = first;
+    while (last < sorted_.size() && sorted_[last] <= hi) {
+        ++last;
+    }
+    return Range(first, last);
+}
+
+void detail::MassIndex::find(const Double* lo, const Double* hi,
+    const Size n, Range* ranges) const
+{
+    Size size = sorted_.size();
+    Size k[batchSize];
+    for (Size q = 0; q < n; q += batchSize) {
+        Size m = std::min(batchSize, n - q);
+        for (Size j = 0; j < m; ++j) {
+            k[j] = 1;
+        }
+        // every search takes depth_ or depth_ - 1 steps
+        for (Size level = 0; level < depth_; ++level) {
+            for (Size j = 0; j < m; ++j) {
+                if (k[j] <= size) {
+#ifdef __GNUC__
+                    __builtin_prefetch(&eytzinger_[0] + 8 * k[j]);
+#endif
+                    k[j] = 2 * k[j] + (eytzinger_[k[j]] < lo[q + j]);
+                }
+            }
+        }
+        for (Size j = 0; j < m; ++j) {
+            Size first = toRank(k[j]);
+            Size last = first;
+            while (last < size && sorted_[last] <= hi[q + j]) {
+                ++last;
+            }
+            ranges[q + j] = Range(first, last);
+        }
+    }
+}
+
+Double detail::MassIndex::getMass(const Size rank) const
+{
+    return sorted_[rank];
+}
+
+Size detail::MassIndex::getId(const Size rank) const
+{
+    return ids_[rank];
+}
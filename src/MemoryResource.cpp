@@ -0,0 +1,211 @@
+/*
+ * MemoryResource.cpp
+ *
+ *  Copyright (C) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/MemoryResource.hpp>
+#include <algorithm>
+#include <new>
+
+#ifndef __GNUC__
+#include <boost/thread/tss.hpp>
+#endif
+
+using namespace ipaca;
+
+namespace {
+
+/** The alignment of all blocks; enough for any fundamental type and for
+ * SSE registers.
+ */
+const Size alignment = 16;
+
+Size alignUp(const Size bytes)
+{
+    return (bytes + alignment - 1) & ~(alignment - 1);
+}
+
+/** Every block is preceded by a header that records its origin.
+ */
+union BlockHeader
+{
+    struct
+    {
+        MemoryResource* resource;
+        Size bytes;
+    } info;
+    char pad[alignment];
+};
+
+// the memory resource of the calling thread
+#ifdef __GNUC__
+__thread MemoryResource* currentResource = 0;
+
+MemoryResource* getCurrent()
+{
+    return currentResource;
+}
+
+void setCurrent(MemoryResource* resource)
+{
+    currentResource = resource;
+}
+#else
+void noCleanup(MemoryResource*)
+{
+}
+
+boost::thread_specific_ptr<MemoryResource> currentResource(&noCleanup);
+
+MemoryResource* getCurrent()
+{
+    return currentResource.get();
+}
+
+void setCurrent(MemoryResource* resource)
+{
+    currentResource.reset(resource);
+}
+#endif
+
+} // anonymous namespace
+
+MemoryResource::~MemoryResource()
+{
+}
+
+MonotonicArena::MonotonicArena(const Size chunkSize) :
+    chunkSize_(std::max(alignUp(chunkSize), alignment)), current_(0),
+            end_(0), allocated_(0)
+{
+}
+
+MonotonicArena::~MonotonicArena()
+{
+    for (Size i = 0; i < chunks_.size(); ++i) {
+        ::operator delete(chunks_[i].begin);
+    }
+}
+
+void MonotonicArena::addChunk(const Size bytes)
+{
+    Chunk c;
+    c.size = std::max(bytes, chunkSize_);
+    c.begin = static_cast<char*>(::operator new(c.size));
+    chunks_.push_back(c);
+    current_ = c.begin;
+    end_ = c.begin + c.size;
+}
+
+void* MonotonicArena::allocate(const Size bytes)
+{
+    Size n = alignUp(bytes);
+    if (n < bytes) {
+        return 0;
+    }
+    if (static_cast<Size>(end_ - current_) < n) {
+        try {
+            addChunk(n);
+        } catch (const std::bad_alloc&) {
+            return 0;
+        }
+    }
+    void* p = current_;
+    current_ += n;
+    allocated_ += n;
+    return p;
+}
+
+void MonotonicArena::deallocate(void* p, const Size bytes)
+{
+    Size n = alignUp(bytes);
+    allocated_ -= n;
+    // give back the most recent block
+    if (static_cast<char*>(p) + n == current_) {
+        current_ = static_cast<char*>(p);
+    }
+}
+
+void MonotonicArena::reset()
+{
+    allocated_ = 0;
+    if (chunks_.size() > 1) {
+        // replace the chunks by one chunk of the same total size
+        Size total = getCapacity();
+        for (Size i = 0; i < chunks_.size(); ++i) {
+            ::operator delete(chunks_[i].begin);
+        }
+        chunks_.clear();
+        current_ = end_ = 0;
+        try {
+            addChunk(total);
+        } catch (const std::bad_alloc&) {
+            // start over with regular chunks
+        }
+        return;
+    }
+    if (!chunks_.empty()) {
+        current_ = chunks_[0].begin;
+    }
+}
+
+Size MonotonicArena::getAllocated() const
+{
+    return allocated_;
+}
+
+Size MonotonicArena::getCapacity() const
+{
+    Size total = 0;
+    for (Size i = 0; i < chunks_.size(); ++i) {
+        total += chunks_[i].size;
+    }
+    return total;
+}
+
+MemoryResourceScope::MemoryResourceScope(MemoryResource* resource) :
+    previous_(getCurrent())
+{
+    setCurrent(resource);
+}
+
+MemoryResourceScope::~MemoryResourceScope()
+{
+    setCurrent(previous_);
+}
+
+MemoryResource* ipaca::getMemoryResource()
+{
+    return getCurrent();
+}
+
+void* detail::allocateBlock(const Size bytes)
+{
+    Size n = bytes + sizeof(BlockHeader);
+    if (n < bytes) {
+        throw std::bad_alloc();
+    }
+    MemoryResource* resource = getCurrent();
+    void* p = resource ? resource->allocate(n) : ::operator new(n);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    BlockHeader* h = static_cast<BlockHeader*>(p);
+    h->info.resource = resource;
+    h->info.bytes = n;
+    return h + 1;
+}
+
+void detail::deallocateBlock(void* p)
+{
+    if (!p) {
+        return;
+    }
+    BlockHeader* h = static_cast<BlockHeader*>(p) - 1;
+    if (h->info.resource) {
+        h->info.resource->deallocate(h, h->info.bytes);
+    } else {
+        ::operator delete(h);
+    }
+}
@@ -10,10 +10,16 @@
  * 
  */
 #include <ipaca/Mercury7Impl.hpp>
+#include <ipaca/BinnedConvolution.hpp>
+#include <ipaca/CompactMercury.hpp>
+#include <ipaca/ConvolutionKernels.hpp>
+#include <ipaca/ElementPattern.hpp>
+#include <ipaca/MomentApproximation.hpp>
+#include <algorithm>
 #include <cassert>
 #include <cmath>
-#include <iostream>
-
+#include <functional>
+#include <map>
 // switch off the assert() calls in release code
 #ifndef IPACA_DEBUG
 #define NDEBUG
@@ -21,8 +27,222 @@
 
 using namespace ipaca;
 
+namespace {
+
+/** @return True if two elements have the same isotope distribution.
+ */
+Bool isSameElement(const detail::Element& e1, const detail::Element& e2)
+{
+    if (e1.isotopes.size() != e2.isotopes.size()) {
+        return false;
+    }
+    for (Size u = 0; u < e1.isotopes.size(); ++u) {
+        if (e1.isotopes[u].mz != e2.isotopes[u].mz || e1.isotopes[u].ab
+                != e2.isotopes[u].ab) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** @return The index of an element in a stoichiometry; the element is
+ *          appended with a zero count if it is not present.
+ */
+Size findElement(detail::Stoichiometry& s, const detail::Element& e)
+{
+    for (Size k = 0; k < s.size(); ++k) {
+        if (isSameElement(s[k], e)) {
+            return k;
+        }
+    }
+    s.push_back(e);
+    s.back().count = 0.0;
+    return s.size() - 1;
+}
+
+} // anonymous namespace
+
+detail::Mercury7Impl::Mercury7Impl(const OutputMode& mode) :
+    mode_(mode), planner_(new detail::ConvolutionPlanner), calibration_(
+        KernelCalibration::getDefault()), counters_(new detail::KernelCounters),
+        resolution_(0.0), precision_(DOUBLE_PRECISION)
+{
+}
+
+void detail::Mercury7Impl::setMassResolution(const Double resolution)
+{
+    ipaca_precondition(resolution >= 0.0,
+        "Mercury7Impl::setMassResolution: resolution must not be negative.");
+    resolution_ = resolution;
+}
+
+Double detail::Mercury7Impl::getMassResolution() const
+{
+    return resolution_;
+}
+
+void detail::Mercury7Impl::setPrecision(const Precision precision)
+{
+    precision_ = precision;
+}
+
+Precision detail::Mercury7Impl::getPrecision() const
+{
+    return precision_;
+}
+
+void detail::Mercury7Impl::setKernelCalibration(
+    const KernelCalibration& calibration)
+{
+    calibration_ = calibration;
+}
+
+const KernelCalibration& detail::Mercury7Impl::getKernelCalibration() const
+{
+    return calibration_;
+}
+
+KernelStats detail::Mercury7Impl::getKernelStats() const
+{
+    KernelStats stats = counters_->get();
+    stats.calibration = calibration_;
+    return stats;
+}
+
+void detail::Mercury7Impl::resetKernelStats()
+{
+    counters_->reset();
+}
+
+void detail::Mercury7Impl::setApproximationThreshold(
+    const ApproximationThreshold& threshold)
+{
+    threshold_ = threshold;
+}
+
+const ApproximationThreshold&
+detail::Mercury7Impl::getApproximationThreshold() const
+{
+    return threshold_;
+}
+
+void detail::Mercury7Impl::setPatternCache(
+    const boost::shared_ptr<PatternCache>& cache)
+{
+    cache_ = cache;
+}
+
+const boost::shared_ptr<PatternCache>&
+detail::Mercury7Impl::getPatternCache() const
+{
+    return cache_;
+}
+
+boost::shared_ptr<const PowerTable> detail::Mercury7Impl::createPowerTable(
+    const std::vector<detail::Isotopes>& isotopes, const Double limit,
+    const Size maxCount) const
+{
+    detail::KernelCountersScope counting(*counters_);
+    ipaca_precondition(limit > 0.0,
+        "Mercury7Impl::createPowerTable: limit must be positive.");
+    ipaca_precondition(maxCount > 0,
+        "Mercury7Impl::createPowerTable: maxCount must be positive.");
+    std::vector<std::vector<detail::Spectrum> > powers(isotopes.size());
+    std::vector<std::vector<Size> > offsets(isotopes.size());
+    for (Size e = 0; e < isotopes.size(); ++e) {
+        ipaca_precondition(!isotopes[e].empty(),
+            "Mercury7Impl::createPowerTable: empty isotope table.");
+        powers[e].push_back(isotopes[e]);
+        offsets[e].push_back(0);
+        for (Size m = maxCount; m > 1; m /= 2) {
+            const detail::Spectrum& half = powers[e].back();
+            detail::Spectrum square;
+            Size first = convolveAndPrune(half, half, square, limit);
+            offsets[e].push_back(2 * offsets[e].back() + first);
+            powers[e].push_back(detail::Spectrum());
+            powers[e].back().swap(square);
+        }
+    }
+    return boost::shared_ptr<const PowerTable>(new PowerTable(isotopes, limit,
+        powers, offsets));
+}
+
+void detail::Mercury7Impl::setPowerTable(
+    const boost::shared_ptr<const PowerTable>& table)
+{
+    powers_ = table;
+}
+
+const boost::shared_ptr<const PowerTable>&
+detail::Mercury7Impl::getPowerTable() const
+{
+    return powers_;
+}
+
+void detail::Mercury7Impl::getCacheKey(
+    const detail::Stoichiometry& stoichiometry, const Double limit,
+    std::string& key) const
+{
+    Double settings[] = { limit, static_cast<Double>(mode_.getType()),
+            static_cast<Double>(mode_.getCount()), resolution_,
+            static_cast<Double>(precision_),
+            static_cast<Double>(threshold_.getType()), threshold_.getValue(),
+            powers_ ? powers_->getLimit() : 0.0 };
+    key.assign(reinterpret_cast<const char*>(settings), sizeof(settings));
+    detail::appendCanonicalStoichiometry(stoichiometry, key);
+}
+
+Double detail::Mercury7Impl::getApproximationErrorBound(
+    const detail::Stoichiometry& stoichiometry) const
+{
+    detail::CompositionMoments m = detail::getCompositionMoments(
+        stoichiometry);
+    return detail::getApproximationErrorBound(m,
+        detail::selectApproximationModel(m));
+}
+
+Bool detail::Mercury7Impl::useApproximation(
+    const detail::Stoichiometry& stoichiometry, const Double limit) const
+{
+    if (threshold_.getType() == ApproximationThreshold::NEVER
+            || !detail::isPlausibleStoichiometry(stoichiometry)) {
+        return false;
+    }
+    detail::CompositionMoments m = detail::getCompositionMoments(
+        stoichiometry);
+    if (threshold_.getType() == ApproximationThreshold::MASS) {
+        return m.massMean > threshold_.getValue();
+    }
+    detail::IndexMoments im;
+    im.mean = m.indexMean;
+    im.variance = m.indexVariance;
+    im.span = m.maxIndex;
+    Double relative = m.total > 0.0 ? limit / m.total : limit;
+    return detail::estimatePeakCount(im, relative, getMaxPeaks())
+            > threshold_.getValue();
+}
+
+void detail::Mercury7Impl::setOutputMode(const OutputMode& mode)
+{
+    mode_ = mode;
+}
+
+const OutputMode& detail::Mercury7Impl::getOutputMode() const
+{
+    return mode_;
+}
+
+Size detail::Mercury7Impl::getMaxPeaks() const
+{
+    if (mode_.getType() == OutputMode::FIRST_N) {
+        return mode_.getCount();
+    }
+    return std::numeric_limits<Size>::max();
+}
+
 void detail::Mercury7Impl::convolve(const detail::Spectrum& s1,
-    const detail::Spectrum& s2, detail::Spectrum& result) const
+    const detail::Spectrum& s2, detail::Spectrum& result,
+    const Size maxPeaks) const
 {
     // Check if the input is non-empty. We use size() instead of
     // empty() because we need the values later.
@@ -44,29 +264,116 @@ void detail::Mercury7Impl::convolve(const detail::Spectrum& s1,
     }
     // No need to clear out the return values, we will overwrite them
     // anyways. Hence, simply make sure the elements exist and that we
-    // will not need to reallocate inside the loop.
-    result.resize(n1 + n2 - 1);
-    for (size_t k = 0; k < n1 + n2 - 1; k++) {
-        double totalAbundance = 0.0;
-        double massExpectation = 0.0;
-        size_t start = k < (n2 - 1) ? 0 : k - n2 + 1; // max(0, k-n2+1)
-        size_t end = k < (n1 - 1) ? k : n1 - 1; // min(n1-1, k)
-        // calculate the convolution of the k-th peak with everything else
-        for (size_t i = start; i <= end; i++) {
-            double ithAbundance = s1[i].ab * s2[k - i].ab;
-            if (ithAbundance > 0.0) {
-                // calculate the expected mass position
-                totalAbundance += ithAbundance;
-                double ithMass = s1[i].mz + s2[k - i].mz;
-                massExpectation += ithAbundance * ithMass;
+    // will not need to reallocate inside the loop. The k-th peak only
+    // depends on the first k peaks of the operands, hence we can stop
+    // early if only the first few peaks are of interest.
+    Size n = std::min(n1 + n2 - 1, maxPeaks);
+    result.resize(n);
+    convolveRange(s1, s2, 0, n, result);
+}
+
+void detail::Mercury7Impl::convolveRange(const detail::Spectrum& s1,
+    const detail::Spectrum& s2, const Size first, const Size last,
+    detail::Spectrum& result) const
+{
+    assert(result.size() == last - first);
+    if (first == last) {
+        return;
+    }
+    ConvolutionKernel kernel = calibration_.select(s1.size(), s2.size(),
+        &s1 == &s2);
+    detail::convolveRange(kernel, s1, s2, first, last, &result[0]);
+    counters_->record(kernel, last - first);
+}
+
+Size detail::Mercury7Impl::convolveAndPrune(const detail::Spectrum& s1,
+    const detail::Spectrum& s2, detail::Spectrum& result, const Double limit,
+    const Size maxPeaks, const Size lo, const Size hi) const
+{
+    assert(limit > 0.0);
+    Size n1 = s1.size();
+    Size n2 = s2.size();
+    if (n1 == 0 || n2 == 0) {
+        // all abundances are zero: nothing survives
+        result.clear();
+        return 0;
+    }
+    Size n = std::min(n1 + n2 - 1, hi);
+    // Find the first surviving peak. The k-th peak is bounded from above
+    // by the product of the cumulative abundances of the first k+1 peaks
+    // of both operands; as long as that bound stays below the limit, we
+    // do not need to calculate the peak at all.
+    Size first = 0;
+    double p1 = 0.0, p2 = 0.0;
+    detail::SpectrumElement peak;
+    for (; first < n; ++first) {
+        p1 += first < n1 ? s1[first].ab : 0.0;
+        p2 += first < n2 ? s2[first].ab : 0.0;
+        if (first >= lo && p1 * p2 > limit) {
+            detail::calculatePeak(s1, s2, first, peak);
+            if (peak.ab > limit) {
+                break;
             }
         }
-        // We cannot simply throw away isotopes with zero probability, as
-        // this would mess up the isotope count k.
-        result[k].mz = totalAbundance > 0 ? (massExpectation / totalAbundance)
-                : 0;
-        result[k].ab = totalAbundance;
     }
+    // At most maxPeaks peaks are kept, counted from the first surviving
+    // one; the leading peaks below the limit do not count.
+    if (maxPeaks < n - first) {
+        n = first + maxPeaks;
+    }
+    // Find the last surviving peak, using the same bound from the right.
+    // The bound only holds for the untruncated convolution, hence we
+    // count from its last index and skip everything beyond maxPeaks (or
+    // beyond the clipping range).
+    Size last = n1 + n2 - 1;
+    double q1 = 0.0, q2 = 0.0;
+    for (Size r = 0; last > first; ++r) {
+        q1 += r < n1 ? s1[n1 - 1 - r].ab : 0.0;
+        q2 += r < n2 ? s2[n2 - 1 - r].ab : 0.0;
+        if (last <= n && q1 * q2 > limit) {
+            detail::calculatePeak(s1, s2, last - 1, peak);
+            if (peak.ab > limit) {
+                break;
+            }
+        }
+        --last;
+    }
+    // only calculate and store the surviving peaks
+    result.resize(last - first);
+    convolveRange(s1, s2, first, last, result);
+    return first;
+}
+
+Size detail::Mercury7Impl::convolveAndPrune(const detail::Spectrum& s1,
+    const detail::Spectrum& s2, detail::Spectrum& result,
+    const PrunePolicy& policy, const Double share, const Size maxPeaks,
+    const Size lo, const Size hi) const
+{
+    Double limit = policy.getFixedLimit();
+    if (limit > 0.0) {
+        return convolveAndPrune(s1, s2, result, limit, maxPeaks, lo, hi);
+    }
+    // The policy may depend on the complete result, hence the peaks are
+    // only cut to maxPeaks after pruning.
+    if (lo == 0 && hi == std::numeric_limits<Size>::max()) {
+        convolve(s1, s2, result);
+    } else {
+        // only calculate the clipping range
+        Size n = s1.empty() || s2.empty() ? 0 : std::min(
+            s1.size() + s2.size() - 1, hi);
+        if (lo >= n) {
+            result.clear();
+            return 0;
+        }
+        result.resize(n - lo);
+        convolveRange(s1, s2, lo, n, result);
+    }
+    Size first = 0;
+    prune(result, policy, share, &first);
+    if (result.size() > maxPeaks) {
+        result.resize(maxPeaks);
+    }
+    return lo + first;
 }
 
 void detail::Mercury7Impl::prune(detail::Spectrum& s, const double limit) const
@@ -75,80 +382,197 @@ void detail::Mercury7Impl::prune(detail::Spectrum& s, const double limit) const
     // a non-positve limit is a programming error. Parameter validity
     // must be checked in operator() (which is where it comes in).
     assert(limit > 0.0);
-    // prune from the left
-    typedef detail::Spectrum::const_iterator CI;
-    CI l;
-    for (l = s.begin(); l != s.end(); ++l) {
-        if (l->ab > limit) {
-            break;
+    prune(s, AbsoluteLimitPrunePolicy(limit), 1.0);
+}
+
+Double detail::Mercury7Impl::prune(detail::Spectrum& s,
+    const PrunePolicy& policy, const Double share, Size* shift) const
+{
+    Size first = 0, last = s.size();
+    policy(s, share, first, last);
+    assert(first <= last && last <= s.size());
+    if (shift) {
+        *shift = first;
+    }
+    if (first == 0 && last == s.size()) {
+        return 0.0;
+    }
+    double discarded = 0.0;
+    for (Size k = 0; k < first; ++k) {
+        discarded += s[k].ab;
+    }
+    for (Size k = last; k < s.size(); ++k) {
+        discarded += s[k].ab;
+    }
+    // trim down using the swap trick; should be faster than two copies...
+    detail::Spectrum(s.begin() + first, s.begin() + last).swap(s);
+    return discarded;
+}
+
+void detail::Mercury7Impl::clip(detail::Spectrum& s, Size& offset,
+    const Size partialSpan, const IndexWindow* window) const
+{
+    if (!window) {
+        return;
+    }
+    Size lo, hi;
+    window->clip(offset, partialSpan, lo, hi);
+    hi = std::min(hi, s.size());
+    if (lo >= hi) {
+        s.clear();
+        return;
+    }
+    if (lo > 0 || hi < s.size()) {
+        detail::Spectrum(s.begin() + lo, s.begin() + hi).swap(s);
+        offset += lo;
+    }
+}
+
+Size detail::Mercury7Impl::elementMercury(const detail::Element& element,
+    const detail::ElementPlan& plan, const PrunePolicy& policy,
+    const Double share, detail::Spectrum& result,
+    const IndexWindow* window) const
+{
+    Size n = static_cast<Size>(element.count);
+    Size atomSpan = element.isotopes.size() - 1;
+    Size offset = 0, first = 0;
+    if (plan.closedForm) {
+        // Evaluate the element pattern directly. Every configuration that
+        // is skipped is below limit/(n+1), hence the peaks are exact up
+        // to the limit.
+        Double limit = policy.getFixedLimit();
+        assert(limit > 0.0);
+        Size lo = 0, hi = std::numeric_limits<Size>::max();
+        if (window) {
+            window->clip(0, n * atomSpan, lo, hi);
         }
+        detail::closedFormPattern(element.isotopes, n,
+            limit / static_cast<Double>(n + 1), result, &offset, lo, hi);
+        prune(result, policy, share, &first);
+        return offset + first;
     }
-    // prune from the right
-    typedef detail::Spectrum::const_reverse_iterator RCI;
-    RCI r;
-    for (r = s.rbegin(); r != s.rend(); ++r) {
-        if (r->ab > limit || r.base() == l) {
-            break;
+    if (powers_ && !window && n > 0 && policy.getFixedLimit()
+            == powers_->getLimit() && dynamic_cast<
+            const AbsoluteLimitPrunePolicy*>(&policy)) {
+        Size e = powers_->find(element.isotopes);
+        if (e < powers_->size() && (n >> powers_->getPowers(e)) == 0) {
+            return powerMercury(e, n, policy, share, result);
         }
     }
-    // trim down using the swap trick; should be faster than two copies...
-    detail::Spectrum(l, r.base()).swap(s);
+    // walk the addition chain; node 0 is the isotope distribution
+    const detail::AdditionChain& chain = plan.chain;
+    std::vector<detail::Spectrum> nodes(chain.size() + 1);
+    std::vector<Size> offsets(nodes.size(), 0);
+    std::vector<Size> exponents(nodes.size(), 1);
+    nodes[0].assign(element.isotopes.begin(), element.isotopes.end());
+    assert(!nodes[0].empty());
+    clip(nodes[0], offsets[0], atomSpan, window);
+    if (chain.empty()) {
+        result.swap(nodes[0]);
+        prune(result, policy, share, &first);
+        return offsets[0] + first;
+    }
+    // release intermediates as soon as they are no longer needed
+    std::vector<Size> lastUse(nodes.size(), 0);
+    for (Size k = 0; k < chain.size(); ++k) {
+        lastUse[chain[k].lhs] = k;
+        lastUse[chain[k].rhs] = k;
+    }
+    for (Size k = 0; k < chain.size(); ++k) {
+        Size l = chain[k].lhs;
+        Size r = chain[k].rhs;
+        offsets[k + 1] = offsets[l] + offsets[r];
+        exponents[k + 1] = exponents[l] + exponents[r];
+        Size lo = 0, hi = std::numeric_limits<Size>::max();
+        if (window) {
+            window->clip(offsets[k + 1], exponents[k + 1] * atomSpan, lo, hi);
+        }
+        offsets[k + 1] += convolveAndPrune(nodes[l], nodes[r], nodes[k + 1],
+            policy, share, std::numeric_limits<Size>::max(), lo, hi);
+        if (lastUse[l] == k) {
+            detail::Spectrum().swap(nodes[l]);
+        }
+        if (lastUse[r] == k) {
+            detail::Spectrum().swap(nodes[r]);
+        }
+    }
+    result.swap(nodes.back());
+    return offsets.back();
 }
 
-void detail::Mercury7Impl::integerMercury(
-    const detail::Stoichiometry& stoichiometry, const double limit,
-    detail::Spectrum& msa) const
+Size detail::Mercury7Impl::powerMercury(const Size element, const Size n,
+    const PrunePolicy& policy, const Double share,
+    detail::Spectrum& result) const
 {
-    assert(limit > 0.0);
-    msa.clear();
-    detail::Spectrum tmp, esa;
-    Bool msa_initialized = false;
+    Size k = 0;
+    while (!((n >> k) & 1)) {
+        ++k;
+    }
+    Size offset = powers_->getPower(element, k, result);
+    Size first = 0;
+    prune(result, policy, share, &first);
+    offset += first;
+    detail::Spectrum power, product;
+    for (++k; (n >> k) != 0; ++k) {
+        if (!((n >> k) & 1)) {
+            continue;
+        }
+        Size powerOffset = powers_->getPower(element, k, power);
+        offset += powerOffset + convolveAndPrune(result, power, product,
+            policy, share, std::numeric_limits<Size>::max());
+        result.swap(product);
+    }
+    return offset;
+}
 
-    // walk through the elements
-    typedef detail::Stoichiometry::const_iterator SCI;
-    for (SCI iter = stoichiometry.begin(); iter != stoichiometry.end(); ++iter) {
-        // number of atoms at iterator position
-        assert(iter->count >= 0.0);
-        Size n = static_cast<Size>(iter->count);
-        // if the element is present in the composition,
-        // then calculate ESA and update MSA
-        if (n) {
-            // initialize ESA
-            esa.assign(iter->isotopes.begin(), iter->isotopes.end());
-            assert(!esa.empty());
-            while (1) {
-                // check if we need to do the MSA update
-                if (n & 1) {
-                    // MSA update
-                    if (msa_initialized) {
-                        // normal update
-                        convolve(msa, esa, tmp);
-                        msa = tmp;
-                    } else {
-                        // initialize MSA=ESA
-                        msa = esa;
-                        msa_initialized = true;
-                    }
-                    prune(msa, limit);
-                }
-                // the ESA update is always carried out (with the exception of
-                // the last time, i.e. when n==1)
-                if (n == 1) {
-                    break;
-                }
-                convolve(esa, esa, tmp);
-                esa = tmp;
-                prune(esa, limit);
-                n = n >> 1;
-            }
+Size detail::Mercury7Impl::integerMercury(
+    const detail::Stoichiometry& stoichiometry,
+    const detail::ConvolutionPlan& plan, const PrunePolicy& policy,
+    const Double share, detail::Spectrum& msa,
+    const IndexWindow* window) const
+{
+    msa.clear();
+    if (plan.elements.empty()) {
+        return 0;
+    }
+    // calculate the contributions of all elements
+    Size nResults = plan.elements.size() + plan.merges.size();
+    std::vector<detail::Spectrum> results(nResults);
+    std::vector<Size> offsets(nResults, 0);
+    std::vector<Size> spans(nResults, 0);
+    for (Size k = 0; k < plan.elements.size(); ++k) {
+        const detail::ElementPlan& ep = plan.elements[k];
+        const detail::Element& element = stoichiometry[ep.element];
+        assert(element.count >= 0.0);
+        offsets[k] = elementMercury(element, ep, policy, share, results[k],
+            window);
+        spans[k] = static_cast<Size>(element.count)
+                * (element.isotopes.size() - 1);
+    }
+    // merge them in the planned order
+    for (Size k = 0; k < plan.merges.size(); ++k) {
+        Size target = plan.elements.size() + k;
+        Size l = plan.merges[k].lhs;
+        Size r = plan.merges[k].rhs;
+        offsets[target] = offsets[l] + offsets[r];
+        spans[target] = spans[l] + spans[r];
+        Size lo = 0, hi = std::numeric_limits<Size>::max();
+        if (window) {
+            window->clip(offsets[target], spans[target], lo, hi);
         }
+        offsets[target] += convolveAndPrune(results[l], results[r],
+            results[target], policy, share, std::numeric_limits<Size>::max(),
+            lo, hi);
+        detail::Spectrum().swap(results[l]);
+        detail::Spectrum().swap(results[r]);
     }
+    msa.swap(results.back());
+    return offsets.back();
 }
 
 void detail::Mercury7Impl::fractionalMercury(const detail::Stoichiometry& s,
-    double limit, detail::Spectrum& frac) const
+    detail::Spectrum& frac) const
 {
-    assert(limit > 0.0);
     frac.clear();
     typedef detail::Stoichiometry::const_iterator SCI;
     for (SCI i = s.begin(); i != s.end(); ++i) {
@@ -156,21 +580,7 @@ void detail::Mercury7Impl::fractionalMercury(const detail::Stoichiometry& s,
         detail::Spectrum temp(frac);
         // initialize ESA
         detail::Spectrum esa;
-        for (Size u = 0; u < i->isotopes.size(); ++u) {
-            if (i->isotopes[u].ab <= 0.0) {
-                continue;
-            }
-            detail::SpectrumElement se;
-            if (u > 0) {
-                se.mz = i->isotopes[u].mz - i->isotopes[0].mz + esa.front().mz;
-                se.ab = i->isotopes[u].ab * i->count;
-                esa.push_back(se);
-            } else {
-                se.mz = i->isotopes[0].mz * i->count;
-                se.ab = (1 - i->count) + i->isotopes[0].ab * i->count;
-            }
-            esa.push_back(se);
-        }
+        detail::fractionalAtom(i->isotopes, i->count, esa);
         if (i == s.begin()) {
             frac = esa;
         } else {
@@ -187,34 +597,74 @@ detail::Spectrum detail::Mercury7Impl::operator()(
         // TODO: figure out the correct error behavior.
         return detail::Spectrum();
     }
+    return (*this)(stoichiometry, AbsoluteLimitPrunePolicy(limit));
+}
+
+void detail::Mercury7Impl::exactMercury(
+    const detail::Stoichiometry& stoichiometry, const PrunePolicy& policy,
+    detail::Spectrum& result, const IndexWindow* window,
+    const Double budget) const
+{
     // split the stoichiometry into integer and fractional parts
     detail::Stoichiometry intStoi;
     detail::Stoichiometry fracStoi;
     detail::splitStoichiometry(stoichiometry, intStoi, fracStoi);
     // check if there is any integer contribution, and calculate the mz and
     // abundance vectors if yes
-    std::cerr << "Mercury7Impl::operator(): got intStoi: " << intStoi << std::endl;
-    std::cerr << "Mercury7Impl::operator(): got fracStoi: " << fracStoi << std::endl;
     detail::Spectrum intSpec;
     bool hasValidIntegerStoichiometry = detail::isPlausibleStoichiometry(
         intStoi);
-    if (hasValidIntegerStoichiometry) {
-        integerMercury(intStoi, limit, intSpec);
+    bool hasValidFractionalStoichiometry = detail::isPlausibleStoichiometry(
+        fracStoi);
+    // Plan the calculation. Elements are only evaluated in closed form
+    // for policies with a fixed limit; for all others, the cost estimates
+    // use the default limit. Intermediate results are never cut to a
+    // number of peaks, hence the plan does not depend on the output mode.
+    Double limit = policy.getFixedLimit();
+    boost::shared_ptr<const detail::ConvolutionPlan> plan = planner_->getPlan(
+        intStoi, limit > 0.0 ? limit : 1e-26, limit > 0.0,
+        std::numeric_limits<Size>::max());
+    // spread the error budget evenly over all pruning steps
+    Double weight = plan->pruneWeight;
+    if (hasValidIntegerStoichiometry && hasValidFractionalStoichiometry) {
+        weight += 1.0;
     }
+    Double share = weight > 0.0 ? budget / weight : budget;
     // check if there is any fractional contribution and calculate the mz and
     // abundance vectors if yes
     detail::Spectrum fracSpec;
-    bool hasValidFractionalStoichiometry = detail::isPlausibleStoichiometry(
-        fracStoi);
     if (hasValidFractionalStoichiometry) {
-        fractionalMercury(fracStoi, limit, fracSpec);
+        fractionalMercury(fracStoi, fracSpec);
+    }
+    Size intOffset = 0;
+    IndexWindow intWindow;
+    if (hasValidIntegerStoichiometry) {
+        if (window) {
+            // The integer part is clipped against the complete composition;
+            // the fractional spectrum bounds the span of the rest.
+            intWindow = *window;
+            intWindow.span = fracSpec.empty() ? 0 : fracSpec.size() - 1;
+            typedef detail::Stoichiometry::const_iterator SCI;
+            for (SCI i = intStoi.begin(); i != intStoi.end(); ++i) {
+                intWindow.span += static_cast<Size>(i->count)
+                        * (i->isotopes.size() - 1);
+            }
+            intOffset = integerMercury(intStoi, *plan, policy, share, intSpec,
+                &intWindow);
+        } else {
+            integerMercury(intStoi, *plan, policy, share, intSpec);
+        }
     }
     // if we have integer and fractional contributions, we need to convolve the
     // two; otherwise assign the resepctive non-zero contribution.
-    detail::Spectrum result;
     if (hasValidIntegerStoichiometry && hasValidFractionalStoichiometry) {
-        Mercury7Impl::convolve(intSpec, fracSpec, result);
-        Mercury7Impl::prune(result, limit);
+        // the fractional spectrum starts at isotope index 0
+        Size lo = 0, hi = std::numeric_limits<Size>::max();
+        if (window) {
+            intWindow.clip(intOffset, intWindow.span, lo, hi);
+        }
+        Mercury7Impl::convolveAndPrune(intSpec, fracSpec, result, policy,
+            share, std::numeric_limits<Size>::max(), lo, hi);
     } else {
         if (hasValidIntegerStoichiometry) {
             result = intSpec;
@@ -222,9 +672,624 @@ detail::Spectrum detail::Mercury7Impl::operator()(
             result = fracSpec;
         }
     }
+}
+
+void detail::Mercury7Impl::firstMercury(
+    const detail::Stoichiometry& stoichiometry, const PrunePolicy& policy,
+    detail::Spectrum& result) const
+{
+    // The peaks up to isotope index last only depend on the peaks up to
+    // last of all partial results, hence clipping the calculation to
+    // [0, last] yields them exactly. The leading peaks below the limit do
+    // not count; the window is widened until it holds the first N
+    // surviving peaks or the complete distribution.
+    Size n = getMaxPeaks();
+    Size span = 0;
+    typedef detail::Stoichiometry::const_iterator SCI;
+    for (SCI i = stoichiometry.begin(); i != stoichiometry.end(); ++i) {
+        if (i->count > 0.0 && !i->isotopes.empty()) {
+            span += static_cast<Size>(std::ceil(i->count))
+                    * (i->isotopes.size() - 1);
+        }
+    }
+    IndexWindow window;
+    window.first = 0;
+    window.last = n - 1;
+    window.span = 0;
+    for (;;) {
+        exactMercury(stoichiometry, policy, result, &window);
+        if (result.size() >= n || window.last >= span) {
+            break;
+        }
+        window.last = window.last < span / 2 ? 2 * window.last + 1 : span;
+    }
+    if (result.size() > n) {
+        result.resize(n);
+    }
+}
+
+void detail::Mercury7Impl::singleMercury(
+    const detail::Stoichiometry& stoichiometry, const PrunePolicy& policy,
+    detail::Spectrum& result) const
+{
+    Double limit = policy.getFixedLimit();
+    detail::compactMercury<float>(stoichiometry, limit > 0.0 ? limit : 0.0,
+        result);
+    if (limit <= 0.0) {
+        prune(result, policy, 1.0);
+    }
+    if (result.size() > getMaxPeaks()) {
+        result.resize(getMaxPeaks());
+    }
+}
+
+void detail::Mercury7Impl::prunePeaks(detail::Spectrum& s,
+    const PrunePolicy& policy, const Double share) const
+{
+    Double limit = policy.getFixedLimit();
+    if (limit <= 0.0) {
+        prune(s, policy, share);
+        return;
+    }
+    // sparse peak lists: drop every peak below the limit
+    Size n = 0;
+    for (Size k = 0; k < s.size(); ++k) {
+        if (s[k].ab > limit) {
+            s[n++] = s[k];
+        }
+    }
+    s.resize(n);
+}
+
+void detail::Mercury7Impl::binnedMercury(
+    const detail::Stoichiometry& stoichiometry, const PrunePolicy& policy,
+    detail::Spectrum& result) const
+{
+    result.clear();
+    if (!detail::isPlausibleStoichiometry(stoichiometry)) {
+        return;
+    }
+    // the distribution of a single atom and the number of atoms per part;
+    // fractional atoms are handled as in fractionalMercury()
+    std::vector<detail::Spectrum> atoms;
+    std::vector<Size> counts;
+    typedef detail::Stoichiometry::const_iterator SCI;
+    for (SCI i = stoichiometry.begin(); i != stoichiometry.end(); ++i) {
+        if (i->count <= 0.0 || i->isotopes.empty()) {
+            continue;
+        }
+        Double integer = trunc(i->count);
+        Double fractional = i->count - integer;
+        if (integer > 0.0) {
+            atoms.push_back(i->isotopes);
+            counts.push_back(static_cast<Size>(integer));
+        }
+        if (fractional > 0.0) {
+            atoms.push_back(detail::Spectrum());
+            detail::fractionalAtom(i->isotopes, fractional, atoms.back());
+            counts.push_back(1);
+        }
+    }
+    // spread the error budget over all pruning steps
+    std::vector<detail::AdditionChain> chains(atoms.size());
+    Double weight = static_cast<Double>(atoms.size() - 1);
+    for (Size k = 0; k < atoms.size(); ++k) {
+        detail::mergePeaks(atoms[k], resolution_);
+        detail::binaryChain(counts[k], chains[k]);
+        weight += detail::getChainPruneWeight(chains[k]);
+    }
+    Double share = 1.0 / weight;
+    detail::Spectrum power, temp;
+    for (Size k = 0; k < atoms.size(); ++k) {
+        const detail::AdditionChain& chain = chains[k];
+        std::vector<detail::Spectrum> nodes(chain.size() + 1);
+        nodes[0].swap(atoms[k]);
+        for (Size j = 0; j < chain.size(); ++j) {
+            detail::binnedConvolve(nodes[chain[j].lhs], nodes[chain[j].rhs],
+                resolution_, nodes[j + 1]);
+            prunePeaks(nodes[j + 1], policy, share);
+        }
+        if (chain.empty()) {
+            prunePeaks(nodes[0], policy, share);
+        }
+        power.swap(nodes.back());
+        if (k == 0) {
+            result.swap(power);
+        } else {
+            detail::binnedConvolve(result, power, resolution_, temp);
+            prunePeaks(temp, policy, share);
+            result.swap(temp);
+        }
+    }
+}
+
+detail::Spectrum detail::Mercury7Impl::operator()(
+    const detail::Stoichiometry& stoichiometry, const PrunePolicy& policy,
+    Double* discarded) const
+{
+    // count the convolutions of this thread without locking
+    detail::KernelCountersScope counting(*counters_);
+    detail::Spectrum result;
+    Double limit = policy.getFixedLimit();
+    std::string key;
+    Bool cached = cache_ && !discarded
+            && dynamic_cast<const AbsoluteLimitPrunePolicy*>(&policy);
+    if (cached) {
+        getCacheKey(stoichiometry, limit, key);
+        if (cache_->find(key, result)) {
+            return result;
+        }
+    }
+    if (resolution_ > 0.0) {
+        binnedMercury(stoichiometry, policy, result);
+    } else if (useApproximation(stoichiometry, limit > 0.0 ? limit : 1e-26)) {
+        detail::approximateSpectrum(stoichiometry, limit > 0.0 ? limit : 0.0,
+            result);
+        if (limit <= 0.0) {
+            prune(result, policy, 1.0);
+        }
+    } else if (precision_ == SINGLE_PRECISION) {
+        singleMercury(stoichiometry, policy, result);
+    } else if (mode_.getType() == OutputMode::FIRST_N && limit > 0.0) {
+        firstMercury(stoichiometry, policy, result);
+    } else {
+        exactMercury(stoichiometry, policy, result);
+    }
+    // the leading peaks below the limit have been pruned before
+    if (result.size() > getMaxPeaks()) {
+        result.resize(getMaxPeaks());
+    }
+    if (mode_.getType() == OutputMode::TOP_K) {
+        selectTopK(result, mode_.getCount());
+    }
+    if (discarded) {
+        // The total abundance of the exact result is the product of the
+        // total abundances of all contributions.
+        Double expected = 0.0;
+        if (detail::isPlausibleStoichiometry(stoichiometry)) {
+            expected = 1.0;
+            typedef detail::Stoichiometry::const_iterator SCI;
+            for (SCI i = stoichiometry.begin(); i != stoichiometry.end(); ++i) {
+                Double total = 0.0;
+                typedef detail::Isotopes::const_iterator ICI;
+                for (ICI j = i->isotopes.begin(); j != i->isotopes.end(); ++j) {
+                    total += j->ab;
+                }
+                Double integer = trunc(i->count);
+                Double fractional = i->count - integer;
+                expected *= std::pow(total, integer);
+                if (fractional > 0.0) {
+                    expected *= (1.0 - fractional) + fractional * total;
+                }
+            }
+        }
+        Double actual = 0.0;
+        typedef detail::Spectrum::const_iterator CI;
+        for (CI i = result.begin(); i != result.end(); ++i) {
+            actual += i->ab;
+        }
+        *discarded = expected > actual ? expected - actual : 0.0;
+    }
+    if (cached) {
+        cache_->insert(key, result);
+    }
+    return result;
+}
+
+detail::Spectrum detail::Mercury7Impl::operator()(
+    const detail::Stoichiometry& stoichiometry, const Double massMin,
+    const Double massMax, const PrunePolicy& policy) const
+{
+    detail::KernelCountersScope counting(*counters_);
+    ipaca_precondition(massMin <= massMax,
+        "Mercury7Impl::operator(): empty mass window.");
+    detail::Spectrum result;
+    IndexWindow window;
+    if (!getIndexWindow(stoichiometry, massMin, massMax, window)) {
+        return result;
+    }
+    Double limit = policy.getFixedLimit();
+    if (resolution_ > 0.0) {
+        binnedMercury(stoichiometry, policy, result);
+    } else if (useApproximation(stoichiometry, limit > 0.0 ? limit : 1e-26)) {
+        detail::approximateSpectrum(stoichiometry, limit > 0.0 ? limit : 0.0,
+            result);
+        if (limit <= 0.0) {
+            prune(result, policy, 1.0);
+        }
+    } else if (precision_ == SINGLE_PRECISION) {
+        singleMercury(stoichiometry, policy, result);
+    } else {
+        exactMercury(stoichiometry, policy, result, &window);
+    }
+    // the index window is conservative; cut to the exact mass window
+    Size first = 0, last = result.size();
+    while (first < last && result[first].mz < massMin) {
+        ++first;
+    }
+    while (last > first && result[last - 1].mz > massMax) {
+        --last;
+    }
+    detail::Spectrum(result.begin() + first, result.begin() + last).swap(
+        result);
+    if (result.size() > getMaxPeaks()) {
+        result.resize(getMaxPeaks());
+    }
+    if (mode_.getType() == OutputMode::TOP_K) {
+        selectTopK(result, mode_.getCount());
+    }
+    return result;
+}
+
+void detail::Mercury7Impl::sweep(const detail::Stoichiometry& stoichiometry,
+    const std::vector<Size>& labeled,
+    const std::vector<detail::Enrichment>& enrichments,
+    const PrunePolicy& policy, std::vector<detail::Spectrum>& spectra) const
+{
+    detail::KernelCountersScope counting(*counters_);
+    // split off the labeled elements
+    std::vector<Bool> isLabeled(stoichiometry.size(), false);
+    detail::Stoichiometry labels;
+    for (Size j = 0; j < labeled.size(); ++j) {
+        ipaca_precondition(labeled[j] < stoichiometry.size(),
+            "Mercury7Impl::sweep: labeled element out of range.");
+        ipaca_precondition(!isLabeled[labeled[j]],
+            "Mercury7Impl::sweep: element labeled twice.");
+        isLabeled[labeled[j]] = true;
+        labels.push_back(stoichiometry[labeled[j]]);
+    }
+    detail::Stoichiometry background;
+    for (Size k = 0; k < stoichiometry.size(); ++k) {
+        if (!isLabeled[k]) {
+            background.push_back(stoichiometry[k]);
+        }
+    }
+    for (Size i = 0; i < enrichments.size(); ++i) {
+        ipaca_precondition(enrichments[i].size() == labeled.size(),
+            "Mercury7Impl::sweep: expected one abundance vector per "
+            "labeled element.");
+        for (Size j = 0; j < labeled.size(); ++j) {
+            ipaca_precondition(enrichments[i][j].size()
+                    == labels[j].isotopes.size(),
+                "Mercury7Impl::sweep: expected one abundance per isotope.");
+        }
+    }
+    // the unlabeled part is shared by all levels
+    Bool hasBackground = detail::isPlausibleStoichiometry(background);
+    Bool hasLabels = detail::isPlausibleStoichiometry(labels);
+    Double share = hasBackground && hasLabels ? 1.0 / 3.0 : 1.0;
+    detail::Spectrum backgroundSpec;
+    if (hasBackground) {
+        exactMercury(background, policy, backgroundSpec, 0, share);
+    }
+    spectra.resize(enrichments.size());
+    detail::Spectrum labelSpec;
+    for (Size i = 0; i < enrichments.size(); ++i) {
+        detail::Spectrum& result = spectra[i];
+        result.clear();
+        if (hasLabels) {
+            for (Size j = 0; j < labels.size(); ++j) {
+                detail::Isotopes& isotopes = labels[j].isotopes;
+                for (Size u = 0; u < isotopes.size(); ++u) {
+                    ipaca_precondition(enrichments[i][j][u] >= 0.0,
+                        "Mercury7Impl::sweep: negative abundance.");
+                    isotopes[u].ab = enrichments[i][j][u];
+                }
+            }
+            exactMercury(labels, policy, labelSpec, 0, share);
+            if (hasBackground) {
+                convolveAndPrune(backgroundSpec, labelSpec, result, policy,
+                    share, getMaxPeaks());
+            } else {
+                result.swap(labelSpec);
+            }
+        } else {
+            result = backgroundSpec;
+        }
+        if (result.size() > getMaxPeaks()) {
+            result.resize(getMaxPeaks());
+        }
+        if (mode_.getType() == OutputMode::TOP_K) {
+            selectTopK(result, mode_.getCount());
+        }
+    }
+}
+
+void detail::Mercury7Impl::variants(
+    const detail::Stoichiometry& stoichiometry,
+    const std::vector<detail::Stoichiometry>& deltas,
+    const std::vector<detail::Variant>& variants, const PrunePolicy& policy,
+    std::vector<detail::Spectrum>& spectra) const
+{
+    detail::KernelCountersScope counting(*counters_);
+    // a common element table; elements of the deltas are matched against
+    // the compound and appended if they are not present
+    detail::Stoichiometry elements(stoichiometry);
+    std::vector<std::vector<Double> > deltaCounts(deltas.size());
+    for (Size m = 0; m < deltas.size(); ++m) {
+        typedef detail::Stoichiometry::const_iterator SCI;
+        for (SCI i = deltas[m].begin(); i != deltas[m].end(); ++i) {
+            Size e = findElement(elements, *i);
+            deltaCounts[m].resize(elements.size(), 0.0);
+            deltaCounts[m][e] += i->count;
+        }
+    }
+    // the total delta of each variant; variants with the same total delta
+    // are calculated only once
+    typedef std::map<std::vector<Double>, Size> DeltaMap;
+    DeltaMap distinct;
+    std::vector<std::vector<Double> > totals;
+    std::vector<Size> index(variants.size());
+    for (Size v = 0; v < variants.size(); ++v) {
+        ipaca_precondition(variants[v].size() == deltas.size(),
+            "Mercury7Impl::variants: expected one count per modification.");
+        std::vector<Double> total(elements.size(), 0.0);
+        for (Size m = 0; m < deltas.size(); ++m) {
+            for (Size e = 0; e < deltaCounts[m].size(); ++e) {
+                total[e] += static_cast<Double>(variants[v][m])
+                        * deltaCounts[m][e];
+            }
+        }
+        for (Size e = 0; e < elements.size(); ++e) {
+            ipaca_precondition(elements[e].count + total[e] >= 0.0,
+                "Mercury7Impl::variants: a modification removes more atoms "
+                "than present.");
+        }
+        std::pair<DeltaMap::iterator, Bool> r = distinct.insert(
+            std::make_pair(total, totals.size()));
+        if (r.second) {
+            totals.push_back(total);
+        }
+        index[v] = r.first->second;
+    }
+    // the core holds the atoms that are present in all variants
+    detail::Stoichiometry core(elements);
+    for (Size t = 0; t < totals.size(); ++t) {
+        for (Size e = 0; e < elements.size(); ++e) {
+            core[e].count = std::min(core[e].count, elements[e].count
+                    + totals[t][e]);
+        }
+    }
+    Bool hasCore = detail::isPlausibleStoichiometry(core);
+    Double share = 1.0 / 3.0;
+    detail::Spectrum coreSpec;
+    if (hasCore) {
+        exactMercury(core, policy, coreSpec, 0, share);
+    }
+    std::vector<detail::Spectrum> results(totals.size());
+    detail::Spectrum residualSpec;
+    for (Size t = 0; t < totals.size(); ++t) {
+        detail::Stoichiometry residual(elements);
+        for (Size e = 0; e < elements.size(); ++e) {
+            residual[e].count = std::max(0.0, elements[e].count
+                    + totals[t][e] - core[e].count);
+        }
+        if (!detail::isPlausibleStoichiometry(residual)) {
+            results[t] = coreSpec;
+        } else if (!hasCore) {
+            exactMercury(residual, policy, results[t]);
+        } else {
+            exactMercury(residual, policy, residualSpec, 0, share);
+            convolveAndPrune(coreSpec, residualSpec, results[t], policy,
+                share, getMaxPeaks());
+        }
+        if (results[t].size() > getMaxPeaks()) {
+            results[t].resize(getMaxPeaks());
+        }
+        if (mode_.getType() == OutputMode::TOP_K) {
+            selectTopK(results[t], mode_.getCount());
+        }
+    }
+    spectra.resize(variants.size());
+    for (Size v = 0; v < variants.size(); ++v) {
+        spectra[v] = results[index[v]];
+    }
+}
+
+void detail::Mercury7Impl::blockMercury(const detail::Blocks& blocks,
+    const PrunePolicy& policy, const Double budget,
+    detail::Spectrum& result) const
+{
+    result.clear();
+    Size nBlocks = 0;
+    typedef detail::Blocks::const_iterator BCI;
+    for (BCI i = blocks.begin(); i != blocks.end(); ++i) {
+        if (i->count > 0 && detail::isPlausibleStoichiometry(i->stoichiometry)) {
+            ++nBlocks;
+        }
+    }
+    if (nBlocks == 0) {
+        return;
+    }
+    // The abundance discarded from a block is lost count times in its
+    // power, hence the budget of each block is divided by its count.
+    detail::Stoichiometry pseudo;
+    for (BCI i = blocks.begin(); i != blocks.end(); ++i) {
+        if (i->count == 0 || !detail::isPlausibleStoichiometry(
+            i->stoichiometry)) {
+            continue;
+        }
+        detail::Element e;
+        exactMercury(i->stoichiometry, policy, e.isotopes, 0, 0.5 * budget
+                / static_cast<Double>(nBlocks * i->count));
+        if (e.isotopes.empty()) {
+            return;
+        }
+        e.count = static_cast<Double>(i->count);
+        pseudo.push_back(e);
+    }
+    exactMercury(pseudo, policy, result, 0, 0.5 * budget);
+}
+
+detail::Spectrum detail::Mercury7Impl::operator()(
+    const detail::Blocks& blocks, const PrunePolicy& policy) const
+{
+    detail::KernelCountersScope counting(*counters_);
+    detail::Spectrum result;
+    blockMercury(blocks, policy, 1.0, result);
+    if (result.size() > getMaxPeaks()) {
+        result.resize(getMaxPeaks());
+    }
+    if (mode_.getType() == OutputMode::TOP_K) {
+        selectTopK(result, mode_.getCount());
+    }
     return result;
 }
 
+void detail::Mercury7Impl::series(const detail::Blocks& ends,
+    const detail::Stoichiometry& unit, const Size nMin, const Size nMax,
+    const PrunePolicy& policy, std::vector<detail::Spectrum>& spectra) const
+{
+    detail::KernelCountersScope counting(*counters_);
+    ipaca_precondition(nMin <= nMax, "Mercury7Impl::series: nMin > nMax.");
+    ipaca_precondition(detail::isPlausibleStoichiometry(unit),
+        "Mercury7Impl::series: invalid repeat unit.");
+    spectra.clear();
+    // Split the budget into quarters: the unit (whose losses enter each
+    // member up to nMax times), the power unit^nMin, the steps from nMin
+    // to nMax, and the end groups together with the final convolutions.
+    Size nSteps = nMax - nMin + 1;
+    detail::Spectrum unitSpec;
+    exactMercury(unit, policy, unitSpec, 0, 0.25 / static_cast<Double>(
+        std::max(nMax, static_cast<Size>(1))));
+    detail::Spectrum power;
+    if (nMin == 0) {
+        detail::SpectrumElement one;
+        one.mz = 0.0;
+        one.ab = 1.0;
+        power.push_back(one);
+    } else if (!unitSpec.empty()) {
+        detail::Stoichiometry pseudo(1);
+        pseudo[0].isotopes = unitSpec;
+        pseudo[0].count = static_cast<Double>(nMin);
+        exactMercury(pseudo, policy, power, 0, 0.25);
+    }
+    detail::Spectrum endSpec;
+    blockMercury(ends, policy, 0.125, endSpec);
+    Bool hasEnds = !endSpec.empty();
+    Double stepShare = 0.25 / static_cast<Double>(nSteps);
+    Double mergeShare = 0.125 / static_cast<Double>(nSteps);
+    spectra.resize(nSteps);
+    detail::Spectrum next;
+    for (Size n = nMin; n <= nMax; ++n) {
+        if (n > nMin) {
+            convolveAndPrune(power, unitSpec, next, policy, stepShare,
+                std::numeric_limits<Size>::max());
+            power.swap(next);
+        }
+        detail::Spectrum& result = spectra[n - nMin];
+        if (hasEnds) {
+            convolveAndPrune(endSpec, power, result, policy, mergeShare,
+                getMaxPeaks());
+        } else {
+            result = power;
+        }
+        if (result.size() > getMaxPeaks()) {
+            result.resize(getMaxPeaks());
+        }
+        if (mode_.getType() == OutputMode::TOP_K) {
+            selectTopK(result, mode_.getCount());
+        }
+        if (n == nMax) {
+            // avoid the overflow of n for nMax = max(Size)
+            break;
+        }
+    }
+}
+
+Bool detail::Mercury7Impl::getIndexWindow(
+    const detail::Stoichiometry& stoichiometry, const Double massMin,
+    const Double massMax, IndexWindow& window) const
+{
+    if (!detail::isPlausibleStoichiometry(stoichiometry)) {
+        return false;
+    }
+    // Every configuration at isotope index k has a mass between
+    // mono + k * dmin and mono + k * dmax, where dmin and dmax are the
+    // smallest and largest mass increments per index of any isotope.
+    Double mono = 0.0;
+    Double dmin = std::numeric_limits<Double>::max(), dmax = 0.0;
+    typedef detail::Stoichiometry::const_iterator SCI;
+    for (SCI i = stoichiometry.begin(); i != stoichiometry.end(); ++i) {
+        if (i->count <= 0.0 || i->isotopes.empty()) {
+            continue;
+        }
+        mono += i->count * i->isotopes[0].mz;
+        for (Size u = 1; u < i->isotopes.size(); ++u) {
+            if (i->isotopes[u].ab <= 0.0) {
+                continue;
+            }
+            Double d = (i->isotopes[u].mz - i->isotopes[0].mz)
+                    / static_cast<Double>(u);
+            dmin = std::min(dmin, d);
+            dmax = std::max(dmax, d);
+        }
+    }
+    // allow for rounding errors in the accumulated masses
+    Double slack = 1e-9 * std::max(std::fabs(massMax), 1.0);
+    if (massMax + slack < mono) {
+        return false;
+    }
+    if (dmax <= 0.0) {
+        // only the monoisotopic peak
+        window.first = 0;
+        window.last = 0;
+        return massMin - slack <= mono;
+    }
+    Double lo = std::max(0.0, std::ceil((massMin - slack - mono) / dmax));
+    Double hi = std::floor((massMax + slack - mono) / dmin);
+    if (lo > hi) {
+        return false;
+    }
+    const Double maxIndex = static_cast<Double>(
+        std::numeric_limits<Size>::max() / 2);
+    window.first = static_cast<Size>(std::min(lo, maxIndex));
+    window.last = static_cast<Size>(std::min(hi, maxIndex));
+    window.span = 0;
+    return true;
+}
+
+void detail::IndexWindow::clip(const Size offset, const Size partialSpan,
+    Size& lo, Size& hi) const
+{
+    // a peak at index i (relative to the partial composition) ends up in
+    // [i, i + rest] of the result
+    Size rest = span > partialSpan ? span - partialSpan : 0;
+    Size absLo = first > rest ? first - rest : 0;
+    lo = absLo > offset ? absLo - offset : 0;
+    hi = last + 1 > offset ? last + 1 - offset : 0;
+}
+
+void detail::Mercury7Impl::selectTopK(detail::Spectrum& s, const Size k) const
+{
+    if (s.size() <= k) {
+        return;
+    }
+    // find the k-th largest abundance
+    std::vector<Double> abundances(s.size());
+    for (Size i = 0; i < s.size(); ++i) {
+        abundances[i] = s[i].ab;
+    }
+    std::nth_element(abundances.begin(), abundances.begin() + (k - 1),
+        abundances.end(), std::greater<Double>());
+    Double kth = abundances[k - 1];
+    // count how many peaks with exactly that abundance we can keep
+    Size ties = k;
+    for (Size i = 0; i < k; ++i) {
+        if (abundances[i] > kth) {
+            --ties;
+        }
+    }
+    // compact in place, preserving the mass order
+    Size n = 0;
+    for (Size i = 0; i < s.size(); ++i) {
+        if (s[i].ab > kth || (s[i].ab == kth && ties-- > 0)) {
+            s[n++] = s[i];
+        }
+    }
+    s.resize(n);
+}
+
 double detail::Mercury7Impl::getMonoisotopicMass(
     const detail::Stoichiometry& stoichiometry) const
 {
@@ -252,7 +1317,7 @@ double detail::Mercury7Impl::getAverageMass(
             entryAvg += j->mz * j->ab;
         }
         // add to the overall average
-        avg += entryAvg;
+        avg += i->count * entryAvg;
     }
     return avg;
 }
@@ -0,0 +1,241 @@
+/*
+ * MomentApproximation.cpp
+ *
+ *  Copyright (C) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/MomentApproximation.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace ipaca;
+
+namespace {
+
+/** The Berry-Esseen constant for independent, non-identically distributed
+ * summands (Shevtsova, 2010).
+ */
+const Double berryEsseenConstant = 0.5600;
+
+/** Add \a n atoms with the (unnormalized) isotope index distribution
+ * \a probs and peak masses \a masses to the moments.
+ */
+void addAtoms(const std::vector<Double>& probs,
+    const std::vector<Double>& masses, const Double n,
+    detail::CompositionMoments& m)
+{
+    Double total = 0.0;
+    for (Size u = 0; u < probs.size(); ++u) {
+        total += probs[u];
+    }
+    if (total <= 0.0) {
+        m.total = 0.0;
+        return;
+    }
+    Double mean = 0.0, mass = 0.0;
+    Size last = 0;
+    for (Size u = 0; u < probs.size(); ++u) {
+        Double q = probs[u] / total;
+        mean += q * static_cast<Double>(u);
+        mass += q * masses[u];
+        if (probs[u] > 0.0) {
+            last = u;
+        }
+    }
+    Double variance = 0.0, third = 0.0, covariance = 0.0;
+    for (Size u = 0; u < probs.size(); ++u) {
+        Double q = probs[u] / total;
+        Double d = static_cast<Double>(u) - mean;
+        variance += q * d * d;
+        third += q * std::fabs(d * d * d);
+        covariance += q * d * (masses[u] - mass);
+    }
+    m.total *= std::pow(total, n);
+    m.indexMean += n * mean;
+    m.indexVariance += n * variance;
+    m.absoluteThirdMoment += n * third;
+    m.massMean += n * mass;
+    m.massIndexCovariance += n * covariance;
+    m.maxIndex += n * static_cast<Double>(last);
+    if (last > 1) {
+        m.bernoulli = false;
+    } else if (last == 1) {
+        Double p = probs[1] / total;
+        m.bernoulliSquares += n * p * p;
+    }
+}
+
+/** @return The probability of the standard normal distribution between
+ *          \a a and \a b, evaluated in the tails for accuracy.
+ */
+Double normalInterval(const Double a, const Double b)
+{
+    const Double s = 1.0 / std::sqrt(2.0);
+    if (a >= 0.0) {
+        return 0.5 * (erfc(a * s) - erfc(b * s));
+    }
+    if (b <= 0.0) {
+        return 0.5 * (erfc(-b * s) - erfc(-a * s));
+    }
+    return 1.0 - 0.5 * (erfc(-a * s) + erfc(b * s));
+}
+
+/** @return The probability of the k-th isotope index under the model.
+ */
+Double indexProbability(const detail::CompositionMoments& m,
+    const detail::ApproximationModel model, const Double k)
+{
+    if (model == detail::POISSON_MODEL) {
+        Double lambda = m.indexMean;
+        if (lambda <= 0.0) {
+            return k == 0.0 ? 1.0 : 0.0;
+        }
+        return std::exp(k * std::log(lambda) - lambda - lgamma(k + 1.0));
+    }
+    if (m.indexVariance <= 0.0) {
+        return k == std::floor(m.indexMean + 0.5) ? 1.0 : 0.0;
+    }
+    Double sd = std::sqrt(m.indexVariance);
+    return normalInterval((k - 0.5 - m.indexMean) / sd, (k + 0.5
+            - m.indexMean) / sd);
+}
+
+} // anonymous namespace
+
+detail::CompositionMoments detail::getCompositionMoments(
+    const detail::Stoichiometry& stoichiometry)
+{
+    detail::CompositionMoments m;
+    m.total = 1.0;
+    m.indexMean = 0.0;
+    m.indexVariance = 0.0;
+    m.absoluteThirdMoment = 0.0;
+    m.massMean = 0.0;
+    m.massIndexCovariance = 0.0;
+    m.bernoulli = true;
+    m.bernoulliSquares = 0.0;
+    m.maxIndex = 0.0;
+    std::vector<Double> probs, masses;
+    typedef detail::Stoichiometry::const_iterator SCI;
+    for (SCI i = stoichiometry.begin(); i != stoichiometry.end(); ++i) {
+        if (i->count <= 0.0 || i->isotopes.empty()) {
+            continue;
+        }
+        Size n = i->isotopes.size();
+        Double integer = trunc(i->count);
+        Double fractional = i->count - integer;
+        if (integer > 0.0) {
+            probs.resize(n);
+            masses.resize(n);
+            for (Size u = 0; u < n; ++u) {
+                probs[u] = i->isotopes[u].ab;
+                masses[u] = i->isotopes[u].mz;
+            }
+            addAtoms(probs, masses, integer, m);
+        }
+        if (fractional > 0.0) {
+            // A fractional atom is present with probability f; its mass
+            // is scaled by f, and the heavy isotopes keep their offsets.
+            Double m0 = i->isotopes[0].mz;
+            probs.resize(n);
+            masses.resize(n);
+            probs[0] = (1.0 - fractional) + fractional * i->isotopes[0].ab;
+            masses[0] = fractional * m0;
+            for (Size u = 1; u < n; ++u) {
+                probs[u] = fractional * i->isotopes[u].ab;
+                masses[u] = fractional * m0 + i->isotopes[u].mz - m0;
+            }
+            addAtoms(probs, masses, 1.0, m);
+        }
+    }
+    return m;
+}
+
+Double detail::getApproximationErrorBound(
+    const detail::CompositionMoments& m,
+    const detail::ApproximationModel model)
+{
+    Double bound = 0.0;
+    if (model == detail::POISSON_MODEL) {
+        if (!m.bernoulli) {
+            return m.total;
+        }
+        Double lambda = m.indexMean;
+        if (lambda > 0.0) {
+            bound = (1.0 - std::exp(-lambda)) / lambda * m.bernoulliSquares;
+        }
+    } else if (m.indexVariance > 0.0) {
+        bound = 2.0 * berryEsseenConstant * m.absoluteThirdMoment / std::pow(
+            m.indexVariance, 1.5);
+    }
+    return std::min(bound, 1.0) * m.total;
+}
+
+detail::ApproximationModel detail::selectApproximationModel(
+    const detail::CompositionMoments& m)
+{
+    if (m.bernoulli && getApproximationErrorBound(m, POISSON_MODEL)
+            < getApproximationErrorBound(m, GAUSSIAN_MODEL)) {
+        return POISSON_MODEL;
+    }
+    return GAUSSIAN_MODEL;
+}
+
+Double detail::approximateSpectrum(const detail::Stoichiometry& stoichiometry,
+    const Double cutoff, detail::Spectrum& spectrum,
+    detail::ApproximationModel* model)
+{
+    spectrum.clear();
+    detail::CompositionMoments m = getCompositionMoments(stoichiometry);
+    detail::ApproximationModel selected = selectApproximationModel(m);
+    if (model) {
+        *model = selected;
+    }
+    Double bound = getApproximationErrorBound(m, selected);
+    if (m.total <= 0.0) {
+        return bound;
+    }
+    // start at the mode; both models are unimodal
+    Double mode = selected == detail::POISSON_MODEL ? std::floor(m.indexMean)
+            : std::floor(m.indexMean + 0.5);
+    mode = std::max(0.0, std::min(mode, m.maxIndex));
+    Double pMode = m.total * indexProbability(m, selected, mode);
+    if (pMode <= cutoff) {
+        return bound;
+    }
+    std::vector<Double> left, right;
+    for (Double k = mode - 1.0; k >= 0.0; k -= 1.0) {
+        Double p = m.total * indexProbability(m, selected, k);
+        if (p <= cutoff) {
+            break;
+        }
+        left.push_back(p);
+    }
+    for (Double k = mode + 1.0; k <= m.maxIndex; k += 1.0) {
+        Double p = m.total * indexProbability(m, selected, k);
+        if (p <= cutoff) {
+            break;
+        }
+        right.push_back(p);
+    }
+    // assemble the spectrum; masses follow the regression on the index
+    Double slope = m.indexVariance > 0.0 ? m.massIndexCovariance
+            / m.indexVariance : 0.0;
+    Double first = mode - static_cast<Double>(left.size());
+    spectrum.resize(left.size() + 1 + right.size());
+    for (Size k = 0; k < spectrum.size(); ++k) {
+        Double p;
+        if (k < left.size()) {
+            p = left[left.size() - 1 - k];
+        } else if (k == left.size()) {
+            p = pMode;
+        } else {
+            p = right[k - left.size() - 1];
+        }
+        Double index = first + static_cast<Double>(k);
+        spectrum[k].mz = m.massMean + slope * (index - m.indexMean);
+        spectrum[k].ab = p;
+    }
+    return bound;
+}
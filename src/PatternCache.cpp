@@ -0,0 +1,69 @@
+/*
+ * PatternCache.cpp
+ *
+ *  Copyright (C) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/PatternCache.hpp>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+using namespace ipaca;
+
+namespace {
+
+void appendRaw(std::string& key, const void* p, const Size n)
+{
+    key.append(static_cast<const char*>(p), n);
+}
+
+} // anonymous namespace
+
+PatternCache::~PatternCache()
+{
+}
+
+void detail::appendCanonicalStoichiometry(const detail::Stoichiometry& s,
+    std::string& key)
+{
+    typedef std::pair<std::string, Double> Entry;
+    std::vector<Entry> entries;
+    entries.reserve(s.size());
+    typedef detail::Stoichiometry::const_iterator SCI;
+    for (SCI i = s.begin(); i != s.end(); ++i) {
+        if (i->count == 0.0) {
+            continue;
+        }
+        // fractional atoms are mixtures of their own (see
+        // Mercury7Impl::exactMercury()), hence they cannot be merged
+        const Bool integral = i->count == std::floor(i->count);
+        Entry e;
+        e.first += integral ? '\0' : '\1';
+        Size n = i->isotopes.size();
+        appendRaw(e.first, &n, sizeof(n));
+        typedef detail::Isotopes::const_iterator ICI;
+        for (ICI j = i->isotopes.begin(); j != i->isotopes.end(); ++j) {
+            appendRaw(e.first, &j->mz, sizeof(j->mz));
+            appendRaw(e.first, &j->ab, sizeof(j->ab));
+        }
+        e.second = i->count;
+        entries.push_back(e);
+    }
+    std::sort(entries.begin(), entries.end());
+    Size n = 0;
+    for (Size k = 0; k < entries.size(); ++k) {
+        if (n > 0 && entries[k].first[0] == '\0'
+                && entries[n - 1].first == entries[k].first) {
+            entries[n - 1].second += entries[k].second;
+        } else {
+            entries[n++] = entries[k];
+        }
+    }
+    appendRaw(key, &n, sizeof(n));
+    for (Size k = 0; k < n; ++k) {
+        key += entries[k].first;
+        appendRaw(key, &entries[k].second, sizeof(Double));
+    }
+}
@@ -0,0 +1,249 @@
+/*
+ * PatternClient.cpp
+ *
+ *  Copyright (C) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/PatternClient.hpp>
+#include <ipaca/Error.hpp>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace ipaca;
+
+namespace {
+
+void sendAll(const int fd, const char* p, Size n)
+{
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL;
+#else
+    const int flags = 0;
+#endif
+    while (n > 0) {
+        ssize_t r = ::send(fd, p, n, flags);
+        if (r < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw RuntimeError("PatternClient: connection lost.");
+        }
+        p += r;
+        n -= static_cast<Size>(r);
+    }
+}
+
+void receiveAll(const int fd, char* p, Size n)
+{
+    while (n > 0) {
+        ssize_t r = ::recv(fd, p, n, 0);
+        if (r <= 0) {
+            if (r < 0 && errno == EINTR) {
+                continue;
+            }
+            throw RuntimeError("PatternClient: connection lost.");
+        }
+        p += r;
+        n -= static_cast<Size>(r);
+    }
+}
+
+} // anonymous namespace
+
+PatternClient::PatternClient(const String& path) :
+    fd_(-1), nextId_(0), pending_(0)
+{
+    sockaddr_un address;
+    ipaca_precondition(!path.empty() && path.size()
+            < sizeof(address.sun_path),
+        "PatternClient: invalid socket path.");
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size());
+    fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd_ < 0 || ::connect(fd_, reinterpret_cast<sockaddr*>(&address),
+        sizeof(address)) != 0) {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+        throw RuntimeError("PatternClient: cannot connect to " + path + ".");
+    }
+}
+
+PatternClient::~PatternClient()
+{
+    ::close(fd_);
+}
+
+Size PatternClient::sendFrame(const detail::ServiceMessage type,
+    const std::string& payload)
+{
+    ipaca_precondition(payload.size() <= detail::maxServicePayload,
+        "PatternClient: request too large.");
+    detail::ServiceHeader h;
+    h.size = static_cast<boost::uint32_t>(payload.size());
+    h.id = static_cast<boost::uint32_t>(nextId_++);
+    h.type = type;
+    h.status = IPACA_OK;
+    // one write per frame
+    std::string frame(reinterpret_cast<const char*>(&h), sizeof(h));
+    frame += payload;
+    sendAll(fd_, frame.data(), frame.size());
+    ++pending_;
+    return h.id;
+}
+
+Size PatternClient::receiveFrame(detail::ServiceHeader& header,
+    std::string& payload)
+{
+    ipaca_precondition(pending_ > 0, "PatternClient: no pending request.");
+    receiveAll(fd_, reinterpret_cast<char*>(&header), sizeof(header));
+    if (header.size > detail::maxServicePayload) {
+        throw RuntimeError("PatternClient: malformed response.");
+    }
+    payload.resize(header.size);
+    if (header.size > 0) {
+        receiveAll(fd_, &payload[0], header.size);
+    }
+    --pending_;
+    return header.id;
+}
+
+void PatternClient::call(const detail::ServiceMessage type,
+    const std::string& payload, detail::ServiceHeader& header,
+    std::string& response)
+{
+    ipaca_precondition(pending_ == 0,
+        "PatternClient: synchronous call with pending requests.");
+    sendFrame(type, payload);
+    receiveFrame(header, response);
+}
+
+Size PatternClient::addElement(const detail::Isotopes& isotopes)
+{
+    std::string payload;
+    detail::ServiceWriter w(payload);
+    w.putU32(isotopes.size());
+    typedef detail::Isotopes::const_iterator ICI;
+    for (ICI i = isotopes.begin(); i != isotopes.end(); ++i) {
+        w.putF64(i->mz);
+        w.putF64(i->ab);
+    }
+    detail::ServiceHeader h;
+    std::string response;
+    call(detail::SERVICE_ADD_ELEMENT, payload, h, response);
+    if (h.status != IPACA_OK) {
+        throw ParameterError("PatternClient: the element was rejected.");
+    }
+    detail::ServiceReader r(response.data(), response.data()
+            + response.size());
+    return r.getU32();
+}
+
+void PatternClient::setHydrogen(const Size element)
+{
+    std::string payload;
+    detail::ServiceWriter w(payload);
+    w.putU32(element);
+    detail::ServiceHeader h;
+    std::string response;
+    call(detail::SERVICE_SET_HYDROGEN, payload, h, response);
+    if (h.status != IPACA_OK) {
+        throw ParameterError("PatternClient: unknown hydrogen element.");
+    }
+}
+
+Size PatternClient::send(const PatternRequest& request)
+{
+    const Size n = request.size();
+    ipaca_precondition(request.offsets.size() == n + 1
+            && request.offsets[n] == request.elements.size()
+            && request.counts.size() == request.elements.size(),
+        "PatternClient: inconsistent request.");
+    std::string payload;
+    detail::ServiceWriter w(payload);
+    w.putF64(request.limit);
+    w.putI32(request.outputMode);
+    w.putU32(request.outputCount);
+    w.putI32(request.particle);
+    w.putU32(n);
+    for (Size k = 0; k < n; ++k) {
+        ipaca_precondition(request.offsets[k] <= request.offsets[k + 1],
+            "PatternClient: inconsistent request.");
+        w.putI32(request.charges[k]);
+        w.putU32(request.offsets[k + 1] - request.offsets[k]);
+        for (Size j = request.offsets[k]; j < request.offsets[k + 1]; ++j) {
+            w.putU32(request.elements[j]);
+            w.putF64(request.counts[j]);
+        }
+    }
+    return sendFrame(detail::SERVICE_CALCULATE, payload);
+}
+
+Size PatternClient::receive(PatternResponse& response)
+{
+    detail::ServiceHeader h;
+    std::string payload;
+    Size id = receiveFrame(h, payload);
+    response.status = h.status;
+    response.peakOffsets.assign(1, 0);
+    response.mz.clear();
+    response.ab.clear();
+    if (h.status != IPACA_OK) {
+        return id;
+    }
+    detail::ServiceReader r(payload.data(), payload.data() + payload.size());
+    Size n = r.getU32();
+    for (Size k = 0; k < n && !r.failed(); ++k) {
+        Size peaks = r.getU32();
+        if (peaks > r.remaining() / (2 * sizeof(Double))) {
+            break;
+        }
+        for (Size j = 0; j < peaks; ++j) {
+            response.mz.push_back(r.getF64());
+            response.ab.push_back(r.getF64());
+        }
+        response.peakOffsets.push_back(response.mz.size());
+    }
+    if (r.failed() || r.remaining() != 0 || response.peakOffsets.size()
+            != n + 1) {
+        throw RuntimeError("PatternClient: malformed response.");
+    }
+    return id;
+}
+
+PatternResponse PatternClient::calculate(const PatternRequest& request)
+{
+    ipaca_precondition(pending_ == 0,
+        "PatternClient: synchronous call with pending requests.");
+    PatternResponse response;
+    send(request);
+    receive(response);
+    return response;
+}
+
+ServiceStats PatternClient::getStats()
+{
+    detail::ServiceHeader h;
+    std::string response;
+    call(detail::SERVICE_STATS, std::string(), h, response);
+    detail::ServiceReader r(response.data(), response.data()
+            + response.size());
+    ServiceStats s;
+    s.requests = r.getU64();
+    s.hits = r.getU64();
+    s.misses = r.getU64();
+    s.entries = r.getU64();
+    if (h.status != IPACA_OK || r.failed()) {
+        throw RuntimeError("PatternClient: malformed response.");
+    }
+    return s;
+}
+
+Size PatternClient::getPending() const
+{
+    return pending_;
+}
@@ -0,0 +1,232 @@
+/*
+ * PatternScorer.cpp
+ *
+ *  Copyright (C) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/PatternScorer.hpp>
+#include <ipaca/Error.hpp>
+#include <cmath>
+#include <limits>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace ipaca;
+
+namespace {
+
+/** Sets the scores of a rejected candidate.
+ */
+PatternScore reject(const Size matched)
+{
+    PatternScore s;
+    s.cosine = 0.0;
+    s.kullbackLeibler = std::numeric_limits<Double>::infinity();
+    s.chiSquared = 2.0;
+    s.matched = matched;
+    s.rejected = true;
+    return s;
+}
+
+/** Accumulates the dot product, the squared norms and the symmetric
+ * chi-squared distance of two abundance vectors of even length.
+ */
+void accumulate(const Double* o, const Double* c, const Size n,
+    Double& dot, Double& oo, Double& cc, Double& chi)
+{
+    const Double tiny = std::numeric_limits<Double>::min();
+#ifdef __SSE2__
+    __m128d vdot = _mm_setzero_pd(), voo = vdot, vcc = vdot, vchi = vdot;
+    __m128d vtiny = _mm_set1_pd(tiny);
+    for (Size k = 0; k < n; k += 2) {
+        __m128d x = _mm_loadu_pd(o + k);
+        __m128d y = _mm_loadu_pd(c + k);
+        __m128d d = _mm_sub_pd(x, y);
+        vdot = _mm_add_pd(vdot, _mm_mul_pd(x, y));
+        voo = _mm_add_pd(voo, _mm_mul_pd(x, x));
+        vcc = _mm_add_pd(vcc, _mm_mul_pd(y, y));
+        vchi = _mm_add_pd(vchi, _mm_div_pd(_mm_mul_pd(d, d), _mm_max_pd(
+            _mm_add_pd(x, y), vtiny)));
+    }
+    Double r[2];
+    _mm_storeu_pd(r, vdot);
+    dot = r[0] + r[1];
+    _mm_storeu_pd(r, voo);
+    oo = r[0] + r[1];
+    _mm_storeu_pd(r, vcc);
+    cc = r[0] + r[1];
+    _mm_storeu_pd(r, vchi);
+    chi = r[0] + r[1];
+#else
+    dot = oo = cc = chi = 0.0;
+    for (Size k = 0; k < n; ++k) {
+        Double d = o[k] - c[k];
+        Double s = o[k] + c[k];
+        dot += o[k] * c[k];
+        oo += o[k] * o[k];
+        cc += c[k] * c[k];
+        chi += d * d / (s > tiny ? s : tiny);
+    }
+#endif
+}
+
+} // anonymous namespace
+
+PatternScorer::PatternScorer(const detail::Spectrum& observed,
+    const Double tolerance, const ToleranceUnit unit) :
+    requireMonoisotopic_(true), requireTopPeak_(true), floor_(1e-6)
+{
+    ipaca_precondition(tolerance > 0.0,
+        "PatternScorer: the tolerance must be positive.");
+    Double total = 0.0;
+    for (Size k = 0; k < observed.size(); ++k) {
+        ipaca_precondition(k == 0 || observed[k - 1].mz <= observed[k].mz,
+            "PatternScorer: the observed peaks must be sorted.");
+        total += observed[k].ab;
+    }
+    mz_.reserve(observed.size());
+    ab_.reserve(observed.size());
+    tolerance_.reserve(observed.size());
+    for (Size k = 0; k < observed.size(); ++k) {
+        mz_.push_back(observed[k].mz);
+        ab_.push_back(total > 0.0 ? observed[k].ab / total : 0.0);
+        tolerance_.push_back(unit == PPM ? observed[k].mz * tolerance * 1e-6
+                : tolerance);
+    }
+}
+
+void PatternScorer::setRequireMonoisotopic(const Bool require)
+{
+    requireMonoisotopic_ = require;
+}
+
+Bool PatternScorer::getRequireMonoisotopic() const
+{
+    return requireMonoisotopic_;
+}
+
+void PatternScorer::setRequireTopPeak(const Bool require)
+{
+    requireTopPeak_ = require;
+}
+
+Bool PatternScorer::getRequireTopPeak() const
+{
+    return requireTopPeak_;
+}
+
+void PatternScorer::setFloor(const Double floor)
+{
+    ipaca_precondition(floor > 0.0,
+        "PatternScorer::setFloor: the floor must be positive.");
+    floor_ = floor;
+}
+
+Double PatternScorer::getFloor() const
+{
+    return floor_;
+}
+
+Size PatternScorer::match(const Double mz, Size& first) const
+{
+    // the upper window ends mz_ + tolerance_ increase monotonically
+    Size n = mz_.size();
+    while (first < n && mz_[first] + tolerance_[first] < mz) {
+        ++first;
+    }
+    Size best = n;
+    Double distance = std::numeric_limits<Double>::max();
+    for (Size k = first; k < n && mz_[k] - tolerance_[k] <= mz; ++k) {
+        Double d = std::fabs(mz - mz_[k]);
+        if (d <= tolerance_[k] && d < distance) {
+            best = k;
+            distance = d;
+        }
+    }
+    return best;
+}
+
+PatternScore PatternScorer::score(const detail::Spectrum& candidate,
+    std::vector<Double>& observed, std::vector<Double>& expected) const
+{
+    Double total = 0.0;
+    Size top = 0;
+    for (Size k = 0; k < candidate.size(); ++k) {
+        total += candidate[k].ab;
+        if (candidate[k].ab > candidate[top].ab) {
+            top = k;
+        }
+    }
+    if (!(total > 0.0)) {
+        return reject(0);
+    }
+    // early rejection
+    Size n = mz_.size();
+    Size first = 0;
+    if (requireMonoisotopic_ && match(candidate[0].mz, first) == n) {
+        return reject(0);
+    }
+    first = 0;
+    if (requireTopPeak_ && match(candidate[top].mz, first) == n) {
+        return reject(0);
+    }
+    // align
+    observed.assign(ab_.begin(), ab_.end());
+    expected.assign(n, 0.0);
+    PatternScore s;
+    s.matched = 0;
+    s.rejected = false;
+    first = 0;
+    typedef detail::Spectrum::const_iterator CI;
+    for (CI i = candidate.begin(); i != candidate.end(); ++i) {
+        Size k = match(i->mz, first);
+        if (k < n) {
+            expected[k] += i->ab / total;
+            ++s.matched;
+        } else {
+            observed.push_back(0.0);
+            expected.push_back(i->ab / total);
+        }
+    }
+    if (observed.size() % 2 != 0) {
+        observed.push_back(0.0);
+        expected.push_back(0.0);
+    }
+    // score
+    Double dot = 0.0, oo = 0.0, cc = 0.0, chi = 0.0;
+    if (!observed.empty()) {
+        accumulate(&observed[0], &expected[0], observed.size(), dot, oo, cc,
+            chi);
+    }
+    s.cosine = oo > 0.0 && cc > 0.0 ? dot / std::sqrt(oo * cc) : 0.0;
+    s.chiSquared = chi;
+    Double kl = 0.0;
+    for (Size k = 0; k < n; ++k) {
+        if (observed[k] > 0.0) {
+            Double c = expected[k] > floor_ ? expected[k] : floor_;
+            kl += observed[k] * std::log(observed[k] / c);
+        }
+    }
+    s.kullbackLeibler = kl;
+    return s;
+}
+
+PatternScore PatternScorer::operator()(const detail::Spectrum& candidate) const
+{
+    std::vector<Double> observed, expected;
+    return score(candidate, observed, expected);
+}
+
+void PatternScorer::operator()(
+    const std::vector<detail::Spectrum>& candidates,
+    std::vector<PatternScore>& scores) const
+{
+    // the scratch buffers are shared by all candidates
+    std::vector<Double> observed, expected;
+    scores.resize(candidates.size());
+    for (Size k = 0; k < candidates.size(); ++k) {
+        scores[k] = score(candidates[k], observed, expected);
+    }
+}
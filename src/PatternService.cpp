@@ -0,0 +1,658 @@
+/*
+ * PatternService.cpp
+ *
+ *  Copyright (C) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/PatternService.hpp>
+#include <ipaca/Error.hpp>
+#include <boost/unordered_map.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <list>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace ipaca;
+
+PatternRequest::PatternRequest() :
+    limit(1e-26), outputMode(IPACA_ALL), outputCount(0),
+            particle(IPACA_PROTON), offsets(1, 0)
+{
+}
+
+void PatternRequest::addCompound(const Size* ids, const Double* atoms,
+    const Size n, const Int charge)
+{
+    elements.insert(elements.end(), ids, ids + n);
+    counts.insert(counts.end(), atoms, atoms + n);
+    offsets.push_back(elements.size());
+    charges.push_back(charge);
+}
+
+Size PatternRequest::size() const
+{
+    return charges.size();
+}
+
+detail::ServiceWriter::ServiceWriter(std::string& buffer) :
+    buffer_(buffer)
+{
+}
+
+void detail::ServiceWriter::putU32(const Size v)
+{
+    boost::uint32_t x = static_cast<boost::uint32_t>(v);
+    buffer_.append(reinterpret_cast<const char*>(&x), sizeof(x));
+}
+
+void detail::ServiceWriter::putI32(const Int v)
+{
+    boost::int32_t x = static_cast<boost::int32_t>(v);
+    buffer_.append(reinterpret_cast<const char*>(&x), sizeof(x));
+}
+
+void detail::ServiceWriter::putU64(const Size v)
+{
+    boost::uint64_t x = static_cast<boost::uint64_t>(v);
+    buffer_.append(reinterpret_cast<const char*>(&x), sizeof(x));
+}
+
+void detail::ServiceWriter::putF64(const Double v)
+{
+    buffer_.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+detail::ServiceReader::ServiceReader(const char* begin, const char* end) :
+    current_(begin), end_(end), failed_(false)
+{
+}
+
+void detail::ServiceReader::get(void* p, const Size n)
+{
+    if (remaining() < n) {
+        std::memset(p, 0, n);
+        current_ = end_;
+        failed_ = true;
+        return;
+    }
+    std::memcpy(p, current_, n);
+    current_ += n;
+}
+
+Size detail::ServiceReader::getU32()
+{
+    boost::uint32_t x;
+    get(&x, sizeof(x));
+    return x;
+}
+
+Int detail::ServiceReader::getI32()
+{
+    boost::int32_t x;
+    get(&x, sizeof(x));
+    return x;
+}
+
+Size detail::ServiceReader::getU64()
+{
+    boost::uint64_t x;
+    get(&x, sizeof(x));
+    return static_cast<Size>(x);
+}
+
+Double detail::ServiceReader::getF64()
+{
+    Double x;
+    get(&x, sizeof(x));
+    return x;
+}
+
+Size detail::ServiceReader::remaining() const
+{
+    return static_cast<Size>(end_ - current_);
+}
+
+Bool detail::ServiceReader::failed() const
+{
+    return failed_;
+}
+
+namespace {
+
+/** Stop reading from a connection with this many bytes of unsent
+ * responses.
+ */
+const Size maxBacklog = 1 << 24;
+
+/** A cached isotope pattern.
+ */
+struct CacheEntry
+{
+    std::string key;
+    std::vector<Double> mz, ab;
+};
+
+/** A least-recently-used cache of isotope patterns.
+ */
+class ResultCache
+{
+public:
+    explicit ResultCache(const Size capacity) :
+        capacity_(std::max(capacity, static_cast<Size>(1)))
+    {
+    }
+
+    /** @return The entry for \a key, or null; the entry becomes the most
+     *          recently used one.
+     */
+    const CacheEntry* find(const std::string& key)
+    {
+        Index::iterator i = index_.find(key);
+        if (i == index_.end()) {
+            return 0;
+        }
+        entries_.splice(entries_.begin(), entries_, i->second);
+        return &*i->second;
+    }
+
+    void insert(const std::string& key, const Double* mz, const Double* ab,
+        const Size n)
+    {
+        if (index_.find(key) != index_.end()) {
+            return;
+        }
+        if (index_.size() >= capacity_) {
+            index_.erase(entries_.back().key);
+            entries_.pop_back();
+        }
+        entries_.push_front(CacheEntry());
+        CacheEntry& e = entries_.front();
+        e.key = key;
+        e.mz.assign(mz, mz + n);
+        e.ab.assign(ab, ab + n);
+        index_[key] = entries_.begin();
+    }
+
+    Size size() const
+    {
+        return index_.size();
+    }
+
+private:
+    typedef std::list<CacheEntry> Entries;
+    typedef boost::unordered_map<std::string, Entries::iterator> Index;
+    Entries entries_;
+    Index index_;
+    Size capacity_;
+};
+
+/** A client connection with its own element table.
+ */
+struct Connection
+{
+    explicit Connection(const int f) :
+        fd(f), outPos(0), calculator(ipaca_calculator_create()),
+                hasHydrogen(false)
+    {
+    }
+
+    ~Connection()
+    {
+        ::close(fd);
+        ipaca_calculator_destroy(calculator);
+    }
+
+    int fd;
+    std::string in, out;
+    Size outPos;
+    ipaca_calculator* calculator;
+    /** The cache keys of the elements, i.e. their isotope tables in wire
+     * format.
+     */
+    std::vector<std::string> keys;
+    Bool hasHydrogen;
+    std::string hydrogenKey;
+};
+
+void setNonBlocking(const int fd)
+{
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
+
+void fillAddress(const String& path, sockaddr_un& address)
+{
+    ipaca_precondition(!path.empty() && path.size()
+            < sizeof(address.sun_path),
+        "PatternServer: invalid socket path.");
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size());
+}
+
+} // anonymous namespace
+
+struct PatternServer::Impl
+{
+    explicit Impl(const Size capacity) :
+        listener(-1), bound(false), cache(capacity)
+    {
+        wake[0] = wake[1] = -1;
+        stats.requests = stats.hits = stats.misses = stats.entries = 0;
+    }
+
+    ~Impl()
+    {
+        connections.clear();
+        if (listener >= 0) {
+            ::close(listener);
+        }
+        if (bound) {
+            ::unlink(path.c_str());
+        }
+        for (Size i = 0; i < 2; ++i) {
+            if (wake[i] >= 0) {
+                ::close(wake[i]);
+            }
+        }
+    }
+
+    void accept();
+    Bool read(Connection& c);
+    Bool write(Connection& c);
+    void handle(Connection& c, const detail::ServiceHeader& header,
+        const char* begin, const char* end);
+    Int addElement(Connection& c, detail::ServiceReader& r,
+        detail::ServiceWriter& w, const char* begin, const char* end);
+    Int setHydrogen(Connection& c, detail::ServiceReader& r);
+    Int calculate(Connection& c, detail::ServiceReader& r,
+        detail::ServiceWriter& w);
+
+    String path;
+    int listener;
+    Bool bound;
+    int wake[2];
+    ResultCache cache;
+    ServiceStats stats;
+    std::vector<boost::shared_ptr<Connection> > connections;
+    // buffers for the calculation of a single compound
+    std::vector<Double> mz, ab;
+    std::vector<Size> elements;
+    std::vector<Double> counts;
+};
+
+PatternServer::PatternServer(const String& path, const Size capacity) :
+    pImpl_(new Impl(capacity))
+{
+    sockaddr_un address;
+    fillAddress(path, address);
+    pImpl_->path = path;
+    // refuse to replace the socket of a running server
+    int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe >= 0) {
+        int r = ::connect(probe, reinterpret_cast<sockaddr*>(&address),
+            sizeof(address));
+        ::close(probe);
+        if (r == 0) {
+            throw RuntimeError("PatternServer: " + path + " is in use.");
+        }
+    }
+    ::unlink(path.c_str());
+    pImpl_->listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (pImpl_->listener < 0 || ::bind(pImpl_->listener,
+        reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        throw RuntimeError("PatternServer: cannot bind to " + path + ".");
+    }
+    pImpl_->bound = true;
+    if (::listen(pImpl_->listener, SOMAXCONN) != 0 || ::pipe(pImpl_->wake)
+            != 0) {
+        throw RuntimeError("PatternServer: cannot listen on " + path + ".");
+    }
+    setNonBlocking(pImpl_->listener);
+    setNonBlocking(pImpl_->wake[0]);
+    setNonBlocking(pImpl_->wake[1]);
+}
+
+PatternServer::~PatternServer()
+{
+}
+
+void PatternServer::run()
+{
+    std::vector<pollfd> fds;
+    for (;;) {
+        fds.clear();
+        pollfd p;
+        p.fd = pImpl_->wake[0];
+        p.events = POLLIN;
+        fds.push_back(p);
+        p.fd = pImpl_->listener;
+        fds.push_back(p);
+        const Size n = pImpl_->connections.size();
+        for (Size k = 0; k < n; ++k) {
+            const Connection& c = *pImpl_->connections[k];
+            Size backlog = c.out.size() - c.outPos;
+            p.fd = c.fd;
+            p.events = backlog < maxBacklog ? POLLIN : 0;
+            if (backlog > 0) {
+                p.events |= POLLOUT;
+            }
+            fds.push_back(p);
+        }
+        if (::poll(&fds[0], fds.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw RuntimeError("PatternServer: poll failed.");
+        }
+        if (fds[0].revents & POLLIN) {
+            char buffer[64];
+            while (::read(pImpl_->wake[0], buffer, sizeof(buffer)) > 0) {
+            }
+            return;
+        }
+        for (Size k = 0; k < n; ++k) {
+            Connection& c = *pImpl_->connections[k];
+            short revents = fds[k + 2].revents;
+            Bool open = !(revents & (POLLERR | POLLNVAL));
+            if (open && (revents & (POLLIN | POLLHUP))) {
+                open = pImpl_->read(c);
+            }
+            if (open && (revents & POLLOUT)) {
+                open = pImpl_->write(c);
+            }
+            if (!open) {
+                pImpl_->connections[k].reset();
+            }
+        }
+        pImpl_->connections.erase(std::remove(pImpl_->connections.begin(),
+            pImpl_->connections.end(), boost::shared_ptr<Connection>()),
+            pImpl_->connections.end());
+        if (fds[1].revents & POLLIN) {
+            pImpl_->accept();
+        }
+    }
+}
+
+void PatternServer::stop()
+{
+    char c = 0;
+    ssize_t r = ::write(pImpl_->wake[1], &c, 1);
+    (void) r;
+}
+
+ServiceStats PatternServer::getStats() const
+{
+    ServiceStats s = pImpl_->stats;
+    s.entries = pImpl_->cache.size();
+    return s;
+}
+
+void PatternServer::Impl::accept()
+{
+    for (;;) {
+        int fd = ::accept(listener, 0, 0);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            return;
+        }
+        setNonBlocking(fd);
+        boost::shared_ptr<Connection> c(new Connection(fd));
+        if (!c->calculator) {
+            continue;
+        }
+        connections.push_back(c);
+    }
+}
+
+Bool PatternServer::Impl::read(Connection& c)
+{
+    char buffer[65536];
+    for (;;) {
+        ssize_t r = ::recv(c.fd, buffer, sizeof(buffer), 0);
+        if (r > 0) {
+            c.in.append(buffer, static_cast<Size>(r));
+            continue;
+        }
+        if (r == 0) {
+            return false;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        }
+        return false;
+    }
+    // answer all complete frames
+    const Size headerSize = sizeof(detail::ServiceHeader);
+    Size pos = 0;
+    while (c.in.size() - pos >= headerSize) {
+        detail::ServiceHeader header;
+        std::memcpy(&header, c.in.data() + pos, headerSize);
+        if (header.size > detail::maxServicePayload) {
+            return false;
+        }
+        if (c.in.size() - pos - headerSize < header.size) {
+            break;
+        }
+        const char* begin = c.in.data() + pos + headerSize;
+        handle(c, header, begin, begin + header.size);
+        pos += headerSize + header.size;
+    }
+    c.in.erase(0, pos);
+    return write(c);
+}
+
+Bool PatternServer::Impl::write(Connection& c)
+{
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL;
+#else
+    const int flags = 0;
+#endif
+    while (c.outPos < c.out.size()) {
+        ssize_t r = ::send(c.fd, c.out.data() + c.outPos, c.out.size()
+                - c.outPos, flags);
+        if (r >= 0) {
+            c.outPos += static_cast<Size>(r);
+            continue;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        }
+        return false;
+    }
+    if (c.outPos == c.out.size()) {
+        c.out.clear();
+        c.outPos = 0;
+    } else if (c.outPos > c.out.size() / 2) {
+        c.out.erase(0, c.outPos);
+        c.outPos = 0;
+    }
+    return true;
+}
+
+void PatternServer::Impl::handle(Connection& c,
+    const detail::ServiceHeader& header, const char* begin, const char* end)
+{
+    std::string payload;
+    detail::ServiceReader r(begin, end);
+    detail::ServiceWriter w(payload);
+    Int status;
+    try {
+        switch (header.type) {
+            case detail::SERVICE_ADD_ELEMENT:
+                status = addElement(c, r, w, begin, end);
+                break;
+            case detail::SERVICE_SET_HYDROGEN:
+                status = setHydrogen(c, r);
+                break;
+            case detail::SERVICE_CALCULATE:
+                status = calculate(c, r, w);
+                break;
+            case detail::SERVICE_STATS:
+                w.putU64(stats.requests);
+                w.putU64(stats.hits);
+                w.putU64(stats.misses);
+                w.putU64(cache.size());
+                status = IPACA_OK;
+                break;
+            default:
+                status = IPACA_ERROR_ARGUMENT;
+        }
+    } catch (...) {
+        status = IPACA_ERROR_INTERNAL;
+    }
+    if (status != IPACA_OK) {
+        payload.clear();
+    }
+    ++stats.requests;
+    detail::ServiceHeader h;
+    h.size = static_cast<boost::uint32_t>(payload.size());
+    h.id = header.id;
+    h.type = header.type;
+    h.status = status;
+    c.out.append(reinterpret_cast<const char*>(&h), sizeof(h));
+    c.out.append(payload);
+}
+
+Int PatternServer::Impl::addElement(Connection& c, detail::ServiceReader& r,
+    detail::ServiceWriter& w, const char* begin, const char* end)
+{
+    Size n = r.getU32();
+    if (n == 0 || r.remaining() != 2 * n * sizeof(Double)) {
+        return IPACA_ERROR_ARGUMENT;
+    }
+    mz.resize(n);
+    ab.resize(n);
+    for (Size u = 0; u < n; ++u) {
+        mz[u] = r.getF64();
+        ab[u] = r.getF64();
+    }
+    long id = ipaca_calculator_add_element(c.calculator, &mz[0], &ab[0], n);
+    if (id < 0) {
+        return IPACA_ERROR_ARGUMENT;
+    }
+    // the wire format of an element is its cache key
+    c.keys.push_back(std::string(begin, end));
+    w.putU32(static_cast<Size>(id));
+    return IPACA_OK;
+}
+
+Int PatternServer::Impl::setHydrogen(Connection& c, detail::ServiceReader& r)
+{
+    Size id = r.getU32();
+    if (r.failed() || r.remaining() != 0) {
+        return IPACA_ERROR_ARGUMENT;
+    }
+    Int status = ipaca_calculator_set_hydrogen(c.calculator, id);
+    if (status == IPACA_OK) {
+        c.hasHydrogen = true;
+        c.hydrogenKey = c.keys[id];
+    }
+    return status;
+}
+
+Int PatternServer::Impl::calculate(Connection& c, detail::ServiceReader& r,
+    detail::ServiceWriter& w)
+{
+    Double limit = r.getF64();
+    Int mode = r.getI32();
+    Size count = r.getU32();
+    Int particle = r.getI32();
+    Size nCompounds = r.getU32();
+    if (r.failed() || (particle != IPACA_PROTON && particle
+            != IPACA_ELECTRON)) {
+        return IPACA_ERROR_ARGUMENT;
+    }
+    Int status = ipaca_calculator_set_limit(c.calculator, limit);
+    if (status == IPACA_OK) {
+        status = ipaca_calculator_set_output(c.calculator, mode, count);
+    }
+    if (status != IPACA_OK) {
+        return status;
+    }
+    // the part of the cache key that is shared by all compounds
+    std::string prefix;
+    detail::ServiceWriter p(prefix);
+    p.putF64(limit);
+    p.putI32(mode);
+    p.putU32(mode == IPACA_ALL ? 0 : count);
+    p.putI32(particle);
+    p.putU32(c.hasHydrogen ? 1 : 0);
+    prefix += c.hydrogenKey;
+    w.putU32(nCompounds);
+    std::string key;
+    detail::ServiceWriter k(key);
+    for (Size i = 0; i < nCompounds; ++i) {
+        int charge = r.getI32();
+        Size n = r.getU32();
+        if (r.failed() || n > r.remaining() / (4 + sizeof(Double))) {
+            return IPACA_ERROR_ARGUMENT;
+        }
+        key = prefix;
+        k.putI32(charge);
+        k.putU32(n);
+        elements.resize(n);
+        counts.resize(n);
+        for (Size j = 0; j < n; ++j) {
+            elements[j] = r.getU32();
+            counts[j] = r.getF64();
+            if (elements[j] >= c.keys.size()) {
+                return IPACA_ERROR_ARGUMENT;
+            }
+            key += c.keys[elements[j]];
+            k.putF64(counts[j]);
+        }
+        const CacheEntry* e = cache.find(key);
+        if (e) {
+            ++stats.hits;
+            w.putU32(e->mz.size());
+            for (Size j = 0; j < e->mz.size(); ++j) {
+                w.putF64(e->mz[j]);
+                w.putF64(e->ab[j]);
+            }
+            continue;
+        }
+        size_t offsets[] = { 0, n };
+        size_t peakOffsets[2];
+        if (mz.size() < 256) {
+            mz.resize(256);
+            ab.resize(256);
+        }
+        for (;;) {
+            status = ipaca_calculate(c.calculator, 1, offsets,
+                n > 0 ? &elements[0] : 0, n > 0 ? &counts[0] : 0, &charge,
+                particle, &mz[0], &ab[0], mz.size(), peakOffsets, 0);
+            if (status != IPACA_ERROR_CAPACITY) {
+                break;
+            }
+            mz.resize(2 * mz.size());
+            ab.resize(2 * ab.size());
+        }
+        if (status != IPACA_OK) {
+            return status;
+        }
+        ++stats.misses;
+        Size peaks = peakOffsets[1];
+        cache.insert(key, &mz[0], &ab[0], peaks);
+        w.putU32(peaks);
+        for (Size j = 0; j < peaks; ++j) {
+            w.putF64(mz[j]);
+            w.putF64(ab[j]);
+        }
+    }
+    return r.remaining() == 0 ? IPACA_OK : IPACA_ERROR_ARGUMENT;
+}
@@ -0,0 +1,289 @@
+/*
+ * PowerTable.cpp
+ *
+ *  Copyright (C) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/PowerTable.hpp>
+#include <ipaca/Error.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/static_assert.hpp>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+
+using namespace ipaca;
+
+namespace {
+
+/*
+ * Layout: a TableHeader, one ElementEntry per element, and then per
+ * element its isotope table, its PowerEntry list and the peaks of its
+ * powers. All offsets are byte offsets from the start of the table.
+ */
+
+const char tableMagic[8] = { 'I', 'P', 'A', 'C', 'A', 'P', 'W', 'T' };
+const boost::uint32_t tableVersion = 1;
+
+struct TableHeader
+{
+    char magic[8];
+    boost::uint32_t version;
+    boost::uint32_t elements;
+    Double limit;
+    boost::uint64_t size;
+};
+
+struct ElementEntry
+{
+    boost::uint32_t isotopes;
+    boost::uint32_t powers;
+    boost::uint64_t isotopeOffset;
+    boost::uint64_t powerOffset;
+};
+
+struct PowerEntry
+{
+    boost::uint64_t first;
+    boost::uint64_t peaks;
+    boost::uint64_t offset;
+};
+
+BOOST_STATIC_ASSERT(sizeof(detail::Isotope) == 2 * sizeof(Double));
+
+/** Check that \a count items of \a unit bytes at \a offset are within
+ * the table and aligned.
+ */
+Bool inRange(const boost::uint64_t offset, const boost::uint64_t count,
+    const Size unit, const Size size)
+{
+    return offset % sizeof(Double) == 0 && offset <= size && count <= (size
+            - offset) / unit;
+}
+
+Size writePeaks(char* image, const Size pos, const detail::Spectrum& peaks)
+{
+    if (!peaks.empty()) {
+        std::memcpy(image + pos, &peaks[0], peaks.size()
+                * sizeof(detail::Isotope));
+    }
+    return pos + peaks.size() * sizeof(detail::Isotope);
+}
+
+} // anonymous namespace
+
+struct PowerTable::Mapping
+{
+    explicit Mapping(const String& filename) :
+        file(filename.c_str(), boost::interprocess::read_only),
+        region(file, boost::interprocess::read_only)
+    {
+    }
+
+    boost::interprocess::file_mapping file;
+    boost::interprocess::mapped_region region;
+};
+
+PowerTable::PowerTable() :
+    data_(0), size_(0)
+{
+}
+
+PowerTable::PowerTable(const std::vector<detail::Isotopes>& isotopes,
+    const Double limit,
+    const std::vector<std::vector<detail::Spectrum> >& powers,
+    const std::vector<std::vector<Size> >& offsets) :
+    data_(0), size_(0)
+{
+    ipaca_precondition(powers.size() == isotopes.size() && offsets.size()
+            == isotopes.size(),
+        "PowerTable: powers and offsets are required for every element.");
+    Size n = sizeof(TableHeader) + isotopes.size() * sizeof(ElementEntry);
+    for (Size e = 0; e < isotopes.size(); ++e) {
+        ipaca_precondition(offsets[e].size() == powers[e].size(),
+            "PowerTable: an offset is required for every power.");
+        n += isotopes[e].size() * sizeof(detail::Isotope) + powers[e].size()
+                * sizeof(PowerEntry);
+        for (Size k = 0; k < powers[e].size(); ++k) {
+            n += powers[e][k].size() * sizeof(detail::Isotope);
+        }
+    }
+    image_.resize(n);
+    char* image = &image_[0];
+    TableHeader* header = reinterpret_cast<TableHeader*>(image);
+    std::memcpy(header->magic, tableMagic, sizeof(tableMagic));
+    header->version = tableVersion;
+    header->elements = static_cast<boost::uint32_t>(isotopes.size());
+    header->limit = limit;
+    header->size = n;
+    ElementEntry* entries = reinterpret_cast<ElementEntry*>(image
+            + sizeof(TableHeader));
+    Size pos = sizeof(TableHeader) + isotopes.size() * sizeof(ElementEntry);
+    for (Size e = 0; e < isotopes.size(); ++e) {
+        entries[e].isotopes = static_cast<boost::uint32_t>(isotopes[e].size());
+        entries[e].powers = static_cast<boost::uint32_t>(powers[e].size());
+        entries[e].isotopeOffset = pos;
+        pos = writePeaks(image, pos, isotopes[e]);
+        entries[e].powerOffset = pos;
+        PowerEntry* p = reinterpret_cast<PowerEntry*>(image + pos);
+        pos += powers[e].size() * sizeof(PowerEntry);
+        for (Size k = 0; k < powers[e].size(); ++k) {
+            p[k].first = offsets[e][k];
+            p[k].peaks = powers[e][k].size();
+            p[k].offset = pos;
+            pos = writePeaks(image, pos, powers[e][k]);
+        }
+    }
+    assert(pos == n);
+    attach(image, n);
+}
+
+PowerTable::~PowerTable()
+{
+}
+
+Bool PowerTable::attach(const char* data, const Size size)
+{
+    if (size < sizeof(TableHeader)) {
+        return false;
+    }
+    const TableHeader* header = reinterpret_cast<const TableHeader*>(data);
+    if (std::memcmp(header->magic, tableMagic, sizeof(tableMagic)) != 0
+            || header->version != tableVersion || header->size > size
+            || !inRange(sizeof(TableHeader), header->elements,
+                sizeof(ElementEntry), header->size)) {
+        return false;
+    }
+    const Size n = header->size;
+    const ElementEntry* entries = reinterpret_cast<const ElementEntry*>(data
+            + sizeof(TableHeader));
+    for (Size e = 0; e < header->elements; ++e) {
+        if (!inRange(entries[e].isotopeOffset, entries[e].isotopes,
+            sizeof(detail::Isotope), n) || !inRange(entries[e].powerOffset,
+            entries[e].powers, sizeof(PowerEntry), n)) {
+            return false;
+        }
+        const PowerEntry* p = reinterpret_cast<const PowerEntry*>(data
+                + entries[e].powerOffset);
+        for (Size k = 0; k < entries[e].powers; ++k) {
+            if (!inRange(p[k].offset, p[k].peaks, sizeof(detail::Isotope), n)) {
+                return false;
+            }
+        }
+    }
+    data_ = data;
+    size_ = n;
+    return true;
+}
+
+boost::shared_ptr<const PowerTable> PowerTable::load(const String& filename,
+    const std::vector<detail::Isotopes>& isotopes, const Double limit)
+{
+    boost::shared_ptr<PowerTable> table(new PowerTable);
+    try {
+        table->mapping_.reset(new Mapping(filename));
+    } catch (const boost::interprocess::interprocess_exception&) {
+        ipaca_fail("PowerTable::load: cannot map '" + filename + "'.");
+    }
+    const boost::interprocess::mapped_region& region =
+            table->mapping_->region;
+    if (!table->attach(static_cast<const char*>(region.get_address()),
+        region.get_size())) {
+        ipaca_fail("PowerTable::load: '" + filename
+                + "' is not a power table of this version.");
+    }
+    Bool match = table->getLimit() == limit && table->size()
+            == isotopes.size();
+    for (Size e = 0; match && e < isotopes.size(); ++e) {
+        match = table->find(isotopes[e]) == e;
+    }
+    if (!match) {
+        ipaca_fail("PowerTable::load: '" + filename
+                + "' has been built for other elements or another limit.");
+    }
+    return table;
+}
+
+void PowerTable::save(const String& filename) const
+{
+    std::ofstream ofs(filename.c_str(), std::ios::binary);
+    ofs.write(data_, static_cast<std::streamsize>(size_));
+    if (!ofs) {
+        ipaca_fail("PowerTable::save: cannot write '" + filename + "'.");
+    }
+}
+
+Double PowerTable::getLimit() const
+{
+    return reinterpret_cast<const TableHeader*>(data_)->limit;
+}
+
+Size PowerTable::size() const
+{
+    return reinterpret_cast<const TableHeader*>(data_)->elements;
+}
+
+Size PowerTable::getBytes() const
+{
+    return size_;
+}
+
+Size PowerTable::find(const detail::Isotopes& isotopes) const
+{
+    const ElementEntry* entries = reinterpret_cast<const ElementEntry*>(data_
+            + sizeof(TableHeader));
+    for (Size e = 0; e < size(); ++e) {
+        if (entries[e].isotopes != isotopes.size()) {
+            continue;
+        }
+        const detail::Isotope* table =
+                reinterpret_cast<const detail::Isotope*>(data_
+                        + entries[e].isotopeOffset);
+        Bool equal = true;
+        for (Size u = 0; equal && u < isotopes.size(); ++u) {
+            equal = table[u].mz == isotopes[u].mz && table[u].ab
+                    == isotopes[u].ab;
+        }
+        if (equal) {
+            return e;
+        }
+    }
+    return size();
+}
+
+void PowerTable::getIsotopes(const Size element,
+    detail::Isotopes& isotopes) const
+{
+    ipaca_precondition(element < size(),
+        "PowerTable::getIsotopes: no such element.");
+    const ElementEntry& entry = reinterpret_cast<const ElementEntry*>(data_
+            + sizeof(TableHeader))[element];
+    const detail::Isotope* table = reinterpret_cast<const detail::Isotope*>(data_
+            + entry.isotopeOffset);
+    isotopes.assign(table, table + entry.isotopes);
+}
+
+Size PowerTable::getPowers(const Size element) const
+{
+    ipaca_precondition(element < size(),
+        "PowerTable::getPowers: no such element.");
+    return reinterpret_cast<const ElementEntry*>(data_ + sizeof(TableHeader))[
+        element].powers;
+}
+
+Size PowerTable::getPower(const Size element, const Size k,
+    detail::Spectrum& spectrum) const
+{
+    ipaca_precondition(k < getPowers(element),
+        "PowerTable::getPower: no such power.");
+    const ElementEntry& entry = reinterpret_cast<const ElementEntry*>(data_
+            + sizeof(TableHeader))[element];
+    const PowerEntry& power = reinterpret_cast<const PowerEntry*>(data_
+            + entry.powerOffset)[k];
+    const detail::Isotope* peaks = reinterpret_cast<const detail::Isotope*>(data_
+            + power.offset);
+    spectrum.assign(peaks, peaks + power.peaks);
+    return power.first;
+}
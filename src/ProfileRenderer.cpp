@@ -0,0 +1,249 @@
+/*
+ * ProfileRenderer.cpp
+ *
+ *  Copyright (C) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/ProfileRenderer.hpp>
+#include <ipaca/Error.hpp>
+#include <algorithm>
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace ipaca;
+
+namespace {
+
+/** The ratio of the standard deviation and the FWHM of a Gaussian.
+ */
+const Double sigmaPerFwhm = 0.42466090014400953; // 1 / (2 sqrt(2 ln 2))
+
+/** Adds a Gaussian to the uniform grid points [lo, hi].
+ * @param d The distance of grid point lo from the center.
+ */
+void renderGaussian(Double* buffer, const Size lo, const Size hi,
+    const Double d, const Double step, const Double sigma,
+    const Double height)
+{
+    // g(k+1) = g(k) * r(k) and r(k+1) = r(k) * c
+    Double a = 0.5 / (sigma * sigma);
+    Double g = height * std::exp(-a * d * d);
+    Double r = std::exp(-a * (2.0 * d * step + step * step));
+    Double c = std::exp(-2.0 * a * step * step);
+    Size k = lo;
+#ifdef __SSE2__
+    if (hi - lo >= 3) {
+        // two lanes (k, k+1), advanced by two grid points at a time
+        Double g1 = g * r;
+        Double r1 = r * c;
+        __m128d vg = _mm_set_pd(g1, g);
+        __m128d vr = _mm_set_pd(r1 * r1 * c, r * r1);
+        __m128d vc = _mm_set1_pd(c * c * c * c);
+        for (; k + 1 <= hi; k += 2) {
+            __m128d b = _mm_loadu_pd(buffer + k);
+            _mm_storeu_pd(buffer + k, _mm_add_pd(b, vg));
+            vg = _mm_mul_pd(vg, vr);
+            vr = _mm_mul_pd(vr, vc);
+        }
+        if (k <= hi) {
+            Double next[2];
+            _mm_storeu_pd(next, vg);
+            buffer[k] += next[0];
+        }
+        return;
+    }
+#endif
+    for (; k <= hi; ++k) {
+        buffer[k] += g;
+        g *= r;
+        r *= c;
+    }
+}
+
+/** Adds a Lorentzian to the uniform grid points [lo, hi].
+ * @param d The distance of grid point lo from the center.
+ */
+void renderLorentzian(Double* buffer, const Size lo, const Size hi,
+    const Double d, const Double step, const Double gamma,
+    const Double height)
+{
+    Double g2 = gamma * gamma;
+    Double hg2 = height * g2;
+    Size k = lo;
+#ifdef __SSE2__
+    __m128d vd = _mm_set_pd(d + step, d);
+    __m128d vstep = _mm_set1_pd(2.0 * step);
+    __m128d vg2 = _mm_set1_pd(g2);
+    __m128d vh = _mm_set1_pd(hg2);
+    for (; k + 1 <= hi; k += 2) {
+        __m128d v = _mm_div_pd(vh, _mm_add_pd(_mm_mul_pd(vd, vd), vg2));
+        __m128d b = _mm_loadu_pd(buffer + k);
+        _mm_storeu_pd(buffer + k, _mm_add_pd(b, v));
+        vd = _mm_add_pd(vd, vstep);
+    }
+#endif
+    for (; k <= hi; ++k) {
+        Double x = d + static_cast<Double>(k - lo) * step;
+        buffer[k] += hg2 / (x * x + g2);
+    }
+}
+
+} // anonymous namespace
+
+ProfileRenderer::ProfileRenderer(const Double mzFirst, const Double mzStep,
+    const Size size) :
+    first_(mzFirst), step_(mzStep), size_(size), shape_(GAUSSIAN), model_(
+        CONSTANT_RESOLUTION), resolution_(60000.0), referenceMz_(200.0),
+        truncation_(1e-6)
+{
+    ipaca_precondition(mzStep > 0.0,
+        "ProfileRenderer: the grid step must be positive.");
+    ipaca_precondition(size > 0, "ProfileRenderer: empty grid.");
+}
+
+ProfileRenderer::ProfileRenderer(const std::vector<Double>& grid) :
+    first_(0.0), step_(0.0), size_(grid.size()), grid_(grid), shape_(
+        GAUSSIAN), model_(CONSTANT_RESOLUTION), resolution_(60000.0),
+        referenceMz_(200.0), truncation_(1e-6)
+{
+    ipaca_precondition(!grid.empty(), "ProfileRenderer: empty grid.");
+    for (Size k = 1; k < grid.size(); ++k) {
+        ipaca_precondition(grid[k - 1] <= grid[k],
+            "ProfileRenderer: the grid must be sorted.");
+    }
+    first_ = grid.front();
+}
+
+void ProfileRenderer::setPeakShape(const PeakShape shape)
+{
+    shape_ = shape;
+}
+
+ProfileRenderer::PeakShape ProfileRenderer::getPeakShape() const
+{
+    return shape_;
+}
+
+void ProfileRenderer::setResolution(const Double resolution,
+    const ResolutionModel model, const Double referenceMz)
+{
+    ipaca_precondition(resolution > 0.0,
+        "ProfileRenderer::setResolution: resolution must be positive.");
+    ipaca_precondition(referenceMz > 0.0,
+        "ProfileRenderer::setResolution: reference m/z must be positive.");
+    resolution_ = resolution;
+    model_ = model;
+    referenceMz_ = referenceMz;
+}
+
+Double ProfileRenderer::getFwhm(const Double mz) const
+{
+    switch (model_) {
+        case ORBITRAP_RESOLUTION:
+            return mz * std::sqrt(mz / referenceMz_) / resolution_;
+        case CONSTANT_WIDTH:
+            return resolution_;
+        default:
+            return mz / resolution_;
+    }
+}
+
+void ProfileRenderer::setTruncation(const Double truncation)
+{
+    ipaca_precondition(truncation > 0.0 && truncation < 1.0,
+        "ProfileRenderer::setTruncation: truncation must be in (0, 1).");
+    truncation_ = truncation;
+}
+
+Double ProfileRenderer::getTruncation() const
+{
+    return truncation_;
+}
+
+Size ProfileRenderer::size() const
+{
+    return size_;
+}
+
+Double ProfileRenderer::getMz(const Size k) const
+{
+    return grid_.empty() ? first_ + static_cast<Double>(k) * step_
+            : grid_[k];
+}
+
+void ProfileRenderer::renderPeak(const Double mz, const Double height,
+    Double* buffer) const
+{
+    Double fwhm = getFwhm(mz);
+    if (!(fwhm > 0.0) || height == 0.0) {
+        return;
+    }
+    // the half width of the truncated kernel
+    Double scale, halfWidth;
+    if (shape_ == GAUSSIAN) {
+        scale = fwhm * sigmaPerFwhm;
+        halfWidth = scale * std::sqrt(-2.0 * std::log(truncation_));
+    } else {
+        scale = 0.5 * fwhm;
+        halfWidth = scale * std::sqrt(1.0 / truncation_ - 1.0);
+    }
+    if (grid_.empty()) {
+        // uniform grid: address the kernel directly
+        Double a = std::ceil((mz - halfWidth - first_) / step_);
+        Double b = std::floor((mz + halfWidth - first_) / step_);
+        Double last = static_cast<Double>(size_ - 1);
+        if (b < 0.0 || a > last || a > b) {
+            return;
+        }
+        Size lo = a > 0.0 ? static_cast<Size>(a) : 0;
+        Size hi = b < last ? static_cast<Size>(b) : size_ - 1;
+        Double d = getMz(lo) - mz;
+        if (shape_ == GAUSSIAN) {
+            renderGaussian(buffer, lo, hi, d, step_, scale, height);
+        } else {
+            renderLorentzian(buffer, lo, hi, d, step_, scale, height);
+        }
+        return;
+    }
+    // sorted grid: find the kernel by binary search
+    typedef std::vector<Double>::const_iterator GCI;
+    GCI i = std::lower_bound(grid_.begin(), grid_.end(), mz - halfWidth);
+    Double* out = buffer + (i - grid_.begin());
+    if (shape_ == GAUSSIAN) {
+        Double a = 0.5 / (scale * scale);
+        for (; i != grid_.end() && *i <= mz + halfWidth; ++i, ++out) {
+            Double d = *i - mz;
+            *out += height * std::exp(-a * d * d);
+        }
+    } else {
+        Double g2 = scale * scale;
+        for (; i != grid_.end() && *i <= mz + halfWidth; ++i, ++out) {
+            Double d = *i - mz;
+            *out += height * g2 / (d * d + g2);
+        }
+    }
+}
+
+void ProfileRenderer::render(const detail::Spectrum& spectrum,
+    Double* buffer, const Double intensity) const
+{
+    typedef detail::Spectrum::const_iterator CI;
+    for (CI i = spectrum.begin(); i != spectrum.end(); ++i) {
+        renderPeak(i->mz, i->ab * intensity, buffer);
+    }
+}
+
+void ProfileRenderer::render(const std::vector<detail::Spectrum>& spectra,
+    Double* buffers, const Size stride, const Double* intensities) const
+{
+    ipaca_precondition(stride >= size_,
+        "ProfileRenderer::render: the stride must not be smaller than the "
+        "grid.");
+    for (Size k = 0; k < spectra.size(); ++k) {
+        render(spectra[k], buffers + k * stride,
+            intensities ? intensities[k] : 1.0);
+    }
+}
@@ -0,0 +1,177 @@
+/*
+ * PrunePolicy.cpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/PrunePolicy.hpp>
+#include <ipaca/Error.hpp>
+
+using namespace ipaca;
+
+namespace {
+
+/** Finds the range of peaks with an abundance above \a limit at both
+ * ends of the spectrum.
+ */
+void trimBelow(const detail::Spectrum& s, const Double limit, Size& first,
+    Size& last)
+{
+    first = 0;
+    last = s.size();
+    while (first < last && s[first].ab <= limit) {
+        ++first;
+    }
+    while (last > first && s[last - 1].ab <= limit) {
+        --last;
+    }
+}
+
+/** Trims peaks from both ends of the spectrum (always the smaller one
+ * first) as long as the discarded abundance does not exceed \a allowed.
+ */
+void trimTails(const detail::Spectrum& s, const Double allowed, Size& first,
+    Size& last)
+{
+    first = 0;
+    last = s.size();
+    Double discarded = 0.0;
+    while (first < last) {
+        Double l = s[first].ab;
+        Double r = s[last - 1].ab;
+        if (l <= r) {
+            if (discarded + l > allowed) {
+                break;
+            }
+            discarded += l;
+            ++first;
+        } else {
+            if (discarded + r > allowed) {
+                break;
+            }
+            discarded += r;
+            --last;
+        }
+    }
+}
+
+Double totalAbundance(const detail::Spectrum& s)
+{
+    Double total = 0.0;
+    typedef detail::Spectrum::const_iterator CI;
+    for (CI i = s.begin(); i != s.end(); ++i) {
+        total += i->ab;
+    }
+    return total;
+}
+
+} // anonymous namespace
+
+PrunePolicy::~PrunePolicy()
+{
+}
+
+Double PrunePolicy::getFixedLimit() const
+{
+    return 0.0;
+}
+
+//
+// AbsoluteLimitPrunePolicy
+//
+
+AbsoluteLimitPrunePolicy::AbsoluteLimitPrunePolicy(const Double limit) :
+    limit_(limit)
+{
+    ipaca_precondition(limit > 0.0,
+        "AbsoluteLimitPrunePolicy: limit must be positive.");
+}
+
+void AbsoluteLimitPrunePolicy::operator()(const detail::Spectrum& s,
+    const Double, Size& first, Size& last) const
+{
+    trimBelow(s, limit_, first, last);
+}
+
+Double AbsoluteLimitPrunePolicy::getFixedLimit() const
+{
+    return limit_;
+}
+
+Double AbsoluteLimitPrunePolicy::getLimit() const
+{
+    return limit_;
+}
+
+//
+// RelativeLimitPrunePolicy
+//
+
+RelativeLimitPrunePolicy::RelativeLimitPrunePolicy(const Double fraction) :
+    fraction_(fraction)
+{
+    ipaca_precondition(fraction >= 0.0 && fraction < 1.0,
+        "RelativeLimitPrunePolicy: fraction must be in [0, 1).");
+}
+
+void RelativeLimitPrunePolicy::operator()(const detail::Spectrum& s,
+    const Double, Size& first, Size& last) const
+{
+    Double maxAbundance = 0.0;
+    typedef detail::Spectrum::const_iterator CI;
+    for (CI i = s.begin(); i != s.end(); ++i) {
+        if (i->ab > maxAbundance) {
+            maxAbundance = i->ab;
+        }
+    }
+    trimBelow(s, fraction_ * maxAbundance, first, last);
+}
+
+Double RelativeLimitPrunePolicy::getFraction() const
+{
+    return fraction_;
+}
+
+//
+// CoveragePrunePolicy
+//
+
+CoveragePrunePolicy::CoveragePrunePolicy(const Double coverage) :
+    coverage_(coverage)
+{
+    ipaca_precondition(coverage > 0.0 && coverage <= 1.0,
+        "CoveragePrunePolicy: coverage must be in (0, 1].");
+}
+
+void CoveragePrunePolicy::operator()(const detail::Spectrum& s,
+    const Double, Size& first, Size& last) const
+{
+    trimTails(s, (1.0 - coverage_) * totalAbundance(s), first, last);
+}
+
+Double CoveragePrunePolicy::getCoverage() const
+{
+    return coverage_;
+}
+
+//
+// ErrorBudgetPrunePolicy
+//
+
+ErrorBudgetPrunePolicy::ErrorBudgetPrunePolicy(const Double budget) :
+    budget_(budget)
+{
+    ipaca_precondition(budget >= 0.0 && budget < 1.0,
+        "ErrorBudgetPrunePolicy: budget must be in [0, 1).");
+}
+
+void ErrorBudgetPrunePolicy::operator()(const detail::Spectrum& s,
+    const Double share, Size& first, Size& last) const
+{
+    trimTails(s, budget_ * share * totalAbundance(s), first, last);
+}
+
+Double ErrorBudgetPrunePolicy::getBudget() const
+{
+    return budget_;
+}
@@ -0,0 +1,315 @@
+/*
+ * SharedPatternCache.cpp
+ *
+ *  Copyright (C) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/SharedPatternCache.hpp>
+#include <ipaca/Error.hpp>
+#include <boost/cstdint.hpp>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace ipaca;
+
+namespace {
+
+const boost::uint64_t cacheMagic = 0x3143504143415049ULL; // "IPACAPC1"
+
+/** The number of slots searched for a key.
+ */
+const Size probeLength = 8;
+
+/** The number of attempts to read a slot that is being written.
+ */
+const Size readAttempts = 4;
+
+/** The number of 1 ms waits for another process to set up the segment.
+ */
+const Size setupWaits = 2000;
+
+/** The fixed part of a slot; followed by the key (padded to 8 bytes) and
+ * the peaks as (mz, ab) pairs. The fields that readers check may change
+ * under them, hence they are volatile and read exactly once.
+ */
+struct SlotHeader
+{
+    volatile boost::uint32_t seq;
+    volatile boost::uint32_t keySize;
+    volatile boost::uint64_t hash;
+    boost::uint64_t stamp;
+    volatile boost::uint32_t peaks;
+    boost::uint32_t pad;
+};
+
+Size roundUp(const Size n, const Size a)
+{
+    return (n + a - 1) / a * a;
+}
+
+/** FNV-1a, with the final mix of MurmurHash3 since the slot index only
+ * uses the low bits; zero marks empty slots.
+ */
+boost::uint64_t hashKey(const std::string& key)
+{
+    boost::uint64_t h = 14695981039346656037ULL;
+    for (Size i = 0; i < key.size(); ++i) {
+        h ^= static_cast<unsigned char>(key[i]);
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h ? h : 1;
+}
+
+} // anonymous namespace
+
+struct SharedPatternCache::Header
+{
+    volatile boost::uint64_t magic;
+    boost::uint64_t slots, maxPeaks, maxKey, slotSize;
+    volatile boost::uint64_t clock;
+    char pad[16];
+};
+
+SharedPatternCache::SharedPatternCache(const String& name, const Size slots,
+    const Size maxPeaks, const Size maxKey) :
+    header_(0), size_(0), mask_(0), slotSize_(0)
+{
+    ipaca_precondition(name.size() > 1 && name[0] == '/',
+        "SharedPatternCache: the name must start with a slash.");
+    ipaca_precondition(slots > 0 && maxPeaks > 0 && maxKey > 0,
+        "SharedPatternCache: empty geometry.");
+    Size n = 1;
+    while (n < slots) {
+        n <<= 1;
+    }
+    int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    Bool creator = fd >= 0;
+    if (!creator) {
+        if (errno == EEXIST) {
+            fd = ::shm_open(name.c_str(), O_RDWR, 0);
+        }
+        if (fd < 0) {
+            throw RuntimeError("SharedPatternCache: cannot open " + name
+                    + ".");
+        }
+    }
+    if (creator) {
+        slotSize_ = roundUp(sizeof(SlotHeader) + roundUp(maxKey, 8) + 2
+                * maxPeaks * sizeof(Double), 64);
+        size_ = sizeof(Header) + n * slotSize_;
+        if (::ftruncate(fd, static_cast<off_t>(size_)) != 0) {
+            ::close(fd);
+            ::shm_unlink(name.c_str());
+            throw RuntimeError("SharedPatternCache: cannot allocate " + name
+                    + ".");
+        }
+    } else {
+        // wait for the creator to size the segment
+        struct stat st;
+        for (Size i = 0; ::fstat(fd, &st) == 0 && static_cast<Size>(
+            st.st_size) < sizeof(Header) && i < setupWaits; ++i) {
+            ::usleep(1000);
+        }
+        size_ = static_cast<Size>(st.st_size);
+    }
+    void* p = size_ >= sizeof(Header) ? ::mmap(0, size_, PROT_READ
+            | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        throw RuntimeError("SharedPatternCache: cannot map " + name + ".");
+    }
+    header_ = static_cast<Header*>(p);
+    if (creator) {
+        header_->slots = n;
+        header_->maxPeaks = maxPeaks;
+        header_->maxKey = roundUp(maxKey, 8);
+        header_->slotSize = slotSize_;
+        header_->clock = 0;
+        // publish the geometry
+        __sync_synchronize();
+        header_->magic = cacheMagic;
+    } else {
+        for (Size i = 0; header_->magic != cacheMagic && i < setupWaits; ++i) {
+            ::usleep(1000);
+        }
+        __sync_synchronize();
+        slotSize_ = header_->slotSize;
+        if (header_->magic != cacheMagic || size_ < sizeof(Header)
+                + header_->slots * slotSize_ || slotSize_ < sizeof(SlotHeader)
+                + header_->maxKey + 2 * header_->maxPeaks * sizeof(Double)) {
+            ::munmap(p, size_);
+            throw RuntimeError("SharedPatternCache: " + name
+                    + " is not a pattern cache.");
+        }
+    }
+    mask_ = header_->slots - 1;
+}
+
+SharedPatternCache::~SharedPatternCache()
+{
+    ::munmap(header_, size_);
+}
+
+const char* SharedPatternCache::getSlot(const Size index) const
+{
+    return reinterpret_cast<const char*>(header_) + sizeof(Header) + index
+            * slotSize_;
+}
+
+char* SharedPatternCache::getSlot(const Size index)
+{
+    return reinterpret_cast<char*>(header_) + sizeof(Header) + index
+            * slotSize_;
+}
+
+Bool SharedPatternCache::find(const std::string& key,
+    detail::Spectrum& spectrum) const
+{
+    const Size n = key.size();
+    if (n <= header_->maxKey) {
+        const boost::uint64_t h = hashKey(key);
+        const Size peakOffset = sizeof(SlotHeader) + header_->maxKey;
+        for (Size p = 0; p < probeLength; ++p) {
+            const char* slot = getSlot((h + p) & mask_);
+            const SlotHeader* s = reinterpret_cast<const SlotHeader*>(slot);
+            for (Size attempt = 0; attempt < readAttempts; ++attempt) {
+                boost::uint32_t seq = s->seq;
+                if (seq & 1) {
+                    continue;
+                }
+                __sync_synchronize();
+                // A writer may change the slot while we read it; only the
+                // validated copies bound the reads.
+                const boost::uint64_t hash = s->hash;
+                const Size keySize = s->keySize;
+                const Size peakCount = s->peaks;
+                Bool match = hash == h && keySize == n && peakCount
+                        <= header_->maxPeaks && std::memcmp(slot
+                        + sizeof(SlotHeader), key.data(), n) == 0;
+                if (match) {
+                    spectrum.resize(peakCount);
+                    const Double* peaks = reinterpret_cast<const Double*>(slot
+                            + peakOffset);
+                    for (Size k = 0; k < spectrum.size(); ++k) {
+                        spectrum[k].mz = peaks[2 * k];
+                        spectrum[k].ab = peaks[2 * k + 1];
+                    }
+                }
+                __sync_synchronize();
+                if (s->seq != seq) {
+                    continue;
+                }
+                if (match) {
+                    return true;
+                }
+                if (hash == 0) {
+                    // the key would have been stored here
+                    spectrum.clear();
+                    return false;
+                }
+                break;
+            }
+        }
+    }
+    spectrum.clear();
+    return false;
+}
+
+void SharedPatternCache::insert(const std::string& key,
+    const detail::Spectrum& spectrum)
+{
+    const Size n = key.size();
+    if (n > header_->maxKey || spectrum.size() > header_->maxPeaks) {
+        return;
+    }
+    const boost::uint64_t h = hashKey(key);
+    // the first empty slot of the window, or the oldest entry
+    char* victim = 0;
+    boost::uint64_t oldest = std::numeric_limits<boost::uint64_t>::max();
+    for (Size p = 0; p < probeLength; ++p) {
+        char* slot = getSlot((h + p) & mask_);
+        SlotHeader* s = reinterpret_cast<SlotHeader*>(slot);
+        if (s->seq & 1) {
+            continue;
+        }
+        if (s->hash == 0) {
+            victim = slot;
+            break;
+        }
+        if (s->hash == h && s->keySize == n && std::memcmp(slot
+                + sizeof(SlotHeader), key.data(), n) == 0) {
+            return;
+        }
+        if (s->stamp < oldest) {
+            oldest = s->stamp;
+            victim = slot;
+        }
+    }
+    if (!victim) {
+        return;
+    }
+    SlotHeader* s = reinterpret_cast<SlotHeader*>(victim);
+    boost::uint32_t seq = s->seq;
+    if ((seq & 1) || !__sync_bool_compare_and_swap(&s->seq, seq, seq + 1)) {
+        return;
+    }
+    s->hash = h;
+    s->keySize = static_cast<boost::uint32_t>(n);
+    s->peaks = static_cast<boost::uint32_t>(spectrum.size());
+    std::memcpy(victim + sizeof(SlotHeader), key.data(), n);
+    Double* peaks = reinterpret_cast<Double*>(victim + sizeof(SlotHeader)
+            + header_->maxKey);
+    for (Size k = 0; k < spectrum.size(); ++k) {
+        peaks[2 * k] = spectrum[k].mz;
+        peaks[2 * k + 1] = spectrum[k].ab;
+    }
+    s->stamp = __sync_add_and_fetch(&header_->clock, 1);
+    __sync_synchronize();
+    s->seq = seq + 2;
+}
+
+void SharedPatternCache::clear()
+{
+    for (Size i = 0; i <= mask_; ++i) {
+        SlotHeader* s = reinterpret_cast<SlotHeader*>(getSlot(i));
+        boost::uint32_t seq = s->seq;
+        if ((seq & 1) || !__sync_bool_compare_and_swap(&s->seq, seq, seq
+                + 1)) {
+            continue;
+        }
+        s->hash = 0;
+        s->stamp = 0;
+        __sync_synchronize();
+        s->seq = seq + 2;
+    }
+}
+
+Size SharedPatternCache::getSlots() const
+{
+    return header_->slots;
+}
+
+Size SharedPatternCache::getMaxPeaks() const
+{
+    return header_->maxPeaks;
+}
+
+Size SharedPatternCache::getMaxKey() const
+{
+    return header_->maxKey;
+}
+
+void SharedPatternCache::remove(const String& name)
+{
+    ::shm_unlink(name.c_str());
+}
@@ -5,6 +5,7 @@
  *
  */
 #include <ipaca/Stoichiometry.hpp>
+#include <ipaca/Error.hpp>
 #include <cmath>
 #include <iostream>
 
@@ -50,6 +51,21 @@ void detail::splitStoichiometry(const detail::Stoichiometry& s,
     }
 }
 
+void detail::fractionalAtom(const detail::Isotopes& isotopes,
+    const Double fractional, detail::Isotopes& esa)
+{
+    ipaca_precondition(!isotopes.empty(),
+        "fractionalAtom: the element has no isotopes.");
+    Double m0 = isotopes[0].mz;
+    esa = isotopes;
+    esa[0].mz = fractional * m0;
+    esa[0].ab = (1.0 - fractional) + fractional * isotopes[0].ab;
+    for (Size u = 1; u < esa.size(); ++u) {
+        esa[u].mz = isotopes[u].mz - m0 + esa[0].mz;
+        esa[u].ab = fractional * isotopes[u].ab;
+    }
+}
+
 std::ostream& detail::operator<<(std::ostream& os, const detail::Stoichiometry& s)
 {
     typedef detail::Stoichiometry::const_iterator CI;
@@ -0,0 +1,84 @@
+/*
+ * ipacad.cpp
+ *
+ *  Copyright (C) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/PatternService.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <signal.h>
+
+/*
+ * The pattern service daemon. It runs in the foreground until it receives
+ * SIGINT or SIGTERM; use a process supervisor to run it in the background.
+ *
+ *   ipacad [-c capacity] socket
+ */
+
+using namespace ipaca;
+
+namespace {
+
+PatternServer* server = 0;
+
+extern "C" void onSignal(int)
+{
+    if (server) {
+        server->stop();
+    }
+}
+
+int usage()
+{
+    std::cerr << "usage: ipacad [-c capacity] socket" << std::endl;
+    return EXIT_FAILURE;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[])
+{
+    Size capacity = 1 << 20;
+    const char* path = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            char* end = 0;
+            long c = std::strtol(argv[++i], &end, 10);
+            if (*end != '\0' || c <= 0) {
+                return usage();
+            }
+            capacity = static_cast<Size>(c);
+        } else if (!path && argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            return usage();
+        }
+    }
+    if (!path) {
+        return usage();
+    }
+    try {
+        PatternServer s(path, capacity);
+        server = &s;
+        struct sigaction action;
+        std::memset(&action, 0, sizeof(action));
+        action.sa_handler = &onSignal;
+        sigaction(SIGINT, &action, 0);
+        sigaction(SIGTERM, &action, 0);
+        signal(SIGPIPE, SIG_IGN);
+        s.run();
+        server = 0;
+        ServiceStats stats = s.getStats();
+        std::clog << "ipacad: " << stats.requests << " requests, "
+                << stats.hits << " cache hits, " << stats.misses
+                << " misses, " << stats.entries << " cached patterns"
+                << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "ipacad: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
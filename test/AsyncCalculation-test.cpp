@@ -0,0 +1,354 @@
+/*
+ * AsyncCalculation-test.cpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/AsyncCalculation.hpp>
+#include <ipaca/Executor.hpp>
+#include <ipaca/MemoryResource.hpp>
+#include <ipaca/Mercury7.hpp>
+#include <ipaca/Spectrum.hpp>
+#include <ipaca/Stoichiometry.hpp>
+#include <ipaca/Traits.hpp>
+#include <ipaca/Types.hpp>
+#include <boost/thread/mutex.hpp>
+#include <iostream>
+#include <vector>
+#include "TestElements.hpp"
+#include "vigra/unittest.hxx"
+
+typedef ipaca::detail::Spectrum MySpectrum;
+typedef ipaca::detail::Stoichiometry MyStoichiometry;
+
+//
+// ipaca configuration starts here
+//
+struct SpectrumConverter
+{
+    void operator()(const ipaca::detail::Spectrum& lhs, MySpectrum& rhs)
+    {
+        rhs = lhs;
+    }
+};
+
+struct StoichiometryConverter
+{
+    void operator()(const MyStoichiometry& lhs,
+        ipaca::detail::Stoichiometry& rhs)
+    {
+        rhs = lhs;
+    }
+};
+
+namespace ipaca {
+
+template<>
+struct Traits<MyStoichiometry, MySpectrum>
+{
+    typedef SpectrumConverter spectrum_converter;
+    typedef StoichiometryConverter stoichiometry_converter;
+    static detail::Element getHydrogens(const Size n);
+    static Bool isHydrogen(const detail::Element&);
+    static Double getElectronMass();
+};
+
+detail::Element Traits<MyStoichiometry, MySpectrum>::getHydrogens(const Size n)
+{
+    return ipaca::detail::getHydrogens(n);
+}
+
+Bool Traits<MyStoichiometry, MySpectrum>::isHydrogen(const detail::Element& e)
+{
+    return ipaca::detail::isHydrogen(e);
+}
+
+Double Traits<MyStoichiometry, MySpectrum>::getElectronMass()
+{
+    return ipaca::detail::getElectronMass();
+}
+
+} // namespace ipaca
+//
+// ipaca configuration ends here
+//
+
+using namespace ipaca;
+
+typedef Mercury7<MyStoichiometry, MySpectrum> MyMercury7;
+
+/** An executor that queues work until the test runs it, like an event
+ * loop.
+ */
+struct QueueExecutor : Executor
+{
+    void execute(const Work& work)
+    {
+        queue.push_back(work);
+    }
+
+    void runAll()
+    {
+        for (Size k = 0; k < queue.size(); ++k) {
+            queue[k]();
+        }
+        queue.clear();
+    }
+
+    std::vector<Work> queue;
+};
+
+/** Records the results passed to the callback.
+ */
+struct Recorder
+{
+    Recorder() :
+        calls(0), cancelled(0), peaks(0)
+    {
+    }
+
+    void operator()(const boost::shared_future<MySpectrum>& future)
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        ++calls;
+        try {
+            peaks += future.get().size();
+        } catch (const CancelledError&) {
+            ++cancelled;
+        }
+    }
+
+    boost::mutex mutex;
+    Size calls, cancelled, peaks;
+};
+
+/** A prune policy that fails.
+ */
+struct FailingPolicy : PrunePolicy
+{
+    void operator()(const detail::Spectrum&, const Double, Size&,
+        Size&) const
+    {
+        ipaca_fail("FailingPolicy: failed.");
+    }
+};
+
+/** Tests for the asynchronous interface in AsyncCalculation.hpp and
+ * Executor.cpp.
+ */
+struct AsyncCalculationTestSuite : vigra::test_suite
+{
+    /** Constructor.
+     * The AsyncCalculationTestSuite constructor adds all AsyncCalculation
+     * tests to the test suite. If you write an additional test, add the
+     * test case here.
+     */
+    AsyncCalculationTestSuite() :
+        vigra::test_suite("AsyncCalculation")
+    {
+        add(testCase(&AsyncCalculationTestSuite::testThreadPool));
+        add(testCase(&AsyncCalculationTestSuite::testFuture));
+        add(testCase(&AsyncCalculationTestSuite::testCallback));
+        add(testCase(&AsyncCalculationTestSuite::testCancel));
+        add(testCase(&AsyncCalculationTestSuite::testSnapshot));
+        add(testCase(&AsyncCalculationTestSuite::testErrors));
+        add(testCase(&AsyncCalculationTestSuite::testMemoryResource));
+    }
+
+    /** C_6n H_12n O_6n.
+     */
+    MyStoichiometry createGlucose(const Double n)
+    {
+        return test::createCompound(6.0 * n, 12.0 * n, 6.0 * n);
+    }
+
+    void shouldMatch(const MySpectrum& s, const MySpectrum& t)
+    {
+        shouldEqual(s.size(), t.size());
+        for (Size k = 0; k < s.size(); ++k) {
+            shouldEqual(s[k].mz, t[k].mz);
+            shouldEqual(s[k].ab, t[k].ab);
+        }
+    }
+
+    static void increment(boost::mutex* mutex, Size* count)
+    {
+        boost::mutex::scoped_lock lock(*mutex);
+        ++*count;
+    }
+
+    void testThreadPool()
+    {
+        boost::mutex mutex;
+        Size count = 0;
+        {
+            ThreadPoolExecutor pool(4);
+            shouldEqual(pool.getThreads(), static_cast<Size>(4));
+            for (Size k = 0; k < 1000; ++k) {
+                pool.execute(boost::bind(&increment, &mutex, &count));
+            }
+            // the destructor runs the queued work
+        }
+        shouldEqual(count, static_cast<Size>(1000));
+        ThreadPoolExecutor pool;
+        should(pool.getThreads() > 0);
+    }
+
+    void testFuture()
+    {
+        MyMercury7 m;
+        ThreadPoolExecutor pool(2);
+        std::vector<AsyncCalculation<MySpectrum> > calculations;
+        for (Size n = 1; n <= 20; ++n) {
+            calculations.push_back(m.submit(pool,
+                createGlucose(static_cast<Double>(n)), 1,
+                MyMercury7::PROTON));
+        }
+        for (Size n = 1; n <= 20; ++n) {
+            MySpectrum expected = m(createGlucose(static_cast<Double>(n)), 1,
+                MyMercury7::PROTON);
+            shouldMatch(calculations[n - 1].get(), expected);
+            shouldEqual(calculations[n - 1].getStatus(), ASYNC_DONE);
+            should(!calculations[n - 1].cancel());
+        }
+        // custom policies and empty results
+        boost::shared_ptr<const PrunePolicy> policy(
+            new RelativeLimitPrunePolicy(1e-6));
+        shouldMatch(m.submit(pool, createGlucose(50), 2, MyMercury7::ELECTRON,
+            policy).get(), m(createGlucose(50), 2, MyMercury7::ELECTRON,
+            *policy));
+        shouldEqual(m.submit(pool, createGlucose(1), 0, MyMercury7::PROTON,
+            0.0).get().size(), static_cast<Size>(0));
+        shouldEqual(m(createGlucose(1), 0, MyMercury7::PROTON, 0.0).size(),
+            static_cast<Size>(0));
+    }
+
+    void testCallback()
+    {
+        MyMercury7 m;
+        Recorder recorder;
+        Size peaks = 0;
+        {
+            ThreadPoolExecutor pool(3);
+            for (Size n = 1; n <= 30; ++n) {
+                const Double count = static_cast<Double>(n);
+                m.submit(pool, createGlucose(count), 1, MyMercury7::PROTON,
+                    1e-26, boost::ref(recorder));
+                peaks += m(createGlucose(count), 1, MyMercury7::PROTON).size();
+            }
+        }
+        shouldEqual(recorder.calls, static_cast<Size>(30));
+        shouldEqual(recorder.cancelled, static_cast<Size>(0));
+        shouldEqual(recorder.peaks, peaks);
+    }
+
+    void testCancel()
+    {
+        MyMercury7 m;
+        QueueExecutor loop;
+        Recorder recorder;
+        std::vector<AsyncCalculation<MySpectrum> > bulk;
+        for (Size n = 1; n <= 10; ++n) {
+            bulk.push_back(m.submit(loop,
+                createGlucose(100.0 * static_cast<Double>(n)), 1,
+                MyMercury7::PROTON, 1e-26, boost::ref(recorder)));
+        }
+        AsyncCalculation<MySpectrum> interactive = m.submit(loop,
+            createGlucose(1), 1, MyMercury7::PROTON);
+        shouldEqual(loop.queue.size(), static_cast<Size>(11));
+        // make room for the interactive request
+        for (Size k = 0; k < bulk.size(); ++k) {
+            shouldEqual(bulk[k].getStatus(), ASYNC_QUEUED);
+            should(bulk[k].cancel());
+            shouldEqual(bulk[k].getStatus(), ASYNC_CANCELLED);
+            should(!bulk[k].cancel());
+        }
+        // the callbacks report the cancellation right away
+        shouldEqual(recorder.calls, static_cast<Size>(10));
+        shouldEqual(recorder.cancelled, static_cast<Size>(10));
+        should(bulk[0].getFuture().is_ready());
+        bool thrown = false;
+        try {
+            bulk[0].get();
+        } catch (const CancelledError&) {
+            thrown = true;
+        }
+        should(thrown);
+        loop.runAll();
+        shouldEqual(recorder.calls, static_cast<Size>(10));
+        shouldEqual(interactive.getStatus(), ASYNC_DONE);
+        shouldMatch(interactive.get(), m(createGlucose(1), 1,
+            MyMercury7::PROTON));
+    }
+
+    void testSnapshot()
+    {
+        MyMercury7 m;
+        QueueExecutor loop;
+        AsyncCalculation<MySpectrum> c = m.submit(loop, createGlucose(10), 1,
+            MyMercury7::PROTON);
+        MySpectrum expected = m(createGlucose(10), 1, MyMercury7::PROTON);
+        m.setOutputMode(OutputMode::topK(1));
+        loop.runAll();
+        shouldMatch(c.get(), expected);
+    }
+
+    void testErrors()
+    {
+        MyMercury7 m;
+        QueueExecutor loop;
+        boost::shared_ptr<const PrunePolicy> policy(new FailingPolicy);
+        Recorder recorder;
+        AsyncCalculation<MySpectrum> c = m.submit(loop, createGlucose(10), 1,
+            MyMercury7::PROTON, policy);
+        loop.runAll();
+        shouldEqual(c.getStatus(), ASYNC_DONE);
+        bool thrown = false;
+        try {
+            c.get();
+        } catch (const CancelledError&) {
+        } catch (const RuntimeError&) {
+            thrown = true;
+        }
+        should(thrown);
+        thrown = false;
+        try {
+            m.submit(loop, createGlucose(1), 1, MyMercury7::PROTON,
+                boost::shared_ptr<const PrunePolicy>());
+        } catch (const PreconditionViolation&) {
+            thrown = true;
+        }
+        should(thrown);
+        shouldEqual(loop.queue.size(), static_cast<Size>(0));
+    }
+
+    void testMemoryResource()
+    {
+        MyMercury7 m;
+        QueueExecutor loop;
+        MyStoichiometry glucose = createGlucose(10);
+        MySpectrum expected = m(glucose, 1, MyMercury7::PROTON);
+        MonotonicArena arena;
+        AsyncCalculation<MySpectrum> c;
+        {
+            MemoryResourceScope scope(&arena);
+            c = m.submit(loop, glucose, 1, MyMercury7::PROTON);
+        }
+        // nothing that outlives the call comes from the arena
+        shouldEqual(arena.getAllocated(), static_cast<Size>(0));
+        arena.reset();
+        loop.runAll();
+        shouldMatch(c.get(), expected);
+    }
+};
+
+/** The main function that runs the tests for the asynchronous interface.
+ * Under normal circumstances you need not edit this.
+ */
+int main()
+{
+    AsyncCalculationTestSuite test;
+    int success = test.run();
+    std::cout << test.report() << std::endl;
+    return success;
+}
@@ -0,0 +1,118 @@
+/*
+ * BinnedConvolution-test.cpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/BinnedConvolution.hpp>
+#include <ipaca/Error.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include "vigra/unittest.hxx"
+
+using namespace ipaca;
+
+/** Tests for the mass-binned convolution in BinnedConvolution.cpp.
+ */
+struct BinnedConvolutionTestSuite : vigra::test_suite
+{
+    /** Constructor.
+     * The BinnedConvolutionTestSuite constructor adds all BinnedConvolution
+     * tests to the test suite. If you write an additional test, add the
+     * test case here.
+     */
+    BinnedConvolutionTestSuite() :
+        vigra::test_suite("BinnedConvolution")
+    {
+        add(testCase(&BinnedConvolutionTestSuite::testMerge));
+        add(testCase(&BinnedConvolutionTestSuite::testConvolve));
+    }
+
+    detail::Spectrum createSpectrum(const Double* mz, const Double* ab,
+        const Size n)
+    {
+        detail::Spectrum s;
+        for (Size k = 0; k < n; ++k) {
+            detail::SpectrumElement e;
+            e.mz = mz[k];
+            e.ab = ab[k];
+            s.push_back(e);
+        }
+        return s;
+    }
+
+    void testMerge()
+    {
+        // two peaks 0.001 apart at m/z 100 and one far away, unsorted
+        Double mz[] = { 101.0, 100.0, 100.001, 50.0 };
+        Double ab[] = { 0.25, 0.5, 0.25, 0.0 };
+        detail::Spectrum s = createSpectrum(mz, ab, 4);
+        detail::Spectrum merged(s);
+        detail::mergePeaks(merged, 10000.0);
+        shouldEqual(merged.size(), static_cast<Size>(2));
+        shouldEqualTolerance(merged[0].ab, 0.75, 1e-15);
+        shouldEqualTolerance(merged[0].mz, (100.0 * 0.5 + 100.001 * 0.25)
+                / 0.75, 1e-12);
+        shouldEqual(merged[1].mz, 101.0);
+        // resolved at a higher resolution
+        merged = s;
+        detail::mergePeaks(merged, 1e6);
+        shouldEqual(merged.size(), static_cast<Size>(3));
+        shouldEqual(merged[0].mz, 100.0);
+        shouldEqual(merged[1].mz, 100.001);
+        // everything merges at a low resolution
+        merged = s;
+        detail::mergePeaks(merged, 10.0);
+        shouldEqual(merged.size(), static_cast<Size>(1));
+        shouldEqualTolerance(merged[0].ab, 1.0, 1e-15);
+        bool thrown = false;
+        try {
+            detail::mergePeaks(merged, 0.0);
+        } catch (PreconditionViolation&) {
+            thrown = true;
+        }
+        shouldEqual(thrown, true);
+    }
+
+    void testConvolve()
+    {
+        Double mz1[] = { 12.0, 13.0033548378 };
+        Double ab1[] = { 0.9893, 0.0107 };
+        Double mz2[] = { 14.0030740052, 15.0001088984 };
+        Double ab2[] = { 0.99632, 0.00368 };
+        detail::Spectrum c = createSpectrum(mz1, ab1, 2);
+        detail::Spectrum n = createSpectrum(mz2, ab2, 2);
+        // at a high resolution, the two M+1 configurations are resolved
+        detail::Spectrum result;
+        detail::binnedConvolve(c, n, 1e5, result);
+        shouldEqual(result.size(), static_cast<Size>(4));
+        shouldEqualTolerance(result[1].mz, 12.0 + 15.0001088984, 1e-12);
+        shouldEqualTolerance(result[1].ab, 0.9893 * 0.00368, 1e-15);
+        shouldEqualTolerance(result[2].mz, 13.0033548378 + 14.0030740052,
+            1e-12);
+        shouldEqualTolerance(result[2].ab, 0.0107 * 0.99632, 1e-15);
+        // at a lower resolution, they are merged into their centroid
+        detail::binnedConvolve(c, n, 1000.0, result);
+        shouldEqual(result.size(), static_cast<Size>(3));
+        Double ab = 0.9893 * 0.00368 + 0.0107 * 0.99632;
+        shouldEqualTolerance(result[1].ab, ab, 1e-15);
+        shouldEqualTolerance(result[1].mz, (0.9893 * 0.00368 * (12.0
+                + 15.0001088984) + 0.0107 * 0.99632 * (13.0033548378
+                + 14.0030740052)) / ab, 1e-12);
+        // empty operands
+        detail::binnedConvolve(c, detail::Spectrum(), 1000.0, result);
+        should(result.empty());
+    }
+};
+
+/** The main function that runs the tests for the mass-binned convolution.
+ * Under normal circumstances you need not edit this.
+ */
+int main()
+{
+    BinnedConvolutionTestSuite test;
+    int success = test.run();
+    std::cout << test.report() << std::endl;
+    return success;
+}
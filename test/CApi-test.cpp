@@ -0,0 +1,254 @@
+/*
+ * CApi-test.cpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/CApi.h>
+#include <ipaca/Mercury7Impl.hpp>
+#include <ipaca/Traits.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "vigra/unittest.hxx"
+
+using namespace ipaca;
+
+/** Tests for the C interface in CApi.cpp.
+ */
+struct CApiTestSuite : vigra::test_suite
+{
+    /** Constructor.
+     * The CApiTestSuite constructor adds all CApi tests to the test
+     * suite. If you write an additional test, add the test case here.
+     */
+    CApiTestSuite() :
+        vigra::test_suite("CApi")
+    {
+        add(testCase(&CApiTestSuite::testBatch));
+        add(testCase(&CApiTestSuite::testHydrogen));
+        add(testCase(&CApiTestSuite::testCapacity));
+        add(testCase(&CApiTestSuite::testErrors));
+    }
+
+    /** The element table: C, H, O.
+     */
+    void createElements(ipaca_calculator* c, std::vector<detail::Isotopes>& t)
+    {
+        double mzC[] = { 12.0, 13.0033548378 };
+        double abC[] = { 0.9893, 0.0107 };
+        double mzH[] = { 1.0078250321, 2.0141017780 };
+        double abH[] = { 0.999885, 0.000115 };
+        double mzO[] = { 15.9949146221, 16.9991315, 17.9991604 };
+        double abO[] = { 0.99757, 0.00038, 0.00205 };
+        double* mz[] = { mzC, mzH, mzO };
+        double* ab[] = { abC, abH, abO };
+        size_t n[] = { 2, 2, 3 };
+        t.clear();
+        for (Size e = 0; e < 3; ++e) {
+            shouldEqual(ipaca_calculator_add_element(c, mz[e], ab[e], n[e]),
+                static_cast<long>(e));
+            detail::Isotopes isotopes(n[e]);
+            for (Size u = 0; u < n[e]; ++u) {
+                isotopes[u].mz = mz[e][u];
+                isotopes[u].ab = ab[e][u];
+            }
+            t.push_back(isotopes);
+        }
+    }
+
+    /** A batch of compounds in CSR form: water, methane, glucose, an
+     * empty composition and C2.5 H6.
+     */
+    void createBatch(std::vector<size_t>& offsets,
+        std::vector<size_t>& elements, std::vector<double>& counts)
+    {
+        size_t o[] = { 0, 2, 4, 7, 7, 9 };
+        size_t e[] = { 1, 2, 0, 1, 0, 1, 2, 0, 1 };
+        double c[] = { 2.0, 1.0, 1.0, 4.0, 6.0, 12.0, 6.0, 2.5, 6.0 };
+        offsets.assign(o, o + 6);
+        elements.assign(e, e + 9);
+        counts.assign(c, c + 9);
+    }
+
+    /** The expected peaks of compound k.
+     */
+    detail::Spectrum expect(const std::vector<detail::Isotopes>& table,
+        const std::vector<size_t>& offsets,
+        const std::vector<size_t>& elements,
+        const std::vector<double>& counts, const Size k, const int charge,
+        const Bool protonsToHydrogen)
+    {
+        detail::Stoichiometry s;
+        for (Size j = offsets[k]; j < offsets[k + 1]; ++j) {
+            detail::Element e;
+            e.isotopes = table[elements[j]];
+            e.count = counts[j];
+            if (protonsToHydrogen && elements[j] == 1) {
+                e.count += charge;
+            }
+            s.push_back(e);
+        }
+        if (!protonsToHydrogen && charge > 0) {
+            s.push_back(detail::getHydrogens(charge));
+        }
+        detail::Mercury7Impl m;
+        detail::Spectrum result = m(s, 1e-26);
+        if (charge != 0) {
+            Double absCharge = charge < 0 ? -charge : charge;
+            for (Size j = 0; j < result.size(); ++j) {
+                result[j].mz = (result[j].mz - charge
+                        * detail::getElectronMass()) / absCharge;
+            }
+        }
+        return result;
+    }
+
+    void shouldMatch(const detail::Spectrum& expected, const double* mz,
+        const double* ab, const size_t first, const size_t last)
+    {
+        shouldEqual(last - first, expected.size());
+        for (Size j = 0; j < expected.size(); ++j) {
+            shouldEqualTolerance(mz[first + j], expected[j].mz, 1e-12);
+            shouldEqualTolerance(ab[first + j], expected[j].ab, 1e-12);
+        }
+    }
+
+    void testBatch()
+    {
+        ipaca_calculator* c = ipaca_calculator_create();
+        std::vector<detail::Isotopes> table;
+        createElements(c, table);
+        std::vector<size_t> offsets, elements;
+        std::vector<double> counts;
+        createBatch(offsets, elements, counts);
+        const Size n = offsets.size() - 1;
+        int charges[] = { 0, 1, 2, 0, 3 };
+        std::vector<double> mz(1000), ab(1000);
+        std::vector<size_t> peakOffsets(n + 1);
+        size_t done = 0;
+        shouldEqual(ipaca_calculate(c, n, &offsets[0], &elements[0],
+            &counts[0], charges, IPACA_PROTON, &mz[0], &ab[0], mz.size(),
+            &peakOffsets[0], &done), IPACA_OK);
+        shouldEqual(done, n);
+        shouldEqual(peakOffsets[0], static_cast<size_t>(0));
+        for (Size k = 0; k < n; ++k) {
+            shouldMatch(expect(table, offsets, elements, counts, k,
+                charges[k], false), &mz[0], &ab[0], peakOffsets[k],
+                peakOffsets[k + 1]);
+        }
+        // the output mode bounds the number of peaks per compound
+        shouldEqual(ipaca_calculator_set_output(c, IPACA_TOP_K, 2), IPACA_OK);
+        shouldEqual(ipaca_calculate(c, n, &offsets[0], &elements[0],
+            &counts[0], 0, IPACA_ELECTRON, &mz[0], &ab[0], 2 * n,
+            &peakOffsets[0], 0), IPACA_OK);
+        for (Size k = 0; k < n; ++k) {
+            should(peakOffsets[k + 1] - peakOffsets[k] <= 2);
+        }
+        ipaca_calculator_destroy(c);
+    }
+
+    void testHydrogen()
+    {
+        ipaca_calculator* c = ipaca_calculator_create();
+        std::vector<detail::Isotopes> table;
+        createElements(c, table);
+        shouldEqual(ipaca_calculator_set_hydrogen(c, 1), IPACA_OK);
+        std::vector<size_t> offsets, elements;
+        std::vector<double> counts;
+        createBatch(offsets, elements, counts);
+        const Size n = offsets.size() - 1;
+        // charge protons go to the hydrogen entry; negative charges remove
+        // protons
+        int charges[] = { -1, 1, -2, 0, 2 };
+        std::vector<double> mz(1000), ab(1000);
+        std::vector<size_t> peakOffsets(n + 1);
+        shouldEqual(ipaca_calculate(c, n, &offsets[0], &elements[0],
+            &counts[0], charges, IPACA_PROTON, &mz[0], &ab[0], mz.size(),
+            &peakOffsets[0], 0), IPACA_OK);
+        for (Size k = 0; k < n; ++k) {
+            shouldMatch(expect(table, offsets, elements, counts, k,
+                charges[k], true), &mz[0], &ab[0], peakOffsets[k],
+                peakOffsets[k + 1]);
+        }
+        ipaca_calculator_destroy(c);
+    }
+
+    void testCapacity()
+    {
+        ipaca_calculator* c = ipaca_calculator_create();
+        std::vector<detail::Isotopes> table;
+        createElements(c, table);
+        std::vector<size_t> offsets, elements;
+        std::vector<double> counts;
+        createBatch(offsets, elements, counts);
+        const Size n = offsets.size() - 1;
+        std::vector<double> mz(1000), ab(1000);
+        std::vector<size_t> all(n + 1);
+        shouldEqual(ipaca_calculate(c, n, &offsets[0], &elements[0],
+            &counts[0], 0, IPACA_PROTON, &mz[0], &ab[0], mz.size(), &all[0],
+            0), IPACA_OK);
+        // room for the first two compounds only
+        std::vector<size_t> part(n + 1);
+        size_t done = 0;
+        shouldEqual(ipaca_calculate(c, n, &offsets[0], &elements[0],
+            &counts[0], 0, IPACA_PROTON, &mz[0], &ab[0], all[2] + 1,
+            &part[0], &done), IPACA_ERROR_CAPACITY);
+        shouldEqual(done, static_cast<size_t>(2));
+        shouldEqual(part[2], all[2]);
+        // resume with the remaining compounds
+        std::vector<size_t> rest(n - done + 1);
+        shouldEqual(ipaca_calculate(c, n - done, &offsets[done],
+            &elements[0], &counts[0], 0, IPACA_PROTON, &mz[0], &ab[0],
+            mz.size(), &rest[0], &done), IPACA_OK);
+        shouldEqual(rest[n - 2], all[n] - all[2]);
+        ipaca_calculator_destroy(c);
+    }
+
+    void testErrors()
+    {
+        ipaca_calculator* c = ipaca_calculator_create();
+        std::vector<detail::Isotopes> table;
+        createElements(c, table);
+        double mz[10], ab[10];
+        size_t peakOffsets[2];
+        size_t offsets[] = { 0, 1 };
+        size_t badElement[] = { 3 };
+        size_t carbon[] = { 0 };
+        double one[] = { 1.0 };
+        double negative[] = { -1.0 };
+        int minusOne[] = { -1 };
+        shouldEqual(ipaca_calculate(c, 1, offsets, badElement, one, 0,
+            IPACA_PROTON, mz, ab, 10, peakOffsets, 0), IPACA_ERROR_ARGUMENT);
+        shouldEqual(ipaca_calculate(c, 1, offsets, carbon, negative, 0,
+            IPACA_PROTON, mz, ab, 10, peakOffsets, 0), IPACA_ERROR_ARGUMENT);
+        shouldEqual(ipaca_calculate(c, 1, offsets, carbon, one, 0, 7, mz,
+            ab, 10, peakOffsets, 0), IPACA_ERROR_ARGUMENT);
+        // deprotonation needs hydrogens
+        shouldEqual(ipaca_calculate(c, 1, offsets, carbon, one, minusOne,
+            IPACA_PROTON, mz, ab, 10, peakOffsets, 0), IPACA_ERROR_ARGUMENT);
+        shouldEqual(ipaca_calculate(c, 1, offsets, carbon, one, minusOne,
+            IPACA_ELECTRON, mz, ab, 10, peakOffsets, 0), IPACA_OK);
+        shouldEqual(ipaca_calculator_add_element(c, mz, ab, 0), -1L);
+        shouldEqual(ipaca_calculator_set_hydrogen(c, 3),
+            IPACA_ERROR_ARGUMENT);
+        shouldEqual(ipaca_calculator_set_limit(c, 0.0), IPACA_ERROR_ARGUMENT);
+        shouldEqual(ipaca_calculator_set_output(c, IPACA_FIRST_N, 0),
+            IPACA_ERROR_ARGUMENT);
+        shouldEqual(ipaca_calculator_set_output(c, 5, 1),
+            IPACA_ERROR_ARGUMENT);
+        ipaca_calculator_destroy(c);
+        ipaca_calculator_destroy(0);
+    }
+};
+
+/** The main function that runs the tests for the C interface.
+ * Under normal circumstances you need not edit this.
+ */
+int main()
+{
+    CApiTestSuite test;
+    int success = test.run();
+    std::cout << test.report() << std::endl;
+    return success;
+}
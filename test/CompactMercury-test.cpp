@@ -0,0 +1,275 @@
+/*
+ * CompactMercury-test.cpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/CompactMercury.hpp>
+#include <ipaca/Mercury7Impl.hpp>
+#include <ipaca/PatternCache.hpp>
+#include <boost/shared_ptr.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+#include "TestElements.hpp"
+#include "vigra/unittest.hxx"
+
+using namespace ipaca;
+
+/** A pattern cache that keeps everything.
+ */
+struct MapCache : PatternCache
+{
+    Bool find(const std::string& key, detail::Spectrum& spectrum) const
+    {
+        std::map<std::string, detail::Spectrum>::const_iterator i =
+                entries.find(key);
+        if (i == entries.end()) {
+            return false;
+        }
+        spectrum = i->second;
+        return true;
+    }
+
+    void insert(const std::string& key, const detail::Spectrum& spectrum)
+    {
+        entries[key] = spectrum;
+    }
+
+    std::map<std::string, detail::Spectrum> entries;
+};
+
+/** Tests for the compact engine in CompactMercury.cpp.
+ */
+struct CompactMercuryTestSuite : vigra::test_suite
+{
+    /** Constructor.
+     * The CompactMercuryTestSuite constructor adds all CompactMercury tests
+     * to the test suite. If you write an additional test, add the test
+     * case here.
+     */
+    CompactMercuryTestSuite() :
+        vigra::test_suite("CompactMercury")
+    {
+        add(testCase(&CompactMercuryTestSuite::testElement));
+        add(testCase(&CompactMercuryTestSuite::testPrune));
+        add(testCase(&CompactMercuryTestSuite::testDouble));
+        add(testCase(&CompactMercuryTestSuite::testFloat));
+        add(testCase(&CompactMercuryTestSuite::testFractional));
+        add(testCase(&CompactMercuryTestSuite::testPrecision));
+    }
+
+    /** The compounds of the accuracy tests: glucose, a peptide and a
+     * small protein.
+     */
+    std::vector<detail::Stoichiometry> createCompounds()
+    {
+        std::vector<detail::Stoichiometry> compounds;
+        compounds.push_back(test::createCompound(6.0, 12.0, 0.0, 6.0, 0.0));
+        compounds.push_back(test::createCompound(50.0, 80.0, 14.0, 15.0,
+            1.0));
+        compounds.push_back(test::createCompound(500.0, 800.0, 140.0, 150.0,
+            5.0));
+        return compounds;
+    }
+
+    Double getAverageMass(const detail::Stoichiometry& s)
+    {
+        Double mass = 0.0;
+        for (Size i = 0; i < s.size(); ++i) {
+            for (Size u = 0; u < s[i].isotopes.size(); ++u) {
+                mass += s[i].count * s[i].isotopes[u].mz
+                        * s[i].isotopes[u].ab;
+            }
+        }
+        return mass;
+    }
+
+    /** Compares all peaks of \a expected above a fraction of the base peak
+     * to the peak of \a actual at the same nominal mass.
+     */
+    void shouldAgree(const detail::Spectrum& expected,
+        const detail::Spectrum& actual, const Double fraction,
+        const Double abTolerance, const Double mzTolerance)
+    {
+        Double maxAb = 0.0;
+        for (Size k = 0; k < expected.size(); ++k) {
+            maxAb = std::max(maxAb, expected[k].ab);
+        }
+        shouldEqualTolerance(actual[0].mz, expected[0].mz, 1e-12);
+        for (Size k = 0; k < expected.size(); ++k) {
+            if (expected[k].ab < fraction * maxAb) {
+                continue;
+            }
+            Size j = static_cast<Size>(std::floor(expected[k].mz
+                    - actual[0].mz + 0.5));
+            should(j < actual.size());
+            should(std::abs(actual[j].mz - expected[k].mz) <= mzTolerance);
+            shouldEqualTolerance(actual[j].ab, expected[k].ab, abTolerance);
+        }
+    }
+
+    void testElement()
+    {
+        detail::Stoichiometry s = test::createCompound(0.0, 0.0, 0.0, 0.0, 1.0);
+        detail::CompactSpectrum<float> e;
+        detail::compactElement(s[4].isotopes, e);
+        // sulfur has no isotope at nominal mass 35; the placeholder is
+        // skipped
+        shouldEqual(e.origin, 31.97207069);
+        shouldEqual(e.ab.size(), static_cast<Size>(5));
+        shouldEqual(e.ab[3], 0.0f);
+        shouldEqualTolerance(e.ab[4], 0.0002f, 1e-6);
+        shouldEqualTolerance(e.weightedDefect[4] / e.ab[4],
+            static_cast<float>(35.96708088 - 31.97207069 - 4.0), 1e-4);
+        detail::CompactSpectrum<float> e2;
+        detail::compactConvolve(e, e, e2);
+        shouldEqual(e2.origin, 2.0 * 31.97207069);
+        shouldEqual(e2.ab.size(), static_cast<Size>(9));
+        shouldEqualTolerance(e2.ab[0], 0.9493f * 0.9493f, 1e-6);
+        shouldEqualTolerance(e2.ab[2], 2.0f * 0.9493f * 0.0429f + 0.0076f
+                * 0.0076f, 1e-6);
+    }
+
+    void testPrune()
+    {
+        detail::CompactSpectrum<double> s;
+        s.origin = 100.0;
+        Double ab[] = { 1e-9, 0.5, 1e-9, 0.4, 1e-9, 1e-9 };
+        s.ab.assign(ab, ab + 6);
+        s.weightedDefect.assign(6, 0.0);
+        s.weightedDefect[1] = 0.5 * 0.01;
+        detail::compactPrune(s, 1e-6);
+        shouldEqual(s.origin, 101.0);
+        shouldEqual(s.ab.size(), static_cast<Size>(3));
+        shouldEqual(s.ab[0], 0.5);
+        shouldEqual(s.ab[1], 1e-9);
+        shouldEqual(s.weightedDefect[0], 0.5 * 0.01);
+        detail::compactPrune(s, 1.0);
+        shouldEqual(s.ab.size(), static_cast<Size>(0));
+    }
+
+    void testDouble()
+    {
+        // the compact engine in double precision reproduces Mercury7Impl
+        std::vector<detail::Stoichiometry> compounds = createCompounds();
+        detail::Mercury7Impl m;
+        for (Size i = 0; i < compounds.size(); ++i) {
+            detail::Spectrum expected = m(compounds[i], 1e-26);
+            detail::Spectrum actual;
+            detail::compactMercury<double>(compounds[i], 1e-26, actual);
+            shouldAgree(expected, actual, 1e-12, 1e-10, 1e-9);
+        }
+    }
+
+    void testFloat()
+    {
+        // single precision agrees with double precision on all peaks that
+        // matter for pattern matching
+        std::vector<detail::Stoichiometry> compounds = createCompounds();
+        for (Size i = 0; i < compounds.size(); ++i) {
+            detail::Spectrum expected, actual;
+            detail::compactMercury<double>(compounds[i], 1e-26, expected);
+            detail::compactMercury<float>(compounds[i], 1e-26, actual);
+            shouldAgree(expected, actual, 1e-3, 1e-4, 1e-6);
+            // the limit is raised to the range of float
+            should(actual.back().ab >= std::numeric_limits<float>::min());
+            Double sum = 0.0;
+            for (Size k = 0; k < actual.size(); ++k) {
+                sum += actual[k].ab;
+            }
+            // the isotope abundances themselves are rounded to float
+            shouldEqualTolerance(sum, 1.0, 1e-4);
+        }
+    }
+
+    void testFractional()
+    {
+        // C2.5 H6 and an averagine-like compound
+        detail::Stoichiometry compounds[] = {
+                test::createCompound(2.5, 6.0, 0.0, 0.0, 0.0),
+                test::createCompound(49.38, 77.58, 13.58, 14.8, 0.42) };
+        for (Size i = 0; i < 2; ++i) {
+            detail::Spectrum d, f;
+            detail::compactMercury<double>(compounds[i], 1e-26, d);
+            detail::compactMercury<float>(compounds[i], 1e-26, f);
+            shouldAgree(d, f, 1e-3, 1e-4, 1e-6);
+            // the fractional atoms preserve the average mass
+            Double sum = 0.0, mass = 0.0;
+            for (Size k = 0; k < d.size(); ++k) {
+                sum += d[k].ab;
+                mass += d[k].ab * d[k].mz;
+            }
+            shouldEqualTolerance(sum, 1.0, 1e-12);
+            shouldEqualTolerance(mass, getAverageMass(compounds[i]), 1e-12);
+            if (i == 0) {
+                shouldEqualTolerance(d[0].mz, 2.5 * 12.0 + 6.0
+                        * 1.0078250321, 1e-12);
+            }
+        }
+    }
+
+    void testPrecision()
+    {
+        std::vector<detail::Stoichiometry> compounds = createCompounds();
+        detail::Mercury7Impl m, single;
+        shouldEqual(single.getPrecision(), DOUBLE_PRECISION);
+        single.setPrecision(SINGLE_PRECISION);
+        shouldEqual(single.getPrecision(), SINGLE_PRECISION);
+        for (Size i = 0; i < compounds.size(); ++i) {
+            detail::Spectrum expected, actual;
+            detail::compactMercury<float>(compounds[i], 1e-20, expected);
+            actual = single(compounds[i], 1e-20);
+            shouldEqual(actual.size(), expected.size());
+            for (Size k = 0; k < actual.size(); ++k) {
+                shouldEqual(actual[k].mz, expected[k].mz);
+                shouldEqual(actual[k].ab, expected[k].ab);
+            }
+            shouldAgree(m(compounds[i], 1e-20), actual, 1e-3, 1e-4, 1e-6);
+        }
+        // the policy, the output mode and the mass window apply
+        const detail::Stoichiometry& protein = compounds[2];
+        RelativeLimitPrunePolicy relative(1e-3);
+        detail::Spectrum d = single(protein, 1e-20);
+        detail::Spectrum f = single(protein, relative);
+        should(f.size() < d.size());
+        Size offset = static_cast<Size>(std::floor(f[0].mz - d[0].mz + 0.5));
+        should(offset + f.size() <= d.size());
+        for (Size k = 0; k < f.size(); ++k) {
+            shouldEqual(f[k].mz, d[offset + k].mz);
+            shouldEqual(f[k].ab, d[offset + k].ab);
+        }
+        single.setOutputMode(OutputMode::firstN(3));
+        shouldEqual(single(protein, 1e-20).size(), static_cast<Size>(3));
+        single.setOutputMode(OutputMode::topK(2));
+        shouldEqual(single(protein, 1e-20).size(), static_cast<Size>(2));
+        single.setOutputMode(OutputMode());
+        Double mono = d[0].mz;
+        f = single(protein, mono + 1.5, mono + 3.5,
+            AbsoluteLimitPrunePolicy(1e-20));
+        shouldEqual(f.size(), static_cast<Size>(2));
+        shouldEqual(f[0].mz, d[2].mz);
+        // the precision is part of the cache key
+        boost::shared_ptr<MapCache> cache(new MapCache);
+        m.setPatternCache(cache);
+        single.setPatternCache(cache);
+        m(protein, 1e-20);
+        single(protein, 1e-20);
+        shouldEqual(cache->entries.size(), static_cast<Size>(2));
+    }
+};
+
+/** The main function that runs the tests for the compact engine.
+ * Under normal circumstances you need not edit this.
+ */
+int main()
+{
+    CompactMercuryTestSuite test;
+    int success = test.run();
+    std::cout << test.report() << std::endl;
+    return success;
+}
@@ -0,0 +1,248 @@
+/*
+ * ConvolutionKernels-test.cpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/ConvolutionKernels.hpp>
+#include <ipaca/Error.hpp>
+#include <ipaca/Mercury7Impl.hpp>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include "vigra/unittest.hxx"
+
+using namespace ipaca;
+
+/** Tests for the convolution kernels and their calibration.
+ */
+struct ConvolutionKernelsTestSuite : vigra::test_suite
+{
+    /** Constructor.
+     * The ConvolutionKernelsTestSuite constructor adds all ConvolutionKernels
+     * tests to the test suite. If you write an additional test, add the test
+     * case here.
+     */
+    ConvolutionKernelsTestSuite() :
+        vigra::test_suite("ConvolutionKernels")
+    {
+        add(testCase(&ConvolutionKernelsTestSuite::testKernels));
+        add(testCase(&ConvolutionKernelsTestSuite::testSelect));
+        add(testCase(&ConvolutionKernelsTestSuite::testCalibration));
+        add(testCase(&ConvolutionKernelsTestSuite::testStats));
+    }
+
+    detail::Spectrum createSpectrum(const Size n, const Double offset)
+    {
+        detail::Spectrum s(n);
+        for (Size k = 0; k < n; ++k) {
+            s[k].mz = offset + static_cast<Double>(k) + 0.001 * std::sin(
+                static_cast<Double>(k));
+            s[k].ab = (k % 5 == 3) ? 0.0 : 1.0 / static_cast<Double>(k + 1);
+        }
+        return s;
+    }
+
+    void shouldMatch(const detail::Spectrum& a, const detail::Spectrum& b)
+    {
+        shouldEqual(a.size(), b.size());
+        for (Size k = 0; k < a.size(); ++k) {
+            shouldEqualTolerance(a[k].mz, b[k].mz, 1e-12);
+            shouldEqualTolerance(a[k].ab, b[k].ab, 1e-12);
+        }
+    }
+
+    void testKernels()
+    {
+        Size sizes[] = { 1, 2, 5, 17, 40 };
+        for (Size i = 0; i < 5; ++i) {
+            for (Size j = 0; j < 5; ++j) {
+                detail::Spectrum s1 = createSpectrum(sizes[i], 12.0);
+                detail::Spectrum s2 = createSpectrum(sizes[j], 1.0);
+                Size n = s1.size() + s2.size() - 1;
+                Size ranges[][2] = { { 0, n }, { 0, 1 }, { n - 1, n },
+                    { n / 3, n - n / 3 } };
+                for (Size r = 0; r < 4; ++r) {
+                    Size first = ranges[r][0], last = ranges[r][1];
+                    if (first >= last) {
+                        continue;
+                    }
+                    detail::Spectrum direct(last - first);
+                    detail::Spectrum scatter(last - first);
+                    detail::convolveRange(DIRECT_KERNEL, s1, s2, first, last,
+                        &direct[0]);
+                    detail::convolveRange(SCATTER_KERNEL, s1, s2, first, last,
+                        &scatter[0]);
+                    shouldMatch(direct, scatter);
+                    for (Size k = first; k < last; ++k) {
+                        detail::SpectrumElement peak;
+                        detail::calculatePeak(s1, s2, k, peak);
+                        shouldEqual(peak.mz, direct[k - first].mz);
+                        shouldEqual(peak.ab, direct[k - first].ab);
+                    }
+                }
+            }
+            // self-convolutions
+            detail::Spectrum s = createSpectrum(sizes[i], 12.0);
+            Size n = 2 * s.size() - 1;
+            detail::Spectrum square(n), scatter(n), direct(n);
+            detail::convolveRange(SQUARE_KERNEL, s, s, 0, n, &square[0]);
+            detail::convolveRange(SCATTER_KERNEL, s, s, 0, n, &scatter[0]);
+            detail::Spectrum copy(s);
+            detail::convolveRange(DIRECT_KERNEL, s, copy, 0, n, &direct[0]);
+            shouldMatch(direct, square);
+            shouldMatch(direct, scatter);
+        }
+        // squaring needs identical operands
+        detail::Spectrum s1 = createSpectrum(3, 1.0), s2 = createSpectrum(3,
+            1.0);
+        detail::Spectrum r(5);
+        bool thrown = false;
+        try {
+            detail::convolveRange(SQUARE_KERNEL, s1, s2, 0, 5, &r[0]);
+        } catch (PreconditionViolation&) {
+            thrown = true;
+        }
+        shouldEqual(thrown, true);
+    }
+
+    void testSelect()
+    {
+        KernelCalibration c;
+        c.scatterCrossover = 4;
+        c.squareCrossover = 16;
+        shouldEqual(c.select(3, 100, false), SCATTER_KERNEL);
+        shouldEqual(c.select(100, 3, false), SCATTER_KERNEL);
+        shouldEqual(c.select(4, 100, false), DIRECT_KERNEL);
+        shouldEqual(c.select(15, 15, true), SCATTER_KERNEL);
+        shouldEqual(c.select(16, 16, true), SQUARE_KERNEL);
+        shouldEqual(std::string(getKernelName(SCATTER_KERNEL)),
+            std::string("scatter"));
+    }
+
+    void testCalibration()
+    {
+        KernelCalibration m = KernelCalibration::measure();
+        shouldEqual(m.source, KernelCalibration::MEASURED);
+        should(m.scatterCrossover >= 1);
+        // save and load
+        std::ostringstream os;
+        m.save(os);
+        std::istringstream is(os.str());
+        KernelCalibration l = KernelCalibration::load(is);
+        shouldEqual(l.source, KernelCalibration::LOADED);
+        shouldEqual(l.scatterCrossover, m.scatterCrossover);
+        shouldEqual(l.squareCrossover, m.squareCrossover);
+        // malformed profiles
+        const char* broken[] = { "", "something 1\n",
+            "ipaca-kernel-calibration 2\nscatterCrossover 1\nsquareCrossover 1\n",
+            "ipaca-kernel-calibration 1\nscatterCrossover 1\n",
+            "ipaca-kernel-calibration 1\nscatterCrossover x\n" };
+        for (Size k = 0; k < 5; ++k) {
+            std::istringstream bis(broken[k]);
+            bool thrown = false;
+            try {
+                KernelCalibration::load(bis);
+            } catch (RuntimeError&) {
+                thrown = true;
+            }
+            shouldEqual(thrown, true);
+        }
+        bool thrown = false;
+        try {
+            KernelCalibration::load(String("/nonexistent/ipaca.calibration"));
+        } catch (RuntimeError&) {
+            thrown = true;
+        }
+        shouldEqual(thrown, true);
+        // the process-wide calibration is created once
+        should(&KernelCalibration::getDefault()
+                == &KernelCalibration::getDefault());
+    }
+
+    void testStats()
+    {
+        // C100 H200 O50
+        detail::Stoichiometry stoi(3);
+        Double c[][2] = { { 12.0, 0.9893 }, { 13.0033548378, 0.0107 } };
+        Double h[][2] = { { 1.0078250321, 0.999885 }, { 2.0141017780, 0.000115 } };
+        Double o[][2] = { { 15.9949146221, 0.99757 }, { 16.9991315, 0.00038 },
+            { 17.9991604, 0.00205 } };
+        Double (*tables[])[2] = { c, h, o };
+        Size sizes[] = { 2, 2, 3 };
+        Double counts[] = { 100.0, 200.0, 50.0 };
+        for (Size k = 0; k < 3; ++k) {
+            for (Size u = 0; u < sizes[k]; ++u) {
+                detail::Isotope i;
+                i.mz = tables[k][u][0];
+                i.ab = tables[k][u][1];
+                stoi[k].isotopes.push_back(i);
+            }
+            stoi[k].count = counts[k];
+        }
+        detail::Mercury7Impl m;
+        // no closed form, to exercise the chains
+        ErrorBudgetPrunePolicy policy(1e-12);
+        KernelCalibration direct;
+        direct.scatterCrossover = 0;
+        direct.squareCrossover = 0;
+        m.setKernelCalibration(direct);
+        detail::Spectrum s1 = m(stoi, policy);
+        KernelStats stats = m.getKernelStats();
+        should(stats.calls[DIRECT_KERNEL] > 0);
+        should(stats.calls[SQUARE_KERNEL] > 0);
+        shouldEqual(stats.calls[SCATTER_KERNEL], static_cast<Size>(0));
+        should(stats.peaks[SQUARE_KERNEL] > 0.0);
+        shouldEqual(stats.calibration.scatterCrossover, static_cast<Size>(0));
+        // scatter everything
+        m.resetKernelStats();
+        shouldEqual(m.getKernelStats().calls[DIRECT_KERNEL],
+            static_cast<Size>(0));
+        KernelCalibration scatter;
+        scatter.scatterCrossover = 100000;
+        scatter.squareCrossover = 100000;
+        m.setKernelCalibration(scatter);
+        detail::Spectrum s2 = m(stoi, policy);
+        stats = m.getKernelStats();
+        should(stats.calls[SCATTER_KERNEL] > 0);
+        shouldEqual(stats.calls[DIRECT_KERNEL], static_cast<Size>(0));
+        shouldEqual(stats.calls[SQUARE_KERNEL], static_cast<Size>(0));
+        shouldEqual(s1.size(), s2.size());
+        for (Size k = 0; k < s1.size(); ++k) {
+            shouldEqualTolerance(s1[k].mz, s2[k].mz, 1e-12);
+            shouldEqualTolerance(s1[k].ab, s2[k].ab, 1e-10);
+        }
+        // scopes collect the counts of their thread and merge them
+        detail::KernelCounters counters, other;
+        {
+            detail::KernelCountersScope outer(counters);
+            counters.record(DIRECT_KERNEL, 3);
+            {
+                detail::KernelCountersScope inner(counters);
+                counters.record(SCATTER_KERNEL, 5);
+                other.record(DIRECT_KERNEL, 7);
+                shouldEqual(other.get().calls[DIRECT_KERNEL],
+                    static_cast<Size>(1));
+            }
+            shouldEqual(counters.get().calls[SCATTER_KERNEL],
+                static_cast<Size>(1));
+            shouldEqual(counters.get().calls[DIRECT_KERNEL],
+                static_cast<Size>(0));
+        }
+        stats = counters.get();
+        shouldEqual(stats.calls[DIRECT_KERNEL], static_cast<Size>(1));
+        shouldEqual(stats.peaks[DIRECT_KERNEL], 3.0);
+        shouldEqual(stats.peaks[SCATTER_KERNEL], 5.0);
+    }
+};
+
+/** The main function that runs the tests for the convolution kernels.
+ * Under normal circumstances you need not edit this.
+ */
+int main()
+{
+    ConvolutionKernelsTestSuite test;
+    int success = test.run();
+    std::cout << test.report() << std::endl;
+    return success;
+}
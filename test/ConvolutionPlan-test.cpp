@@ -0,0 +1,227 @@
+/*
+ * ConvolutionPlan-test.cpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/ConvolutionPlan.hpp>
+#include <ipaca/PrunePolicy.hpp>
+// expose the class
+#define private public
+#define protected public
+#include <ipaca/Mercury7Impl.hpp>
+#undef private
+#undef protected
+#include <cmath>
+#include <iostream>
+#include "vigra/unittest.hxx"
+
+using namespace ipaca;
+
+/** Tests for the convolution planner in ConvolutionPlan.cpp.
+ */
+struct ConvolutionPlanTestSuite : vigra::test_suite
+{
+    /** Constructor.
+     * The ConvolutionPlanTestSuite constructor adds all ConvolutionPlan tests
+     * to the test suite. If you write an additional test, add the test
+     * case here.
+     */
+    ConvolutionPlanTestSuite() :
+        vigra::test_suite("ConvolutionPlan")
+    {
+        add(testCase(&ConvolutionPlanTestSuite::testChains));
+        add(testCase(&ConvolutionPlanTestSuite::testPruneWeight));
+        add(testCase(&ConvolutionPlanTestSuite::testPlanner));
+        add(testCase(&ConvolutionPlanTestSuite::testMercury));
+    }
+
+    /** Evaluate the exponent an addition chain produces.
+     */
+    Size evaluate(const detail::AdditionChain& chain)
+    {
+        std::vector<Size> exponent(chain.size() + 1);
+        exponent[0] = 1;
+        for (Size k = 0; k < chain.size(); ++k) {
+            should(chain[k].lhs <= k);
+            should(chain[k].rhs <= k);
+            exponent[k + 1] = exponent[chain[k].lhs] + exponent[chain[k].rhs];
+        }
+        return exponent.back();
+    }
+
+    detail::Stoichiometry createStoichiometry()
+    {
+        // C254 H377 N65 O75 S6
+        detail::Stoichiometry s;
+        detail::Element e;
+        detail::Isotope i;
+        Double c[][2] = { { 12.0, 0.9893 }, { 13.0033548378, 0.0107 } };
+        Double h[][2] = { { 1.0078250321, 0.999885 }, { 2.0141017780, 0.000115 } };
+        Double n[][2] = { { 14.0030740052, 0.99632 }, { 15.0001088984, 0.00368 } };
+        Double o[][2] = { { 15.9949146221, 0.99757 }, { 16.9991315, 0.00038 },
+            { 17.9991604, 0.00205 } };
+        Double su[][2] = { { 31.97207069, 0.9493 }, { 32.97145850, 0.0076 },
+            { 33.96786683, 0.0429 }, { 34.0, 0.0 }, { 35.96708088, 0.0002 } };
+        Double counts[] = { 254.0, 377.0, 65.0, 75.0, 6.0 };
+        Double (*tables[])[2] = { c, h, n, o, su };
+        Size sizes[] = { 2, 2, 2, 3, 5 };
+        for (Size k = 0; k < 5; ++k) {
+            e.isotopes.clear();
+            for (Size u = 0; u < sizes[k]; ++u) {
+                i.mz = tables[k][u][0];
+                i.ab = tables[k][u][1];
+                e.isotopes.push_back(i);
+            }
+            e.count = counts[k];
+            s.push_back(e);
+        }
+        return s;
+    }
+
+    void testChains()
+    {
+        detail::AdditionChain chain;
+        for (Size n = 1; n < 600; ++n) {
+            detail::binaryChain(n, chain);
+            shouldEqual(evaluate(chain), n);
+            for (Size w = 1; w <= 4; ++w) {
+                detail::slidingWindowChain(n, w, chain);
+                shouldEqual(evaluate(chain), n);
+            }
+        }
+        // 15 = 1111b: window 4 needs E^2, E^3, ..., E^15
+        detail::slidingWindowChain(15, 4, chain);
+        shouldEqual(chain.size(), static_cast<Size>(8));
+        // the left-to-right binary method squares the partial result
+        detail::slidingWindowChain(8, 1, chain);
+        shouldEqual(chain.size(), static_cast<Size>(3));
+        for (Size k = 0; k < chain.size(); ++k) {
+            shouldEqual(chain[k].lhs, chain[k].rhs);
+        }
+    }
+
+    void testPruneWeight()
+    {
+        detail::AdditionChain chain;
+        shouldEqual(detail::getChainPruneWeight(chain), 1.0);
+        // E^2 = E (x) E; E^4 = E^2 (x) E^2
+        detail::binaryChain(4, chain);
+        shouldEqual(chain.size(), static_cast<Size>(2));
+        shouldEqual(detail::getChainPruneWeight(chain), 3.0);
+        // E^3 = E^2 (x) E
+        detail::binaryChain(3, chain);
+        shouldEqual(detail::getChainPruneWeight(chain), 2.0);
+    }
+
+    void testPlanner()
+    {
+        detail::Stoichiometry s = createStoichiometry();
+        detail::ConvolutionPlanner planner;
+        shouldEqual(planner.size(), static_cast<Size>(0));
+        boost::shared_ptr<const detail::ConvolutionPlan> p1 = planner.getPlan(s,
+            1e-26, false, 1000);
+        // one cached plan per element power
+        shouldEqual(planner.size(), static_cast<Size>(5));
+        shouldEqual(p1->elements.size(), static_cast<Size>(5));
+        shouldEqual(p1->merges.size(), static_cast<Size>(4));
+        should(p1->cost > 0.0);
+        for (Size k = 0; k < p1->elements.size(); ++k) {
+            const detail::ElementPlan& ep = p1->elements[k];
+            should(!ep.closedForm);
+            shouldEqual(evaluate(ep.chain),
+                static_cast<Size>(s[ep.element].count));
+        }
+        // the merge steps combine every result exactly once
+        std::vector<Size> used(p1->elements.size() + p1->merges.size(), 0);
+        for (Size k = 0; k < p1->merges.size(); ++k) {
+            should(p1->merges[k].lhs < p1->elements.size() + k);
+            should(p1->merges[k].rhs < p1->elements.size() + k);
+            ++used[p1->merges[k].lhs];
+            ++used[p1->merges[k].rhs];
+        }
+        for (Size k = 0; k + 1 < used.size(); ++k) {
+            shouldEqual(used[k], static_cast<Size>(1));
+        }
+        shouldEqual(used.back(), static_cast<Size>(0));
+        // masses do not matter
+        s[0].isotopes[0].mz += 1.0;
+        boost::shared_ptr<const detail::ConvolutionPlan> p2 = planner.getPlan(s,
+            1e-26, false, 1000);
+        shouldEqual(planner.size(), static_cast<Size>(5));
+        shouldEqual(p2->cost, p1->cost);
+        // counts do, but only for the element that changes
+        s[0].count += 1.0;
+        p2 = planner.getPlan(s, 1e-26, false, 1000);
+        shouldEqual(planner.size(), static_cast<Size>(6));
+        // other compositions share the element plans
+        detail::Stoichiometry t(s.begin() + 1, s.end());
+        p2 = planner.getPlan(t, 1e-26, false, 1000);
+        shouldEqual(planner.size(), static_cast<Size>(6));
+        shouldEqual(p2->elements.size(), static_cast<Size>(4));
+        shouldEqual(p2->merges.size(), static_cast<Size>(3));
+        // the cache does not change the plans
+        detail::ConvolutionPlan p3 = planner.createPlan(s, 1e-26, false, 1000);
+        p2 = planner.getPlan(s, 1e-26, false, 1000);
+        shouldEqual(p2->cost, p3.cost);
+        shouldEqual(p2->pruneWeight, p3.pruneWeight);
+        shouldEqual(p2->merges.size(), p3.merges.size());
+        for (Size k = 0; k < p3.elements.size(); ++k) {
+            shouldEqual(p2->elements[k].chain.size(),
+                p3.elements[k].chain.size());
+        }
+        // closed form elements; sulfur has too many isotopes
+        p2 = planner.getPlan(s, 1e-26, true, 1000);
+        for (Size k = 0; k < p2->elements.size(); ++k) {
+            shouldEqual(p2->elements[k].closedForm, p2->elements[k].element != 4);
+        }
+        planner.clear();
+        shouldEqual(planner.size(), static_cast<Size>(0));
+        // capacity: the least recently used element plans are evicted
+        detail::ConvolutionPlanner small(6);
+        small.getPlan(s, 1e-26, false, 1000);
+        shouldEqual(small.size(), static_cast<Size>(5));
+        for (Size k = 0; k < 5; ++k) {
+            s[0].count += 1.0;
+            small.getPlan(s, 1e-26, false, 1000);
+            shouldEqual(small.size(), static_cast<Size>(6));
+        }
+        // the other elements have been used all along
+        small.getPlan(t, 1e-26, false, 1000);
+        shouldEqual(small.size(), static_cast<Size>(6));
+    }
+
+    void testMercury()
+    {
+        // planned evaluation against exact repeated squaring
+        detail::Stoichiometry s = createStoichiometry();
+        detail::Mercury7Impl m;
+        detail::Spectrum exact = m(s, ErrorBudgetPrunePolicy(0.0));
+        m.prune(exact, 1e-26);
+        detail::Spectrum planned = m(s, 1e-26);
+        shouldEqual(planned.size(), exact.size());
+        for (Size k = 0; k < planned.size(); ++k) {
+            if (exact[k].ab > 1e-20) {
+                shouldEqualTolerance(planned[k].mz, exact[k].mz, 1e-9);
+            }
+            should(std::fabs(planned[k].ab - exact[k].ab) < 1e-9 * exact[k].ab
+                    + 1e-25);
+        }
+        // the element plans are reused
+        Size cached = m.planner_->size();
+        should(cached > 0);
+        m(s, 1e-26);
+        shouldEqual(m.planner_->size(), cached);
+    }
+};
+
+/** The main function that runs the tests for the convolution planner.
+ * Under normal circumstances you need not edit this.
+ */
+int main()
+{
+    ConvolutionPlanTestSuite test;
+    int success = test.run();
+    std::cout << test.report() << std::endl;
+    return success;
+}
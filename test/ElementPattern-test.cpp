@@ -0,0 +1,187 @@
+/*
+ * ElementPattern-test.cpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/ConvolutionPlan.hpp>
+#include <ipaca/ElementPattern.hpp>
+#include <ipaca/PrunePolicy.hpp>
+// expose the class
+#define private public
+#define protected public
+#include <ipaca/Mercury7Impl.hpp>
+#undef private
+#undef protected
+#include <cmath>
+#include <iostream>
+#include "vigra/unittest.hxx"
+
+using namespace ipaca;
+
+/** Tests for the closed form element patterns in ElementPattern.cpp.
+ */
+struct ElementPatternTestSuite : vigra::test_suite
+{
+    /** Constructor.
+     * The ElementPatternTestSuite constructor adds all ElementPattern tests
+     * to the test suite. If you write an additional test, add the test
+     * case here.
+     */
+    ElementPatternTestSuite() :
+        vigra::test_suite("ElementPattern")
+    {
+        add(testCase(&ElementPatternTestSuite::testBinomialTerms));
+        add(testCase(&ElementPatternTestSuite::testClosedFormPattern));
+        add(testCase(&ElementPatternTestSuite::testMercury));
+    }
+
+    detail::Isotopes createIsotopes(const Double* masses, const Double* freqs,
+        const Size n)
+    {
+        detail::Isotopes isotopes;
+        detail::Isotope i;
+        for (Size k = 0; k < n; ++k) {
+            i.mz = masses[k];
+            i.ab = freqs[k];
+            isotopes.push_back(i);
+        }
+        return isotopes;
+    }
+
+    void testBinomialTerms()
+    {
+        Size first;
+        std::vector<Double> probs;
+        // B(4, 0.5) = [ 1 4 6 4 1 ] / 16
+        detail::binomialTerms(4, 0.5, 0.0, first, probs);
+        shouldEqual(first, static_cast<Size>(0));
+        shouldEqual(probs.size(), static_cast<Size>(5));
+        Double expected[] = { 0.0625, 0.25, 0.375, 0.25, 0.0625 };
+        for (Size k = 0; k < 5; ++k) {
+            shouldEqualTolerance(probs[k], expected[k], 1e-12);
+        }
+        // only the terms above the threshold
+        detail::binomialTerms(4, 0.5, 0.1, first, probs);
+        shouldEqual(first, static_cast<Size>(1));
+        shouldEqual(probs.size(), static_cast<Size>(3));
+        // degenerate cases
+        detail::binomialTerms(10, 0.0, 0.0, first, probs);
+        shouldEqual(first, static_cast<Size>(0));
+        shouldEqual(probs.size(), static_cast<Size>(1));
+        detail::binomialTerms(10, 1.0, 0.0, first, probs);
+        shouldEqual(first, static_cast<Size>(10));
+        shouldEqual(probs.size(), static_cast<Size>(1));
+        // against the explicit formula
+        Size n = 1000;
+        Double p = 0.0107;
+        detail::binomialTerms(n, p, 1e-30, first, probs);
+        for (Size i = 0; i < probs.size(); ++i) {
+            Double k = static_cast<Double>(first + i);
+            Double expect = std::exp(lgamma(1001.0) - lgamma(k + 1.0)
+                    - lgamma(1001.0 - k) + k * std::log(p) + (1000.0 - k)
+                    * std::log(1.0 - p));
+            shouldEqualTolerance(probs[i], expect, 1e-9);
+        }
+    }
+
+    void testClosedFormPattern()
+    {
+        // two identical isotopes, two atoms
+        Double masses[] = { 1.0, 2.0, 3.0, 4.0 };
+        Double freqs[] = { 0.5, 0.5 };
+        detail::Isotopes iso = createIsotopes(masses, freqs, 2);
+        detail::Spectrum s;
+        detail::closedFormPattern(iso, 2, 0.0, s);
+        shouldEqual(s.size(), static_cast<Size>(3));
+        Double expectedMasses[] = { 2.0, 3.0, 4.0 };
+        Double expectedAbundances[] = { 0.25, 0.5, 0.25 };
+        for (Size k = 0; k < 3; ++k) {
+            shouldEqualTolerance(s[k].mz, expectedMasses[k], 1e-12);
+            shouldEqualTolerance(s[k].ab, expectedAbundances[k], 1e-12);
+        }
+        // a single isotope
+        detail::closedFormPattern(createIsotopes(masses, freqs, 1), 1000,
+            0.0, s);
+        shouldEqual(s.size(), static_cast<Size>(1));
+        shouldEqualTolerance(s[0].mz, 1000.0, 1e-12);
+        shouldEqualTolerance(s[0].ab, std::pow(0.5, 1000.0), 1e-12);
+        // four isotopes are not supported
+        should(!detail::hasClosedFormPattern(createIsotopes(masses, freqs, 4)));
+        bool thrown = false;
+        try {
+            detail::closedFormPattern(createIsotopes(masses, freqs, 4), 2,
+                0.0, s);
+        } catch (PreconditionViolation&) {
+            thrown = true;
+        }
+        shouldEqual(thrown, true);
+    }
+
+    void testMercury()
+    {
+        // compare against exact repeated squaring
+        Double massesC[] = { 12.0, 13.0033548378 };
+        Double freqsC[] = { 0.9893, 0.0107 };
+        Double massesO[] = { 15.9949146221, 16.9991315, 17.9991604 };
+        Double freqsO[] = { 0.99757, 0.00038, 0.00205 };
+        Double massesCl[] = { 34.96885268, 35.96885268, 36.96590259 };
+        Double freqsCl[] = { 0.7576, 0.0, 0.2424 };
+        detail::Isotopes elements[] = { createIsotopes(massesC, freqsC, 2),
+            createIsotopes(massesO, freqsO, 3), createIsotopes(massesCl,
+                freqsCl, 3) };
+        Size counts[] = { 2, 17, 523, 4000 };
+        detail::Mercury7Impl m;
+        for (Size e = 0; e < 3; ++e) {
+            for (Size c = 0; c < 4; ++c) {
+                detail::Stoichiometry stoi(1);
+                stoi[0].isotopes = elements[e];
+                stoi[0].count = static_cast<Double>(counts[c]);
+                detail::Spectrum exact = m(stoi, ErrorBudgetPrunePolicy(0.0));
+                detail::Spectrum closed;
+                detail::closedFormPattern(elements[e], counts[c], 1e-30
+                        / static_cast<Double>(counts[c] + 1), closed);
+                // align at the monoisotopic peak
+                Size offset = 0;
+                while (offset < exact.size() && std::fabs(exact[offset].mz
+                        - closed[0].mz) > 0.5) {
+                    ++offset;
+                }
+                should(offset < exact.size());
+                for (Size k = 0; k < closed.size(); ++k) {
+                    if (exact[offset + k].ab > 1e-20) {
+                        shouldEqualTolerance(closed[k].mz,
+                            exact[offset + k].mz, 1e-9);
+                        shouldEqualTolerance(closed[k].ab,
+                            exact[offset + k].ab, 1e-9);
+                    }
+                }
+                // the default path uses the closed form
+                detail::Spectrum pruned = m(stoi);
+                detail::Spectrum expected(exact);
+                m.prune(expected, 1e-26);
+                shouldEqual(pruned.size(), expected.size());
+                // peaks are exact up to the limit
+                for (Size k = 0; k < pruned.size(); ++k) {
+                    if (expected[k].ab > 1e-20) {
+                        shouldEqualTolerance(pruned[k].mz, expected[k].mz,
+                            1e-9);
+                    }
+                    should(std::fabs(pruned[k].ab - expected[k].ab) < 1e-9
+                            * expected[k].ab + 1e-26);
+                }
+            }
+        }
+    }
+};
+
+/** The main function that runs the tests for the element patterns.
+ * Under normal circumstances you need not edit this.
+ */
+int main()
+{
+    ElementPatternTestSuite test;
+    int success = test.run();
+    std::cout << test.report() << std::endl;
+    return success;
+}
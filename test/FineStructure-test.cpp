@@ -0,0 +1,177 @@
+/*
+ * FineStructure-test.cpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/FineStructure.hpp>
+#include <ipaca/Error.hpp>
+#include <ipaca/Mercury7Impl.hpp>
+#include <ipaca/PrunePolicy.hpp>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <vector>
+#include "TestElements.hpp"
+#include "vigra/unittest.hxx"
+
+using namespace ipaca;
+
+/** Tests for the fine structure calculation in FineStructure.cpp.
+ */
+struct FineStructureTestSuite : vigra::test_suite
+{
+    /** Constructor.
+     * The FineStructureTestSuite constructor adds all FineStructure tests
+     * to the test suite. If you write an additional test, add the test
+     * case here.
+     */
+    FineStructureTestSuite() :
+        vigra::test_suite("FineStructure")
+    {
+        add(testCase(&FineStructureTestSuite::testBinomial));
+        add(testCase(&FineStructureTestSuite::testCoverage));
+        add(testCase(&FineStructureTestSuite::testOrder));
+        add(testCase(&FineStructureTestSuite::testNominal));
+    }
+
+    /** The abundances in order of decreasing probability.
+     */
+    std::vector<Double> getAbundances(const detail::Spectrum& s)
+    {
+        std::vector<Double> ab;
+        for (Size k = 0; k < s.size(); ++k) {
+            ab.push_back(s[k].ab);
+        }
+        std::sort(ab.begin(), ab.end(), std::greater<Double>());
+        return ab;
+    }
+
+    void testBinomial()
+    {
+        // C100 has 101 isotopologues with binomial probabilities
+        detail::Stoichiometry c100 = test::createCompound(100.0, 0.0, 0.0);
+        detail::Spectrum s;
+        Double covered = detail::fineStructure(c100, 1.0, s);
+        shouldEqual(s.size(), static_cast<Size>(101));
+        shouldEqualTolerance(covered, 1.0, 1e-12);
+        for (Size k = 0; k < s.size(); ++k) {
+            Double kk = static_cast<Double>(k);
+            Double lp = lgamma(101.0) - lgamma(kk + 1.0) - lgamma(101.0
+                    - kk) + kk * std::log(0.0107) + (100.0 - kk) * std::log(
+                0.9893);
+            shouldEqualTolerance(s[k].ab, std::exp(lp), 1e-10);
+            shouldEqualTolerance(s[k].mz, 1200.0 + kk * 1.0033548378, 1e-9);
+        }
+        // the mode is the configuration with a single 13C, not the
+        // monoisotopic one
+        std::vector<Double> ab = getAbundances(s);
+        should(s[1].ab > s[0].ab);
+        shouldEqual(ab[0], s[1].ab);
+    }
+
+    void testCoverage()
+    {
+        detail::Stoichiometry s = test::createCompound(60.0, 98.0, 20.0);
+        detail::Spectrum fine;
+        Double targets[] = { 0.5, 0.9, 0.99, 0.9999 };
+        Size previous = 0;
+        for (Size t = 0; t < 4; ++t) {
+            Double covered = detail::fineStructure(s, targets[t], fine);
+            Double sum = 0.0, smallest = 1.0;
+            for (Size k = 0; k < fine.size(); ++k) {
+                sum += fine[k].ab;
+                smallest = std::min(smallest, fine[k].ab);
+                if (k > 0) {
+                    should(fine[k - 1].mz <= fine[k].mz);
+                }
+            }
+            shouldEqualTolerance(covered, sum, 1e-12);
+            // the coverage is reached, and not much more than needed
+            should(covered >= targets[t]);
+            should(covered - smallest < targets[t]);
+            should(fine.size() > previous);
+            previous = fine.size();
+        }
+        // the number of isotopologues may be limited
+        Double covered = detail::fineStructure(s, 0.9999, fine, 5);
+        shouldEqual(fine.size(), static_cast<Size>(5));
+        should(covered < 0.9999);
+        // degenerate input
+        detail::Stoichiometry empty;
+        shouldEqual(detail::fineStructure(empty, 0.9, fine), 0.0);
+        shouldEqual(fine.size(), static_cast<Size>(0));
+        bool thrown = false;
+        try {
+            detail::fineStructure(s, 0.0, fine);
+        } catch (PreconditionViolation&) {
+            thrown = true;
+        }
+        shouldEqual(thrown, true);
+    }
+
+    void testOrder()
+    {
+        // partial results hold the most probable isotopologues
+        detail::Stoichiometry s = test::createCompound(6.0, 12.0, 6.0);
+        detail::Spectrum all, part;
+        detail::fineStructure(s, 1.0, all);
+        // 7 carbon, 13 hydrogen and 28 oxygen configurations
+        shouldEqual(all.size(), static_cast<Size>(7 * 13 * 28));
+        std::vector<Double> expected = getAbundances(all);
+        detail::fineStructure(s, 0.999, part);
+        std::vector<Double> actual = getAbundances(part);
+        should(actual.size() < expected.size());
+        for (Size k = 0; k < actual.size(); ++k) {
+            shouldEqualTolerance(actual[k], expected[k], 1e-12);
+        }
+    }
+
+    /** Sum the isotopologues per nominal isotope index and compare against
+     * the nominal (or coarsely binned) calculation.
+     */
+    void shouldMatchNominal(const detail::Stoichiometry& s,
+        const Double resolution = 0.0)
+    {
+        detail::Mercury7Impl m;
+        m.setMassResolution(resolution);
+        detail::Spectrum nominal = m(s, ErrorBudgetPrunePolicy(0.0));
+        detail::Spectrum fine;
+        detail::fineStructure(s, 1.0, fine);
+        Double mono = m.getMonoisotopicMass(s);
+        detail::Spectrum binned(nominal.size());
+        for (Size k = 0; k < fine.size(); ++k) {
+            Size index = static_cast<Size>(std::floor(fine[k].mz - mono
+                    + 0.5));
+            shouldEqual(index < binned.size(), true);
+            binned[index].mz += fine[k].mz * fine[k].ab;
+            binned[index].ab += fine[k].ab;
+        }
+        for (Size k = 0; k < nominal.size(); ++k) {
+            shouldEqualTolerance(binned[k].ab, nominal[k].ab, 1e-9);
+            if (nominal[k].ab > 1e-10) {
+                shouldEqualTolerance(binned[k].mz / binned[k].ab,
+                    nominal[k].mz, 1e-8);
+            }
+        }
+    }
+
+    void testNominal()
+    {
+        shouldMatchNominal(test::createCompound(6.0, 12.0, 6.0));
+        // fractional atoms; the binned mode merges each nominal cluster
+        shouldMatchNominal(test::createCompound(2.5, 5.25, 1.0), 500.0);
+    }
+};
+
+/** The main function that runs the tests for the fine structure
+ * calculation. Under normal circumstances you need not edit this.
+ */
+int main()
+{
+    FineStructureTestSuite test;
+    int success = test.run();
+    std::cout << test.report() << std::endl;
+    return success;
+}
@@ -0,0 +1,187 @@
+/*
+ * MassCalculator-test.cpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/MassCalculator.hpp>
+#include <ipaca/Mercury7Impl.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "vigra/unittest.hxx"
+
+using namespace ipaca;
+
+/** Tests for the batch mass calculator in MassCalculator.cpp.
+ */
+struct MassCalculatorTestSuite : vigra::test_suite
+{
+    /** Constructor.
+     * The MassCalculatorTestSuite constructor adds all MassCalculator tests
+     * to the test suite. If you write an additional test, add the test
+     * case here.
+     */
+    MassCalculatorTestSuite() :
+        vigra::test_suite("MassCalculator")
+    {
+        add(testCase(&MassCalculatorTestSuite::testElements));
+        add(testCase(&MassCalculatorTestSuite::testBatch));
+        add(testCase(&MassCalculatorTestSuite::testStride));
+    }
+
+    /** Create the elements C, H, N, O, S.
+     */
+    detail::Stoichiometry createElements()
+    {
+        Double tc[][2] = { { 12.0, 0.9893 }, { 13.0033548378, 0.0107 } };
+        Double th[][2] = { { 1.0078250321, 0.999885 }, { 2.0141017780, 0.000115 } };
+        Double tn[][2] = { { 14.0030740052, 0.99632 }, { 15.0001088984, 0.00368 } };
+        Double to[][2] = { { 15.9949146221, 0.99757 }, { 16.9991315, 0.00038 },
+            { 17.9991604, 0.00205 } };
+        Double ts[][2] = { { 31.97207069, 0.9493 }, { 32.97145850, 0.0076 },
+            { 33.96786683, 0.0429 }, { 34.0, 0.0 }, { 35.96708088, 0.0002 } };
+        Double (*tables[])[2] = { tc, th, tn, to, ts };
+        Size sizes[] = { 2, 2, 2, 3, 5 };
+        detail::Stoichiometry stoi;
+        for (Size k = 0; k < 5; ++k) {
+            detail::Element e;
+            for (Size u = 0; u < sizes[k]; ++u) {
+                detail::Isotope i;
+                i.mz = tables[k][u][0];
+                i.ab = tables[k][u][1];
+                e.isotopes.push_back(i);
+            }
+            e.count = 1.0;
+            stoi.push_back(e);
+        }
+        return stoi;
+    }
+
+    /** Create a random composition matrix with \a n compounds.
+     */
+    std::vector<Double> createCounts(const Size nElements, const Size n,
+        const Size stride)
+    {
+        std::vector<Double> counts(nElements * stride, -1.0);
+        for (Size e = 0; e < nElements; ++e) {
+            for (Size c = 0; c < n; ++c) {
+                counts[e * stride + c] = static_cast<Double>(rand() % 500);
+                if (c % 7 == 3) {
+                    counts[e * stride + c] += 0.25;
+                }
+            }
+        }
+        return counts;
+    }
+
+    void testElements()
+    {
+        detail::Stoichiometry elements = createElements();
+        MassCalculator calc;
+        shouldEqual(calc.size(), static_cast<Size>(0));
+        for (Size e = 0; e < elements.size(); ++e) {
+            shouldEqual(calc.addElement(elements[e]), e);
+        }
+        shouldEqual(calc.size(), elements.size());
+        shouldEqual(calc.getMonoisotopicMass(0), 12.0);
+        shouldEqualTolerance(calc.getAverageMass(0), 12.0 * 0.9893
+                + 13.0033548378 * 0.0107, 1e-12);
+        shouldEqual(calc.addElement(1.0, 2.0), static_cast<Size>(5));
+        shouldEqual(calc.getAverageMass(5), 2.0);
+        bool thrown = false;
+        try {
+            calc.getMonoisotopicMass(6);
+        } catch (PreconditionViolation&) {
+            thrown = true;
+        }
+        shouldEqual(thrown, true);
+        // the average mass of a stoichiometry accounts for the counts
+        detail::Mercury7Impl m;
+        detail::Stoichiometry c2;
+        c2.push_back(elements[0]);
+        c2[0].count = 2.0;
+        shouldEqualTolerance(m.getAverageMass(c2), 2.0
+                * calc.getAverageMass(0), 1e-12);
+    }
+
+    void testBatch()
+    {
+        detail::Stoichiometry elements = createElements();
+        MassCalculator calc;
+        for (Size e = 0; e < elements.size(); ++e) {
+            calc.addElement(elements[e]);
+        }
+        // cover full blocks and a remainder
+        const Size n = 1003;
+        std::vector<Double> counts = createCounts(elements.size(), n, n);
+        std::vector<Double> mono(n), average(n);
+        calc(&counts[0], n, &mono[0], &average[0]);
+        detail::Mercury7Impl m;
+        for (Size c = 0; c < n; ++c) {
+            detail::Stoichiometry s = elements;
+            for (Size e = 0; e < s.size(); ++e) {
+                s[e].count = counts[e * n + c];
+            }
+            shouldEqualTolerance(mono[c], m.getMonoisotopicMass(s), 1e-9);
+            shouldEqualTolerance(average[c], m.getAverageMass(s), 1e-9);
+        }
+        // either output may be omitted
+        std::vector<Double> mono2(n, 0.0);
+        calc(&counts[0], n, &mono2[0], 0);
+        for (Size c = 0; c < n; ++c) {
+            shouldEqual(mono2[c], mono[c]);
+        }
+        std::vector<Double> average2(n, 0.0);
+        calc(&counts[0], n, 0, &average2[0]);
+        for (Size c = 0; c < n; ++c) {
+            shouldEqual(average2[c], average[c]);
+        }
+    }
+
+    void testStride()
+    {
+        detail::Stoichiometry elements = createElements();
+        MassCalculator calc;
+        for (Size e = 0; e < elements.size(); ++e) {
+            calc.addElement(elements[e]);
+        }
+        const Size n = 37, stride = 41;
+        std::vector<Double> counts = createCounts(elements.size(), n, stride);
+        std::vector<Double> mono(n + 1, -1.0), average(n, 0.0);
+        calc(&counts[0], n, stride, &mono[0], &average[0]);
+        for (Size c = 0; c < n; ++c) {
+            Double expected = 0.0;
+            for (Size e = 0; e < elements.size(); ++e) {
+                expected += counts[e * stride + c]
+                        * calc.getMonoisotopicMass(e);
+            }
+            shouldEqualTolerance(mono[c], expected, 1e-12);
+        }
+        // nothing is written past the last compound
+        shouldEqual(mono[n], -1.0);
+        // an empty table yields zero masses
+        MassCalculator empty;
+        empty(0, n, &mono[0], 0);
+        shouldEqual(mono[0], 0.0);
+        shouldEqual(mono[n - 1], 0.0);
+        bool thrown = false;
+        try {
+            calc(&counts[0], n, n - 1, &mono[0], 0);
+        } catch (PreconditionViolation&) {
+            thrown = true;
+        }
+        shouldEqual(thrown, true);
+    }
+};
+
+/** The main function that runs the tests for the batch mass calculator.
+ * Under normal circumstances you need not edit this.
+ */
+int main()
+{
+    MassCalculatorTestSuite test;
+    int success = test.run();
+    std::cout << test.report() << std::endl;
+    return success;
+}
@@ -0,0 +1,189 @@
+/*
+ * MemoryResource-test.cpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/MemoryResource.hpp>
+#include <ipaca/Mercury7Impl.hpp>
+#include <iostream>
+#include <vector>
+#include "TestElements.hpp"
+#include "vigra/unittest.hxx"
+
+using namespace ipaca;
+
+/** A heap-backed memory resource that counts its blocks.
+ */
+class CountingResource : public MemoryResource
+{
+public:
+    CountingResource() :
+        allocations(0), outstanding(0)
+    {
+    }
+
+    void* allocate(const Size bytes)
+    {
+        ++allocations;
+        ++outstanding;
+        return ::operator new(bytes);
+    }
+
+    void deallocate(void* p, const Size)
+    {
+        --outstanding;
+        ::operator delete(p);
+    }
+
+    Size allocations, outstanding;
+};
+
+/** Tests for the memory resources in MemoryResource.cpp.
+ */
+struct MemoryResourceTestSuite : vigra::test_suite
+{
+    /** Constructor.
+     * The MemoryResourceTestSuite constructor adds all MemoryResource tests
+     * to the test suite. If you write an additional test, add the test
+     * case here.
+     */
+    MemoryResourceTestSuite() :
+        vigra::test_suite("MemoryResource")
+    {
+        add(testCase(&MemoryResourceTestSuite::testArena));
+        add(testCase(&MemoryResourceTestSuite::testScope));
+        add(testCase(&MemoryResourceTestSuite::testContainers));
+        add(testCase(&MemoryResourceTestSuite::testMercury));
+    }
+
+    void testArena()
+    {
+        MonotonicArena arena(1024);
+        shouldEqual(arena.getCapacity(), static_cast<Size>(0));
+        void* p = arena.allocate(10);
+        should(p != 0);
+        shouldEqual(reinterpret_cast<std::size_t>(p) % 16,
+            static_cast<std::size_t>(0));
+        shouldEqual(arena.getAllocated(), static_cast<Size>(16));
+        // the most recent block is given back ...
+        arena.deallocate(p, 10);
+        shouldEqual(arena.getAllocated(), static_cast<Size>(0));
+        shouldEqual(arena.allocate(16), p);
+        // ... older ones are not
+        void* q = arena.allocate(32);
+        arena.deallocate(p, 16);
+        should(arena.allocate(16) != p);
+        arena.deallocate(q, 32);
+        // large blocks get a chunk of their own
+        should(arena.allocate(5000) != 0);
+        shouldEqual(arena.getCapacity(), static_cast<Size>(1024 + 5000
+                + 8));
+        // a reset coalesces the chunks
+        arena.reset();
+        shouldEqual(arena.getAllocated(), static_cast<Size>(0));
+        shouldEqual(arena.getCapacity(), static_cast<Size>(1024 + 5000
+                + 8));
+        p = arena.allocate(4000);
+        q = arena.allocate(2000);
+        shouldEqual(static_cast<char*>(q) - static_cast<char*>(p),
+            static_cast<std::ptrdiff_t>(4000));
+        shouldEqual(arena.getCapacity(), static_cast<Size>(1024 + 5000
+                + 8));
+    }
+
+    void testScope()
+    {
+        should(getMemoryResource() == 0);
+        MonotonicArena a, b;
+        {
+            MemoryResourceScope sa(&a);
+            should(getMemoryResource() == &a);
+            {
+                MemoryResourceScope sb(&b);
+                should(getMemoryResource() == &b);
+                {
+                    MemoryResourceScope heap(0);
+                    should(getMemoryResource() == 0);
+                }
+                should(getMemoryResource() == &b);
+            }
+            should(getMemoryResource() == &a);
+        }
+        should(getMemoryResource() == 0);
+    }
+
+    void testContainers()
+    {
+        CountingResource counter;
+        detail::Stoichiometry s;
+        {
+            MemoryResourceScope scope(&counter);
+            s = test::createCompound(6.0, 12.0, 6.0);
+        }
+        should(counter.allocations > 0);
+        shouldEqual(counter.outstanding, static_cast<Size>(4));
+        // growth after the scope has been left still releases the old
+        // block to the resource it came from
+        s.reserve(100);
+        should(counter.outstanding < 4);
+        shouldEqual(s[2].isotopes[2].mz, 17.9991604);
+        s.clear();
+        detail::Stoichiometry().swap(s);
+        shouldEqual(counter.outstanding, static_cast<Size>(0));
+    }
+
+    void testMercury()
+    {
+        detail::Stoichiometry s = test::createCompound(60.0, 120.0, 60.0);
+        detail::Mercury7Impl m;
+        detail::Spectrum expected = m(s, 1e-26);
+        // all intermediates come from the resource, and everything but the
+        // result is released
+        CountingResource counter;
+        {
+            MemoryResourceScope scope(&counter);
+            detail::Spectrum actual = m(s, 1e-26);
+            should(counter.allocations > 1);
+            shouldEqual(counter.outstanding, static_cast<Size>(1));
+            shouldEqual(actual.size(), expected.size());
+            for (Size k = 0; k < expected.size(); ++k) {
+                shouldEqual(actual[k].mz, expected[k].mz);
+                shouldEqual(actual[k].ab, expected[k].ab);
+            }
+        }
+        shouldEqual(counter.outstanding, static_cast<Size>(0));
+        // a batch in an arena
+        MonotonicArena arena;
+        for (Size batch = 0; batch < 3; ++batch) {
+            std::vector<Double> mono;
+            {
+                MemoryResourceScope scope(&arena);
+                for (Size k = 1; k <= 20; ++k) {
+                    const Double n = static_cast<Double>(k);
+                    detail::Stoichiometry c = test::createCompound(6.0 * n,
+                        12.0 * n, 6.0 * n);
+                    mono.push_back(m(c, 1e-26)[0].mz);
+                }
+            }
+            shouldEqual(arena.getAllocated(), static_cast<Size>(0));
+            should(arena.getCapacity() > 0);
+            shouldEqual(mono.size(), static_cast<Size>(20));
+            shouldEqualTolerance(mono[0], expected[0].mz / 10.0, 1e-12);
+            Size capacity = arena.getCapacity();
+            arena.reset();
+            shouldEqual(arena.getCapacity(), capacity);
+        }
+    }
+};
+
+/** The main function that runs the tests for the memory resources.
+ * Under normal circumstances you need not edit this.
+ */
+int main()
+{
+    MemoryResourceTestSuite test;
+    int success = test.run();
+    std::cout << test.report() << std::endl;
+    return success;
+}
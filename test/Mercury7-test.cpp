@@ -6,6 +6,7 @@
  */
 #include <ipaca/Mercury7.hpp>
 #include <ipaca/Mercury7Impl.hpp>
+#include <ipaca/PatternIndex.hpp>
 #include <ipaca/Spectrum.hpp>
 #include <ipaca/Stoichiometry.hpp>
 #include <ipaca/Traits.hpp>
@@ -140,6 +141,104 @@ struct MercuryTestSuite : vigra::test_suite
         spectrum = m(s, 1, MyMercury7::ELECTRON);
         std::cerr << "\n---" << spectrum << std::endl;
 
+        // windows in m/z
+        MySpectrum full = m(s, 2, MyMercury7::PROTON);
+        MySpectrum windowed = m.window(s, 2, MyMercury7::PROTON,
+            full[1].mz - 0.1, full[2].mz + 0.1);
+        shouldEqual(windowed.size(), static_cast<Size>(2));
+        shouldEqualTolerance(windowed[0].mz, full[1].mz, 1e-12);
+        shouldEqualTolerance(windowed[1].ab, full[2].ab, 1e-12);
+        full = m(s, 1, MyMercury7::ELECTRON);
+        windowed = m.window(s, 1, MyMercury7::ELECTRON, full[0].mz - 0.1,
+            full[0].mz + 0.1);
+        shouldEqual(windowed.size(), static_cast<Size>(1));
+        shouldEqualTolerance(windowed[0].mz, full[0].mz, 1e-12);
+
+        // enrichment sweeps (18O labeling)
+        std::vector<Size> labeled(1, 1);
+        std::vector<detail::Enrichment> levels;
+        for (Size k = 0; k < 3; ++k) {
+            detail::Abundances ab(3, 0.0);
+            ab[2] = 0.5 * static_cast<Double>(k);
+            ab[0] = 1.0 - ab[2];
+            levels.push_back(detail::Enrichment(1, ab));
+        }
+        std::vector<MySpectrum> spectra = m.sweep(s, 1, MyMercury7::PROTON,
+            labeled, levels);
+        shouldEqual(spectra.size(), static_cast<Size>(3));
+        for (Size k = 0; k < spectra.size(); ++k) {
+            MyStoichiometry t = s;
+            for (Size u = 0; u < 3; ++u) {
+                t[1].isotopes[u].ab = levels[k][0][u];
+            }
+            full = m(t, 1, MyMercury7::PROTON);
+            shouldEqual(spectra[k].size(), full.size());
+            for (Size j = 0; j < full.size(); ++j) {
+                shouldEqualTolerance(spectra[k][j].mz, full[j].mz, 1e-9);
+                shouldEqualTolerance(spectra[k][j].ab, full[j].ab, 1e-12);
+            }
+        }
+
+        // modified forms (oxidation)
+        std::vector<MyStoichiometry> deltas(1, MyStoichiometry(1, s[1]));
+        std::vector<detail::Variant> variants(2, detail::Variant(1, 0));
+        variants[1][0] = 1;
+        spectra = m.variants(s, 1, MyMercury7::PROTON, deltas, variants);
+        shouldEqual(spectra.size(), static_cast<Size>(2));
+        MyStoichiometry t = s;
+        t[1].count += 1.0;
+        full = m(t, 1, MyMercury7::PROTON);
+        shouldEqual(spectra[1].size(), full.size());
+        for (Size j = 0; j < full.size(); ++j) {
+            shouldEqualTolerance(spectra[1][j].mz, full[j].mz, 1e-9);
+            shouldEqualTolerance(spectra[1][j].ab, full[j].ab, 1e-12);
+        }
+
+        // building blocks: (H2O)3 and the series (H2O)1..3
+        t = s;
+        t[0].count = 6.0;
+        t[1].count = 3.0;
+        full = m(t, 1, MyMercury7::PROTON);
+        std::vector<Size> counts(2, 1);
+        counts[1] = 2;
+        spectrum = m.blocks(std::vector<MyStoichiometry>(2, s), counts, 1,
+            MyMercury7::PROTON);
+        shouldEqual(spectrum.size(), full.size());
+        for (Size j = 0; j < full.size(); ++j) {
+            shouldEqualTolerance(spectrum[j].mz, full[j].mz, 1e-9);
+            shouldEqualTolerance(spectrum[j].ab, full[j].ab, 1e-12);
+        }
+        spectra = m.series(std::vector<MyStoichiometry>(1, s), s, 0, 2, 1,
+            MyMercury7::PROTON);
+        shouldEqual(spectra.size(), static_cast<Size>(3));
+        shouldEqual(spectra[2].size(), full.size());
+        for (Size j = 0; j < full.size(); ++j) {
+            shouldEqualTolerance(spectra[2][j].mz, full[j].mz, 1e-9);
+            shouldEqualTolerance(spectra[2][j].ab, full[j].ab, 1e-12);
+        }
+
+        // a library of patterns indexed by monoisotopic m/z
+        PatternIndex<MySpectrum> library;
+        for (Int z = 1; z <= 3; ++z) {
+            for (Size n = 1; n <= 3; ++n) {
+                t = s;
+                t[0].count = 2.0 * static_cast<Double>(n);
+                t[1].count = static_cast<Double>(n);
+                full = m(t, z, MyMercury7::PROTON);
+                Double mz = m.getMonoisotopicMz(t, z, MyMercury7::PROTON);
+                shouldEqualTolerance(mz, full[0].mz, 1e-12);
+                library.add(full, mz, z);
+            }
+        }
+        library.build();
+        full = m(s, 2, MyMercury7::PROTON);
+        PatternIndex<MySpectrum>::Range r = library.find(full[0].mz, 2);
+        shouldEqual(r.second - r.first, 1);
+        shouldEqual((*r.first)->size(), full.size());
+        shouldEqual(library.getCharge(library.getId(*r.first)), 2);
+        full = m(s, 1, MyMercury7::ELECTRON);
+        shouldEqualTolerance(m.getMonoisotopicMz(s, 1, MyMercury7::ELECTRON),
+            full[0].mz, 1e-12);
     }
 };
 
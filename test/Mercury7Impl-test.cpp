@@ -4,6 +4,9 @@
  * Copyright (c) 2012 Marc Kirchner
  *
  */
+#include <ipaca/BinnedConvolution.hpp>
+#include <ipaca/ConvolutionPlan.hpp>
+#include <ipaca/PrunePolicy.hpp>
 #include <ipaca/Stoichiometry.hpp>
 #include <ipaca/Types.hpp>
 // expose the class
@@ -12,7 +15,10 @@
 #include <ipaca/Mercury7Impl.hpp>
 #undef private
 #undef protected
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include "TestElements.hpp"
 #include "vigra/unittest.hxx"
 
 using namespace ipaca;
@@ -31,7 +37,17 @@ struct Mercury7TestSuite : vigra::test_suite
     {
         add(testCase(&Mercury7TestSuite::testPrune));
         add(testCase(&Mercury7TestSuite::testConvolve));
+        add(testCase(&Mercury7TestSuite::testConvolveAndPrune));
+        add(testCase(&Mercury7TestSuite::testSquare));
         add(testCase(&Mercury7TestSuite::testOperator));
+        add(testCase(&Mercury7TestSuite::testPrunePolicy));
+        add(testCase(&Mercury7TestSuite::testOutputMode));
+        add(testCase(&Mercury7TestSuite::testMassWindow));
+        add(testCase(&Mercury7TestSuite::testSweep));
+        add(testCase(&Mercury7TestSuite::testVariants));
+        add(testCase(&Mercury7TestSuite::testBlocks));
+        add(testCase(&Mercury7TestSuite::testMassResolution));
+        add(testCase(&Mercury7TestSuite::testFractional));
     }
 
     void testPrune()
@@ -148,6 +164,79 @@ struct Mercury7TestSuite : vigra::test_suite
         }
     }
 
+    void testConvolveAndPrune()
+    {
+        detail::Mercury7Impl m;
+        // a spectrum with long, shallow tails
+        detail::Spectrum s1;
+        detail::SpectrumElement e;
+        for (Size k = 0; k < 40; ++k) {
+            Double x = static_cast<Double>(k) - 12.0;
+            e.mz = 100.0 + static_cast<Double>(k) * 1.003;
+            e.ab = std::exp(-0.5 * x * x / 4.0);
+            s1.push_back(e);
+        }
+        detail::Spectrum s2(s1.begin() + 5, s1.begin() + 20);
+        Double limits[] = { 1e-300, 1e-26, 1e-8, 1e-2, 0.5, 1e3 };
+        Size maxPeaks[] = { 1000, 54, 20, 3 };
+        for (Size l = 0; l < 6; ++l) {
+            for (Size p = 0; p < 4; ++p) {
+                // the peaks are counted from the first surviving one
+                detail::Spectrum expected, fused;
+                m.convolve(s1, s2, expected);
+                m.prune(expected, limits[l]);
+                if (expected.size() > maxPeaks[p]) {
+                    expected.resize(maxPeaks[p]);
+                }
+                m.convolveAndPrune(s1, s2, fused, limits[l], maxPeaks[p]);
+                shouldEqual(fused.size(), expected.size());
+                for (Size k = 0; k < fused.size(); ++k) {
+                    shouldEqual(fused[k].mz, expected[k].mz);
+                    shouldEqual(fused[k].ab, expected[k].ab);
+                }
+            }
+        }
+        // empty operands
+        detail::Spectrum empty, r;
+        r.resize(10);
+        m.convolveAndPrune(s1, empty, r, 1e-26);
+        shouldEqual(r.size(), static_cast<Size>(0));
+    }
+
+    void testSquare()
+    {
+        detail::Mercury7Impl m;
+        detail::Spectrum s;
+        detail::SpectrumElement e;
+        for (Size n = 1; n < 12; ++n) {
+            e.mz = 10.0 + static_cast<Double>(n) * 1.0021;
+            e.ab = 1.0 / static_cast<Double>(n * n);
+            s.push_back(e);
+            // s and its copy take the generic and the squaring path
+            detail::Spectrum t(s);
+            detail::Spectrum generic, squared;
+            m.convolve(s, t, generic);
+            m.convolve(s, s, squared);
+            shouldEqual(squared.size(), generic.size());
+            for (Size k = 0; k < generic.size(); ++k) {
+                shouldEqualTolerance(squared[k].mz, generic[k].mz, 1e-12);
+                shouldEqualTolerance(squared[k].ab, generic[k].ab, 1e-12);
+            }
+            // fused squaring
+            m.prune(generic, 1e-3);
+            m.convolveAndPrune(s, s, squared, 1e-3);
+            shouldEqual(squared.size(), generic.size());
+            for (Size k = 0; k < generic.size(); ++k) {
+                shouldEqualTolerance(squared[k].mz, generic[k].mz, 1e-12);
+                shouldEqualTolerance(squared[k].ab, generic[k].ab, 1e-12);
+            }
+            // limited number of peaks
+            m.convolve(s, s, squared, 3);
+            shouldEqual(squared.size(), std::min(static_cast<Size>(3),
+                2 * n - 1));
+        }
+    }
+
     detail::Stoichiometry createIntegerH2O()
     {
         detail::Stoichiometry h2o;
@@ -175,6 +264,596 @@ struct Mercury7TestSuite : vigra::test_suite
         return h2o;
     }
 
+    detail::Stoichiometry createLargeCompound()
+    {
+        detail::Stoichiometry s;
+        detail::Isotope i;
+        detail::Element c;
+        double massesC[] = { 12.0, 13.0033548378 };
+        double freqsC[] = { 0.9893, 0.0107 };
+        for (size_t k = 0; k < 2; ++k) {
+            i.mz = massesC[k];
+            i.ab = freqsC[k];
+            c.isotopes.push_back(i);
+        }
+        c.count = 523.0;
+        detail::Element o;
+        double massesO[] = { 15.9949146221, 16.9991315, 17.9991604 };
+        double freqsO[] = { 0.99757, 0.00038, 0.00205 };
+        for (size_t k = 0; k < 3; ++k) {
+            i.mz = massesO[k];
+            i.ab = freqsO[k];
+            o.isotopes.push_back(i);
+        }
+        o.count = 97.0;
+        s.push_back(c);
+        s.push_back(o);
+        return s;
+    }
+
+    void testPrunePolicy()
+    {
+        detail::Stoichiometry s = createLargeCompound();
+        detail::Mercury7Impl m;
+        Double discarded = 1.0;
+        detail::Spectrum exact = m(s, AbsoluteLimitPrunePolicy(1e-300),
+            &discarded);
+        shouldEqualTolerance(discarded, 0.0, 1e-12);
+        // the default limit and the absolute limit policy agree
+        detail::Spectrum spectrum = m(s);
+        detail::Spectrum spectrum2 = m(s, AbsoluteLimitPrunePolicy(1e-26));
+        shouldEqual(spectrum.size(), spectrum2.size());
+        for (Size k = 0; k < spectrum.size(); ++k) {
+            shouldEqual(spectrum[k].mz, spectrum2[k].mz);
+            shouldEqual(spectrum[k].ab, spectrum2[k].ab);
+        }
+        // the error budget is a guaranteed bound on the discarded abundance
+        Double exactTotal = 0.0;
+        for (Size k = 0; k < exact.size(); ++k) {
+            exactTotal += exact[k].ab;
+        }
+        Double budgets[] = { 1e-3, 1e-5, 1e-9 };
+        for (Size b = 0; b < 3; ++b) {
+            spectrum = m(s, ErrorBudgetPrunePolicy(budgets[b]), &discarded);
+            should(spectrum.size() < exact.size());
+            should(discarded <= budgets[b] * exactTotal);
+            Double total = 0.0;
+            for (Size k = 0; k < spectrum.size(); ++k) {
+                total += spectrum[k].ab;
+            }
+            should(std::fabs(exactTotal - total - discarded) < 1e-12);
+        }
+        // coverage and relative limit policies report what they discard
+        spectrum = m(s, CoveragePrunePolicy(0.99999), &discarded);
+        should(spectrum.size() < exact.size());
+        should(discarded > 0.0);
+        spectrum = m(s, RelativeLimitPrunePolicy(1e-6), &discarded);
+        should(spectrum.size() < exact.size());
+        should(discarded > 0.0);
+    }
+
+    void testOutputMode()
+    {
+        detail::Stoichiometry s = createLargeCompound();
+        detail::Mercury7Impl m;
+        detail::Spectrum full = m(s);
+        // convolution with a limited number of peaks
+        {
+            detail::Spectrum r, t;
+            m.convolve(full, full, r);
+            m.convolve(full, full, t, 4);
+            shouldEqual(t.size(), static_cast<Size>(4));
+            for (Size k = 0; k < 4; ++k) {
+                shouldEqual(t[k].mz, r[k].mz);
+                shouldEqual(t[k].ab, r[k].ab);
+            }
+        }
+        // first N peaks
+        m.setOutputMode(OutputMode::firstN(5));
+        shouldEqual(m.getOutputMode().getType(), OutputMode::FIRST_N);
+        detail::Spectrum spectrum = m(s);
+        shouldEqual(spectrum.size(), static_cast<Size>(5));
+        for (Size k = 0; k < 5; ++k) {
+            shouldEqualTolerance(spectrum[k].mz, full[k].mz, 1e-12);
+            shouldEqualTolerance(spectrum[k].ab, full[k].ab, 1e-12);
+        }
+        // K most abundant peaks, in order of increasing mass
+        m.setOutputMode(OutputMode::topK(3));
+        spectrum = m(s);
+        shouldEqual(spectrum.size(), static_cast<Size>(3));
+        Size maxIdx = 0;
+        for (Size k = 1; k < full.size(); ++k) {
+            if (full[k].ab > full[maxIdx].ab) {
+                maxIdx = k;
+            }
+        }
+        Double minKept = spectrum[0].ab;
+        Double maxKept = spectrum[0].ab;
+        for (Size k = 0; k < 3; ++k) {
+            minKept = std::min(minKept, spectrum[k].ab);
+            maxKept = std::max(maxKept, spectrum[k].ab);
+            if (k > 0) {
+                should(spectrum[k].mz > spectrum[k - 1].mz);
+            }
+        }
+        Size larger = 0;
+        for (Size k = 0; k < full.size(); ++k) {
+            if (full[k].ab > minKept) {
+                ++larger;
+            }
+        }
+        shouldEqual(larger, static_cast<Size>(2));
+        shouldEqualTolerance(maxKept, full[maxIdx].ab, 1e-12);
+        // back to the full distribution
+        m.setOutputMode(OutputMode::all());
+        shouldEqual(m(s).size(), full.size());
+        // the leading peaks of large compounds fall below the limit
+        shouldMatchFirstN(test::createCompound(3000, 4000, 800), 1e-10, 1);
+        shouldMatchFirstN(test::createCompound(3000, 4000, 800), 1e-10, 5);
+        shouldMatchFirstN(test::createCompound(8000, 12000, 2000), 1e-26, 5);
+    }
+
+    /** Checks the first N peaks against the complete distribution.
+     */
+    void shouldMatchFirstN(const detail::Stoichiometry& s, const Double limit,
+        const Size n)
+    {
+        detail::Mercury7Impl m;
+        detail::Spectrum full = m(s, limit);
+        should(full.size() > n);
+        should(full[0].mz > m.getMonoisotopicMass(s) + 0.5);
+        m.setOutputMode(OutputMode::firstN(n));
+        detail::Spectrum first = m(s, limit);
+        shouldEqual(first.size(), n);
+        for (Size k = 0; k < n; ++k) {
+            shouldEqualTolerance(first[k].mz, full[k].mz, 1e-9);
+            shouldEqualTolerance(first[k].ab, full[k].ab, 1e-12);
+        }
+    }
+
+    /** Checks a windowed result against the complete distribution.
+     */
+    void shouldMatchWindow(const detail::Spectrum& windowed,
+        const detail::Spectrum& full, const Double massMin,
+        const Double massMax)
+    {
+        detail::Spectrum expected;
+        for (Size k = 0; k < full.size(); ++k) {
+            if (full[k].mz >= massMin && full[k].mz <= massMax) {
+                expected.push_back(full[k]);
+            }
+        }
+        shouldEqual(windowed.size(), expected.size());
+        for (Size k = 0; k < windowed.size(); ++k) {
+            shouldEqualTolerance(windowed[k].mz, expected[k].mz, 1e-12);
+            should(std::fabs(windowed[k].ab - expected[k].ab) < 1e-9
+                    * expected[k].ab + 1e-26);
+        }
+    }
+
+    void testMassWindow()
+    {
+        detail::Stoichiometry s = createLargeCompound();
+        detail::Mercury7Impl m;
+        // monoisotopic mass ~7827.5
+        Double mono = m.getMonoisotopicMass(s);
+        Double windows[][2] = { { mono + 2.5, mono + 5.5 },
+            { mono - 10.0, mono + 0.5 }, { mono + 20.5, mono + 21.5 },
+            { mono + 1.0, mono + 1.0 }, { 0.0, 1e6 } };
+        for (Size w = 0; w < 5; ++w) {
+            Double lo = windows[w][0], hi = windows[w][1];
+            // fixed limits (fused kernel, closed form) and others
+            detail::Spectrum full = m(s, AbsoluteLimitPrunePolicy(1e-26));
+            detail::Spectrum windowed = m(s, lo, hi,
+                AbsoluteLimitPrunePolicy(1e-26));
+            shouldMatchWindow(windowed, full, lo, hi);
+            full = m(s, ErrorBudgetPrunePolicy(0.0));
+            windowed = m(s, lo, hi, ErrorBudgetPrunePolicy(0.0));
+            shouldMatchWindow(windowed, full, lo, hi);
+        }
+        // nothing in the window
+        should(m(s, 0.0, mono - 0.1, AbsoluteLimitPrunePolicy(1e-26)).empty());
+        should(m(s, mono + 1000.0, mono + 1001.0,
+            AbsoluteLimitPrunePolicy(1e-26)).empty());
+        // fewer peaks are calculated
+        ErrorBudgetPrunePolicy exact(0.0);
+        m.resetKernelStats();
+        m(s, exact);
+        KernelStats stats = m.getKernelStats();
+        Double fullPeaks = 0.0;
+        for (Size k = 0; k < NUM_KERNELS; ++k) {
+            fullPeaks += stats.peaks[k];
+        }
+        m.resetKernelStats();
+        m(s, mono + 1.5, mono + 2.5, exact);
+        stats = m.getKernelStats();
+        Double windowPeaks = 0.0;
+        for (Size k = 0; k < NUM_KERNELS; ++k) {
+            windowPeaks += stats.peaks[k];
+        }
+        should(windowPeaks < 0.5 * fullPeaks);
+        // fractional stoichiometries
+        s[0].count += 0.5;
+        mono = m.getMonoisotopicMass(s);
+        detail::Spectrum full = m(s, AbsoluteLimitPrunePolicy(1e-26));
+        detail::Spectrum windowed = m(s, mono + 2.5, mono + 5.5,
+            AbsoluteLimitPrunePolicy(1e-26));
+        should(!windowed.empty());
+        shouldMatchWindow(windowed, full, mono + 2.5, mono + 5.5);
+        // output modes apply within the window
+        m.setOutputMode(OutputMode::firstN(2));
+        windowed = m(s, mono + 2.5, mono + 5.5,
+            AbsoluteLimitPrunePolicy(1e-26));
+        shouldEqual(windowed.size(), static_cast<Size>(2));
+        should(windowed[0].mz >= mono + 2.5);
+        m.setOutputMode(OutputMode::all());
+        // invalid windows
+        bool thrown = false;
+        try {
+            m(s, 2.0, 1.0, AbsoluteLimitPrunePolicy(1e-26));
+        } catch (PreconditionViolation&) {
+            thrown = true;
+        }
+        shouldEqual(thrown, true);
+    }
+
+    /** Checks that all significant peaks of \a expected are in \a actual.
+     */
+    void shouldMatchPeaks(const detail::Spectrum& actual,
+        const detail::Spectrum& expected)
+    {
+        Size j = 0;
+        for (Size k = 0; k < expected.size(); ++k) {
+            if (expected[k].ab < 1e-15) {
+                continue;
+            }
+            while (j < actual.size() && actual[j].mz < expected[k].mz - 0.5) {
+                ++j;
+            }
+            should(j < actual.size());
+            if (j == actual.size()) {
+                return;
+            }
+            shouldEqualTolerance(actual[j].mz, expected[k].mz, 1e-6);
+            should(std::fabs(actual[j].ab - expected[k].ab) < 1e-8
+                    * expected[k].ab + 1e-15);
+        }
+    }
+
+    /** Sums up the peaks calculated by all kernels.
+     */
+    Double getCalculatedPeaks(const KernelStats& stats)
+    {
+        Double peaks = 0.0;
+        for (Size k = 0; k < NUM_KERNELS; ++k) {
+            peaks += stats.peaks[k];
+        }
+        return peaks;
+    }
+
+    void testSweep()
+    {
+        detail::Stoichiometry s = createLargeCompound();
+        detail::Mercury7Impl m;
+        AbsoluteLimitPrunePolicy policy(1e-300);
+        // a 13C labeling curve, including complete labeling
+        std::vector<Size> labeled(1, 0);
+        std::vector<detail::Enrichment> levels;
+        Double fractions[] = { 0.0107, 0.1, 0.5, 0.9, 0.99, 1.0 };
+        for (Size k = 0; k < 6; ++k) {
+            detail::Abundances ab(2);
+            ab[0] = 1.0 - fractions[k];
+            ab[1] = fractions[k];
+            levels.push_back(detail::Enrichment(1, ab));
+        }
+        std::vector<detail::Spectrum> spectra;
+        m.sweep(s, labeled, levels, policy, spectra);
+        shouldEqual(spectra.size(), levels.size());
+        for (Size k = 0; k < levels.size(); ++k) {
+            detail::Stoichiometry t = s;
+            t[0].isotopes[0].ab = levels[k][0][0];
+            t[0].isotopes[1].ab = levels[k][0][1];
+            shouldMatchPeaks(spectra[k], m(t, policy));
+        }
+        // label two elements at once
+        labeled.push_back(1);
+        levels.clear();
+        detail::Enrichment e(2);
+        e[0].push_back(0.5);
+        e[0].push_back(0.5);
+        e[1].push_back(0.1);
+        e[1].push_back(0.0);
+        e[1].push_back(0.9);
+        levels.push_back(e);
+        m.sweep(s, labeled, levels, policy, spectra);
+        shouldEqual(spectra.size(), static_cast<Size>(1));
+        detail::Stoichiometry t = s;
+        t[0].isotopes[0].ab = t[0].isotopes[1].ab = 0.5;
+        t[1].isotopes[0].ab = 0.1;
+        t[1].isotopes[1].ab = 0.0;
+        t[1].isotopes[2].ab = 0.9;
+        shouldMatchPeaks(spectra[0], m(t, policy));
+        // the unlabeled part is only calculated once
+        labeled.assign(1, 1);
+        levels.clear();
+        for (Size k = 0; k < 20; ++k) {
+            detail::Abundances ab(3, 0.0);
+            ab[2] = 0.05 * static_cast<Double>(k);
+            ab[0] = 1.0 - ab[2];
+            levels.push_back(detail::Enrichment(1, ab));
+        }
+        // (without a fixed limit, no element is evaluated in closed form)
+        ErrorBudgetPrunePolicy budget(0.0);
+        m.resetKernelStats();
+        m.sweep(s, labeled, levels, budget, spectra);
+        Double sweepPeaks = getCalculatedPeaks(m.getKernelStats());
+        m.resetKernelStats();
+        for (Size k = 0; k < levels.size(); ++k) {
+            detail::Stoichiometry t = s;
+            for (Size u = 0; u < 3; ++u) {
+                t[1].isotopes[u].ab = levels[k][0][u];
+            }
+            shouldMatchPeaks(spectra[k], m(t, budget));
+        }
+        Double separatePeaks = getCalculatedPeaks(m.getKernelStats());
+        should(sweepPeaks < 0.5 * separatePeaks);
+        // invalid enrichments
+        bool thrown = false;
+        try {
+            levels[0][0].pop_back();
+            m.sweep(s, labeled, levels, policy, spectra);
+        } catch (PreconditionViolation&) {
+            thrown = true;
+        }
+        shouldEqual(thrown, true);
+        thrown = false;
+        try {
+            labeled.assign(1, 2);
+            m.sweep(s, labeled, levels, policy, spectra);
+        } catch (PreconditionViolation&) {
+            thrown = true;
+        }
+        shouldEqual(thrown, true);
+    }
+
+    void testVariants()
+    {
+        detail::Element c = test::createCarbon(60.0);
+        detail::Element h = test::createHydrogen(98.0);
+        detail::Element n = test::createNitrogen(16.0);
+        detail::Element o = test::createOxygen(20.0);
+        detail::Element p = test::createPhosphorus(1.0);
+        detail::Stoichiometry peptide;
+        peptide.push_back(c);
+        peptide.push_back(h);
+        peptide.push_back(n);
+        peptide.push_back(o);
+        // phosphorylation (+HPO3), oxidation (+O), deamidation (-NH +O)
+        std::vector<detail::Stoichiometry> deltas(3);
+        h.count = 1.0;
+        o.count = 3.0;
+        deltas[0].push_back(h);
+        deltas[0].push_back(p);
+        deltas[0].push_back(o);
+        o.count = 1.0;
+        deltas[1].push_back(o);
+        n.count = -1.0;
+        h.count = -1.0;
+        deltas[2].push_back(n);
+        deltas[2].push_back(h);
+        deltas[2].push_back(o);
+        Size forms[][3] = { { 0, 0, 0 }, { 1, 0, 0 }, { 2, 0, 0 },
+            { 0, 1, 0 }, { 1, 1, 0 }, { 0, 0, 1 }, { 1, 0, 1 }, { 1, 0, 0 },
+            { 0, 2, 0 } };
+        std::vector<detail::Variant> variants;
+        for (Size v = 0; v < 9; ++v) {
+            variants.push_back(detail::Variant(forms[v], forms[v] + 3));
+        }
+        detail::Mercury7Impl m;
+        AbsoluteLimitPrunePolicy policy(1e-300);
+        std::vector<detail::Spectrum> spectra;
+        m.variants(peptide, deltas, variants, policy, spectra);
+        shouldEqual(spectra.size(), variants.size());
+        for (Size v = 0; v < variants.size(); ++v) {
+            detail::Stoichiometry t = peptide;
+            t.push_back(p);
+            t.back().count = 0.0;
+            Double dh = static_cast<Double>(forms[v][0]) - static_cast<Double>(
+                forms[v][2]);
+            t[1].count += dh;
+            t[2].count -= static_cast<Double>(forms[v][2]);
+            t[3].count += static_cast<Double>(3 * forms[v][0] + forms[v][1]
+                    + forms[v][2]);
+            t[4].count += static_cast<Double>(forms[v][0]);
+            detail::Spectrum expected = m(t, policy);
+            shouldMatchPeaks(spectra[v], expected);
+            shouldMatchPeaks(expected, spectra[v]);
+        }
+        // duplicate variants are calculated once
+        m.resetKernelStats();
+        m.variants(peptide, deltas, std::vector<detail::Variant>(1,
+            variants[1]), ErrorBudgetPrunePolicy(0.0), spectra);
+        Double single = getCalculatedPeaks(m.getKernelStats());
+        m.resetKernelStats();
+        m.variants(peptide, deltas, std::vector<detail::Variant>(5,
+            variants[1]), ErrorBudgetPrunePolicy(0.0), spectra);
+        shouldEqual(getCalculatedPeaks(m.getKernelStats()), single);
+        shouldEqual(spectra.size(), static_cast<Size>(5));
+        // removing more atoms than present
+        bool thrown = false;
+        try {
+            variants.assign(1, detail::Variant(3, 0));
+            variants[0][2] = 17;
+            m.variants(peptide, deltas, variants, policy, spectra);
+        } catch (PreconditionViolation&) {
+            thrown = true;
+        }
+        shouldEqual(thrown, true);
+    }
+
+    /** Create the PEG repeat unit C2H4O (\a ends = false) or the end
+     * groups H2O (\a ends = true).
+     */
+    detail::Stoichiometry createPegBlock(const Bool ends)
+    {
+        return test::createCompound(ends ? 0.0 : 2.0, ends ? 2.0 : 4.0, 1.0);
+    }
+
+    void testBlocks()
+    {
+        detail::Stoichiometry unit = createPegBlock(false);
+        detail::Stoichiometry water = createPegBlock(true);
+        detail::Blocks blocks(2);
+        blocks[0].stoichiometry = water;
+        blocks[0].count = 1;
+        blocks[1].stoichiometry = unit;
+        blocks[1].count = 45;
+        detail::Mercury7Impl m;
+        // both with and without closed-form evaluation of the blocks
+        const PrunePolicy* policies[] = { new AbsoluteLimitPrunePolicy(
+            1e-300), new AbsoluteLimitPrunePolicy(1e-26),
+            new ErrorBudgetPrunePolicy(0.0) };
+        for (Size k = 0; k < 3; ++k) {
+            detail::Stoichiometry flat = water;
+            for (Size e = 0; e < flat.size(); ++e) {
+                flat[e].count += 45.0 * unit[e].count;
+            }
+            detail::Spectrum expected = m(flat, *policies[k]);
+            detail::Spectrum spectrum = m(blocks, *policies[k]);
+            shouldMatchPeaks(spectrum, expected);
+            shouldMatchPeaks(expected, spectrum);
+        }
+        // a block with at most three peaks
+        detail::Blocks hydrogen(1);
+        hydrogen[0].stoichiometry.push_back(water[1]);
+        hydrogen[0].count = 20;
+        detail::Stoichiometry h40(1, water[1]);
+        h40[0].count = 40.0;
+        shouldMatchPeaks(m(hydrogen, *policies[1]), m(h40, *policies[1]));
+        // polydisperse series
+        std::vector<detail::Spectrum> spectra;
+        m.series(detail::Blocks(1, blocks[0]), unit, 10, 60, *policies[0],
+            spectra);
+        shouldEqual(spectra.size(), static_cast<Size>(51));
+        Size ns[] = { 10, 11, 45, 60 };
+        for (Size k = 0; k < 4; ++k) {
+            blocks[1].count = ns[k];
+            detail::Spectrum expected = m(blocks, *policies[0]);
+            shouldMatchPeaks(spectra[ns[k] - 10], expected);
+            shouldMatchPeaks(expected, spectra[ns[k] - 10]);
+        }
+        // the error budget holds for every member of the series
+        m.series(detail::Blocks(1, blocks[0]), unit, 0, 100,
+            ErrorBudgetPrunePolicy(1e-6), spectra);
+        for (Size n = 0; n < spectra.size(); ++n) {
+            Double total = 0.0;
+            for (Size j = 0; j < spectra[n].size(); ++j) {
+                total += spectra[n][j].ab;
+            }
+            should(total > 1.0 - 1e-6 - 1e-12);
+        }
+        shouldEqual(spectra.size(), static_cast<Size>(101));
+        for (Size k = 0; k < 3; ++k) {
+            delete policies[k];
+        }
+        bool thrown = false;
+        try {
+            m.series(detail::Blocks(), unit, 2, 1, ErrorBudgetPrunePolicy(
+                0.0), spectra);
+        } catch (PreconditionViolation&) {
+            thrown = true;
+        }
+        shouldEqual(thrown, true);
+    }
+
+    void testMassResolution()
+    {
+        detail::Stoichiometry s = createLargeCompound();
+        detail::Mercury7Impl m;
+        shouldEqual(m.getMassResolution(), 0.0);
+        AbsoluteLimitPrunePolicy policy(1e-30);
+        detail::Spectrum nominal = m(s, policy);
+        // the fine structure of each nominal peak is below the peak width
+        m.setMassResolution(20000.0);
+        detail::Spectrum binned = m(s, policy);
+        shouldMatchPeaks(binned, nominal);
+        shouldMatchPeaks(nominal, binned);
+        // at a high resolution, the fine structure is resolved
+        detail::Stoichiometry glucose = test::createCompound(6.0, 12.0, 6.0);
+        m.setMassResolution(0.0);
+        nominal = m(glucose, policy);
+        m.setMassResolution(1e6);
+        detail::Spectrum fine = m(glucose, policy);
+        should(fine.size() > nominal.size());
+        // the M+1 cluster consists of the 13C, 2H and 17O peaks
+        Double mono = m.getMonoisotopicMass(glucose);
+        Size n1 = 0;
+        Double ab1 = 0.0;
+        Double total = 0.0;
+        for (Size k = 0; k < fine.size(); ++k) {
+            if (k > 0) {
+                should(fine[k - 1].mz < fine[k].mz);
+            }
+            if (std::fabs(fine[k].mz - mono - 1.0) < 0.5) {
+                ++n1;
+                ab1 += fine[k].ab;
+            }
+            total += fine[k].ab;
+        }
+        shouldEqual(n1, static_cast<Size>(3));
+        shouldEqualTolerance(ab1, nominal[1].ab, 1e-12);
+        shouldEqualTolerance(total, 1.0, 1e-9);
+        // output modes apply to the merged peaks
+        m.setOutputMode(OutputMode::firstN(3));
+        shouldEqual(m(glucose, policy).size(), static_cast<Size>(3));
+        m.setOutputMode(OutputMode::topK(2));
+        detail::Spectrum top = m(glucose, policy);
+        shouldEqual(top.size(), static_cast<Size>(2));
+        shouldEqual(top[0].ab, fine[0].ab);
+        m.setOutputMode(OutputMode::all());
+        // policies without a fixed limit and fractional atoms
+        glucose[1].count = 12.5;
+        fine = m(glucose, ErrorBudgetPrunePolicy(1e-6));
+        total = 0.0;
+        for (Size k = 0; k < fine.size(); ++k) {
+            total += fine[k].ab;
+        }
+        should(total > 1.0 - 1e-6 - 1e-12);
+        should(total < 1.0 + 1e-12);
+        bool thrown = false;
+        try {
+            m.setMassResolution(-1.0);
+        } catch (PreconditionViolation&) {
+            thrown = true;
+        }
+        shouldEqual(thrown, true);
+    }
+
+    void testFractional()
+    {
+        // C2.5 H3.5
+        detail::Stoichiometry s;
+        s.push_back(test::createCarbon(2.5));
+        s.push_back(test::createHydrogen(3.5));
+        detail::Mercury7Impl m;
+        AbsoluteLimitPrunePolicy policy(1e-30);
+        detail::Spectrum exact = m(s, policy);
+        Double total = 0.0;
+        for (Size k = 0; k < exact.size(); ++k) {
+            total += exact[k].ab;
+        }
+        shouldEqualTolerance(total, 1.0, 1e-12);
+        // the fine structure merges into the nominal peaks
+        m.setMassResolution(1e9);
+        detail::Spectrum binned = m(s, policy);
+        detail::mergePeaks(binned, 100.0);
+        shouldEqual(binned.size(), exact.size());
+        for (Size k = 0; k < exact.size(); ++k) {
+            shouldEqualTolerance(binned[k].mz, exact[k].mz, 1e-12);
+            shouldEqualTolerance(binned[k].ab, exact[k].ab, 1e-12);
+        }
+    }
+
     void testOperator()
     {
         detail::Stoichiometry s = createIntegerH2O();
@@ -0,0 +1,231 @@
+/*
+ * MomentApproximation-test.cpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/MomentApproximation.hpp>
+#include <ipaca/Mercury7Impl.hpp>
+#include <ipaca/PrunePolicy.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include "vigra/unittest.hxx"
+
+using namespace ipaca;
+
+/** Tests for the moment-based approximation in MomentApproximation.cpp.
+ */
+struct MomentApproximationTestSuite : vigra::test_suite
+{
+    /** Constructor.
+     * The MomentApproximationTestSuite constructor adds all
+     * MomentApproximation tests to the test suite. If you write an
+     * additional test, add the test case here.
+     */
+    MomentApproximationTestSuite() :
+        vigra::test_suite("MomentApproximation")
+    {
+        add(testCase(&MomentApproximationTestSuite::testMoments));
+        add(testCase(&MomentApproximationTestSuite::testGaussian));
+        add(testCase(&MomentApproximationTestSuite::testPoisson));
+        add(testCase(&MomentApproximationTestSuite::testThreshold));
+    }
+
+    /** Create a stoichiometry C_c H_h N_n O_o S_s.
+     */
+    detail::Stoichiometry createStoichiometry(const Double c, const Double h,
+        const Double n, const Double o, const Double s)
+    {
+        Double tc[][2] = { { 12.0, 0.9893 }, { 13.0033548378, 0.0107 } };
+        Double th[][2] = { { 1.0078250321, 0.999885 }, { 2.0141017780, 0.000115 } };
+        Double tn[][2] = { { 14.0030740052, 0.99632 }, { 15.0001088984, 0.00368 } };
+        Double to[][2] = { { 15.9949146221, 0.99757 }, { 16.9991315, 0.00038 },
+            { 17.9991604, 0.00205 } };
+        Double ts[][2] = { { 31.97207069, 0.9493 }, { 32.97145850, 0.0076 },
+            { 33.96786683, 0.0429 }, { 34.0, 0.0 }, { 35.96708088, 0.0002 } };
+        Double (*tables[])[2] = { tc, th, tn, to, ts };
+        Size sizes[] = { 2, 2, 2, 3, 5 };
+        Double counts[] = { c, h, n, o, s };
+        detail::Stoichiometry stoi;
+        for (Size k = 0; k < 5; ++k) {
+            if (counts[k] <= 0.0) {
+                continue;
+            }
+            detail::Element e;
+            for (Size u = 0; u < sizes[k]; ++u) {
+                detail::Isotope i;
+                i.mz = tables[k][u][0];
+                i.ab = tables[k][u][1];
+                e.isotopes.push_back(i);
+            }
+            e.count = counts[k];
+            stoi.push_back(e);
+        }
+        return stoi;
+    }
+
+    /** Compare an approximation against the exact distribution.
+     */
+    void shouldBeBounded(const detail::Spectrum& approx,
+        const detail::Spectrum& exact, const Double bound)
+    {
+        // align by mass, using the average peak spacing
+        Double spacing = (exact.back().mz - exact.front().mz)
+                / static_cast<Double>(exact.size() - 1);
+        Double d = std::floor((approx.front().mz - exact.front().mz) / spacing
+                + 0.5);
+        Double maxAb = 0.0;
+        for (Size k = 0; k < exact.size(); ++k) {
+            maxAb = std::max(maxAb, exact[k].ab);
+        }
+        for (Size k = 0; k < approx.size(); ++k) {
+            Double j = static_cast<Double>(k) + d;
+            if (j < 0.0 || j >= static_cast<Double>(exact.size())) {
+                should(approx[k].ab <= bound);
+                continue;
+            }
+            const detail::SpectrumElement& e = exact[static_cast<Size>(j)];
+            should(std::fabs(approx[k].ab - e.ab) <= bound);
+            if (e.ab > 1e-3 * maxAb) {
+                should(std::fabs(approx[k].mz - e.mz) < 0.01);
+            }
+        }
+    }
+
+    void testMoments()
+    {
+        detail::Stoichiometry stoi = createStoichiometry(100.0, 0.0, 0.0, 0.0,
+            0.0);
+        detail::CompositionMoments m = detail::getCompositionMoments(stoi);
+        shouldEqualTolerance(m.total, 1.0, 1e-12);
+        shouldEqualTolerance(m.indexMean, 1.07, 1e-12);
+        shouldEqualTolerance(m.indexVariance, 100.0 * 0.0107 * 0.9893, 1e-12);
+        shouldEqualTolerance(m.massMean, 100.0 * (12.0 * 0.9893
+                + 13.0033548378 * 0.0107), 1e-12);
+        shouldEqual(m.bernoulli, true);
+        shouldEqual(m.maxIndex, 100.0);
+        // oxygen has a +2 isotope
+        m = detail::getCompositionMoments(createStoichiometry(100.0, 0.0, 0.0,
+            1.0, 0.0));
+        shouldEqual(m.bernoulli, false);
+        shouldEqual(m.maxIndex, 102.0);
+        // fractional atoms scale the mass
+        m = detail::getCompositionMoments(createStoichiometry(0.5, 0.0, 0.0,
+            0.0, 0.0));
+        shouldEqualTolerance(m.massMean, 0.5 * 12.0 + 0.5 * 0.0107
+                * 1.0033548378, 1e-12);
+        shouldEqualTolerance(m.indexMean, 0.5 * 0.0107, 1e-12);
+    }
+
+    void testGaussian()
+    {
+        // a protein of about 112 kDa
+        detail::Stoichiometry stoi = createStoichiometry(5000.0, 7900.0,
+            1360.0, 1500.0, 40.0);
+        detail::Spectrum approx;
+        detail::ApproximationModel model;
+        Double bound = detail::approximateSpectrum(stoi, 1e-26, approx, &model);
+        shouldEqual(model, detail::GAUSSIAN_MODEL);
+        should(bound > 0.0);
+        should(bound < 0.2);
+        detail::Mercury7Impl m;
+        detail::Spectrum exact = m(stoi, 1e-26);
+        shouldBeBounded(approx, exact, bound);
+        // the bound shrinks with the size of the compound
+        detail::Stoichiometry larger = createStoichiometry(20000.0, 31600.0,
+            5440.0, 6000.0, 160.0);
+        should(m.getApproximationErrorBound(larger) < bound);
+        should(m.getApproximationErrorBound(larger) > 0.0);
+        // a cutoff prunes the tails
+        detail::Spectrum pruned;
+        detail::approximateSpectrum(stoi, 1e-3, pruned);
+        should(pruned.size() < approx.size());
+        for (Size k = 0; k < pruned.size(); ++k) {
+            should(pruned[k].ab > 1e-3);
+        }
+    }
+
+    void testPoisson()
+    {
+        // carbon only: a sum of Bernoulli atoms with small lambda
+        detail::Stoichiometry stoi = createStoichiometry(60.0, 0.0, 0.0, 0.0,
+            0.0);
+        detail::CompositionMoments cm = detail::getCompositionMoments(stoi);
+        shouldEqual(detail::selectApproximationModel(cm),
+            detail::POISSON_MODEL);
+        detail::Spectrum approx;
+        Double bound = detail::approximateSpectrum(stoi, 1e-26, approx);
+        shouldEqualTolerance(bound, (1.0 - std::exp(-0.642)) / 0.642 * 60.0
+                * 0.0107 * 0.0107, 1e-9);
+        detail::Mercury7Impl m;
+        detail::Spectrum exact = m(stoi, ErrorBudgetPrunePolicy(0.0));
+        shouldBeBounded(approx, exact, bound);
+    }
+
+    void testThreshold()
+    {
+        detail::Stoichiometry small = createStoichiometry(50.0, 80.0, 14.0,
+            15.0, 1.0);
+        detail::Stoichiometry large = createStoichiometry(5000.0, 7900.0,
+            1360.0, 1500.0, 40.0);
+        detail::Mercury7Impl exact;
+        detail::Mercury7Impl m;
+        shouldEqual(m.getApproximationThreshold().getType(),
+            ApproximationThreshold::NEVER);
+        m.setApproximationThreshold(ApproximationThreshold::aboveMass(
+            100000.0));
+        // small compounds stay exact
+        detail::Spectrum s1 = m(small), s2 = exact(small);
+        shouldEqual(s1.size(), s2.size());
+        for (Size k = 0; k < s1.size(); ++k) {
+            shouldEqual(s1[k].ab, s2[k].ab);
+        }
+        // large compounds are approximated
+        detail::Spectrum approx;
+        detail::approximateSpectrum(large, 1e-26, approx);
+        s1 = m(large);
+        shouldEqual(s1.size(), approx.size());
+        for (Size k = 0; k < s1.size(); ++k) {
+            shouldEqual(s1[k].ab, approx[k].ab);
+            shouldEqual(s1[k].mz, approx[k].mz);
+        }
+        // peak count threshold
+        m.setApproximationThreshold(ApproximationThreshold::abovePeakCount(
+            100));
+        s1 = m(large);
+        shouldEqual(s1.size(), approx.size());
+        s1 = m(small);
+        shouldEqual(s1.size(), s2.size());
+        // output modes apply to the approximation as well
+        m.setOutputMode(OutputMode::topK(5));
+        s1 = m(large);
+        shouldEqual(s1.size(), static_cast<Size>(5));
+        // policies without a fixed limit prune the final distribution
+        m.setOutputMode(OutputMode::all());
+        Double discarded = 0.0;
+        s1 = m(large, CoveragePrunePolicy(0.99), &discarded);
+        should(s1.size() < approx.size());
+        should(discarded > 0.0);
+        should(discarded < 0.02);
+        // invalid thresholds
+        bool thrown = false;
+        try {
+            ApproximationThreshold::aboveMass(-1.0);
+        } catch (PreconditionViolation&) {
+            thrown = true;
+        }
+        shouldEqual(thrown, true);
+    }
+};
+
+/** The main function that runs the tests for the moment approximation.
+ * Under normal circumstances you need not edit this.
+ */
+int main()
+{
+    MomentApproximationTestSuite test;
+    int success = test.run();
+    std::cout << test.report() << std::endl;
+    return success;
+}
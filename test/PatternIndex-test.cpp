@@ -0,0 +1,190 @@
+/*
+ * PatternIndex-test.cpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/MassIndex.hpp>
+#include <ipaca/PatternIndex.hpp>
+#include <ipaca/Spectrum.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "vigra/unittest.hxx"
+
+using namespace ipaca;
+
+/** Tests for the mass index in MassIndex.cpp and the pattern index in
+ * PatternIndex.hpp.
+ */
+struct PatternIndexTestSuite : vigra::test_suite
+{
+    /** Constructor.
+     * The PatternIndexTestSuite constructor adds all PatternIndex tests
+     * to the test suite. If you write an additional test, add the test
+     * case here.
+     */
+    PatternIndexTestSuite() :
+        vigra::test_suite("PatternIndex")
+    {
+        add(testCase(&PatternIndexTestSuite::testMassIndex));
+        add(testCase(&PatternIndexTestSuite::testBatch));
+        add(testCase(&PatternIndexTestSuite::testPatternIndex));
+    }
+
+    std::vector<Double> createMasses(const Size n)
+    {
+        std::vector<Double> masses(n);
+        for (Size k = 0; k < n; ++k) {
+            masses[k] = 100.0 + static_cast<Double>(rand() % 100000) * 0.01;
+        }
+        // some duplicates
+        for (Size k = 1; k < n; k += 7) {
+            masses[k] = masses[k - 1];
+        }
+        return masses;
+    }
+
+    /** Compare a range against a linear scan.
+     */
+    void shouldMatchScan(const detail::MassIndex& index,
+        const std::vector<Double>& masses, const Double lo, const Double hi,
+        const detail::MassIndex::Range& r)
+    {
+        Size expected = 0;
+        for (Size k = 0; k < masses.size(); ++k) {
+            if (masses[k] >= lo && masses[k] <= hi) {
+                ++expected;
+            }
+        }
+        shouldEqual(r.second - r.first, expected);
+        for (Size k = r.first; k < r.second; ++k) {
+            should(index.getMass(k) >= lo && index.getMass(k) <= hi);
+            shouldEqual(masses[index.getId(k)], index.getMass(k));
+        }
+    }
+
+    void testMassIndex()
+    {
+        detail::MassIndex empty;
+        shouldEqual(empty.size(), static_cast<Size>(0));
+        shouldEqual(empty.lowerBound(1.0), static_cast<Size>(0));
+        shouldEqual(empty.find(0.0, 1.0).first, empty.find(0.0, 1.0).second);
+        // every size up to a few complete trees
+        for (Size n = 1; n < 70; ++n) {
+            std::vector<Double> masses = createMasses(n);
+            detail::MassIndex index;
+            index.build(masses);
+            shouldEqual(index.size(), n);
+            for (Size k = 1; k < n; ++k) {
+                should(index.getMass(k - 1) <= index.getMass(k));
+            }
+            for (Size k = 0; k < n; ++k) {
+                Size r = index.lowerBound(masses[k]);
+                shouldEqual(index.getMass(r), masses[k]);
+                should(r == 0 || index.getMass(r - 1) < masses[k]);
+            }
+            shouldEqual(index.lowerBound(0.0), static_cast<Size>(0));
+            shouldEqual(index.lowerBound(1e6), n);
+        }
+        std::vector<Double> masses = createMasses(10000);
+        detail::MassIndex index;
+        index.build(masses);
+        for (Size q = 0; q < 200; ++q) {
+            Double mz = 100.0 + static_cast<Double>(rand() % 100000) * 0.01;
+            Double delta = mz * 5e-6 * static_cast<Double>(q % 10);
+            shouldMatchScan(index, masses, mz - delta, mz + delta,
+                index.find(mz - delta, mz + delta));
+        }
+    }
+
+    void testBatch()
+    {
+        std::vector<Double> masses = createMasses(5000);
+        detail::MassIndex index;
+        index.build(masses);
+        // not a multiple of the lockstep width
+        const Size n = 203;
+        std::vector<Double> lo(n), hi(n);
+        for (Size q = 0; q < n; ++q) {
+            lo[q] = 90.0 + static_cast<Double>(rand() % 102000) * 0.01;
+            hi[q] = lo[q] + static_cast<Double>(q % 5) * 0.01;
+        }
+        std::vector<detail::MassIndex::Range> ranges(n);
+        index.find(&lo[0], &hi[0], n, &ranges[0]);
+        for (Size q = 0; q < n; ++q) {
+            detail::MassIndex::Range single = index.find(lo[q], hi[q]);
+            shouldEqual(ranges[q].first, single.first);
+            shouldEqual(ranges[q].second, single.second);
+            shouldMatchScan(index, masses, lo[q], hi[q], ranges[q]);
+        }
+    }
+
+    void testPatternIndex()
+    {
+        typedef PatternIndex<detail::Spectrum> Index;
+        Index library;
+        Double mz[] = { 500.0, 500.002, 500.004, 600.0, 500.001 };
+        Int charges[] = { 1, 1, 1, 1, 2 };
+        for (Size k = 0; k < 5; ++k) {
+            detail::Spectrum pattern(k + 1);
+            pattern[0].mz = mz[k];
+            pattern[0].ab = 1.0;
+            shouldEqual(library.add(pattern, mz[k], charges[k]), k);
+        }
+        shouldEqual(library.size(), static_cast<Size>(5));
+        // queries need a built index
+        bool thrown = false;
+        try {
+            library.find(500.0, 1);
+        } catch (PreconditionViolation&) {
+            thrown = true;
+        }
+        shouldEqual(thrown, true);
+        library.build();
+        // 5 ppm at m/z 500 are 0.0025
+        Index::Range r = library.find(500.001, 1);
+        shouldEqual(r.second - r.first, 2);
+        shouldEqual(library.getId(*r.first), static_cast<Size>(0));
+        shouldEqual(library.getId(*(r.first + 1)), static_cast<Size>(1));
+        // the views point to the stored patterns
+        shouldEqual(*r.first, &library.getPattern(0));
+        shouldEqual((*(r.first + 1))->size(), static_cast<Size>(2));
+        r = library.find(500.001, 1, 10.0);
+        shouldEqual(r.second - r.first, 3);
+        r = library.find(500.001, 2);
+        shouldEqual(r.second - r.first, 1);
+        shouldEqual(library.getMonoisotopicMz(library.getId(*r.first)),
+            500.001);
+        r = library.find(500.0, 3);
+        shouldEqual(r.first == r.second, true);
+        // batched queries
+        std::vector<Double> queries;
+        queries.push_back(600.001);
+        queries.push_back(500.001);
+        queries.push_back(700.0);
+        std::vector<Index::Range> ranges;
+        library.find(queries, 1, 5.0, ranges);
+        shouldEqual(ranges.size(), static_cast<Size>(3));
+        shouldEqual(ranges[0].second - ranges[0].first, 1);
+        shouldEqual(library.getId(*ranges[0].first), static_cast<Size>(3));
+        shouldEqual(ranges[1].second - ranges[1].first, 2);
+        shouldEqual(ranges[2].second - ranges[2].first, 0);
+        // copies refer to their own patterns
+        Index copy(library);
+        r = copy.find(600.0, 1);
+        shouldEqual(r.second - r.first, 1);
+        shouldEqual(*r.first, &copy.getPattern(3));
+    }
+};
+
+/** The main function that runs the tests for the pattern index.
+ * Under normal circumstances you need not edit this.
+ */
+int main()
+{
+    PatternIndexTestSuite test;
+    int success = test.run();
+    std::cout << test.report() << std::endl;
+    return success;
+}
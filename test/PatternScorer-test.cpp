@@ -0,0 +1,207 @@
+/*
+ * PatternScorer-test.cpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/PatternScorer.hpp>
+#include <ipaca/Error.hpp>
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include "vigra/unittest.hxx"
+
+using namespace ipaca;
+
+/** Tests for the pattern scorer in PatternScorer.cpp.
+ */
+struct PatternScorerTestSuite : vigra::test_suite
+{
+    /** Constructor.
+     * The PatternScorerTestSuite constructor adds all PatternScorer tests
+     * to the test suite. If you write an additional test, add the test
+     * case here.
+     */
+    PatternScorerTestSuite() :
+        vigra::test_suite("PatternScorer")
+    {
+        add(testCase(&PatternScorerTestSuite::testIdentical));
+        add(testCase(&PatternScorerTestSuite::testScores));
+        add(testCase(&PatternScorerTestSuite::testAlignment));
+        add(testCase(&PatternScorerTestSuite::testRejection));
+        add(testCase(&PatternScorerTestSuite::testBatch));
+    }
+
+    detail::Spectrum createSpectrum(const Double* mz, const Double* ab,
+        const Size n)
+    {
+        detail::Spectrum s;
+        for (Size k = 0; k < n; ++k) {
+            detail::SpectrumElement e;
+            e.mz = mz[k];
+            e.ab = ab[k];
+            s.push_back(e);
+        }
+        return s;
+    }
+
+    void testIdentical()
+    {
+        Double mz[] = { 500.0, 501.003, 502.006, 503.009, 504.012 };
+        Double ab[] = { 60.0, 30.0, 8.0, 1.5, 0.5 };
+        detail::Spectrum s = createSpectrum(mz, ab, 5);
+        PatternScorer scorer(s, 0.01);
+        PatternScore score = scorer(s);
+        shouldEqual(score.rejected, false);
+        shouldEqual(score.matched, static_cast<Size>(5));
+        shouldEqualTolerance(score.cosine, 1.0, 1e-14);
+        should(std::fabs(score.kullbackLeibler) < 1e-14);
+        should(std::fabs(score.chiSquared) < 1e-14);
+        // the scores do not depend on the scale of the abundances
+        for (Size k = 0; k < s.size(); ++k) {
+            s[k].ab *= 1e-3;
+        }
+        score = scorer(s);
+        shouldEqualTolerance(score.cosine, 1.0, 1e-14);
+    }
+
+    void testScores()
+    {
+        Double mz[] = { 500.0, 501.0 };
+        Double ab[] = { 1.0, 1.0 };
+        PatternScorer scorer(createSpectrum(mz, ab, 2), 0.01);
+        // the third candidate peak has no observed counterpart
+        Double cmz[] = { 500.0, 501.0, 502.0 };
+        Double cab[] = { 0.6, 0.2, 0.2 };
+        PatternScore score = scorer(createSpectrum(cmz, cab, 3));
+        shouldEqual(score.matched, static_cast<Size>(2));
+        shouldEqualTolerance(score.cosine, 0.4 / std::sqrt(0.5 * 0.44),
+            1e-14);
+        shouldEqualTolerance(score.chiSquared, 0.01 / 1.1 + 0.09 / 0.7 + 0.2,
+            1e-14);
+        shouldEqualTolerance(score.kullbackLeibler, 0.5 * std::log(0.5 / 0.6)
+                + 0.5 * std::log(0.5 / 0.2), 1e-14);
+        // an observed peak without candidate counterpart uses the floor
+        Double mmz[] = { 500.0 };
+        Double mab[] = { 1.0 };
+        scorer.setFloor(1e-3);
+        score = scorer(createSpectrum(mmz, mab, 1));
+        shouldEqualTolerance(score.kullbackLeibler, 0.5 * std::log(0.5)
+                + 0.5 * std::log(0.5 / 1e-3), 1e-14);
+        shouldEqualTolerance(score.chiSquared, 0.25 / 1.5 + 0.5, 1e-14);
+        bool thrown = false;
+        try {
+            scorer.setFloor(0.0);
+        } catch (PreconditionViolation&) {
+            thrown = true;
+        }
+        shouldEqual(thrown, true);
+    }
+
+    void testAlignment()
+    {
+        Double mz[] = { 500.0, 501.0, 502.0 };
+        Double ab[] = { 0.6, 0.3, 0.1 };
+        detail::Spectrum observed = createSpectrum(mz, ab, 3);
+        // a fine structure: the isotopologues within the tolerance of an
+        // observed peak are summed
+        Double fmz[] = { 500.001, 500.998, 501.003, 501.993, 502.004 };
+        Double fab[] = { 0.6, 0.2, 0.1, 0.05, 0.05 };
+        detail::Spectrum fine = createSpectrum(fmz, fab, 5);
+        PatternScorer absolute(observed, 0.01);
+        PatternScore score = absolute(fine);
+        shouldEqual(score.matched, static_cast<Size>(5));
+        shouldEqualTolerance(score.cosine, 1.0, 1e-14);
+        // 10 ppm at m/z 500 are 0.005
+        PatternScorer ppm(observed, 10.0, PatternScorer::PPM);
+        score = ppm(fine);
+        shouldEqual(score.matched, static_cast<Size>(4));
+        should(score.cosine < 1.0);
+        // peaks are matched to the closest observed peak
+        Double cmz[] = { 500.0, 500.2, 500.5 };
+        Double cab[] = { 1.0, 1.0, 1.0 };
+        PatternScorer wide(createSpectrum(cmz, cab, 3), 0.3);
+        Double qmz[] = { 500.08, 500.45 };
+        Double qab[] = { 1.0, 1.0 };
+        score = wide(createSpectrum(qmz, qab, 2));
+        shouldEqual(score.matched, static_cast<Size>(2));
+        shouldEqualTolerance(score.cosine, 2.0 / std::sqrt(3.0 * 2.0), 1e-14);
+        bool thrown = false;
+        try {
+            Double umz[] = { 501.0, 500.0 };
+            PatternScorer unsorted(createSpectrum(umz, ab, 2), 0.01);
+        } catch (PreconditionViolation&) {
+            thrown = true;
+        }
+        shouldEqual(thrown, true);
+    }
+
+    void testRejection()
+    {
+        Double mz[] = { 501.0, 502.0, 503.0 };
+        Double ab[] = { 0.5, 0.3, 0.2 };
+        PatternScorer scorer(createSpectrum(mz, ab, 3), 0.01);
+        // the monoisotopic peak is missing
+        Double cmz[] = { 500.0, 501.0, 502.0 };
+        Double cab[] = { 0.1, 0.6, 0.3 };
+        detail::Spectrum candidate = createSpectrum(cmz, cab, 3);
+        PatternScore score = scorer(candidate);
+        shouldEqual(score.rejected, true);
+        shouldEqual(score.cosine, 0.0);
+        scorer.setRequireMonoisotopic(false);
+        score = scorer(candidate);
+        shouldEqual(score.rejected, false);
+        shouldEqual(score.matched, static_cast<Size>(2));
+        // the top peak is missing
+        candidate[0].ab = 0.9;
+        shouldEqual(scorer(candidate).rejected, true);
+        scorer.setRequireTopPeak(false);
+        shouldEqual(scorer(candidate).rejected, false);
+        // empty candidates are always rejected
+        shouldEqual(scorer(detail::Spectrum()).rejected, true);
+    }
+
+    void testBatch()
+    {
+        Double mz[] = { 500.0, 501.003, 502.006, 503.009 };
+        Double ab[] = { 0.55, 0.3, 0.1, 0.05 };
+        PatternScorer scorer(createSpectrum(mz, ab, 4), 0.01);
+        std::vector<detail::Spectrum> candidates;
+        for (Size n = 1; n <= 4; ++n) {
+            candidates.push_back(createSpectrum(mz, ab, n));
+            candidates.back()[n - 1].mz += 0.001 * static_cast<Double>(n);
+        }
+        candidates.push_back(detail::Spectrum());
+        std::vector<PatternScore> scores;
+        scorer(candidates, scores);
+        shouldEqual(scores.size(), candidates.size());
+        for (Size k = 0; k < candidates.size(); ++k) {
+            PatternScore single = scorer(candidates[k]);
+            shouldEqual(scores[k].rejected, single.rejected);
+            shouldEqual(scores[k].matched, single.matched);
+            shouldEqual(scores[k].cosine, single.cosine);
+            shouldEqual(scores[k].chiSquared, single.chiSquared);
+            if (!single.rejected) {
+                shouldEqual(scores[k].kullbackLeibler,
+                    single.kullbackLeibler);
+            }
+        }
+        // more complete candidates score better
+        for (Size k = 1; k < 4; ++k) {
+            should(scores[k].cosine > scores[k - 1].cosine);
+            should(scores[k].chiSquared < scores[k - 1].chiSquared);
+        }
+        shouldEqual(scores[4].rejected, true);
+    }
+};
+
+/** The main function that runs the tests for the pattern scorer.
+ * Under normal circumstances you need not edit this.
+ */
+int main()
+{
+    PatternScorerTestSuite test;
+    int success = test.run();
+    std::cout << test.report() << std::endl;
+    return success;
+}
@@ -0,0 +1,284 @@
+/*
+ * PatternService-test.cpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/PatternClient.hpp>
+#include <ipaca/PatternService.hpp>
+#include <ipaca/Error.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <unistd.h>
+#include "vigra/unittest.hxx"
+
+using namespace ipaca;
+
+/** Tests for the pattern service in PatternService.cpp and
+ * PatternClient.cpp.
+ */
+struct PatternServiceTestSuite : vigra::test_suite
+{
+    /** Constructor.
+     * The PatternServiceTestSuite constructor adds all PatternService tests
+     * to the test suite. If you write an additional test, add the test
+     * case here.
+     */
+    PatternServiceTestSuite() :
+        vigra::test_suite("PatternService")
+    {
+        add(testCase(&PatternServiceTestSuite::testCalculate));
+        add(testCase(&PatternServiceTestSuite::testSharedCache));
+        add(testCase(&PatternServiceTestSuite::testPipelining));
+        add(testCase(&PatternServiceTestSuite::testErrors));
+    }
+
+    String getPath()
+    {
+        std::ostringstream os;
+        os << "/tmp/ipaca-test-" << ::getpid() << ".sock";
+        return os.str();
+    }
+
+    /** Registers C, H, O with a client (in the given order of the table)
+     * and with a local calculator.
+     */
+    void createElements(PatternClient& client, ipaca_calculator* c,
+        const Bool reversed, std::vector<Size>& ids)
+    {
+        double mzC[] = { 12.0, 13.0033548378 };
+        double abC[] = { 0.9893, 0.0107 };
+        double mzH[] = { 1.0078250321, 2.0141017780 };
+        double abH[] = { 0.999885, 0.000115 };
+        double mzO[] = { 15.9949146221, 16.9991315, 17.9991604 };
+        double abO[] = { 0.99757, 0.00038, 0.00205 };
+        double* mz[] = { mzC, mzH, mzO };
+        double* ab[] = { abC, abH, abO };
+        Size n[] = { 2, 2, 3 };
+        ids.resize(3);
+        for (Size k = 0; k < 3; ++k) {
+            Size e = reversed ? 2 - k : k;
+            detail::Isotopes isotopes(n[e]);
+            for (Size u = 0; u < n[e]; ++u) {
+                isotopes[u].mz = mz[e][u];
+                isotopes[u].ab = ab[e][u];
+            }
+            ids[e] = client.addElement(isotopes);
+            shouldEqual(ids[e], k);
+            if (c) {
+                ipaca_calculator_add_element(c, mz[e], ab[e], n[e]);
+            }
+        }
+    }
+
+    /** Water, methane, glucose and C2.5 H6, all charged, in the ids of
+     * \a ids.
+     */
+    PatternRequest createRequest(const std::vector<Size>& ids)
+    {
+        PatternRequest request;
+        Size water[] = { ids[1], ids[2] };
+        Double waterCounts[] = { 2.0, 1.0 };
+        Size methane[] = { ids[0], ids[1] };
+        Double methaneCounts[] = { 1.0, 4.0 };
+        Size glucose[] = { ids[0], ids[1], ids[2] };
+        Double glucoseCounts[] = { 6.0, 12.0, 6.0 };
+        Double fractionalCounts[] = { 2.5, 6.0 };
+        request.addCompound(water, waterCounts, 2, 1);
+        request.addCompound(methane, methaneCounts, 2, 0);
+        request.addCompound(glucose, glucoseCounts, 3, 2);
+        request.addCompound(methane, fractionalCounts, 2, 3);
+        return request;
+    }
+
+    void shouldMatch(const PatternResponse& response,
+        ipaca_calculator* c, const PatternRequest& request)
+    {
+        shouldEqual(response.status, static_cast<Int>(IPACA_OK));
+        std::vector<double> mz(1000), ab(1000);
+        std::vector<size_t> peakOffsets(request.size() + 1);
+        shouldEqual(ipaca_calculate(c, request.size(), &request.offsets[0],
+            &request.elements[0], &request.counts[0], &request.charges[0],
+            request.particle, &mz[0], &ab[0], mz.size(), &peakOffsets[0], 0),
+            IPACA_OK);
+        shouldEqual(response.peakOffsets.size(), peakOffsets.size());
+        for (Size k = 0; k < peakOffsets.size(); ++k) {
+            shouldEqual(response.peakOffsets[k], peakOffsets[k]);
+        }
+        for (Size j = 0; j < response.mz.size(); ++j) {
+            shouldEqual(response.mz[j], mz[j]);
+            shouldEqual(response.ab[j], ab[j]);
+        }
+    }
+
+    void testCalculate()
+    {
+        PatternServer server(getPath());
+        boost::thread t(boost::bind(&PatternServer::run, &server));
+        {
+            PatternClient client(getPath());
+            ipaca_calculator* c = ipaca_calculator_create();
+            std::vector<Size> ids;
+            createElements(client, c, false, ids);
+            PatternRequest request = createRequest(ids);
+            shouldMatch(client.calculate(request), c, request);
+            ServiceStats stats = client.getStats();
+            shouldEqual(stats.misses, request.size());
+            shouldEqual(stats.hits, static_cast<Size>(0));
+            shouldEqual(stats.entries, request.size());
+            // the second time, all patterns come from the cache
+            shouldMatch(client.calculate(request), c, request);
+            stats = client.getStats();
+            shouldEqual(stats.hits, request.size());
+            shouldEqual(stats.misses, request.size());
+            // other settings are cached separately
+            request.outputMode = IPACA_TOP_K;
+            request.outputCount = 1;
+            PatternResponse r = client.calculate(request);
+            shouldEqual(r.mz.size(), request.size());
+            shouldEqual(client.getStats().entries, 2 * request.size());
+            // so is the choice of the hydrogen element
+            request.outputMode = IPACA_ALL;
+            client.setHydrogen(ids[1]);
+            ipaca_calculator_set_hydrogen(c, 1);
+            shouldMatch(client.calculate(request), c, request);
+            shouldEqual(client.getStats().entries, 3 * request.size());
+            ipaca_calculator_destroy(c);
+        }
+        server.stop();
+        t.join();
+        shouldEqual(server.getStats().requests, static_cast<Size>(12));
+    }
+
+    void testSharedCache()
+    {
+        PatternServer server(getPath());
+        boost::thread t(boost::bind(&PatternServer::run, &server));
+        {
+            PatternClient a(getPath());
+            PatternClient b(getPath());
+            ipaca_calculator* c = ipaca_calculator_create();
+            std::vector<Size> idsA, idsB;
+            createElements(a, c, false, idsA);
+            createElements(b, 0, true, idsB);
+            shouldEqual(idsB[0], static_cast<Size>(2));
+            PatternRequest request = createRequest(idsA);
+            shouldMatch(a.calculate(request), c, request);
+            // different element ids, same isotope tables
+            PatternResponse rb = b.calculate(createRequest(idsB));
+            shouldMatch(rb, c, request);
+            ServiceStats stats = b.getStats();
+            shouldEqual(stats.hits, request.size());
+            shouldEqual(stats.misses, request.size());
+            ipaca_calculator_destroy(c);
+        }
+        server.stop();
+        t.join();
+    }
+
+    void testPipelining()
+    {
+        PatternServer server(getPath());
+        boost::thread t(boost::bind(&PatternServer::run, &server));
+        {
+            PatternClient client(getPath());
+            ipaca_calculator* c = ipaca_calculator_create();
+            std::vector<Size> ids;
+            createElements(client, c, false, ids);
+            std::vector<PatternRequest> requests;
+            std::vector<Size> sent;
+            for (Size k = 1; k <= 50; ++k) {
+                PatternRequest request;
+                Size glucose[] = { ids[0], ids[1], ids[2] };
+                const Double n = static_cast<Double>(k);
+                Double counts[] = { 6.0 * n, 12.0 * n, 6.0 * n };
+                request.addCompound(glucose, counts, 3, 1);
+                requests.push_back(request);
+                sent.push_back(client.send(request));
+            }
+            shouldEqual(client.getPending(), static_cast<Size>(50));
+            for (Size k = 0; k < requests.size(); ++k) {
+                PatternResponse response;
+                shouldEqual(client.receive(response), sent[k]);
+                shouldMatch(response, c, requests[k]);
+            }
+            shouldEqual(client.getPending(), static_cast<Size>(0));
+            ipaca_calculator_destroy(c);
+        }
+        server.stop();
+        t.join();
+    }
+
+    void testErrors()
+    {
+        // no server
+        bool thrown = false;
+        try {
+            PatternClient client(getPath());
+        } catch (const RuntimeError&) {
+            thrown = true;
+        }
+        should(thrown);
+        PatternServer server(getPath());
+        boost::thread t(boost::bind(&PatternServer::run, &server));
+        // a running server is not replaced
+        thrown = false;
+        try {
+            PatternServer other(getPath());
+        } catch (const RuntimeError&) {
+            thrown = true;
+        }
+        should(thrown);
+        {
+            PatternClient client(getPath());
+            std::vector<Size> ids;
+            createElements(client, 0, false, ids);
+            thrown = false;
+            try {
+                client.addElement(detail::Isotopes());
+            } catch (const ParameterError&) {
+                thrown = true;
+            }
+            should(thrown);
+            thrown = false;
+            try {
+                client.setHydrogen(3);
+            } catch (const ParameterError&) {
+                thrown = true;
+            }
+            should(thrown);
+            PatternRequest request = createRequest(ids);
+            request.elements[0] = 3;
+            shouldEqual(client.calculate(request).status,
+                static_cast<Int>(IPACA_ERROR_ARGUMENT));
+            request = createRequest(ids);
+            request.particle = 7;
+            shouldEqual(client.calculate(request).status,
+                static_cast<Int>(IPACA_ERROR_ARGUMENT));
+            request = createRequest(ids);
+            request.counts[0] = -1.0;
+            shouldEqual(client.calculate(request).status,
+                static_cast<Int>(IPACA_ERROR_ARGUMENT));
+            // the connection is still usable
+            request = createRequest(ids);
+            shouldEqual(client.calculate(request).status,
+                static_cast<Int>(IPACA_OK));
+        }
+        server.stop();
+        t.join();
+    }
+};
+
+/** The main function that runs the tests for the pattern service.
+ * Under normal circumstances you need not edit this.
+ */
+int main()
+{
+    PatternServiceTestSuite test;
+    int success = test.run();
+    std::cout << test.report() << std::endl;
+    return success;
+}
@@ -0,0 +1,248 @@
+/*
+ * PowerTable-test.cpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/PowerTable.hpp>
+#include <ipaca/Mercury7Impl.hpp>
+#include <ipaca/Error.hpp>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <unistd.h>
+#include "TestElements.hpp"
+#include "vigra/unittest.hxx"
+
+using namespace ipaca;
+
+/** Tests for the element power tables in PowerTable.cpp and their use by
+ * Mercury7Impl.
+ */
+struct PowerTableTestSuite : vigra::test_suite
+{
+    /** Constructor.
+     * The PowerTableTestSuite constructor adds all PowerTable tests to the
+     * test suite. If you write an additional test, add the test case here.
+     */
+    PowerTableTestSuite() :
+        vigra::test_suite("PowerTable")
+    {
+        add(testCase(&PowerTableTestSuite::testCreate));
+        add(testCase(&PowerTableTestSuite::testSnapshot));
+        add(testCase(&PowerTableTestSuite::testMismatch));
+        add(testCase(&PowerTableTestSuite::testMercury));
+    }
+
+    String getFilename()
+    {
+        std::ostringstream os;
+        os << "/tmp/ipaca-powers-" << ::getpid() << ".bin";
+        return os.str();
+    }
+
+    /** C, H, N, O, S.
+     */
+    std::vector<detail::Isotopes> createElements()
+    {
+        detail::Stoichiometry s = test::createCompound(1.0, 1.0, 1.0, 1.0,
+            1.0);
+        std::vector<detail::Isotopes> elements;
+        for (Size e = 0; e < s.size(); ++e) {
+            elements.push_back(s[e].isotopes);
+        }
+        return elements;
+    }
+
+    detail::Stoichiometry createCompound(
+        const std::vector<detail::Isotopes>& elements, const Double* counts)
+    {
+        detail::Stoichiometry s;
+        for (Size e = 0; e < elements.size(); ++e) {
+            detail::Element element;
+            element.isotopes = elements[e];
+            element.count = counts[e];
+            s.push_back(element);
+        }
+        return s;
+    }
+
+    void shouldMatch(const PowerTable& a, const PowerTable& b)
+    {
+        shouldEqual(a.size(), b.size());
+        shouldEqual(a.getLimit(), b.getLimit());
+        shouldEqual(a.getBytes(), b.getBytes());
+        for (Size e = 0; e < a.size(); ++e) {
+            shouldEqual(a.getPowers(e), b.getPowers(e));
+            for (Size k = 0; k < a.getPowers(e); ++k) {
+                detail::Spectrum s, t;
+                shouldEqual(a.getPower(e, k, s), b.getPower(e, k, t));
+                shouldEqual(s.size(), t.size());
+                for (Size i = 0; i < s.size(); ++i) {
+                    shouldEqual(s[i].mz, t[i].mz);
+                    shouldEqual(s[i].ab, t[i].ab);
+                }
+            }
+        }
+    }
+
+    void testCreate()
+    {
+        std::vector<detail::Isotopes> elements = createElements();
+        detail::Mercury7Impl m;
+        boost::shared_ptr<const PowerTable> table = m.createPowerTable(
+            elements, 1e-20, 1000);
+        shouldEqual(table->size(), elements.size());
+        shouldEqual(table->getLimit(), 1e-20);
+        for (Size e = 0; e < elements.size(); ++e) {
+            shouldEqual(table->find(elements[e]), e);
+            // E^1, ..., E^512
+            shouldEqual(table->getPowers(e), static_cast<Size>(10));
+            detail::Isotopes isotopes;
+            table->getIsotopes(e, isotopes);
+            shouldEqual(isotopes.size(), elements[e].size());
+            // E^(2^k) is the distribution of 2^k atoms
+            detail::Element element;
+            element.isotopes = elements[e];
+            element.count = 256.0;
+            detail::Stoichiometry s(1, element);
+            detail::Spectrum expected = m(s, 1e-20);
+            detail::Spectrum power;
+            table->getPower(e, 8, power);
+            shouldEqual(power.size(), expected.size());
+            for (Size i = 0; i < power.size(); ++i) {
+                shouldEqualTolerance(power[i].mz, expected[i].mz, 1e-8);
+                should(std::fabs(power[i].ab - expected[i].ab) < 1e-12);
+            }
+        }
+        detail::Isotopes other = elements[0];
+        other[1].ab = 0.011;
+        shouldEqual(table->find(other), table->size());
+        // a single atom needs no squaring
+        shouldEqual(m.createPowerTable(elements, 1e-20, 1)->getPowers(0),
+            static_cast<Size>(1));
+    }
+
+    void testSnapshot()
+    {
+        std::vector<detail::Isotopes> elements = createElements();
+        detail::Mercury7Impl m;
+        boost::shared_ptr<const PowerTable> table = m.createPowerTable(
+            elements, 1e-20, 4096);
+        table->save(getFilename());
+        boost::shared_ptr<const PowerTable> loaded = PowerTable::load(
+            getFilename(), elements, 1e-20);
+        shouldMatch(*table, *loaded);
+        // the snapshot is the image of the table
+        std::ifstream ifs(getFilename().c_str(), std::ios::binary);
+        ifs.seekg(0, std::ios::end);
+        shouldEqual(static_cast<Size>(ifs.tellg()), table->getBytes());
+        std::remove(getFilename().c_str());
+        // the mapping outlives the file name
+        detail::Spectrum s;
+        loaded->getPower(4, 12, s);
+        should(!s.empty());
+    }
+
+    void shouldFail(const std::vector<detail::Isotopes>& elements,
+        const Double limit)
+    {
+        bool thrown = false;
+        try {
+            PowerTable::load(getFilename(), elements, limit);
+        } catch (const RuntimeError&) {
+            thrown = true;
+        }
+        should(thrown);
+    }
+
+    void testMismatch()
+    {
+        std::vector<detail::Isotopes> elements = createElements();
+        // no file
+        shouldFail(elements, 1e-20);
+        detail::Mercury7Impl m;
+        m.createPowerTable(elements, 1e-20, 64)->save(getFilename());
+        // another limit
+        shouldFail(elements, 1e-15);
+        // other isotope tables
+        std::vector<detail::Isotopes> other = elements;
+        other[4][1].ab = 0.0075;
+        shouldFail(other, 1e-20);
+        other = elements;
+        other.pop_back();
+        shouldFail(other, 1e-20);
+        std::swap(other[0], other[1]);
+        shouldFail(other, 1e-20);
+        // truncated
+        String filename = getFilename();
+        shouldEqual(::truncate(filename.c_str(), 100), 0);
+        shouldFail(elements, 1e-20);
+        // not a power table
+        {
+            std::ofstream ofs(filename.c_str());
+            ofs << "IPACAPWT but not really a power table";
+        }
+        shouldFail(elements, 1e-20);
+        std::remove(filename.c_str());
+    }
+
+    void testMercury()
+    {
+        std::vector<detail::Isotopes> elements = createElements();
+        // a small protein and a sulfur-rich compound
+        Double protein[] = { 1000.0, 1580.0, 270.0, 300.0, 27.0 };
+        Double rich[] = { 10.0, 20.0, 0.0, 8.0, 300.0 };
+        detail::Mercury7Impl plain;
+        detail::Mercury7Impl m;
+        m.setPowerTable(plain.createPowerTable(elements, 1e-26, 1024));
+        should(m.getPowerTable() != 0);
+        for (Size c = 0; c < 2; ++c) {
+            detail::Stoichiometry s = createCompound(elements,
+                c == 0 ? protein : rich);
+            detail::Spectrum expected = plain(s);
+            detail::Spectrum actual = m(s);
+            Double sumExpected = 0.0, sumActual = 0.0;
+            for (Size i = 0; i < expected.size(); ++i) {
+                sumExpected += expected[i].ab;
+            }
+            for (Size i = 0; i < actual.size(); ++i) {
+                sumActual += actual[i].ab;
+            }
+            shouldEqualTolerance(sumActual, sumExpected, 1e-12);
+            // the routes only differ in the peaks at the limit
+            Size n = std::min(expected.size(), actual.size());
+            should(n + 4 > expected.size() && n + 4 > actual.size());
+            for (Size i = 0; i < n; ++i) {
+                shouldEqualTolerance(actual[i].mz, expected[i].mz, 1e-6);
+                should(std::fabs(actual[i].ab - expected[i].ab) < 1e-12);
+            }
+        }
+        // other limits and counts beyond the table take the planned route
+        Double large[] = { 10.0, 20.0, 0.0, 8.0, 3000.0 };
+        detail::Stoichiometry s = createCompound(elements, large);
+        for (Size c = 0; c < 2; ++c) {
+            detail::Spectrum expected = c == 0 ? plain(s) : plain(s, 1e-10);
+            detail::Spectrum actual = c == 0 ? m(s) : m(s, 1e-10);
+            shouldEqual(actual.size(), expected.size());
+            for (Size i = 0; i < actual.size(); ++i) {
+                shouldEqual(actual[i].mz, expected[i].mz);
+                shouldEqual(actual[i].ab, expected[i].ab);
+            }
+        }
+    }
+};
+
+/** The main function that runs the tests for the power tables.
+ * Under normal circumstances you need not edit this.
+ */
+int main()
+{
+    PowerTableTestSuite test;
+    int success = test.run();
+    std::cout << test.report() << std::endl;
+    return success;
+}
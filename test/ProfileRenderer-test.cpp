@@ -0,0 +1,245 @@
+/*
+ * ProfileRenderer-test.cpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/ProfileRenderer.hpp>
+#include <ipaca/Error.hpp>
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include "vigra/unittest.hxx"
+
+using namespace ipaca;
+
+/** Tests for the profile renderer in ProfileRenderer.cpp.
+ */
+struct ProfileRendererTestSuite : vigra::test_suite
+{
+    /** Constructor.
+     * The ProfileRendererTestSuite constructor adds all ProfileRenderer
+     * tests to the test suite. If you write an additional test, add the
+     * test case here.
+     */
+    ProfileRendererTestSuite() :
+        vigra::test_suite("ProfileRenderer")
+    {
+        add(testCase(&ProfileRendererTestSuite::testFwhm));
+        add(testCase(&ProfileRendererTestSuite::testGaussian));
+        add(testCase(&ProfileRendererTestSuite::testLorentzian));
+        add(testCase(&ProfileRendererTestSuite::testSortedGrid));
+        add(testCase(&ProfileRendererTestSuite::testBatch));
+    }
+
+    /** A small isotope distribution.
+     */
+    detail::Spectrum createSpectrum()
+    {
+        detail::Spectrum s;
+        Double mz[] = { 500.0, 501.003, 502.006, 499.0 + 1e-3 };
+        Double ab[] = { 0.6, 0.3, 0.1, 0.0 };
+        for (Size k = 0; k < 4; ++k) {
+            detail::SpectrumElement e;
+            e.mz = mz[k];
+            e.ab = ab[k];
+            s.push_back(e);
+        }
+        return s;
+    }
+
+    /** The peak shape, evaluated directly.
+     */
+    Double evaluate(const ProfileRenderer& r, const Double mz,
+        const Double center, const Double height)
+    {
+        Double fwhm = r.getFwhm(center);
+        Double d = mz - center;
+        if (r.getPeakShape() == ProfileRenderer::GAUSSIAN) {
+            Double sigma = fwhm / (2.0 * std::sqrt(2.0 * std::log(2.0)));
+            if (std::fabs(d) > sigma * std::sqrt(-2.0 * std::log(
+                r.getTruncation()))) {
+                return 0.0;
+            }
+            return height * std::exp(-0.5 * d * d / (sigma * sigma));
+        }
+        Double gamma = 0.5 * fwhm;
+        if (std::fabs(d) > gamma * std::sqrt(1.0 / r.getTruncation() - 1.0)) {
+            return 0.0;
+        }
+        return height * gamma * gamma / (d * d + gamma * gamma);
+    }
+
+    /** Compare a profile against the direct evaluation.
+     */
+    void shouldMatchProfile(const ProfileRenderer& r,
+        const std::vector<Double>& profile, const detail::Spectrum& s,
+        const Double intensity)
+    {
+        for (Size k = 0; k < r.size(); ++k) {
+            Double expected = 0.0;
+            for (Size j = 0; j < s.size(); ++j) {
+                expected += evaluate(r, r.getMz(k), s[j].mz, s[j].ab
+                        * intensity);
+            }
+            // grid points at the truncation boundary may differ by rounding
+            should(std::fabs(profile[k] - expected) <= 1e-9 * expected
+                    + 1.01 * r.getTruncation() * intensity);
+        }
+    }
+
+    void testFwhm()
+    {
+        ProfileRenderer r(400.0, 0.001, 10);
+        shouldEqualTolerance(r.getFwhm(600.0), 0.01, 1e-15);
+        r.setResolution(120000.0, ProfileRenderer::ORBITRAP_RESOLUTION,
+            200.0);
+        shouldEqualTolerance(r.getFwhm(200.0), 200.0 / 120000.0, 1e-15);
+        shouldEqualTolerance(r.getFwhm(800.0), 800.0 / 60000.0, 1e-15);
+        r.setResolution(0.7, ProfileRenderer::CONSTANT_WIDTH);
+        shouldEqual(r.getFwhm(1000.0), 0.7);
+        bool thrown = false;
+        try {
+            r.setTruncation(1.0);
+        } catch (PreconditionViolation&) {
+            thrown = true;
+        }
+        shouldEqual(thrown, true);
+        thrown = false;
+        try {
+            ProfileRenderer(400.0, 0.0, 10);
+        } catch (PreconditionViolation&) {
+            thrown = true;
+        }
+        shouldEqual(thrown, true);
+    }
+
+    void testGaussian()
+    {
+        detail::Spectrum s = createSpectrum();
+        ProfileRenderer r(498.0, 0.0005, 9000);
+        r.setResolution(20000.0);
+        std::vector<Double> profile(r.size(), 0.0);
+        r.render(s, &profile[0], 1000.0);
+        shouldMatchProfile(r, profile, s, 1000.0);
+        // the apex height is the abundance
+        Size apex = static_cast<Size>((500.0 - 498.0) / 0.0005 + 0.5);
+        shouldEqualTolerance(profile[apex], 600.0, 1e-6);
+        // the FWHM of the rendered peak
+        Size k = apex;
+        while (profile[k] > 300.0) {
+            ++k;
+        }
+        Double halfWidth = r.getMz(k) - 500.0;
+        should(std::fabs(2.0 * halfWidth - r.getFwhm(500.0)) < 2 * 0.0005);
+        // the kernel is truncated
+        Size far = static_cast<Size>((500.5 - 498.0) / 0.0005);
+        shouldEqual(profile[far], 0.0);
+        // peaks at the edges of the grid are clipped
+        ProfileRenderer edge(500.0, 0.0005, 100);
+        edge.setResolution(20000.0);
+        std::vector<Double> clipped(edge.size(), 0.0);
+        clipped.push_back(-1.0);
+        edge.render(s, &clipped[0]);
+        shouldEqualTolerance(clipped[0], 0.6, 1e-12);
+        shouldEqual(clipped[edge.size()], -1.0);
+        // sparse grids with narrow peaks
+        ProfileRenderer sparse(490.0, 0.5, 40);
+        std::vector<Double> sp(sparse.size(), 0.0);
+        sparse.render(s, &sp[0]);
+        shouldMatchProfile(sparse, sp, s, 1.0);
+    }
+
+    void testLorentzian()
+    {
+        detail::Spectrum s = createSpectrum();
+        ProfileRenderer r(498.0, 0.0005, 9000);
+        r.setPeakShape(ProfileRenderer::LORENTZIAN);
+        r.setResolution(40000.0, ProfileRenderer::ORBITRAP_RESOLUTION);
+        r.setTruncation(1e-4);
+        std::vector<Double> profile(r.size(), 0.0);
+        r.render(s, &profile[0], 10.0);
+        shouldMatchProfile(r, profile, s, 10.0);
+        Size apex = static_cast<Size>((500.0 - 498.0) / 0.0005 + 0.5);
+        shouldEqualTolerance(profile[apex], 6.0, 1e-3);
+    }
+
+    void testSortedGrid()
+    {
+        detail::Spectrum s = createSpectrum();
+        // a uniform grid given explicitly renders the same profile
+        ProfileRenderer uniform(498.0, 0.001, 5000);
+        std::vector<Double> grid(uniform.size());
+        for (Size k = 0; k < grid.size(); ++k) {
+            grid[k] = uniform.getMz(k);
+        }
+        ProfileRenderer sorted(grid);
+        uniform.setResolution(30000.0);
+        sorted.setResolution(30000.0);
+        std::vector<Double> p1(grid.size(), 0.0), p2(grid.size(), 0.0);
+        uniform.render(s, &p1[0]);
+        sorted.render(s, &p2[0]);
+        for (Size k = 0; k < grid.size(); ++k) {
+            shouldEqualTolerance(p1[k], p2[k], 1e-10);
+        }
+        // a non-uniform grid
+        std::vector<Double> g2;
+        for (Double mz = 499.5; mz < 502.5; mz += 0.0001 * (1.0 + (mz
+                - 499.5))) {
+            g2.push_back(mz);
+        }
+        ProfileRenderer nonUniform(g2);
+        nonUniform.setResolution(30000.0);
+        std::vector<Double> p3(g2.size(), 0.0);
+        nonUniform.render(s, &p3[0], 2.0);
+        shouldMatchProfile(nonUniform, p3, s, 2.0);
+        bool thrown = false;
+        try {
+            std::swap(g2[0], g2[1]);
+            ProfileRenderer unsorted(g2);
+        } catch (PreconditionViolation&) {
+            thrown = true;
+        }
+        shouldEqual(thrown, true);
+    }
+
+    void testBatch()
+    {
+        ProfileRenderer r(498.0, 0.001, 5000);
+        std::vector<detail::Spectrum> spectra(3, createSpectrum());
+        spectra[1][0].mz += 0.5;
+        spectra[2].clear();
+        Double intensities[] = { 1.0, 2.0, 3.0 };
+        Size stride = r.size() + 3;
+        std::vector<Double> buffers(3 * stride, 0.0);
+        r.render(spectra, &buffers[0], stride, intensities);
+        for (Size b = 0; b < 3; ++b) {
+            std::vector<Double> single(r.size(), 0.0);
+            r.render(spectra[b], &single[0], intensities[b]);
+            for (Size k = 0; k < r.size(); ++k) {
+                shouldEqual(buffers[b * stride + k], single[k]);
+            }
+            for (Size k = r.size(); k < stride; ++k) {
+                shouldEqual(buffers[b * stride + k], 0.0);
+            }
+        }
+        // rendering accumulates
+        std::vector<Double> twice(r.size(), 0.0);
+        r.render(spectra[0], &twice[0]);
+        r.render(spectra[0], &twice[0]);
+        for (Size k = 0; k < r.size(); ++k) {
+            shouldEqualTolerance(twice[k], 2.0 * buffers[k], 1e-12);
+        }
+    }
+};
+
+/** The main function that runs the tests for the profile renderer.
+ * Under normal circumstances you need not edit this.
+ */
+int main()
+{
+    ProfileRendererTestSuite test;
+    int success = test.run();
+    std::cout << test.report() << std::endl;
+    return success;
+}
@@ -0,0 +1,172 @@
+/*
+ * PrunePolicy-test.cpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/PrunePolicy.hpp>
+#include <ipaca/Error.hpp>
+#include <iostream>
+#include "vigra/unittest.hxx"
+
+using namespace ipaca;
+
+/** Tests for all prune policies in PrunePolicy.cpp.
+ */
+struct PrunePolicyTestSuite : vigra::test_suite
+{
+    /** Constructor.
+     * The PrunePolicyTestSuite constructor adds all PrunePolicy tests to
+     * the test suite. If you write an additional test, add the test
+     * case here.
+     */
+    PrunePolicyTestSuite() :
+        vigra::test_suite("PrunePolicy")
+    {
+        add(testCase(&PrunePolicyTestSuite::testAbsoluteLimit));
+        add(testCase(&PrunePolicyTestSuite::testRelativeLimit));
+        add(testCase(&PrunePolicyTestSuite::testCoverage));
+        add(testCase(&PrunePolicyTestSuite::testErrorBudget));
+        add(testCase(&PrunePolicyTestSuite::testParameters));
+    }
+
+    /** Generates the spectrum [ 0.01 0.1 0.5 0.3 0.09 ].
+     */
+    detail::Spectrum createSpectrum()
+    {
+        detail::Spectrum s;
+        detail::SpectrumElement e;
+        Double freqs[] = { 0.01, 0.1, 0.5, 0.3, 0.09 };
+        for (Size k = 0; k < 5; ++k) {
+            e.mz = 1.0 + static_cast<Double>(k);
+            e.ab = freqs[k];
+            s.push_back(e);
+        }
+        return s;
+    }
+
+    void testAbsoluteLimit()
+    {
+        detail::Spectrum s = createSpectrum();
+        Size first, last;
+        AbsoluteLimitPrunePolicy p(0.05);
+        p(s, 1.0, first, last);
+        shouldEqual(first, static_cast<Size>(1));
+        shouldEqual(last, static_cast<Size>(5));
+        // also tests < vs <=
+        AbsoluteLimitPrunePolicy q(0.1);
+        q(s, 1.0, first, last);
+        shouldEqual(first, static_cast<Size>(2));
+        shouldEqual(last, static_cast<Size>(4));
+        // prune everything
+        AbsoluteLimitPrunePolicy r(1.0);
+        r(s, 1.0, first, last);
+        shouldEqual(first, last);
+        // empty spectrum
+        detail::Spectrum empty;
+        p(empty, 1.0, first, last);
+        shouldEqual(first, static_cast<Size>(0));
+        shouldEqual(last, static_cast<Size>(0));
+    }
+
+    void testRelativeLimit()
+    {
+        detail::Spectrum s = createSpectrum();
+        Size first, last;
+        // 0.2 * 0.5 = 0.1
+        RelativeLimitPrunePolicy p(0.2);
+        p(s, 1.0, first, last);
+        shouldEqual(first, static_cast<Size>(2));
+        shouldEqual(last, static_cast<Size>(4));
+        // the result must not depend on the scale of the abundances
+        for (Size k = 0; k < s.size(); ++k) {
+            s[k].ab *= 1e-6;
+        }
+        p(s, 1.0, first, last);
+        shouldEqual(first, static_cast<Size>(2));
+        shouldEqual(last, static_cast<Size>(4));
+    }
+
+    void testCoverage()
+    {
+        detail::Spectrum s = createSpectrum();
+        Size first, last;
+        // keep everything
+        CoveragePrunePolicy p(1.0);
+        p(s, 1.0, first, last);
+        shouldEqual(first, static_cast<Size>(0));
+        shouldEqual(last, static_cast<Size>(5));
+        // may discard 0.11; drops 0.01 first, then 0.09
+        CoveragePrunePolicy q(0.89);
+        q(s, 1.0, first, last);
+        shouldEqual(first, static_cast<Size>(1));
+        shouldEqual(last, static_cast<Size>(4));
+        // may discard 0.05; drops 0.01 only
+        CoveragePrunePolicy r(0.95);
+        r(s, 1.0, first, last);
+        shouldEqual(first, static_cast<Size>(1));
+        shouldEqual(last, static_cast<Size>(5));
+    }
+
+    void testErrorBudget()
+    {
+        detail::Spectrum s = createSpectrum();
+        Size first, last;
+        ErrorBudgetPrunePolicy p(0.25);
+        // the full budget allows to discard 0.25
+        p(s, 1.0, first, last);
+        shouldEqual(first, static_cast<Size>(2));
+        shouldEqual(last, static_cast<Size>(4));
+        // half of the budget allows to discard 0.125
+        p(s, 0.5, first, last);
+        shouldEqual(first, static_cast<Size>(1));
+        shouldEqual(last, static_cast<Size>(4));
+        // no share, no pruning
+        p(s, 0.0, first, last);
+        shouldEqual(first, static_cast<Size>(0));
+        shouldEqual(last, static_cast<Size>(5));
+    }
+
+    void testParameters()
+    {
+        bool thrown = false;
+        try {
+            AbsoluteLimitPrunePolicy p(0.0);
+        } catch (PreconditionViolation&) {
+            thrown = true;
+        }
+        shouldEqual(thrown, true);
+        thrown = false;
+        try {
+            RelativeLimitPrunePolicy p(1.0);
+        } catch (PreconditionViolation&) {
+            thrown = true;
+        }
+        shouldEqual(thrown, true);
+        thrown = false;
+        try {
+            CoveragePrunePolicy p(0.0);
+        } catch (PreconditionViolation&) {
+            thrown = true;
+        }
+        shouldEqual(thrown, true);
+        thrown = false;
+        try {
+            ErrorBudgetPrunePolicy p(-1.0);
+        } catch (PreconditionViolation&) {
+            thrown = true;
+        }
+        shouldEqual(thrown, true);
+    }
+};
+
+/** The main function that runs the tests for the prune policies.
+ * Under normal circumstances you need not edit this.
+ */
+int main()
+{
+    PrunePolicyTestSuite test;
+    int success = test.run();
+    std::cout << test.report() << std::endl;
+    return success;
+}
@@ -0,0 +1,383 @@
+/*
+ * SharedPatternCache-test.cpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+#include <ipaca/SharedPatternCache.hpp>
+#include <ipaca/Mercury7Impl.hpp>
+#include <ipaca/Error.hpp>
+#include <boost/shared_ptr.hpp>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "TestElements.hpp"
+#include "vigra/unittest.hxx"
+
+using namespace ipaca;
+
+/** Counts the hits of another cache.
+ */
+struct CountingCache : PatternCache
+{
+    CountingCache(const boost::shared_ptr<PatternCache>& cache) :
+        cache_(cache), hits(0)
+    {
+    }
+
+    Bool find(const std::string& key, detail::Spectrum& spectrum) const
+    {
+        Bool found = cache_->find(key, spectrum);
+        hits += found;
+        return found;
+    }
+
+    void insert(const std::string& key, const detail::Spectrum& spectrum)
+    {
+        cache_->insert(key, spectrum);
+    }
+
+    boost::shared_ptr<PatternCache> cache_;
+    mutable Size hits;
+};
+
+/** Tests for the shared memory pattern cache in SharedPatternCache.cpp and
+ * its use by Mercury7Impl.
+ */
+struct SharedPatternCacheTestSuite : vigra::test_suite
+{
+    /** Constructor.
+     * The SharedPatternCacheTestSuite constructor adds all
+     * SharedPatternCache tests to the test suite. If you write an
+     * additional test, add the test case here.
+     */
+    SharedPatternCacheTestSuite() :
+        vigra::test_suite("SharedPatternCache")
+    {
+        add(testCase(&SharedPatternCacheTestSuite::testInsertFind));
+        add(testCase(&SharedPatternCacheTestSuite::testLimits));
+        add(testCase(&SharedPatternCacheTestSuite::testEviction));
+        add(testCase(&SharedPatternCacheTestSuite::testGeometry));
+        add(testCase(&SharedPatternCacheTestSuite::testProcesses));
+        add(testCase(&SharedPatternCacheTestSuite::testConcurrency));
+        add(testCase(&SharedPatternCacheTestSuite::testVaryingPeaks));
+        add(testCase(&SharedPatternCacheTestSuite::testMercury));
+    }
+
+    String getName()
+    {
+        std::ostringstream os;
+        os << "/ipaca-test-" << ::getpid();
+        return os.str();
+    }
+
+    String getKey(const Size k)
+    {
+        std::ostringstream os;
+        os << "key-" << k;
+        return os.str();
+    }
+
+    /** A spectrum that is derived from \a k, to detect torn reads.
+     */
+    detail::Spectrum getSpectrum(const Size k, const Size n)
+    {
+        detail::Spectrum s(n);
+        for (Size i = 0; i < n; ++i) {
+            s[i].mz = 100.0 * static_cast<Double>(k) + static_cast<Double>(i);
+            s[i].ab = 1.0 / (static_cast<Double>(k + i) + 1.0);
+        }
+        return s;
+    }
+
+    void shouldMatch(const detail::Spectrum& s, const detail::Spectrum& t)
+    {
+        shouldEqual(s.size(), t.size());
+        for (Size i = 0; i < s.size(); ++i) {
+            shouldEqual(s[i].mz, t[i].mz);
+            shouldEqual(s[i].ab, t[i].ab);
+        }
+    }
+
+    void testInsertFind()
+    {
+        SharedPatternCache::remove(getName());
+        {
+            SharedPatternCache cache(getName(), 100, 8, 30);
+            shouldEqual(cache.getSlots(), static_cast<Size>(128));
+            shouldEqual(cache.getMaxPeaks(), static_cast<Size>(8));
+            shouldEqual(cache.getMaxKey(), static_cast<Size>(32));
+            detail::Spectrum s;
+            should(!cache.find(getKey(1), s));
+            for (Size k = 0; k < 50; ++k) {
+                cache.insert(getKey(k), getSpectrum(k, k % 9));
+            }
+            for (Size k = 0; k < 50; ++k) {
+                should(cache.find(getKey(k), s));
+                shouldMatch(s, getSpectrum(k, k % 9));
+            }
+            should(!cache.find(getKey(50), s));
+            shouldEqual(s.size(), static_cast<Size>(0));
+            // existing entries are kept
+            cache.insert(getKey(3), getSpectrum(4, 3));
+            should(cache.find(getKey(3), s));
+            shouldMatch(s, getSpectrum(3, 3));
+            cache.clear();
+            should(!cache.find(getKey(3), s));
+        }
+        SharedPatternCache::remove(getName());
+    }
+
+    void testLimits()
+    {
+        SharedPatternCache::remove(getName());
+        {
+            SharedPatternCache cache(getName(), 16, 4, 8);
+            detail::Spectrum s;
+            cache.insert("long key!", getSpectrum(1, 1));
+            should(!cache.find("long key!", s));
+            cache.insert("key", getSpectrum(1, 5));
+            should(!cache.find("key", s));
+            cache.insert("key", getSpectrum(1, 4));
+            should(cache.find("key", s));
+        }
+        SharedPatternCache::remove(getName());
+        bool thrown = false;
+        try {
+            SharedPatternCache cache("no-slash");
+        } catch (const PreconditionViolation&) {
+            thrown = true;
+        }
+        should(thrown);
+    }
+
+    void testEviction()
+    {
+        SharedPatternCache::remove(getName());
+        {
+            SharedPatternCache cache(getName(), 4, 2, 16);
+            for (Size k = 0; k < 100; ++k) {
+                cache.insert(getKey(k), getSpectrum(k, 2));
+            }
+            // the most recent entry survives; only 4 can
+            detail::Spectrum s;
+            should(cache.find(getKey(99), s));
+            shouldMatch(s, getSpectrum(99, 2));
+            Size found = 0;
+            for (Size k = 0; k < 100; ++k) {
+                if (cache.find(getKey(k), s)) {
+                    shouldMatch(s, getSpectrum(k, 2));
+                    ++found;
+                }
+            }
+            shouldEqual(found, static_cast<Size>(4));
+        }
+        SharedPatternCache::remove(getName());
+    }
+
+    void testGeometry()
+    {
+        SharedPatternCache::remove(getName());
+        {
+            SharedPatternCache a(getName(), 32, 4, 16);
+            SharedPatternCache b(getName());
+            shouldEqual(b.getSlots(), static_cast<Size>(32));
+            shouldEqual(b.getMaxPeaks(), static_cast<Size>(4));
+            shouldEqual(b.getMaxKey(), static_cast<Size>(16));
+            a.insert("a", getSpectrum(1, 4));
+            detail::Spectrum s;
+            should(b.find("a", s));
+            shouldMatch(s, getSpectrum(1, 4));
+        }
+        SharedPatternCache::remove(getName());
+    }
+
+    void testProcesses()
+    {
+        SharedPatternCache::remove(getName());
+        {
+            const String name = getName();
+            SharedPatternCache cache(name, 256, 8, 32);
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                SharedPatternCache child(name);
+                for (Size k = 0; k < 100; ++k) {
+                    child.insert(getKey(k), getSpectrum(k, 8));
+                }
+                ::_exit(0);
+            }
+            int status = 0;
+            ::waitpid(pid, &status, 0);
+            shouldEqual(status, 0);
+            detail::Spectrum s;
+            for (Size k = 0; k < 100; ++k) {
+                should(cache.find(getKey(k), s));
+                shouldMatch(s, getSpectrum(k, 8));
+            }
+        }
+        SharedPatternCache::remove(getName());
+    }
+
+    void testConcurrency()
+    {
+        SharedPatternCache::remove(getName());
+        {
+            // a small table, such that writers keep evicting each other
+            const String name = getName();
+            SharedPatternCache cache(name, 16, 32, 16);
+            const Size processes = 4;
+            std::vector<pid_t> pids;
+            for (Size p = 0; p < processes; ++p) {
+                pid_t pid = ::fork();
+                if (pid == 0) {
+                    SharedPatternCache c(name);
+                    detail::Spectrum s;
+                    int torn = 0;
+                    for (Size i = 0; i < 20000; ++i) {
+                        Size k = (i * 7 + p * 13) % 64;
+                        if (p % 2 == 0) {
+                            c.insert(getKey(k), getSpectrum(k, 32));
+                        } else if (c.find(getKey(k), s)) {
+                            detail::Spectrum e = getSpectrum(k, 32);
+                            for (Size j = 0; j < s.size(); ++j) {
+                                if (s[j].mz != e[j].mz || s[j].ab != e[j].ab) {
+                                    ++torn;
+                                }
+                            }
+                            torn += s.size() != e.size();
+                        }
+                    }
+                    ::_exit(torn == 0 ? 0 : 1);
+                }
+                pids.push_back(pid);
+            }
+            for (Size p = 0; p < processes; ++p) {
+                int status = 0;
+                ::waitpid(pids[p], &status, 0);
+                shouldEqual(status, 0);
+            }
+        }
+        SharedPatternCache::remove(getName());
+    }
+
+    void testVaryingPeaks()
+    {
+        SharedPatternCache::remove(getName());
+        {
+            // writers store each key with a different number of peaks
+            const String name = getName();
+            SharedPatternCache cache(name, 8, 32, 16);
+            const Size processes = 4;
+            std::vector<pid_t> pids;
+            for (Size p = 0; p < processes; ++p) {
+                pid_t pid = ::fork();
+                if (pid == 0) {
+                    SharedPatternCache c(name);
+                    detail::Spectrum s;
+                    int torn = 0;
+                    for (Size i = 0; i < 20000; ++i) {
+                        Size k = (i * 5 + p * 11) % 32;
+                        if (p % 2 == 0) {
+                            c.insert(getKey(k), getSpectrum(k,
+                                (i + k) % 33));
+                        } else if (c.find(getKey(k), s)) {
+                            torn += s.size() > c.getMaxPeaks();
+                            detail::Spectrum e = getSpectrum(k, s.size());
+                            for (Size j = 0; j < s.size(); ++j) {
+                                if (s[j].mz != e[j].mz || s[j].ab != e[j].ab) {
+                                    ++torn;
+                                }
+                            }
+                        }
+                    }
+                    ::_exit(torn == 0 ? 0 : 1);
+                }
+                pids.push_back(pid);
+            }
+            for (Size p = 0; p < processes; ++p) {
+                int status = 0;
+                ::waitpid(pids[p], &status, 0);
+                shouldEqual(status, 0);
+            }
+        }
+        SharedPatternCache::remove(getName());
+    }
+
+    void testMercury()
+    {
+        detail::Stoichiometry glucose = test::createCompound(6.0, 12.0, 6.0);
+        // the same compound, reordered and split
+        detail::Stoichiometry other;
+        other.push_back(test::createOxygen(6.0));
+        other.push_back(test::createHydrogen(5.0));
+        other.push_back(test::createCarbon(6.0));
+        other.push_back(test::createHydrogen(7.0));
+
+        SharedPatternCache::remove(getName());
+        {
+            boost::shared_ptr<SharedPatternCache> shared(
+                new SharedPatternCache(getName(), 64, 64, 256));
+            boost::shared_ptr<CountingCache> cache(new CountingCache(shared));
+            detail::Mercury7Impl plain;
+            detail::Mercury7Impl m;
+            m.setPatternCache(cache);
+            should(m.getPatternCache() == cache);
+            detail::Spectrum expected = plain(glucose);
+            shouldMatch(m(glucose), expected);
+            shouldEqual(cache->hits, static_cast<Size>(0));
+            shouldMatch(m(glucose), expected);
+            shouldEqual(cache->hits, static_cast<Size>(1));
+            // the key is canonical
+            shouldMatch(m(other), expected);
+            shouldEqual(cache->hits, static_cast<Size>(2));
+            // fractional atoms are not merged
+            detail::Stoichiometry whole, halves;
+            whole.push_back(test::createCarbon(3.0));
+            halves.push_back(test::createCarbon(1.5));
+            halves.push_back(test::createCarbon(1.5));
+            std::string wholeKey, halvesKey;
+            detail::appendCanonicalStoichiometry(whole, wholeKey);
+            detail::appendCanonicalStoichiometry(halves, halvesKey);
+            should(wholeKey != halvesKey);
+            detail::Spectrum wholeSpectrum = m(whole);
+            detail::Spectrum halvesSpectrum = m(halves);
+            shouldEqual(cache->hits, static_cast<Size>(2));
+            shouldMatch(wholeSpectrum, plain(whole));
+            shouldMatch(halvesSpectrum, plain(halves));
+            should(halvesSpectrum.size() != wholeSpectrum.size());
+            // another calculator, e.g. in another process
+            detail::Mercury7Impl n;
+            n.setPatternCache(boost::shared_ptr<PatternCache>(
+                new SharedPatternCache(getName())));
+            shouldMatch(n(other), expected);
+            // other settings are cached separately
+            shouldMatch(m(glucose, 1e-10), plain(glucose, 1e-10));
+            m.setOutputMode(OutputMode::topK(2));
+            shouldEqual(m(glucose).size(), static_cast<Size>(2));
+            shouldEqual(cache->hits, static_cast<Size>(2));
+            // relative limits and discarded abundances bypass the cache
+            Double discarded = 0.0;
+            m.setOutputMode(OutputMode());
+            m(glucose, AbsoluteLimitPrunePolicy(), &discarded);
+            m(glucose, RelativeLimitPrunePolicy(1e-10));
+            shouldEqual(cache->hits, static_cast<Size>(2));
+            m(glucose, AbsoluteLimitPrunePolicy());
+            shouldEqual(cache->hits, static_cast<Size>(3));
+        }
+        SharedPatternCache::remove(getName());
+    }
+};
+
+/** The main function that runs the tests for the shared pattern cache.
+ * Under normal circumstances you need not edit this.
+ */
+int main()
+{
+    SharedPatternCacheTestSuite test;
+    int success = test.run();
+    std::cout << test.report() << std::endl;
+    return success;
+}
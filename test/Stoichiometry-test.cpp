@@ -24,6 +24,7 @@ struct StoichiometryTestSuite : vigra::test_suite
     {
         add(testCase(&StoichiometryTestSuite::testIsPlausibleStoichiometry));
         add(testCase(&StoichiometryTestSuite::testSplitStoichiometry));
+        add(testCase(&StoichiometryTestSuite::testFractionalAtom));
     }
 
     detail::Stoichiometry createH2O()
@@ -98,6 +99,28 @@ struct StoichiometryTestSuite : vigra::test_suite
             shouldEqual(s[1].isotopes[k].ab, f[1].isotopes[k].ab);
         }
     }
+
+    void testFractionalAtom()
+    {
+        detail::Stoichiometry s = createH2O();
+        const detail::Isotopes& o = s[1].isotopes;
+        detail::Isotopes esa;
+        detail::fractionalAtom(o, 0.25, esa);
+        shouldEqual(esa.size(), o.size());
+        shouldEqualTolerance(esa[0].mz, 0.25 * o[0].mz, 1e-12);
+        shouldEqualTolerance(esa[0].ab, 0.75 + 0.25 * o[0].ab, 1e-12);
+        Double total = 0.0;
+        for (size_t k = 0; k < esa.size(); ++k) {
+            total += esa[k].ab;
+            if (k > 0) {
+                // the mass differences of the isotopes are kept
+                shouldEqualTolerance(esa[k].mz - esa[0].mz,
+                    o[k].mz - o[0].mz, 1e-12);
+                shouldEqualTolerance(esa[k].ab, 0.25 * o[k].ab, 1e-12);
+            }
+        }
+        shouldEqualTolerance(total, 1.0, 1e-12);
+    }
 };
 
 /** The main function that runs the tests for class Stoichiometry.
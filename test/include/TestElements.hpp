@@ -0,0 +1,117 @@
+/*
+ * TestElements.hpp
+ *
+ * Copyright (c) 2012 Marc Kirchner
+ *
+ */
+
+#ifndef __LIBIPACA_TEST_INCLUDE_TESTELEMENTS_HPP__
+#define __LIBIPACA_TEST_INCLUDE_TESTELEMENTS_HPP__
+
+#include <ipaca/Stoichiometry.hpp>
+#include <ipaca/Types.hpp>
+
+namespace ipaca {
+
+/*
+ * Isotope tables and compounds shared by the test suites.
+ */
+namespace test {
+
+/** Create an element from its isotope table.
+ * @param masses The isotope masses, lightest first.
+ * @param freqs The isotope abundances.
+ * @param n The number of isotopes.
+ * @param count The number of atoms.
+ */
+inline detail::Element createElement(const Double* masses,
+    const Double* freqs, const Size n, const Double count)
+{
+    detail::Element e;
+    for (Size k = 0; k < n; ++k) {
+        detail::Isotope i;
+        i.mz = masses[k];
+        i.ab = freqs[k];
+        e.isotopes.push_back(i);
+    }
+    e.count = count;
+    return e;
+}
+
+inline detail::Element createCarbon(const Double count)
+{
+    Double masses[] = { 12.0, 13.0033548378 };
+    Double freqs[] = { 0.9893, 0.0107 };
+    return createElement(masses, freqs, 2, count);
+}
+
+inline detail::Element createHydrogen(const Double count)
+{
+    Double masses[] = { 1.0078250321, 2.0141017780 };
+    Double freqs[] = { 0.999885, 0.000115 };
+    return createElement(masses, freqs, 2, count);
+}
+
+inline detail::Element createNitrogen(const Double count)
+{
+    Double masses[] = { 14.0030740052, 15.0001088984 };
+    Double freqs[] = { 0.99632, 0.00368 };
+    return createElement(masses, freqs, 2, count);
+}
+
+inline detail::Element createOxygen(const Double count)
+{
+    Double masses[] = { 15.9949146221, 16.9991315, 17.9991604 };
+    Double freqs[] = { 0.99757, 0.00038, 0.00205 };
+    return createElement(masses, freqs, 3, count);
+}
+
+inline detail::Element createPhosphorus(const Double count)
+{
+    Double masses[] = { 30.97376151 };
+    Double freqs[] = { 1.0 };
+    return createElement(masses, freqs, 1, count);
+}
+
+/** Sulfur has no isotope at nominal mass 35; the isotope table holds a
+ * placeholder with zero abundance.
+ */
+inline detail::Element createSulfur(const Double count)
+{
+    Double masses[] = { 31.97207069, 32.97145850, 33.96786683, 34.0,
+            35.96708088 };
+    Double freqs[] = { 0.9493, 0.0076, 0.0429, 0.0, 0.0002 };
+    return createElement(masses, freqs, 5, count);
+}
+
+/** C_c H_h O_o.
+ */
+inline detail::Stoichiometry createCompound(const Double c, const Double h,
+    const Double o)
+{
+    detail::Stoichiometry s;
+    s.push_back(createCarbon(c));
+    s.push_back(createHydrogen(h));
+    s.push_back(createOxygen(o));
+    return s;
+}
+
+/** C_c H_h N_n O_o S_s.
+ */
+inline detail::Stoichiometry createCompound(const Double c, const Double h,
+    const Double n, const Double o, const Double s)
+{
+    detail::Stoichiometry st;
+    st.push_back(createCarbon(c));
+    st.push_back(createHydrogen(h));
+    st.push_back(createNitrogen(n));
+    st.push_back(createOxygen(o));
+    st.push_back(createSulfur(s));
+    return st;
+}
+
+} // namespace test
+
+} // namespace ipaca
+
+#endif /* __LIBIPACA_TEST_INCLUDE_TESTELEMENTS_HPP__ */